@@ -243,18 +243,16 @@ int main(int argc, char** argv)
   problem.mask.at(6) = { 0, 1, 2 };
   problem.mask.at(7) = { 0, 1, 2 };
 
-  // Set up the Ceres optimization parameters
-  ceres::Solver::Options options;
-  options.max_num_iterations = 500;
-  options.num_threads = 4;
-  options.minimizer_progress_to_stdout = true;
-  options.use_nonmonotonic_steps = true;
+  // Set up the Ceres optimization parameters; the linear solver and number of threads are chosen automatically
+  problem.solver_options.max_num_iterations = 500;
+  problem.solver_options.minimizer_progress_to_stdout = true;
+  problem.solver_options.use_nonmonotonic_steps = true;
 
   // Run the calibration
   std::cout << "Starting kinematic calibration optimization..." << std::endl;
   Stats cal_stats_optimal_dh;
   {
-    KinematicCalibrationResult result = optimize(problem, 100.0, options);
+    KinematicCalibrationResult result = optimize(problem, 100.0);
     printResults(result);
 
     //  test(problem.camera_chain, problem.target_chain, result, measurement_sets.second);
@@ -275,7 +273,7 @@ int main(int argc, char** argv)
       problem.mask.at(1) = createDHMask(mask);
     }
 
-    KinematicCalibrationResult result = optimize(problem, 100.0, options);
+    KinematicCalibrationResult result = optimize(problem, 100.0);
     printResults(result);
 
     // Compare the results of this optimization with the measurements using the measured joints and nominal kinematic chain
@@ -6,6 +6,7 @@
 #include <rct_ros_tools/loader_utils.h>
 // The calibration function for 'moving camera' on robot wrist
 #include <rct_optimizations/extrinsic_hand_eye.h>
+#include <rct_optimizations/extrinsic_hand_eye_initialization.h>
 #include <rct_optimizations/serialization/problems.h>
 #include <rct_optimizations/validation/homography_validation.h>
 // Calibration analysis
@@ -66,8 +67,9 @@ int main(int argc, char** argv)
     problem.intr = intr;  // Set the camera properties
 
     // Our 'base to camera guess': A camera off to the side, looking at a point centered in front of the robot
-    problem.target_mount_to_target_guess = loadPose(pnh, "base_to_target_guess");
-    problem.camera_mount_to_camera_guess = loadPose(pnh, "wrist_to_camera_guess");
+    // If the guesses are not provided, they are estimated in closed form from the observations
+    const bool guesses_provided = loadPose(pnh, "base_to_target_guess", problem.target_mount_to_target_guess) &&
+                                  loadPose(pnh, "wrist_to_camera_guess", problem.camera_mount_to_camera_guess);
 
     // Create a named OpenCV window for viewing the images
     cv::namedWindow(WINDOW, cv::WINDOW_NORMAL);
@@ -127,6 +129,12 @@ int main(int argc, char** argv)
       }
     }
 
+    if (!guesses_provided)
+    {
+      ROS_INFO_STREAM("Initial guesses not provided; estimating them from the observations");
+      initializeGuesses(problem);
+    }
+
     // Now we have a defined problem, run optimization:
     ExtrinsicHandEyeResult opt_result = optimize(problem);
 
@@ -138,11 +138,12 @@ int main(int argc, char** argv)
 
     // Also try the OpenCV cameraCalibrate function
     printTitle("OpenCV Calibration");
-    opencvCameraCalibration(problem_def.image_observations, data_set.images.front().size(),
-                            problem_def.intrinsics_guess);
+    opencvCameraCalibration(problem_def.image_observations, data_set.images.front().size(), intr);
 
     // Run optimization
     auto opt_result = optimize(problem_def);
+    for (std::size_t i : opt_result.failed_observation_sets)
+      ROS_WARN_STREAM("Observation set " << i << ": failed to estimate the target pose; excluded from the calibration");
 
     // Report results
     printTitle("Calibration Complete");
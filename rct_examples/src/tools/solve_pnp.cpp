@@ -103,13 +103,10 @@ int main(int argc, char** argv)
     // Solve with OpenCV
     solveCVPnP(intr, target_finder->target().createCorrespondences(target_features));
 
-    // Solve with some native RCT function (for learning)
-    Eigen::Isometry3d guess = Eigen::Isometry3d::Identity();
-    guess = guess * Eigen::Translation3d(0, 0, 0.1) * Eigen::AngleAxisd(M_PI, Eigen::Vector3d::UnitX());
-
+    // Solve with some native RCT function (for learning), starting from the closed-form pose of the planar target
     PnPProblem params;
     params.intr = intr;
-    params.camera_to_target_guess = guess;
+    params.use_closed_form_guess = true;
     params.correspondences = target_finder->target().createCorrespondences(target_features);
 
     PnPResult pnp_result = optimize(params);
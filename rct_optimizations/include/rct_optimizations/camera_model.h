@@ -0,0 +1,195 @@
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <string>
+
+namespace rct_optimizations
+{
+/**
+ * Compile-time camera model policies for use in cost functors.
+ *
+ * A camera model projects a point in the camera frame into the image by normalizing it onto the plane z = 1, applying a
+ * lens distortion model to the normalized coordinates, and scaling the result by the pin-hole intrinsics:
+ *
+ *   u = fx * x_d + cx
+ *   v = fy * y_d + cy
+ *
+ * The distortion model is a policy class with a static number of parameters, so cost functors that are templated on the
+ * camera model have fixed parameter block sizes and the distortion terms of @ref PinholeModel compile away entirely.
+ * The intrinsic parameters are ordered [fx, fy, cx, cy] (as in @ref CameraIntrinsics), and the distortion parameters are
+ * ordered as documented by each distortion policy. The parameter type P may differ from the point type T, which allows
+ * constant (double) parameters to be used with points of type ceres::Jet without promoting the parameters.
+ */
+
+/**
+ * @brief No lens distortion
+ */
+struct NoDistortion
+{
+  static constexpr std::size_t NUM_PARAMS = 0;
+
+  static std::array<std::string, NUM_PARAMS> labels() { return {}; }
+
+  template<typename P, typename T>
+  static void distort(const P* const, const T& x, const T& y, T& x_d, T& y_d)
+  {
+    x_d = x;
+    y_d = y;
+  }
+};
+
+/**
+ * @brief Brown-Conrady radial and tangential distortion (the OpenCV "plumb bob" model), with parameters [k1, k2, p1, p2, k3]
+ */
+struct RadialTangentialDistortion
+{
+  static constexpr std::size_t NUM_PARAMS = 5;
+
+  static std::array<std::string, NUM_PARAMS> labels() { return {{"k1", "k2", "p1", "p2", "k3"}}; }
+
+  template<typename P, typename T>
+  static void distort(const P* const d, const T& x, const T& y, T& x_d, T& y_d)
+  {
+    const T x2 = x * x;
+    const T y2 = y * y;
+    const T xy = x * y;
+    const T r2 = x2 + y2;
+    const T radial = T(1.0) + r2 * (d[0] + r2 * (d[1] + r2 * d[4]));
+
+    x_d = x * radial + d[2] * T(2.0) * xy + d[3] * (r2 + T(2.0) * x2);
+    y_d = y * radial + d[2] * (r2 + T(2.0) * y2) + d[3] * T(2.0) * xy;
+  }
+};
+
+/**
+ * @brief Equidistant fisheye distortion (Kannala-Brandt, the OpenCV fisheye model), with parameters [k1, k2, k3, k4]:
+ *
+ *   theta_d = theta * (1 + k1 * theta^2 + k2 * theta^4 + k3 * theta^6 + k4 * theta^8)
+ *
+ * where theta is the angle between the point and the optical axis
+ */
+struct FisheyeDistortion
+{
+  static constexpr std::size_t NUM_PARAMS = 4;
+
+  static std::array<std::string, NUM_PARAMS> labels() { return {{"k1", "k2", "k3", "k4"}}; }
+
+  template<typename P, typename T>
+  static void distort(const P* const d, const T& x, const T& y, T& x_d, T& y_d)
+  {
+    using std::atan;
+    using std::sqrt;
+
+    const T r2 = x * x + y * y;
+
+    // theta_d / r tends to 1 on the optical axis; avoid the singular derivative of the square root at r = 0
+    T scale(1.0);
+    if (r2 > T(1.0e-16))
+    {
+      const T r = sqrt(r2);
+      const T theta = atan(r);
+      const T theta2 = theta * theta;
+      const T theta_d = theta * (T(1.0) + theta2 * (d[0] + theta2 * (d[1] + theta2 * (d[2] + theta2 * d[3]))));
+      scale = theta_d / r;
+    }
+
+    x_d = x * scale;
+    y_d = y * scale;
+  }
+};
+
+/**
+ * @brief Scales a point in the camera frame onto the normalized image plane (z = 1). Points on the plane of the camera
+ * (z = 0) are not scaled
+ */
+template<typename T>
+inline void normalizeImagePoint(const T point[3], T& x, T& y)
+{
+  if (point[2] == T(0.0))
+  {
+    x = point[0];
+    y = point[1];
+  }
+  else
+  {
+    x = point[0] / point[2];
+    y = point[1] / point[2];
+  }
+}
+
+/**
+ * @brief Pin-hole camera model with a lens distortion policy
+ */
+template<typename DistortionT>
+struct CameraModel
+{
+  using Distortion = DistortionT;
+
+  /** @brief The number of pin-hole intrinsic parameters [fx, fy, cx, cy] */
+  static constexpr std::size_t NUM_INTRINSIC_PARAMS = 4;
+  /** @brief The number of distortion parameters */
+  static constexpr std::size_t NUM_DISTORTION_PARAMS = Distortion::NUM_PARAMS;
+  /** @brief The total number of parameters, for a parameter block ordered [fx, fy, cx, cy, distortion...] */
+  static constexpr std::size_t NUM_PARAMS = NUM_INTRINSIC_PARAMS + NUM_DISTORTION_PARAMS;
+
+  /**
+   * @brief Projects a point in the camera frame into the image
+   * @param intr - The intrinsic parameters [fx, fy, cx, cy]
+   * @param distortion - The @ref NUM_DISTORTION_PARAMS distortion parameters
+   * @param point - The point in the camera frame
+   * @param xy_image - Output: the projection of the point in the image (pixels)
+   */
+  template<typename P, typename T>
+  static void project(const P* const intr, const P* const distortion, const T point[3], T xy_image[2])
+  {
+    T x, y;
+    normalizeImagePoint(point, x, y);
+
+    T x_d, y_d;
+    Distortion::distort(distortion, x, y, x_d, y_d);
+
+    xy_image[0] = intr[0] * x_d + intr[2];
+    xy_image[1] = intr[1] * y_d + intr[3];
+  }
+};
+
+/**
+ * @brief Specialization of the camera model without distortion, which does not access the distortion parameters
+ */
+template<>
+struct CameraModel<NoDistortion>
+{
+  using Distortion = NoDistortion;
+
+  static constexpr std::size_t NUM_INTRINSIC_PARAMS = 4;
+  static constexpr std::size_t NUM_DISTORTION_PARAMS = 0;
+  static constexpr std::size_t NUM_PARAMS = NUM_INTRINSIC_PARAMS;
+
+  template<typename P, typename T>
+  static void project(const P* const intr, const P* const, const T point[3], T xy_image[2])
+  {
+    T x, y;
+    normalizeImagePoint(point, x, y);
+
+    xy_image[0] = intr[0] * x + intr[2];
+    xy_image[1] = intr[1] * y + intr[3];
+  }
+};
+
+using PinholeModel = CameraModel<NoDistortion>;
+using RadialTangentialModel = CameraModel<RadialTangentialDistortion>;
+using FisheyeModel = CameraModel<FisheyeDistortion>;
+
+/**
+ * @brief Run-time selection of a camera model, for optimizations that support more than one
+ */
+enum class CameraModelType
+{
+  PINHOLE,
+  RADIAL_TANGENTIAL,
+  FISHEYE
+};
+
+} // namespace rct_optimizations
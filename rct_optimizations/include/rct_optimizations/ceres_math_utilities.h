@@ -2,7 +2,9 @@
 #define RCT_CERES_MATH_UTILITIES_H
 
 #include <ceres/rotation.h>
+#include <rct_optimizations/camera_model.h>
 #include <rct_optimizations/types.h>
+#include <Eigen/Geometry>
 
 namespace rct_optimizations
 {
@@ -34,62 +36,143 @@ inline void poseTransformPoint(const Pose6d& pose, const T point[3], T t_point[3
   transformPoint(angle_axis, translation, point, t_point);
 }
 
+/**
+ * @brief Projects a point in the camera frame into the image with the pin-hole model (see @ref PinholeModel)
+ */
 template <typename T>
 inline void projectPoint(const CameraIntrinsics& intr, const T point[3], T xy_image[2])
 {
-  T xp1 = point[0];
-  T yp1 = point[1];
-  T zp1 = point[2];
+  PinholeModel::project<double>(intr.values.data(), nullptr, point, xy_image);
+}
 
-  // Scale into the image plane by distance away from camera
-  T xp, yp;
+/**
+ * @brief Projects a point in the camera frame into the image with the pin-hole model (see @ref PinholeModel)
+ */
+template<typename T>
+inline Eigen::Matrix<T, 2, 1> projectPoint(const rct_optimizations::CameraIntrinsics &intr,
+                                           const Eigen::Matrix<T, 3, 1>& point)
+{
+  Eigen::Matrix<T, 2, 1> xy_image;
+  PinholeModel::project<double>(intr.values.data(), nullptr, point.data(), xy_image.data());
+  return xy_image;
+}
 
-  if (zp1 == T(0)) // Avoid divide by zero
+/**
+ * @brief A constant rigid transform for use inside of cost functors, stored as the 3x4 matrix [R | t]
+ *
+ * Cost functors frequently apply transforms that are not optimization parameters (e.g. measured robot poses) to values of
+ * type T (e.g. ceres::Jet). Storing such a transform as a Pose6d and applying it with @ref poseTransformPoint promotes the
+ * angle-axis vector to T and re-evaluates its trigonometric functions on every residual evaluation. This class converts
+ * the transform once at construction; applying it to a point costs 9 multiply-adds of a double with a T.
+ */
+class ConstantTransform
+{
+public:
+  ConstantTransform()
+    : matrix_(Eigen::Matrix<double, 3, 4>::Identity())
   {
-    xp = xp1;
-    yp = yp1;
   }
-  else
+
+  ConstantTransform(const Eigen::Isometry3d& transform)
+    : matrix_(transform.matrix().topRows<3>())
   {
-    xp = xp1 / zp1;
-    yp = yp1 / zp1;
   }
 
-  // Perform projection using focal length and camera optical center into image
-  // plane
-  xy_image[0] = intr.fx() * xp + intr.cx();
-  xy_image[1] = intr.fy() * yp + intr.cy();
-}
+  explicit ConstantTransform(const Pose6d& pose)
+  {
+    Eigen::Matrix3d rotation;
+    ceres::AngleAxisToRotationMatrix(pose.values.data(), rotation.data());
+    matrix_.leftCols<3>() = rotation;
+    matrix_.col(3) << pose.x(), pose.y(), pose.z();
+  }
 
-template<typename T>
-inline Eigen::Matrix<T, 2, 1> projectPoint(const rct_optimizations::CameraIntrinsics &intr,
-                                           const Eigen::Matrix<T, 3, 1>& point)
-{
-  // Scale the input point by its distance from the camera (i.e. z-coordinate)
-  Eigen::Matrix<T, 3, 1> scaled_point(point);
-  scaled_point(2) = T(1.0);
+  inline Eigen::Matrix3d rotation() const { return matrix_.leftCols<3>(); }
+  inline Eigen::Vector3d translation() const { return matrix_.col(3); }
+  inline const Eigen::Matrix<double, 3, 4>& matrix() const { return matrix_; }
 
-  // Avoid divide by zero
-  if (std::abs(point.z() - T(0.0) > T(1.e-10)))
+  Eigen::Isometry3d toIsometry() const
   {
-    scaled_point.x() = point.x() / point.z();
-    scaled_point.y() = point.y() / point.z();
+    Eigen::Isometry3d out(Eigen::Isometry3d::Identity());
+    out.matrix().topRows<3>() = matrix_;
+    return out;
   }
 
-  /* Create the camera parameters matrix
-   * | fx  0   cx | * | x/z | = | u |
-   * | 0   fy  cy | * | y/z | = | v |
-   * | 0   0   1  | * |  1  | = | 1 |
+  ConstantTransform inverse() const
+  {
+    ConstantTransform out;
+    out.matrix_.leftCols<3>() = rotation().transpose();
+    out.matrix_.col(3) = -(rotation().transpose() * translation());
+    return out;
+  }
+
+  ConstantTransform operator*(const ConstantTransform& other) const
+  {
+    ConstantTransform out;
+    out.matrix_.leftCols<3>() = rotation() * other.rotation();
+    out.matrix_.col(3) = rotation() * other.translation() + translation();
+    return out;
+  }
+
+  /**
+   * @brief Transforms a point: t_point = R * point + t
    */
-  Eigen::Matrix3d camera_matrix;
-  camera_matrix << intr.fx(), 0.0, intr.cx(), 0.0, intr.fy(), intr.cy(), 0.0, 0.0, 1.0;
+  template<typename T>
+  inline void transformPoint(const T point[3], T t_point[3]) const
+  {
+    for (int r = 0; r < 3; ++r)
+      t_point[r] = point[0] * matrix_(r, 0) + point[1] * matrix_(r, 1) + point[2] * matrix_(r, 2) + matrix_(r, 3);
+  }
+
+  template<typename T>
+  inline Eigen::Matrix<T, 3, 1> operator*(const Eigen::Matrix<T, 3, 1>& point) const
+  {
+    Eigen::Matrix<T, 3, 1> out;
+    transformPoint(point.data(), out.data());
+    return out;
+  }
 
-  // Perform projection using focal length and camera optical center into image plane
-  Eigen::Matrix<T, 3, 1> image_pt = camera_matrix.cast<T>() * scaled_point;
+  /**
+   * @brief Rotates a vector without applying the translation: out = R * v
+   */
+  template<typename T>
+  inline Eigen::Matrix<T, 3, 1> rotate(const Eigen::Matrix<T, 3, 1>& v) const
+  {
+    Eigen::Matrix<T, 3, 1> out;
+    for (int r = 0; r < 3; ++r)
+      out(r) = v(0) * matrix_(r, 0) + v(1) * matrix_(r, 1) + v(2) * matrix_(r, 2);
+    return out;
+  }
 
-  // Return only the top two elements of the vector
-  return image_pt.template head<2>();
-}
+  /**
+   * @brief Pre-multiplies a rotation matrix by the rotation of this transform: out = R * rotation
+   */
+  template<typename T>
+  inline Eigen::Matrix<T, 3, 3> rotate(const Eigen::Matrix<T, 3, 3>& rotation) const
+  {
+    Eigen::Matrix<T, 3, 3> out;
+    for (int c = 0; c < 3; ++c)
+      out.col(c) = rotate(Eigen::Matrix<T, 3, 1>(rotation.col(c)));
+    return out;
+  }
+
+  /**
+   * @brief Pre-multiplies a transform by this transform: out = this * transform
+   */
+  template<typename T>
+  inline Eigen::Transform<T, 3, Eigen::Isometry> operator*(const Eigen::Transform<T, 3, Eigen::Isometry>& transform) const
+  {
+    Eigen::Transform<T, 3, Eigen::Isometry> out(Eigen::Transform<T, 3, Eigen::Isometry>::Identity());
+    out.linear() = rotate(Eigen::Matrix<T, 3, 3>(transform.linear()));
+    out.translation() = operator*(Eigen::Matrix<T, 3, 1>(transform.translation()));
+    return out;
+  }
+
+private:
+  Eigen::Matrix<double, 3, 4> matrix_;
+
+public:
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+};
 
 } // namespace rct_optimizations
 
@@ -4,6 +4,7 @@
 #include <Eigen/Dense>
 #include <rct_optimizations/types.h>
 #include <rct_optimizations/covariance_types.h>
+#include <rct_optimizations/solver_options.h>
 
 namespace rct_optimizations
 {
@@ -89,6 +90,21 @@ struct CircleFitProblem
    */
   double radius_initial;
 
+  /**
+   * @brief How much of the covariance of the optimized parameters to compute.
+   */
+  CovarianceMode covariance_mode = CovarianceMode::FULL;
+
+  /**
+   * @brief Options of the nonlinear least-squares solver.
+   */
+  ceres::Solver::Options solver_options = DefaultSolverOptions(500);
+
+  /**
+   * @brief How the linear solver, number of threads and elimination ordering of @ref solver_options are chosen.
+   */
+  SolverProfile solver_profile = SolverProfile::AUTOMATIC;
+
   const std::vector<std::string> labels = {"x", "y", "r"};
 };
 
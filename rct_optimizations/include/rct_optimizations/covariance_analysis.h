@@ -4,6 +4,7 @@
 #include <Eigen/Dense>
 #include <iostream>
 #include <rct_optimizations/covariance_types.h>
+#include <rct_optimizations/parallel.h>
 #include <rct_optimizations/types.h>
 
 namespace rct_optimizations
@@ -20,6 +21,30 @@ struct DefaultCovarianceOptions : ceres::Covariance::Options
   }
 };
 
+/**
+ * @brief SparseCovarianceOptions An instance of ceres::Covariance::Options for large problems (e.g. kinematic calibrations
+ * with many parameters and thousands of residuals), where the cubic cost of the dense SVD of the Jacobian dominates.
+ * The covariance is computed with a sparse QR factorization, which requires a full-rank Jacobian; mask or hold constant any
+ * unobservable parameters, or use @ref DefaultCovarianceOptions if the Jacobian may be rank-deficient.
+ */
+struct SparseCovarianceOptions : ceres::Covariance::Options
+{
+  /**
+   * @brief Constructor
+   * @param num_threads - The number of threads to use. A value of 0 selects the number of hardware threads
+   */
+  explicit SparseCovarianceOptions(const std::size_t num_threads = 0)
+  {
+    this->algorithm_type = ceres::SPARSE_QR;
+#ifndef CERES_NO_SUITESPARSE
+    this->sparse_linear_algebra_library_type = ceres::SUITE_SPARSE;
+#else
+    this->sparse_linear_algebra_library_type = ceres::EIGEN_SPARSE;
+#endif
+    this->num_threads = static_cast<int>(getNumThreads(num_threads));
+  }
+};
+
 /**
  * @brief Get the covariance results provided covariance matrix and parameter names
  * @param cov_matrix The covariance matrix
@@ -41,11 +66,13 @@ Eigen::MatrixXd computeCorrelationsFromCovariance(const Eigen::MatrixXd& covaria
  * @param problem The Ceres problem (after optimization).
  * @param param_masks Map of the parameter block pointer and the indices of the parameters within that block to be excluded from the covariance calculation
  * @param options ceres::Covariance::Options to use when calculating covariance.
+ * @param mode How much of the covariance to compute. If NONE, an empty result is returned. If DIAGONAL, the off-diagonal elements are zero
  * @return CovarianceResult for the problem.
  */
 CovarianceResult computeCovariance(ceres::Problem &problem,
                                    const std::map<const double *, std::vector<int> >& param_masks = std::map<const double *, std::vector<int>>(),
-                                   const ceres::Covariance::Options& options = DefaultCovarianceOptions());
+                                   const ceres::Covariance::Options& options = DefaultCovarianceOptions(),
+                                   const CovarianceMode mode = CovarianceMode::FULL);
 
 /**
  * @brief Compute covariance results for the specified parameter blocks in a Ceres optimization problem. Labels results with generic names.
@@ -53,12 +80,14 @@ CovarianceResult computeCovariance(ceres::Problem &problem,
  * @param parameter_blocks Specific parameter blocks to compute covariance between.
  * @param param_masks Map of the parameter block pointer and the indices of the parameters within that block to be excluded from the covariance calculation
  * @param options ceres::Covariance::Options to use when calculating covariance.
+ * @param mode How much of the covariance to compute. If NONE, an empty result is returned. If DIAGONAL, the off-diagonal elements are zero
  * @return CovarianceResult for the problem.
  */
 CovarianceResult computeCovariance(ceres::Problem &problem,
                                    const std::vector<const double *>& parameter_blocks,
                                    const std::map<const double *, std::vector<int> >& param_masks = std::map<const double *, std::vector<int>>(),
-                                   const ceres::Covariance::Options& options = DefaultCovarianceOptions());
+                                   const ceres::Covariance::Options& options = DefaultCovarianceOptions(),
+                                   const CovarianceMode mode = CovarianceMode::FULL);
 
 /**
  * @brief Compute all covariance results for a Ceres optimization problem and label them with the provided names.
@@ -66,30 +95,63 @@ CovarianceResult computeCovariance(ceres::Problem &problem,
  * @param parameter_names Labels for all optimization parameters in the problem.
  * @param param_masks Map of the parameter block pointer and the indices of the parameters within that block to be excluded from the covariance calculation
  * @param options ceres::Covariance::Options to use when calculating covariance.
+ * @param mode How much of the covariance to compute. If NONE, an empty result is returned. If DIAGONAL, the off-diagonal elements are zero
  * @return CovarianceResult for the problem.
  */
 CovarianceResult computeCovariance(ceres::Problem &problem,
                                    const std::map<const double *, std::vector<std::string> > &param_names,
                                    const std::map<const double *, std::vector<int> >& param_masks = std::map<const double *, std::vector<int>>(),
-                                   const ceres::Covariance::Options& options = DefaultCovarianceOptions());
+                                   const ceres::Covariance::Options& options = DefaultCovarianceOptions(),
+                                   const CovarianceMode mode = CovarianceMode::FULL);
 
 /**
  * @brief Compute covariance results for specified parameter blocks in a Ceres optimization problem and label them with the provided names.
  * @param problem The Ceres problem (after optimization).
- * @param parameter_blocks Specific parameter blocks for which covariance will be calculated.
+ * @param parameter_blocks Specific parameter blocks for which covariance will be calculated. Only the covariance between these blocks is computed, and blocks whose parameters are all masked are skipped.
  * @param parameter_names Labels for optimization parameters in the specified blocks.
  * @param param_masks Map of the parameter block pointer and the indices of the parameters within that block to be excluded from the covariance calculation
  * @param options ceres::Covariance::Options to use when calculating covariance.
+ * @param mode How much of the covariance to compute. If NONE, an empty result is returned. If DIAGONAL, the off-diagonal elements are zero
  * @return CovarianceResult for the problem.
  * @throw CovarianceException if covariance.Compute fails.
- * @throw CovarianceException if covariance.GetCovarianceMatrix fails.
+ * @throw CovarianceException if covariance.GetCovarianceBlock fails.
  * @throw CovarianceException if parameter_names.size() != parameter_blocks.size().
  * @throw CovarianceException if the number of parameter label strings provided for a block is different than the number of parameters in that block.
+ * @throw CovarianceException if a mask index is out of range for its parameter block.
  */
 CovarianceResult computeCovariance(ceres::Problem &problem,
                                    const std::vector<const double *>& parameter_blocks,
                                    const std::map<const double *, std::vector<std::string> > &param_names,
                                    const std::map<const double *, std::vector<int> >& param_masks = std::map<const double *, std::vector<int>>(),
-                                   const ceres::Covariance::Options& options = DefaultCovarianceOptions());
+                                   const ceres::Covariance::Options& options = DefaultCovarianceOptions(),
+                                   const CovarianceMode mode = CovarianceMode::FULL);
+
+/**
+ * @brief Compute the marginal covariance of the specified parameter blocks, treating the nuisance parameter blocks (e.g.
+ * the per-image target poses of a calibration) as unknowns that are eliminated with a Schur complement.
+ * Each residual may depend on at most one nuisance block, so the normal matrix of the nuisance blocks is block diagonal
+ * and the cost of the calculation grows linearly with the number of nuisance blocks rather than cubically with the total
+ * number of parameters. The covariance is computed in the tangent space of each block, and any other parameter blocks
+ * in the problem are held constant.
+ * @param problem The Ceres problem (after optimization).
+ * @param parameter_blocks Parameter blocks for which the covariance will be calculated.
+ * @param parameter_names Labels for optimization parameters in the specified blocks.
+ * @param nuisance_blocks Parameter blocks to marginalize out. Constant blocks are ignored.
+ * @param mode How much of the covariance to compute. If NONE, an empty result is returned. If DIAGONAL, the off-diagonal elements are zero
+ * @param min_reciprocal_condition_number Threshold on the ratio of the smallest to the largest eigenvalue below which a
+ * normal matrix is considered singular
+ * @return CovarianceResult for the specified parameter blocks.
+ * @throw CovarianceException if parameter_names.size() != parameter_blocks.size().
+ * @throw CovarianceException if the number of parameter label strings provided for a block is different than the number of parameters in that block.
+ * @throw CovarianceException if a parameter block of interest is constant.
+ * @throw CovarianceException if a residual depends on more than one nuisance block.
+ * @throw CovarianceException if a nuisance block or the parameters of interest are not observable.
+ */
+CovarianceResult computeMarginalCovariance(ceres::Problem &problem,
+                                           const std::vector<const double *>& parameter_blocks,
+                                           const std::map<const double *, std::vector<std::string> > &param_names,
+                                           const std::vector<const double *>& nuisance_blocks,
+                                           const CovarianceMode mode = CovarianceMode::FULL,
+                                           const double min_reciprocal_condition_number = 1.0e-14);
 
 }  // namespace rct_optimizations
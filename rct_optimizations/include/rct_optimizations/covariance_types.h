@@ -31,22 +31,63 @@ struct NamedParam
   }
 };
 
+/**
+ * @brief Selects how much of the covariance of the parameters of an optimization is computed
+ */
+enum class CovarianceMode
+{
+  /** @brief The covariance is not computed */
+  NONE,
+  /** @brief Only the variance of each parameter (i.e. the diagonal of the covariance matrix) is computed */
+  DIAGONAL,
+  /** @brief The full covariance matrix is computed */
+  FULL
+};
+
 /**
  * @brief Covariance results for optimization parameters.
- * Contains standard deviations, covariances, and correlation coefficients, as well as the original covariance and correlation matrices.
+ * Contains the covariance and correlation matrices and the label of each parameter. The labeled standard deviations,
+ * covariances, and correlation coefficients are generated from the matrices on demand.
  */
 struct CovarianceResult
 {
-  /** @brief standard deviations */
-  std::vector<NamedParam> standard_deviations;
-  /** @brief correlation_coeffs */
-  std::vector<NamedParam> correlation_coeffs;
-  /** @brief covariances */
-  std::vector<NamedParam> covariances;
-  /** @brief Covariance matrix output from Ceres */
+  /** @brief Covariance matrix output from Ceres (empty if the covariance was not computed) */
   Eigen::MatrixXd covariance_matrix;
-  /** @brief Correlation matrix */
+  /** @brief Correlation matrix, with the standard deviations on the diagonal and the correlation coefficients elsewhere */
   Eigen::MatrixXd correlation_matrix;
+  /** @brief Label of each parameter, in the order of the rows and columns of the matrices */
+  std::vector<std::string> labels;
+
+  /**
+   * @brief Returns the standard deviation of each parameter (the diagonal of the correlation matrix).
+   * @return
+   */
+  std::vector<NamedParam> getStandardDeviations() const
+  {
+    std::vector<NamedParam> out;
+    out.reserve(static_cast<std::size_t>(correlation_matrix.rows()));
+    for (Eigen::Index i = 0; i < correlation_matrix.rows(); ++i)
+      out.push_back(makeParam(correlation_matrix, i, i));
+    return out;
+  }
+
+  /**
+   * @brief Returns the covariance of each pair of parameters (the upper triangle of the covariance matrix).
+   * @return
+   */
+  std::vector<NamedParam> getCovariances() const
+  {
+    return getUpperTriangle(covariance_matrix);
+  }
+
+  /**
+   * @brief Returns the correlation coefficient of each pair of parameters (the upper triangle of the correlation matrix).
+   * @return
+   */
+  std::vector<NamedParam> getCorrelationCoeffs() const
+  {
+    return getUpperTriangle(correlation_matrix);
+  }
 
   /**
    * @brief Returns named correlation coefficients that exceed @ref threshold.
@@ -56,10 +97,13 @@ struct CovarianceResult
   std::vector<NamedParam> getCorrelationCoeffOutsideThreshold(const std::double_t& threshold) const
   {
     std::vector<NamedParam> out;
-    for (auto corr : correlation_coeffs)
+    for (Eigen::Index row = 0; row < correlation_matrix.rows(); ++row)
     {
-      if (std::abs(corr.value) > threshold)
-        out.push_back(corr);
+      for (Eigen::Index col = row + 1; col < correlation_matrix.cols(); ++col)
+      {
+        if (std::abs(correlation_matrix(row, col)) > threshold)
+          out.push_back(makeParam(correlation_matrix, row, col));
+      }
     }
     std::sort(out.begin(), out.end(), [](NamedParam a, NamedParam b) { return std::abs(a.value) > std::abs(b.value); });
     return out;
@@ -73,19 +117,19 @@ struct CovarianceResult
   {
     std::string out;
     out.append("Std. Devs.\n");
-    for (auto std_dev : standard_deviations)
+    for (auto std_dev : getStandardDeviations())
     {
       out.append(std_dev.toString() + "\n");
     }
 
     out.append("\nCovariance\n");
-    for (auto cov : covariances)
+    for (auto cov : getCovariances())
     {
       out.append(cov.toString() + "\n");
     }
 
     out.append("\nCorrelation Coeffs.\n");
-    for (auto corr : correlation_coeffs)
+    for (auto corr : getCorrelationCoeffs())
     {
       out.append(corr.toString() + "\n");
     }
@@ -113,5 +157,28 @@ struct CovarianceResult
     }
     return out;
   }
+
+private:
+  /** @brief Creates a named parameter from an element of a matrix; diagonal elements are named by their row label only */
+  NamedParam makeParam(const Eigen::MatrixXd& matrix, const Eigen::Index row, const Eigen::Index col) const
+  {
+    NamedParam p;
+    p.value = matrix(row, col);
+    p.names = std::make_pair(labels.at(static_cast<std::size_t>(row)),
+                             row == col ? std::string() : labels.at(static_cast<std::size_t>(col)));
+    return p;
+  }
+
+  std::vector<NamedParam> getUpperTriangle(const Eigen::MatrixXd& matrix) const
+  {
+    std::vector<NamedParam> out;
+    out.reserve(static_cast<std::size_t>(matrix.rows() * (matrix.rows() - 1) / 2));
+    for (Eigen::Index row = 0; row < matrix.rows(); ++row)
+    {
+      for (Eigen::Index col = row + 1; col < matrix.cols(); ++col)
+        out.push_back(makeParam(matrix, row, col));
+    }
+    return out;
+  }
 };
 }  // namespace rct_optimizations
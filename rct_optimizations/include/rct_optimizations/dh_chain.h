@@ -1,6 +1,7 @@
 #pragma once
 
 #include <Eigen/Geometry>
+#include <cstdint>
 #include <memory>
 #include <utility>
 #include <vector>
@@ -105,8 +106,24 @@ struct DHTransform
     return createRelativeTransform(joint_value, offsets);
   }
 
+  /**
+   * @brief Creates a uniformly distributed random joint value between @ref min and @ref max.
+   * Values are drawn from a counter-based random stream seeded with @ref random_seed which is owned by this object.
+   * This function is not thread-safe for a single instance; use @ref createRandomJointValue(std::uint64_t, std::uint64_t) const
+   * for concurrent sampling
+   * @return
+   */
   double createRandomJointValue() const;
 
+  /**
+   * @brief Creates the uniformly distributed random joint value between @ref min and @ref max at a specific counter of a random stream.
+   * The value is a pure function of @ref random_seed, @ref stream, and @ref counter, so this function is thread-safe
+   * @param counter - Index of the value within the random stream
+   * @param stream - Index of the random stream
+   * @return
+   */
+  double createRandomJointValue(const std::uint64_t counter, const std::uint64_t stream = 0) const;
+
   std::array<std::string, 4> getParamLabels() const;
 
   /** @brief DH parameters
@@ -130,6 +147,9 @@ struct DHTransform
 protected:
   friend struct YAML::as_if<DHTransform, void>;
   DHTransform() = default;
+
+  /** @brief Counter of the next value drawn by @ref createRandomJointValue() */
+  mutable std::uint64_t random_counter_ = 0;
 };
 
 /**
@@ -194,10 +214,21 @@ public:
 
   /**
    * @brief Creates a random joint pose by choosing a random uniformly distributed joint value for each joint in the chain
+   * This function is not thread-safe for a single instance; use @ref createUniformlyRandomPoses to generate poses in parallel
    * @return
    */
   Eigen::VectorXd createUniformlyRandomPose() const;
 
+  /**
+   * @brief Creates a number of random joint poses in parallel. The poses are identical to those of @ref n consecutive calls
+   * to @ref createUniformlyRandomPose, which continue after them, and do not depend on the number of threads.
+   * This function is not thread-safe for a single instance
+   * @param n - Number of poses to create
+   * @param num_threads - Maximum number of threads to use. A value of 0 selects the number of hardware threads
+   * @return
+   */
+  std::vector<Eigen::VectorXd> createUniformlyRandomPoses(const std::size_t n, const std::size_t num_threads = 0) const;
+
   /**
    * @brief Returns the number of degrees of freedom (i.e. DH transforms) of the chain
    * @return
@@ -244,6 +275,8 @@ protected:
   std::vector<DHTransform> transforms_;
   /** @brief Fixed transform offset to the beginning of the chain */
   Eigen::Isometry3d base_offset_;
+  /** @brief Index of the next pose created by @ref createUniformlyRandomPose */
+  mutable std::uint64_t random_pose_counter_ = 0;
 
   DHChain() = default;
 };
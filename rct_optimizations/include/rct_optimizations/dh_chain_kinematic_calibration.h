@@ -4,6 +4,7 @@
 #include <rct_optimizations/dh_chain.h>
 #include <rct_optimizations/ceres_math_utilities.h>
 #include <rct_optimizations/covariance_analysis.h>
+#include <rct_optimizations/solver_options.h>
 
 namespace rct_optimizations
 {
@@ -42,6 +43,7 @@ struct KinematicCalibrationProblem2D3D
     , target_mount_to_target_guess(Eigen::Isometry3d::Identity())
     , camera_base_to_target_base_guess(Eigen::Isometry3d::Identity())
   {
+    covariance_options.null_space_rank = -1;  // automatically drop terms below min_reciprocal_condition_number
   }
 
   KinObservation2D3D::Set observations;
@@ -70,6 +72,22 @@ struct KinematicCalibrationProblem2D3D
   double camera_chain_offset_stdev = 1.0e-3;
   /** @brief Expected standard deviation of the DH chain offsets for the target DH chain */
   double target_chain_offset_stdev = 1.0e-3;
+  /** @brief How much of the covariance of the optimized parameters to compute */
+  CovarianceMode covariance_mode = CovarianceMode::FULL;
+  /**
+   * @brief Options for computing the covariance. The default dense SVD handles rank-deficient problems; use
+   * @ref SparseCovarianceOptions for large problems with a full-rank Jacobian
+   */
+  ceres::Covariance::Options covariance_options = DefaultCovarianceOptions();
+  /** @brief Options of the nonlinear least-squares solver */
+  ceres::Solver::Options solver_options = DefaultSolverOptions();
+  /** @brief How the linear solver, number of threads and elimination ordering of @ref solver_options are chosen */
+  SolverProfile solver_profile = SolverProfile::AUTOMATIC;
+  /**
+   * @brief How the solver updates the orientations of the estimated transforms. Angle-axis blocks with masked elements are
+   * always updated additively, so that the masked elements stay constant
+   */
+  PoseParameterization pose_parameterization = PoseParameterization::ANGLE_AXIS;
 
   std::string label_camera_mount_to_camera = "camera_mount_to_camera";
   std::string label_target_mount_to_target = "target_mount_to_target";
@@ -85,6 +103,7 @@ struct KinematicCalibrationProblemPose6D
     , target_mount_to_target_guess(Eigen::Isometry3d::Identity())
     , camera_base_to_target_base_guess(Eigen::Isometry3d::Identity())
   {
+    covariance_options.null_space_rank = -1;  // automatically drop terms below min_reciprocal_condition_number
   }
 
   DHChain camera_chain;
@@ -110,6 +129,22 @@ struct KinematicCalibrationProblemPose6D
   double camera_chain_offset_stdev = 1.0e-3;
   /** @brief Expected standard deviation of the DH chain offsets for the target DH chain */
   double target_chain_offset_stdev = 1.0e-3;
+  /** @brief How much of the covariance of the optimized parameters to compute */
+  CovarianceMode covariance_mode = CovarianceMode::FULL;
+  /**
+   * @brief Options for computing the covariance. The default dense SVD handles rank-deficient problems; use
+   * @ref SparseCovarianceOptions for large problems with a full-rank Jacobian
+   */
+  ceres::Covariance::Options covariance_options = DefaultCovarianceOptions();
+  /** @brief Options of the nonlinear least-squares solver */
+  ceres::Solver::Options solver_options = DefaultSolverOptions();
+  /** @brief How the linear solver, number of threads and elimination ordering of @ref solver_options are chosen */
+  SolverProfile solver_profile = SolverProfile::AUTOMATIC;
+  /**
+   * @brief How the solver updates the orientations of the estimated transforms. Angle-axis blocks with masked elements are
+   * always updated additively, so that the masked elements stay constant
+   */
+  PoseParameterization pose_parameterization = PoseParameterization::ANGLE_AXIS;
 
   std::string label_camera_mount_to_camera = "camera_mount_to_camera";
   std::string label_target_mount_to_target = "target_mount_to_target";
@@ -131,6 +166,33 @@ struct KinematicCalibrationResult
   CovarianceResult covariance;
 };
 
+struct MultiStartOptions
+{
+  /** @brief Number of starts, including the start from the unperturbed guesses of the problem */
+  std::size_t num_starts = 16;
+  /**
+   * @brief Maximum angle (rad) of the random rotation applied to each transform guess. A value of pi or more samples the
+   * orientations uniformly over SO(3)
+   */
+  double max_rotation = M_PI;
+  /** @brief Maximum random offset (m) applied to each axis of the translation of each transform guess */
+  double max_translation = 0.1;
+  /** @brief Seed of the random perturbations */
+  std::uint64_t seed = 0;
+  /** @brief Maximum number of starts to solve concurrently. A value of 0 selects the number of hardware threads */
+  std::size_t num_threads = 0;
+};
+
+struct KinematicCalibrationMultiStartResult : public KinematicCalibrationResult
+{
+  /** @brief Index of the start of the result (0 is the start from the unperturbed guesses) */
+  std::size_t best_start = 0;
+  /** @brief Final cost per observation of each start (infinity for the starts that could not be solved) */
+  std::vector<double> final_costs_per_obs;
+  /** @brief Whether the solver converged for each start */
+  std::vector<bool> start_converged;
+};
+
 class DualDHChainCost
 {
 public:
@@ -311,8 +373,9 @@ class DualDHChainCost2D3D : public DualDHChainCost
     Isometry3<T> camera_to_target = camera_base_to_camera.inverse() * camera_base_to_target;
     Vector3<T> target_in_camera = camera_to_target * target_pt_.cast<T>();
 
-    // Project the target into the image plane
-    Vector2<T> target_in_image = projectPoint(intr_, target_in_camera);
+    // Project the target into the image plane. The problem has no distortion parameters, so use the pin-hole camera model
+    Vector2<T> target_in_image;
+    PinholeModel::project<double>(intr_.values.data(), nullptr, target_in_camera.data(), target_in_image.data());
 
     // Step 3: Calculate the error
     residual[0] = target_in_image.x() - obs_.x();
@@ -334,6 +397,7 @@ class DualDHChainCostPose6D : public DualDHChainCost
                           const DHChain& target_chain, const double orientation_weight)
     : DualDHChainCost (camera_chain, target_chain, measurement.camera_chain_joints, measurement.target_chain_joints)
     , camera_to_target_measured_(measurement.camera_to_target)
+    , camera_to_target_measured_orientation_(measurement.camera_to_target.linear())
     , orientation_weight_(orientation_weight)
   {
   }
@@ -375,13 +439,13 @@ class DualDHChainCostPose6D : public DualDHChainCost
     // Now that we have two transforms in the same frame, get the difference between the expected and observed pose of the target
     Isometry3<T> camera_to_target = camera_base_to_camera.inverse() * camera_base_to_target;
 
-    Isometry3<T> tform_error = camera_to_target_measured_.cast<T>() * camera_to_target.inverse();
+    Isometry3<T> tform_error = camera_to_target_measured_ * camera_to_target.inverse();
 
     residual[0] = tform_error.translation().x();
     residual[1] = tform_error.translation().y();
     residual[2] = tform_error.translation().z();
 
-    T rot_diff = Eigen::Quaternion<T>(camera_to_target_measured_.cast<T>().linear())
+    T rot_diff = camera_to_target_measured_orientation_.cast<T>()
                      .angularDistance(Eigen::Quaternion<T>(camera_to_target.linear()));
 
     residual[3] = ceres::IsNaN(rot_diff) ? T(0.0) : T(orientation_weight_) * rot_diff;
@@ -390,8 +454,76 @@ class DualDHChainCostPose6D : public DualDHChainCost
   }
 
   protected:
-    const Eigen::Isometry3d camera_to_target_measured_;
+    const ConstantTransform camera_to_target_measured_;
+    const Eigen::Quaterniond camera_to_target_measured_orientation_;
     const double orientation_weight_;
+
+  public:
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+};
+
+/**
+ * @brief The optimization variables of the kinematic calibration with 6D pose measurements, initialized from the guesses of a
+ * problem, along with their labels and masks. Used by the batch and sliding window calibrations to set up their Ceres
+ * problems the same way.
+ *
+ * The cost functions of the measurements refer to the DH chains and variables of this object, so it cannot be copied
+ */
+struct KinematicCalibrationVariablesPose6D
+{
+  explicit KinematicCalibrationVariablesPose6D(const KinematicCalibrationProblemPose6D& params);
+
+  KinematicCalibrationVariablesPose6D(const KinematicCalibrationVariablesPose6D&) = delete;
+  KinematicCalibrationVariablesPose6D& operator=(const KinematicCalibrationVariablesPose6D&) = delete;
+
+  /**
+   * @brief Adds the parameter blocks of the variables to a problem, in the order of @ref parameters, and configures them:
+   * the placeholder DH offsets of 0-DoF chains are held constant, the masked elements are excluded from the optimization,
+   * the orientations are updated with the input parameterization, and costs are added to drive the DH offsets towards zero
+   */
+  void addParameterBlocks(ceres::Problem& problem, const PoseParameterization pose_parameterization);
+
+  /**
+   * @brief Adds the residual block of a measurement to a problem
+   * @param orientation_weight - The value by which the orientation residual should be scaled relative to the position
+   * residual
+   */
+  ceres::ResidualBlockId addMeasurement(ceres::Problem& problem,
+                                        const KinematicMeasurement& measurement,
+                                        const double orientation_weight);
+
+  /** @brief The sizes of the parameter blocks, in the order of @ref parameters */
+  std::vector<int> sizes() const;
+
+  /** @brief Saves the current values of the transforms and DH offsets (without the placeholders) into a result */
+  void getResult(KinematicCalibrationResult& result) const;
+
+  DHChain camera_chain;
+  DHChain target_chain;
+
+  /**
+   * @brief DH offsets of the chains. Ceres will not work with parameter blocks of size zero, so chains with DoF == 0 have a
+   * placeholder set of DH offsets of size 1 x 4
+   */
+  Eigen::MatrixX4d camera_chain_dh_offsets;
+  Eigen::MatrixX4d target_chain_dh_offsets;
+
+  /** @brief Position and angle axis of the camera mount to camera, target mount to target and camera base to target base transforms */
+  Eigen::Vector3d t_cm_to_c;
+  Eigen::Vector3d aa_cm_to_c;
+  Eigen::Vector3d t_tm_to_t;
+  Eigen::Vector3d aa_tm_to_t;
+  Eigen::Vector3d t_ccb_to_tcb;
+  Eigen::Vector3d aa_ccb_to_tcb;
+
+  /** @brief Pointers to the variables, in the order of @ref DualDHChainCost::constructParameters */
+  std::vector<double *> parameters;
+  std::map<const double*, std::vector<std::string>> param_labels;
+  std::map<const double*, std::vector<int>> param_masks;
+  std::map<const double*, std::string> param_names;
+
+  double camera_chain_offset_stdev;
+  double target_chain_offset_stdev;
 };
 
 /**
@@ -405,12 +537,41 @@ KinematicCalibrationResult optimize(const KinematicCalibrationProblem2D3D &probl
  * @brief Performs the kinematic calibration optimization with 6D pose measurements
  * @param problem
  * @param orientation_weight - The value by which the orientation residual should be scaled relative to the position residual
+ * @return
+ */
+KinematicCalibrationResult optimize(const KinematicCalibrationProblemPose6D& problem,
+                                    const double orientation_weight = 100.0);
+
+/**
+ * @brief Performs the kinematic calibration optimization with 6D pose measurements, using the input solver options in place
+ * of the solver options of the problem (the solver profile of the problem is still applied)
+ * @param problem
+ * @param orientation_weight - The value by which the orientation residual should be scaled relative to the position residual
  * @param options - Ceres solver options
  * @return
  */
 KinematicCalibrationResult optimize(const KinematicCalibrationProblemPose6D& problem,
-                                    const double orientation_weight = 100.0,
-                                    const ceres::Solver::Options& options = ceres::Solver::Options());
+                                    const double orientation_weight,
+                                    const ceres::Solver::Options& options);
+
+/**
+ * @brief Performs the kinematic calibration optimization with 6D pose measurements from multiple starts, to avoid the local
+ * minima into which poor guesses of the transforms lead the solver.
+ *
+ * The first start uses the guesses of the problem. Every other start randomly rotates and translates the camera mount to
+ * camera, target mount to target and camera base to target base guesses (the masked components are left unchanged). The
+ * starts are solved concurrently, each with a single solver thread and without printing the parameter labels. The covariance
+ * is only computed for the selected start.
+ * @param problem
+ * @param options - The multi-start options
+ * @param orientation_weight - The value by which the orientation residual should be scaled relative to the position residual
+ * @return The result of the converged start with the lowest final cost (or of the start with the lowest final cost if none
+ * converged), and the final cost of every start
+ * @throws OptimizationException if the number of starts is zero or none of the starts could be solved
+ */
+KinematicCalibrationMultiStartResult optimizeMultiStart(const KinematicCalibrationProblemPose6D& problem,
+                                                        const MultiStartOptions& options = MultiStartOptions(),
+                                                        const double orientation_weight = 100.0);
 
 } // namespace rct_optimizations
 
@@ -0,0 +1,94 @@
+/*
+ * This file defines an online version of the kinematic calibration with 6D pose measurements (see
+ * dh_chain_kinematic_calibration.h) for tracking the drift of the DH parameters of a system from a continuous stream of
+ * measurements (e.g. a laser tracker observing a target on a positioner).
+ */
+#pragma once
+
+#include <rct_optimizations/dh_chain_kinematic_calibration.h>
+#include <rct_optimizations/marginalization.h>
+
+#include <ceres/problem.h>
+#include <deque>
+
+namespace rct_optimizations
+{
+/**
+ * @brief Kinematic calibration with 6D pose measurements over a sliding window of the most recent measurements.
+ *
+ * Measurements are consumed one at a time. When the window is full, the oldest measurement is marginalized into a Gaussian
+ * prior on the calibration (see @ref MarginalizationPrior), so that the information of all of the measurements consumed so
+ * far is retained while the size of the problem stays bounded. The @ref MaximumLikelihood costs on the DH offsets of the
+ * initial problem (see @ref KinematicCalibrationProblemPose6D::camera_chain_offset_stdev) remain in the problem throughout.
+ *
+ * Every update re-solves the problem from the previous estimate within a fixed solver time budget, and reports the DH
+ * offsets and their covariance.
+ */
+class KinematicCalibrationSlidingWindowPose6D
+{
+public:
+  /**
+   * @brief Constructor
+   * @param params - The initial problem. Its DH chains, guesses, masks, DH offset priors, solver options and covariance
+   * settings are used by every update. Its measurements, if any, are solved with the solver options of the problem, after
+   * which the oldest of them are marginalized down to the size of the window. Its pose parameterization is not used: the
+   * marginalization prior is a quadratic in the angle-axis values, so the orientations are always updated additively
+   * @param window_size - The maximum number of measurements in the window
+   * @param max_update_time - The maximum time (s) spent by the solver in each update. The maximum number of iterations of
+   * the solver options of the problem also applies
+   * @param orientation_weight - The value by which the orientation residual should be scaled relative to the position
+   * residual
+   * @throws OptimizationException if the window size is zero or the maximum update time is not positive
+   */
+  explicit KinematicCalibrationSlidingWindowPose6D(const KinematicCalibrationProblemPose6D& params,
+                                                   const std::size_t window_size = 50,
+                                                   const double max_update_time = 0.1,
+                                                   const double orientation_weight = 100.0);
+
+  KinematicCalibrationSlidingWindowPose6D(const KinematicCalibrationSlidingWindowPose6D&) = delete;
+  KinematicCalibrationSlidingWindowPose6D& operator=(const KinematicCalibrationSlidingWindowPose6D&) = delete;
+
+  /**
+   * @brief Adds a measurement to the window, marginalizing the oldest measurement if the window is full, and updates the
+   * estimate starting from the previous one. The covariance is computed after the solve, outside of the time budget; set
+   * the covariance mode of the initial problem to CovarianceMode::NONE for the fastest updates.
+   * The cost per observation of the result includes the residuals of the priors
+   */
+  KinematicCalibrationResult update(const KinematicMeasurement& measurement);
+
+  /** @brief The number of measurements in the window */
+  std::size_t numMeasurements() const;
+
+  /** @brief The number of measurements that have been marginalized into the prior */
+  std::size_t numMarginalizedMeasurements() const;
+
+private:
+  /** @brief Adds the residual block of a measurement to the end of the window */
+  void addToWindow(const KinematicMeasurement& measurement);
+
+  /** @brief Marginalizes the oldest measurement of the window into the prior */
+  void marginalizeOldest();
+
+  /** @brief Solves the problem with the given solver options */
+  KinematicCalibrationResult solve(const ceres::Solver::Options& options);
+
+  /** @brief Optimization variables. The cost functions refer to these, so the object cannot be copied or moved */
+  KinematicCalibrationVariablesPose6D variables_;
+  double orientation_weight_;
+
+  ceres::Problem problem_;
+  ceres::Solver::Options solver_options_;
+  SolverProfile solver_profile_;
+  ceres::Covariance::Options covariance_options_;
+  CovarianceMode covariance_mode_;
+  std::size_t window_size_;
+  double max_update_time_;
+
+  /** @brief Residual blocks of the measurements in the window, from oldest to newest */
+  std::deque<ceres::ResidualBlockId> window_;
+  std::size_t num_marginalized_;
+  /** @brief Prior on all of the optimization variables */
+  MarginalizationPrior prior_;
+};
+
+} // namespace rct_optimizations
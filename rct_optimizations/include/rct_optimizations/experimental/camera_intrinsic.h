@@ -1,7 +1,9 @@
 #ifndef RCT_CAMERA_INTRINSIC_H
 #define RCT_CAMERA_INTRINSIC_H
 
+#include <rct_optimizations/camera_model.h>
 #include <rct_optimizations/covariance_types.h>
+#include <rct_optimizations/solver_options.h>
 #include "rct_optimizations/types.h"
 #include "boost/optional.hpp"
 
@@ -11,13 +13,31 @@ namespace rct_optimizations
 struct IntrinsicEstimationProblem
 {
   std::vector<Correspondence2D3D::Set> image_observations;
-  CameraIntrinsics intrinsics_guess;
-  bool use_extrinsic_guesses;
+  /** @brief Initial guess of the camera intrinsics. If not set, the guess (including the radial distortion coefficients k1
+   * and k2) is estimated in closed form from the observations with @ref estimateIntrinsics */
+  boost::optional<CameraIntrinsics> intrinsics_guess;
+
+  /** @brief The camera model to calibrate; the distortion parameters of the model are estimated along with the intrinsics */
+  CameraModelType camera_model = CameraModelType::RADIAL_TANGENTIAL;
+  bool use_extrinsic_guesses = false;
   std::vector<Eigen::Isometry3d> extrinsic_guesses;
 
-  std::string label_extr = "pose";
-  const std::array<std::string, 9> labels_intrinsic_params = {{"fx", "fy", "cx", "cy", "k1", "k2", "p1", "p2", "k3"}};
-  const std::array<std::string, 6> labels_isometry3d = {{"x", "y", "z", "rx", "ry", "rz"}};
+  /** @brief How much of the covariance of the optimized parameters to compute */
+  CovarianceMode covariance_mode = CovarianceMode::FULL;
+
+  /** @brief Options of the nonlinear least-squares solver */
+  ceres::Solver::Options solver_options = DefaultSolverOptions(1000);
+  /** @brief How the linear solver, number of threads and elimination ordering of @ref solver_options are chosen */
+  SolverProfile solver_profile = SolverProfile::AUTOMATIC;
+  /** @brief How the solver updates the orientations of the estimated poses */
+  PoseParameterization pose_parameterization = PoseParameterization::ANGLE_AXIS;
+
+  /** @brief The maximum number of threads used to initialize the target poses and, with the automatic solver profile, to
+   * evaluate the cost functions. A value of 0 selects the number of hardware threads */
+  std::size_t num_threads = 0;
+
+  /** @brief Labels of the intrinsic parameters; the distortion parameters are labeled by the camera model */
+  const std::array<std::string, 4> labels_intrinsic_params = {{"fx", "fy", "cx", "cy"}};
 };
 
 struct IntrinsicEstimationResult
@@ -27,15 +47,50 @@ struct IntrinsicEstimationResult
   double final_cost_per_obs;
 
   CameraIntrinsics intrinsics;
+
+  /** @brief Distortion parameters of the camera model, ordered as defined by the model (e.g. [k1, k2, p1, p2, k3] for
+   * @ref RadialTangentialDistortion); unused elements are zero */
   std::array<double, 5> distortions;
 
+  /** @brief The camera to target transform of each observation set (identity for the observation sets in @ref failed_observation_sets) */
   std::vector<Eigen::Isometry3d> target_transforms;
 
+  /** @brief Indices of the observation sets whose target pose could not be initialized; these are excluded from the calibration */
+  std::vector<std::size_t> failed_observation_sets;
+
+  /** @brief Covariance of the intrinsic parameters, marginalized over the target poses */
   CovarianceResult covariance;
 };
 
 IntrinsicEstimationResult optimize(const IntrinsicEstimationProblem& params);
 
+struct ClosedFormIntrinsicsResult
+{
+  CameraIntrinsics intrinsics;
+
+  /** @brief Distortion coefficients (k1, k2, p1, p2, k3). Only the radial coefficients k1 and k2 are estimated */
+  std::array<double, 5> distortions {{0.0, 0.0, 0.0, 0.0, 0.0}};
+
+  /** @brief Indices of the observation sets whose homography could not be estimated; these are excluded from the estimate */
+  std::vector<std::size_t> failed_observation_sets;
+};
+
+/**
+ * @brief Estimates the camera intrinsics in closed form from observations of a planar target (Zhang, "A Flexible New
+ * Technique for Camera Calibration"), without an initial guess. The homography from the target plane to the image is
+ * computed for each observation set with @ref estimateHomography, and the image of the absolute conic is solved from the
+ * constraints of the homographies, assuming zero skew. The result ignores lens distortion, but it is close enough to the
+ * optimum to initialize @ref optimize.
+ * @param observations - Observation sets of a planar target. At least 2 of them must have sufficiently different orientations
+ * (i.e. the target planes must not be parallel)
+ * @param estimate_distortion - If true, the radial distortion coefficients k1 and k2 are also estimated by linear least
+ * squares, given the intrinsics and the target poses that follow from the homographies
+ * @return The estimated intrinsics
+ * @throws OptimizationException if fewer than 2 homographies can be estimated or if the observations do not constrain the intrinsics
+ */
+ClosedFormIntrinsicsResult estimateIntrinsics(const std::vector<Correspondence2D3D::Set>& observations,
+                                              const bool estimate_distortion = false);
+
 }
 
 #endif //RCT_CAMERA_INTRINSIC_H
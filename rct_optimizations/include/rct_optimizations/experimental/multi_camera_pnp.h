@@ -13,6 +13,7 @@
 #ifndef RCT_MULTI_CAMERA_PNP_H
 #define RCT_MULTI_CAMERA_PNP_H
 
+#include "rct_optimizations/solver_options.h"
 #include "rct_optimizations/types.h"
 
 namespace rct_optimizations
@@ -36,6 +37,13 @@ struct MultiCameraPnPProblem
 
   /** @brief Your best guess for transforms, "base to target", for a given observation set taken.*/
   Eigen::Isometry3d base_to_target_guess;
+
+  /** @brief Options of the nonlinear least-squares solver */
+  ceres::Solver::Options solver_options = DefaultSolverOptions(50);
+  /** @brief How the linear solver, number of threads and elimination ordering of @ref solver_options are chosen */
+  SolverProfile solver_profile = SolverProfile::AUTOMATIC;
+  /** @brief How the solver updates the orientations of the estimated poses */
+  PoseParameterization pose_parameterization = PoseParameterization::ANGLE_AXIS;
 };
 
 struct MultiCameraPnPResult
@@ -17,6 +17,7 @@
 #pragma once
 
 #include <rct_optimizations/covariance_types.h>
+#include <rct_optimizations/solver_options.h>
 #include <rct_optimizations/types.h>
 #include <Eigen/Dense>
 #include <vector>
@@ -30,6 +31,16 @@ struct ExtrinsicHandEyeProblem2D3D
   Eigen::Isometry3d target_mount_to_target_guess;
   Eigen::Isometry3d camera_mount_to_camera_guess;
 
+  /** @brief How much of the covariance of the optimized parameters to compute */
+  CovarianceMode covariance_mode = CovarianceMode::FULL;
+
+  /** @brief Options of the nonlinear least-squares solver */
+  ceres::Solver::Options solver_options = DefaultSolverOptions();
+  /** @brief How the linear solver, number of threads and elimination ordering of @ref solver_options are chosen */
+  SolverProfile solver_profile = SolverProfile::AUTOMATIC;
+  /** @brief How the solver updates the orientations of the estimated poses */
+  PoseParameterization pose_parameterization = PoseParameterization::ANGLE_AXIS;
+
   std::array<std::string, 6> labels_isometry3d = {{"x", "y", "z", "rx", "ry", "rz"}};
   std::string label_target_mount_to_target = "target_mount_to_target";
   std::string label_camera_mount_to_camera = "camera_mount_to_camera";
@@ -48,6 +59,16 @@ struct ExtrinsicHandEyeProblem3D3D
   Eigen::Isometry3d target_mount_to_target_guess;
   Eigen::Isometry3d camera_mount_to_camera_guess;
 
+  /** @brief How much of the covariance of the optimized parameters to compute */
+  CovarianceMode covariance_mode = CovarianceMode::FULL;
+
+  /** @brief Options of the nonlinear least-squares solver */
+  ceres::Solver::Options solver_options = DefaultSolverOptions(50);
+  /** @brief How the linear solver, number of threads and elimination ordering of @ref solver_options are chosen */
+  SolverProfile solver_profile = SolverProfile::AUTOMATIC;
+  /** @brief How the solver updates the orientations of the estimated poses */
+  PoseParameterization pose_parameterization = PoseParameterization::ANGLE_AXIS;
+
   std::array<std::string, 6> labels_isometry3d = {{"x", "y", "z", "rx", "ry", "rz"}};
   std::string label_target_mount_to_target = "target_mount_to_target";
   std::string label_camera_mount_to_camera = "camera_mount_to_camera";
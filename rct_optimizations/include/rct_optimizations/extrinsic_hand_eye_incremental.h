@@ -0,0 +1,177 @@
+/*
+ * This file defines an incremental version of the hand-eye calibration of a 2D camera (see extrinsic_hand_eye.h) for use
+ * during data collection. Rather than rebuilding and solving the whole problem from the original guesses every time new
+ * images are acquired, the calibration object keeps the Ceres problem alive: new observations append residual blocks to it,
+ * and each solve starts from the previous solution. Since a few new observations only perturb the solution slightly, the
+ * subsequent solves are given a small iteration budget.
+ *
+ * For continuous operation (e.g. tracking the drift of the camera mount in production), the sliding window estimator
+ * bounds the size of the problem instead: it keeps only the most recent observations and summarizes the older ones in a
+ * Gaussian prior on the calibration.
+ */
+#pragma once
+
+#include <rct_optimizations/extrinsic_hand_eye.h>
+#include <rct_optimizations/marginalization.h>
+#include <rct_optimizations/solver_options.h>
+#include <rct_optimizations/types.h>
+
+#include <ceres/problem.h>
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace rct_optimizations
+{
+class ExtrinsicHandEyeIncremental2D3D
+{
+public:
+  /**
+   * @brief Constructor
+   * @param params - The initial problem. Its guesses initialize the solution, and its observations, solver options and
+   * covariance mode are used by the calibration
+   * @param max_incremental_iterations - The maximum number of solver iterations of every solve after the first one. The first
+   * solve uses the maximum number of iterations of the solver options of the problem
+   * @throws std::runtime_error if the target features of an observation lie behind the camera at the guesses
+   */
+  explicit ExtrinsicHandEyeIncremental2D3D(const ExtrinsicHandEyeProblem2D3D& params,
+                                           const int max_incremental_iterations = 10);
+
+  ExtrinsicHandEyeIncremental2D3D(const ExtrinsicHandEyeIncremental2D3D&) = delete;
+  ExtrinsicHandEyeIncremental2D3D& operator=(const ExtrinsicHandEyeIncremental2D3D&) = delete;
+
+  /**
+   * @brief Adds an observation to the problem. Observations without correspondences are ignored
+   * @throws std::runtime_error if the target features of the observation lie behind the camera at the current solution, in
+   * which case the observation is not added
+   */
+  void addObservation(const Observation2D3D& observation);
+
+  /**
+   * @brief Adds a set of observations to the problem. Either all or none of the observations are added
+   * @throws std::runtime_error if the target features of any of the observations lie behind the camera at the current
+   * solution
+   */
+  void addObservations(const Observation2D3D::Set& observations);
+
+  /**
+   * @brief Solves the problem with all of the observations added so far, starting from the current solution.
+   * The covariance is computed for the entire problem on every solve; set the covariance mode of the initial problem to
+   * CovarianceMode::NONE for the fastest updates
+   * @throws OptimizationException if no observations have been added
+   */
+  ExtrinsicHandEyeResult solve();
+
+  /** @brief The number of observations (with correspondences) in the problem */
+  std::size_t numObservations() const;
+
+  /** @brief The current estimate of the transform from the camera mount to the camera */
+  Eigen::Isometry3d getCameraMountToCamera() const;
+
+  /** @brief The current estimate of the transform from the target mount to the target */
+  Eigen::Isometry3d getTargetMountToTarget() const;
+
+private:
+  CameraIntrinsics intr_;
+
+  /** @brief Optimization variables: the inverse of the camera mount to camera transform and the target mount to target
+   * transform. The Ceres problem refers to these parameter blocks directly, so the object cannot be copied or moved */
+  Pose6d camera_to_camera_mount_;
+  Pose6d target_mount_to_target_;
+
+  ceres::Problem problem_;
+  ceres::Solver::Options solver_options_;
+  SolverProfile solver_profile_;
+  CovarianceMode covariance_mode_;
+  int max_incremental_iterations_;
+  bool solved_;
+
+  std::map<const double*, std::vector<std::string>> param_labels_;
+};
+
+/**
+ * @brief Online hand-eye calibration of a 2D camera over a sliding window of the most recent observations.
+ *
+ * Observations are consumed one at a time. When the window is full, the oldest observation is marginalized: its residuals
+ * are linearized at the current estimate and combined with the existing prior into a Gaussian prior on the calibration,
+ * which replaces them in the problem (see @ref MarginalizationPrior). Every update adds one observation, marginalizes at most one, and runs a bounded number of
+ * solver iterations, so its cost does not grow with the number of observations consumed.
+ */
+class ExtrinsicHandEyeSlidingWindow2D3D
+{
+public:
+  /**
+   * @brief Constructor
+   * @param params - The initial problem. Its guesses initialize the estimate, and its solver options and covariance mode are
+   * used by every update. Its observations, if any, are solved with the maximum number of iterations of the solver options,
+   * after which the oldest of them are marginalized down to the size of the window. Its pose parameterization is not used:
+   * the marginalization prior is a quadratic in the angle-axis values, so the orientations are always updated additively
+   * @param window_size - The maximum number of observations in the window
+   * @param max_update_iterations - The maximum number of solver iterations of each update
+   * @throws OptimizationException if the window size is zero
+   * @throws std::runtime_error if the target features of an observation lie behind the camera at the guesses
+   */
+  explicit ExtrinsicHandEyeSlidingWindow2D3D(const ExtrinsicHandEyeProblem2D3D& params,
+                                             const std::size_t window_size = 20,
+                                             const int max_update_iterations = 5);
+
+  ExtrinsicHandEyeSlidingWindow2D3D(const ExtrinsicHandEyeSlidingWindow2D3D&) = delete;
+  ExtrinsicHandEyeSlidingWindow2D3D& operator=(const ExtrinsicHandEyeSlidingWindow2D3D&) = delete;
+
+  /**
+   * @brief Adds an observation to the window, marginalizing the oldest observation if the window is full, and updates the
+   * estimate starting from the previous one. Observations without correspondences do not change the window.
+   * The cost per observation of the result includes the residuals of the prior
+   * @throws std::runtime_error if the target features of the observation lie behind the camera at the current estimate, in
+   * which case the observation is not added
+   * @throws OptimizationException if neither the window nor the prior contain any observations
+   */
+  ExtrinsicHandEyeResult update(const Observation2D3D& observation);
+
+  /** @brief The number of observations in the window */
+  std::size_t numObservations() const;
+
+  /** @brief The number of observations that have been marginalized into the prior */
+  std::size_t numMarginalizedObservations() const;
+
+  /** @brief The current estimate of the transform from the camera mount to the camera */
+  Eigen::Isometry3d getCameraMountToCamera() const;
+
+  /** @brief The current estimate of the transform from the target mount to the target */
+  Eigen::Isometry3d getTargetMountToTarget() const;
+
+private:
+  /** @brief Adds the residual block of an observation to the end of the window */
+  void addToWindow(const Observation2D3D& observation);
+
+  /** @brief Marginalizes the oldest observation of the window into the prior */
+  void marginalizeOldest();
+
+  /** @brief Solves the problem with the given maximum number of iterations */
+  ExtrinsicHandEyeResult solve(const int max_iterations);
+
+  CameraIntrinsics intr_;
+
+  /** @brief Optimization variables (see @ref ExtrinsicHandEyeIncremental2D3D) */
+  Pose6d camera_to_camera_mount_;
+  Pose6d target_mount_to_target_;
+
+  ceres::Problem problem_;
+  ceres::Solver::Options solver_options_;
+  SolverProfile solver_profile_;
+  CovarianceMode covariance_mode_;
+  std::size_t window_size_;
+  int max_update_iterations_;
+
+  /** @brief Residual blocks of the observations in the window, from oldest to newest */
+  std::deque<ceres::ResidualBlockId> window_;
+  std::size_t num_marginalized_;
+
+  /** @brief Prior on the parameters [camera_to_camera_mount, target_mount_to_target] */
+  MarginalizationPrior prior_;
+
+  std::map<const double*, std::vector<std::string>> param_labels_;
+};
+
+} // namespace rct_optimizations
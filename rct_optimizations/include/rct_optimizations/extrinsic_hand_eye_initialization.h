@@ -0,0 +1,77 @@
+/*
+ * This file defines closed-form estimators for the initial guesses of the extrinsic hand-eye calibration problems
+ * (see extrinsic_hand_eye.h). They do not require any prior knowledge of the transforms being calibrated, so the
+ * nonlinear optimization can be started close to its optimum without hand-tuned guesses.
+ */
+#pragma once
+
+#include <rct_optimizations/extrinsic_hand_eye.h>
+#include <Eigen/Geometry>
+#include <vector>
+
+namespace rct_optimizations
+{
+/**
+ * @brief Solves the hand-eye equation A_i * X = X * B_i for X in closed form (Park & Martin, "Robot Sensor Calibration:
+ * Solving AX = XB on the Euclidean Group").
+ *
+ * The rotation is the least-squares rotation between the angle-axis vectors of B_i and A_i, and the translation is the
+ * linear least-squares solution of (R_A_i - I) * t_X = R_X * t_B_i - t_A_i.
+ * Motion pairs with a rotation angle close to pi are ignored because the direction of their rotation axis is ambiguous.
+ * @param a - The motions A_i
+ * @param b - The motions B_i (same size as @ref a)
+ * @return X
+ * @throws Exception if the sizes of the inputs do not match, or if the motions do not contain rotations about at least two
+ * non-parallel axes (in which case X is not observable)
+ */
+Eigen::Isometry3d solveAXXB(const std::vector<Eigen::Isometry3d>& a, const std::vector<Eigen::Isometry3d>& b);
+
+/**
+ * @brief Estimates the hand-eye transforms from the camera to target pose measured in each observation.
+ *
+ * For each observation i, the unknown transforms satisfy
+ *
+ *   to_camera_mount_i * camera_mount_to_camera * camera_to_target_i = to_target_mount_i * target_mount_to_target
+ *
+ * Eliminating target_mount_to_target for each pair of observations (i, j) gives an AX = XB problem in
+ * camera_mount_to_camera, which is solved with @ref solveAXXB. The target mount to target transform is then the average of
+ * its estimates from each observation.
+ * @param to_camera_mount - The transform to the camera mount of each observation
+ * @param to_target_mount - The transform to the target mount of each observation
+ * @param camera_to_target - The camera to target pose measured in each observation
+ * @param camera_mount_to_camera - Output estimate of the camera mount to camera transform
+ * @param target_mount_to_target - Output estimate of the target mount to target transform
+ * @throws Exception if the sizes of the inputs do not match, if there are fewer than 3 observations, or if the motion of
+ * the observations is degenerate
+ */
+void estimateHandEye(const std::vector<Eigen::Isometry3d>& to_camera_mount,
+                     const std::vector<Eigen::Isometry3d>& to_target_mount,
+                     const std::vector<Eigen::Isometry3d>& camera_to_target,
+                     Eigen::Isometry3d& camera_mount_to_camera,
+                     Eigen::Isometry3d& target_mount_to_target);
+
+/**
+ * @brief Computes closed-form estimates of the camera mount to camera and target mount to target transforms and stores them
+ * in the guesses of the input problem.
+ *
+ * The camera to target pose of each observation is estimated with @ref estimatePlanarPose, and the hand-eye transforms are
+ * estimated from these poses with @ref estimateHandEye. Observations whose correspondences do not determine a pose (e.g.
+ * fewer than 4 correspondences, or correspondences on a single line) are ignored
+ * @param problem - The problem whose guesses should be initialized
+ * @throws Exception if the guesses cannot be estimated (see @ref estimateHandEye)
+ */
+void initializeGuesses(ExtrinsicHandEyeProblem2D3D& problem);
+
+/**
+ * @brief Computes closed-form estimates of the camera mount to camera and target mount to target transforms and stores them
+ * in the guesses of the input problem.
+ *
+ * The camera to target pose of each observation is estimated with @ref estimatePose3D, and the hand-eye transforms are
+ * estimated from these poses with @ref estimateHandEye. Observations whose correspondences do not determine a pose (e.g.
+ * fewer than 3 correspondences, or correspondences on a single line) are ignored
+ * @param problem - The problem whose guesses should be initialized
+ * @throws Exception if the guesses cannot be estimated (see @ref estimateHandEye)
+ */
+void initializeGuesses(ExtrinsicHandEyeProblem3D3D& problem);
+
+} // namespace rct_optimizations
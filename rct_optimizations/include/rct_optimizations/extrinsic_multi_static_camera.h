@@ -16,6 +16,7 @@
 #define RCT_EXTRINSIC_MULTI_STATIC_CAMERA_H
 
 #include <rct_optimizations/covariance_types.h>
+#include <rct_optimizations/solver_options.h>
 #include <rct_optimizations/types.h>
 #include <Eigen/Dense>
 #include <vector>
@@ -48,6 +49,16 @@ struct ExtrinsicMultiStaticCameraMovingTargetProblem
   /** @brief Your best guess at the "base frame" to "camera frame" transform; one for each camera */
   std::vector<Eigen::Isometry3d> base_to_camera_guess;
 
+  /** @brief How much of the covariance of the optimized parameters to compute */
+  CovarianceMode covariance_mode = CovarianceMode::FULL;
+
+  /** @brief Options of the nonlinear least-squares solver */
+  ceres::Solver::Options solver_options = DefaultSolverOptions(50);
+  /** @brief How the linear solver, number of threads and elimination ordering of @ref solver_options are chosen */
+  SolverProfile solver_profile = SolverProfile::AUTOMATIC;
+  /** @brief How the solver updates the orientations of the estimated poses */
+  PoseParameterization pose_parameterization = PoseParameterization::ANGLE_AXIS;
+
   const std::array<std::string, 6> labels_isometry3d = {{"x", "y", "z", "rx", "ry", "rz"}};
 
   std::string label_wrist_to_target = "wrist_to_target";
@@ -16,6 +16,7 @@
 #define RCT_EXTRINSIC_MULTI_STATIC_CAMERA_ONLY_H
 
 #include <rct_optimizations/covariance_types.h>
+#include <rct_optimizations/solver_options.h>
 #include <rct_optimizations/types.h>
 #include <Eigen/Dense>
 #include <vector>
@@ -50,6 +51,16 @@ struct ExtrinsicMultiStaticCameraOnlyProblem
   /** @brief Your best guess at the "base frame" to "camera frame" transform; one for each camera */
   std::vector<Eigen::Isometry3d> base_to_camera_guess;
 
+  /** @brief How much of the covariance of the optimized parameters to compute */
+  CovarianceMode covariance_mode = CovarianceMode::FULL;
+
+  /** @brief Options of the nonlinear least-squares solver */
+  ceres::Solver::Options solver_options = DefaultSolverOptions(50);
+  /** @brief How the linear solver, number of threads and elimination ordering of @ref solver_options are chosen */
+  SolverProfile solver_profile = SolverProfile::AUTOMATIC;
+  /** @brief How the solver updates the orientations of the estimated poses */
+  PoseParameterization pose_parameterization = PoseParameterization::ANGLE_AXIS;
+
   std::array<std::string, 6> labels_isometry3d = {{"x", "y", "z", "rx", "ry", "rz"}};
 
   std::string label_base_to_target = "base_to_target";
@@ -88,6 +99,10 @@ struct ExtrinsicMultiStaticCameraOnlyResult
   /** @brief The final calibrated result of "base frame" to "camera optical frame". */
   std::vector<Eigen::Isometry3d> base_to_camera;
 
+  /**
+   * @brief Covariance of the camera poses, marginalized over the target poses. It is only computed when the first camera is
+   * fixed; otherwise the choice of base frame is unobservable and the covariance is left empty
+   */
   CovarianceResult covariance;
 };
 
@@ -17,6 +17,7 @@
 
 #include <rct_optimizations/types.h>
 #include <rct_optimizations/covariance_types.h>
+#include <rct_optimizations/solver_options.h>
 #include <Eigen/Dense>
 #include <vector>
 
@@ -51,6 +52,13 @@ struct ExtrinsicMultiStaticCameraMovingTargetWristOnlyProblem
     */
   std::vector<Eigen::Isometry3d> base_to_camera_guess;
 
+  /** @brief Options of the nonlinear least-squares solver */
+  ceres::Solver::Options solver_options = DefaultSolverOptions(50);
+  /** @brief How the linear solver, number of threads and elimination ordering of @ref solver_options are chosen */
+  SolverProfile solver_profile = SolverProfile::AUTOMATIC;
+  /** @brief How the solver updates the orientations of the estimated poses */
+  PoseParameterization pose_parameterization = PoseParameterization::ANGLE_AXIS;
+
   const std::array<std::string, 6> labels_isometry3d = {{"x", "y", "z", "rx", "ry", "rz"}};
 
   std::string label_wrist_to_target = "wrist_to_target";
@@ -0,0 +1,422 @@
+#pragma once
+
+#include <rct_optimizations/ceres_math_utilities.h>
+#include <rct_optimizations/types.h>
+
+#include <ceres/rotation.h>
+#include <ceres/sized_cost_function.h>
+#include <array>
+#include <cmath>
+#include <type_traits>
+
+namespace rct_optimizations
+{
+/**
+ * @brief Cost function for all of the feature correspondences observed in a single image of a calibration target.
+ *
+ * The target points are transformed into the camera frame by a chain of pose parameters and constant transforms:
+ *
+ *   camera_point = camera_to_a * A * a_to_b * B * target_point
+ *
+ * where A and B are pose parameter blocks (ordered [rx, ry, rz, x, y, z]) and camera_to_a and a_to_b are constant.
+ * When the cost is used with a single pose parameter block, that block is B and A is identity.
+ * For 2D images the camera points are projected into the image with the camera model policy (see @ref CameraModel) and
+ * compared to the observed features; for 3D "images" the camera points are compared directly and the camera model is unused.
+ * The camera intrinsic and distortion parameters are constant.
+ *
+ * Rather than creating one residual block per correspondence, this class owns all of the correspondences of an image in
+ * contiguous storage and generates 2 (or 3) residuals per correspondence. The pose parameters are converted into rotation
+ * matrices and composed with the constant transforms (see @ref ConstantTransform) once per evaluation, after which each point
+ * costs a single 3x4 transform.
+ * Use with ceres::AutoDiffCostFunction<ImageObservationCost<DIM>, ceres::DYNAMIC, 6[, 6]> and @ref numResiduals
+ */
+template<Eigen::Index IMAGE_DIM, typename CameraModelT = PinholeModel>
+class ImageObservationCost
+{
+public:
+  using CorrespondenceSet = typename Correspondence<IMAGE_DIM, 3>::Set;
+  using DistortionParams = std::array<double, CameraModelT::NUM_DISTORTION_PARAMS>;
+
+  /**
+   * @brief Constructor for 2D images
+   * @param correspondences - The feature correspondences of the image
+   * @param intr - The intrinsic parameters of the camera
+   * @param camera_to_a - Constant transform from the output frame of pose parameter A to the camera
+   * @param a_to_b - Constant transform from the output frame of pose parameter B to the input frame of pose parameter A
+   */
+  template<Eigen::Index D = IMAGE_DIM, typename std::enable_if<D == 2, int>::type = 0>
+  ImageObservationCost(const CorrespondenceSet& correspondences,
+                       const CameraIntrinsics& intr,
+                       const Eigen::Isometry3d& camera_to_a = Eigen::Isometry3d::Identity(),
+                       const Eigen::Isometry3d& a_to_b = Eigen::Isometry3d::Identity())
+    : ImageObservationCost(correspondences, camera_to_a, a_to_b, intr)
+  {
+  }
+
+  /**
+   * @brief Constructor for 2D images with a camera model that has lens distortion
+   * @param correspondences - The feature correspondences of the image
+   * @param intr - The intrinsic parameters of the camera
+   * @param distortion - The distortion parameters of the camera, ordered as defined by the camera model
+   * @param camera_to_a - Constant transform from the output frame of pose parameter A to the camera
+   * @param a_to_b - Constant transform from the output frame of pose parameter B to the input frame of pose parameter A
+   */
+  template<Eigen::Index D = IMAGE_DIM,
+           typename std::enable_if<D == 2 && (CameraModelT::NUM_DISTORTION_PARAMS > 0), int>::type = 0>
+  ImageObservationCost(const CorrespondenceSet& correspondences,
+                       const CameraIntrinsics& intr,
+                       const DistortionParams& distortion,
+                       const Eigen::Isometry3d& camera_to_a = Eigen::Isometry3d::Identity(),
+                       const Eigen::Isometry3d& a_to_b = Eigen::Isometry3d::Identity())
+    : ImageObservationCost(correspondences, camera_to_a, a_to_b, intr, distortion)
+  {
+  }
+
+  /**
+   * @brief Constructor for 3D images
+   * @param correspondences - The feature correspondences of the image
+   * @param camera_to_a - Constant transform from the output frame of pose parameter A to the camera
+   * @param a_to_b - Constant transform from the output frame of pose parameter B to the input frame of pose parameter A
+   */
+  template<Eigen::Index D = IMAGE_DIM, typename std::enable_if<D == 3, int>::type = 0>
+  ImageObservationCost(const CorrespondenceSet& correspondences,
+                       const Eigen::Isometry3d& camera_to_a = Eigen::Isometry3d::Identity(),
+                       const Eigen::Isometry3d& a_to_b = Eigen::Isometry3d::Identity())
+    : ImageObservationCost(correspondences, camera_to_a, a_to_b, CameraIntrinsics())
+  {
+  }
+
+  /**
+   * @brief Returns the number of residuals generated by this cost
+   */
+  int numResiduals() const { return static_cast<int>(IMAGE_DIM * target_points_.cols()); }
+
+  /**
+   * @brief Computes the residuals for two pose parameters A and B
+   */
+  template<typename T>
+  bool operator()(const T* const pose_a, const T* const pose_b, T* residual) const
+  {
+    Eigen::Matrix<T, 3, 3> rotation_a, rotation_b;
+    ceres::AngleAxisToRotationMatrix(pose_a, rotation_a.data());
+    ceres::AngleAxisToRotationMatrix(pose_b, rotation_b.data());
+    const Eigen::Matrix<T, 3, 1> translation_a(pose_a[3], pose_a[4], pose_a[5]);
+    const Eigen::Matrix<T, 3, 1> translation_b(pose_b[3], pose_b[4], pose_b[5]);
+
+    // camera_to_b = camera_to_a * A * a_to_b * B
+    // The constant transforms are applied with double coefficients, so only the product of the two parameter rotations
+    // requires T x T arithmetic
+    const Eigen::Matrix<T, 3, 3> camera_to_a_rotation_a = camera_to_a_.rotate(rotation_a);
+    const Eigen::Matrix<T, 3, 3> rotation = camera_to_a_rotation_a * a_to_b_.rotate(rotation_b);
+    const Eigen::Matrix<T, 3, 1> translation = camera_to_a_rotation_a * (a_to_b_ * translation_b) + camera_to_a_ * translation_a;
+
+    return computeResiduals(rotation, translation, residual);
+  }
+
+  /**
+   * @brief Computes the residuals for a single pose parameter B
+   */
+  template<typename T>
+  bool operator()(const T* const pose_b, T* residual) const
+  {
+    Eigen::Matrix<T, 3, 3> rotation_b;
+    ceres::AngleAxisToRotationMatrix(pose_b, rotation_b.data());
+    const Eigen::Matrix<T, 3, 1> translation_b(pose_b[3], pose_b[4], pose_b[5]);
+
+    // camera_to_b = (camera_to_a * a_to_b) * B
+    const Eigen::Matrix<T, 3, 3> rotation = camera_to_a_b_.rotate(rotation_b);
+    const Eigen::Matrix<T, 3, 1> translation = camera_to_a_b_ * translation_b;
+
+    return computeResiduals(rotation, translation, residual);
+  }
+
+  /**
+   * @brief Transforms all of the target points into the camera frame for two pose parameters A and B
+   * @return 3 x N matrix of points in the camera frame
+   */
+  Eigen::Matrix3Xd getTargetPointsInCamera(const double* const pose_a, const double* const pose_b) const
+  {
+    const Eigen::Isometry3d camera_to_b = camera_to_a_.toIsometry() * poseToIsometry(pose_a) * a_to_b_.toIsometry()
+                                          * poseToIsometry(pose_b);
+    return camera_to_b * target_points_;
+  }
+
+  /**
+   * @brief Transforms all of the target points into the camera frame for a single pose parameter B
+   * @return 3 x N matrix of points in the camera frame
+   */
+  Eigen::Matrix3Xd getTargetPointsInCamera(const double* const pose_b) const
+  {
+    const Eigen::Isometry3d camera_to_b = camera_to_a_b_ * poseToIsometry(pose_b);
+    return camera_to_b * target_points_;
+  }
+
+protected:
+  ImageObservationCost(const CorrespondenceSet& correspondences,
+                       const Eigen::Isometry3d& camera_to_a,
+                       const Eigen::Isometry3d& a_to_b,
+                       const CameraIntrinsics& intr,
+                       const DistortionParams& distortion = DistortionParams())
+    : intr_(intr)
+    , distortion_(distortion)
+    , camera_to_a_(camera_to_a)
+    , a_to_b_(a_to_b)
+    , camera_to_a_b_(camera_to_a_ * a_to_b_)
+    , image_points_(IMAGE_DIM, correspondences.size())
+    , target_points_(3, correspondences.size())
+  {
+    for (std::size_t i = 0; i < correspondences.size(); ++i)
+    {
+      image_points_.col(i) = correspondences[i].in_image;
+      target_points_.col(i) = correspondences[i].in_target;
+    }
+  }
+
+  static Eigen::Isometry3d poseToIsometry(const double* const pose)
+  {
+    Eigen::Matrix3d rotation;
+    ceres::AngleAxisToRotationMatrix(pose, rotation.data());
+    Eigen::Isometry3d out(Eigen::Isometry3d::Identity());
+    out.linear() = rotation;
+    out.translation() = Eigen::Map<const Eigen::Vector3d>(pose + 3);
+    return out;
+  }
+
+  /**
+   * @brief Applies the composed camera to target transform to every target point and computes the residuals
+   */
+  template<typename T>
+  bool computeResiduals(const Eigen::Matrix<T, 3, 3>& rotation,
+                        const Eigen::Matrix<T, 3, 1>& translation,
+                        T* residual) const
+  {
+    for (Eigen::Index i = 0; i < target_points_.cols(); ++i)
+    {
+      const Eigen::Matrix<T, 3, 1> camera_point = rotation.col(0) * T(target_points_(0, i))
+                                                  + rotation.col(1) * T(target_points_(1, i))
+                                                  + rotation.col(2) * T(target_points_(2, i))
+                                                  + translation;
+      computeResidual(camera_point, i, residual + IMAGE_DIM * i, std::integral_constant<Eigen::Index, IMAGE_DIM>());
+    }
+    return true;
+  }
+
+  template<typename T>
+  void computeResidual(const Eigen::Matrix<T, 3, 1>& camera_point,
+                       const Eigen::Index i,
+                       T* residual,
+                       std::integral_constant<Eigen::Index, 2>) const
+  {
+    T xy_image[2];
+    CameraModelT::project(intr_.values.data(), distortion_.data(), camera_point.data(), xy_image);
+    residual[0] = xy_image[0] - image_points_(0, i);
+    residual[1] = xy_image[1] - image_points_(1, i);
+  }
+
+  template<typename T>
+  void computeResidual(const Eigen::Matrix<T, 3, 1>& camera_point,
+                       const Eigen::Index i,
+                       T* residual,
+                       std::integral_constant<Eigen::Index, 3>) const
+  {
+    residual[0] = camera_point(0) - image_points_(0, i);
+    residual[1] = camera_point(1) - image_points_(1, i);
+    residual[2] = camera_point(2) - image_points_(2, i);
+  }
+
+  /** @brief Camera intrinsic parameters (unused for 3D images) */
+  CameraIntrinsics intr_;
+  /** @brief Camera distortion parameters (unused for 3D images) */
+  DistortionParams distortion_;
+  /** @brief Constant transform from the output frame of pose parameter A to the camera */
+  ConstantTransform camera_to_a_;
+  /** @brief Constant transform from the output frame of pose parameter B to the input frame of pose parameter A */
+  ConstantTransform a_to_b_;
+  /** @brief Product of @ref camera_to_a_ and @ref a_to_b_, used when pose parameter A is not present */
+  ConstantTransform camera_to_a_b_;
+  /** @brief Observed features in the image (IMAGE_DIM x N) */
+  Eigen::Matrix<double, IMAGE_DIM, Eigen::Dynamic> image_points_;
+  /** @brief Corresponding features in the target frame (3 x N) */
+  Eigen::Matrix3Xd target_points_;
+
+public:
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+};
+
+/**
+ * @brief Returns the skew-symmetric (cross product) matrix [v]x of a vector
+ */
+inline Eigen::Matrix3d skewSymmetric(const Eigen::Vector3d& v)
+{
+  Eigen::Matrix3d out;
+  out << 0.0, -v.z(), v.y(),
+         v.z(), 0.0, -v.x(),
+         -v.y(), v.x(), 0.0;
+  return out;
+}
+
+/**
+ * @brief Computes the right Jacobian of SO(3) for an angle-axis vector, such that
+ * d(R(w) * p) / dw = -R(w) * [p]x * J_r(w)
+ */
+inline Eigen::Matrix3d rightJacobianSO3(const Eigen::Vector3d& angle_axis)
+{
+  const Eigen::Matrix3d skew = skewSymmetric(angle_axis);
+
+  const double theta_sq = angle_axis.squaredNorm();
+  double a, b;
+  if (theta_sq < 1.0e-10)
+  {
+    // Taylor series expansion for small angles
+    a = 0.5 - theta_sq / 24.0;
+    b = 1.0 / 6.0 - theta_sq / 120.0;
+  }
+  else
+  {
+    const double theta = std::sqrt(theta_sq);
+    a = (1.0 - std::cos(theta)) / theta_sq;
+    b = (theta - std::sin(theta)) / (theta_sq * theta);
+  }
+
+  return Eigen::Matrix3d::Identity() - a * skew + b * skew * skew;
+}
+
+/**
+ * @brief Analytic-Jacobian version of @ref ImageObservationCost for two pose parameters A and B:
+ *
+ *   camera_point = camera_to_a * A * a_to_b * B * target_point
+ *
+ * The Jacobians of the full transformation and projection chain are computed in closed form using the right Jacobian of SO(3),
+ * which avoids the overhead of propagating dual numbers through the rotation conversions and projections of every point.
+ * The residuals are identical to those of ceres::AutoDiffCostFunction<ImageObservationCost<IMAGE_DIM>, ceres::DYNAMIC, 6, 6>
+ */
+template<Eigen::Index IMAGE_DIM>
+class AnalyticImageObservationCost : public ceres::SizedCostFunction<ceres::DYNAMIC, 6, 6>
+                                   , protected ImageObservationCost<IMAGE_DIM>
+{
+public:
+  using Base = ImageObservationCost<IMAGE_DIM>;
+  using CorrespondenceSet = typename Base::CorrespondenceSet;
+
+  /**
+   * @brief Constructor for 2D images
+   * @param correspondences - The feature correspondences of the image
+   * @param intr - The intrinsic parameters of the camera
+   * @param camera_to_a - Constant transform from the output frame of pose parameter A to the camera
+   * @param a_to_b - Constant transform from the output frame of pose parameter B to the input frame of pose parameter A
+   */
+  template<Eigen::Index D = IMAGE_DIM, typename std::enable_if<D == 2, int>::type = 0>
+  AnalyticImageObservationCost(const CorrespondenceSet& correspondences,
+                               const CameraIntrinsics& intr,
+                               const Eigen::Isometry3d& camera_to_a = Eigen::Isometry3d::Identity(),
+                               const Eigen::Isometry3d& a_to_b = Eigen::Isometry3d::Identity())
+    : Base(correspondences, camera_to_a, a_to_b, intr)
+  {
+    set_num_residuals(Base::numResiduals());
+  }
+
+  /**
+   * @brief Constructor for 3D images
+   * @param correspondences - The feature correspondences of the image
+   * @param camera_to_a - Constant transform from the output frame of pose parameter A to the camera
+   * @param a_to_b - Constant transform from the output frame of pose parameter B to the input frame of pose parameter A
+   */
+  template<Eigen::Index D = IMAGE_DIM, typename std::enable_if<D == 3, int>::type = 0>
+  AnalyticImageObservationCost(const CorrespondenceSet& correspondences,
+                               const Eigen::Isometry3d& camera_to_a = Eigen::Isometry3d::Identity(),
+                               const Eigen::Isometry3d& a_to_b = Eigen::Isometry3d::Identity())
+    : Base(correspondences, camera_to_a, a_to_b, CameraIntrinsics())
+  {
+    set_num_residuals(Base::numResiduals());
+  }
+
+  using Base::getTargetPointsInCamera;
+
+  virtual bool Evaluate(double const* const* parameters, double* residuals, double** jacobians) const override
+  {
+    const double* pose_a = parameters[0];
+    const double* pose_b = parameters[1];
+
+    Eigen::Matrix3d rotation_a, rotation_b;
+    ceres::AngleAxisToRotationMatrix(pose_a, rotation_a.data());
+    ceres::AngleAxisToRotationMatrix(pose_b, rotation_b.data());
+    const Eigen::Map<const Eigen::Vector3d> translation_a(pose_a + 3);
+    const Eigen::Map<const Eigen::Vector3d> translation_b(pose_b + 3);
+
+    // camera_to_b = camera_to_a * A * a_to_b * B
+    const Eigen::Matrix3d camera_to_a_rotation = this->camera_to_a_.rotation();
+    const Eigen::Matrix3d camera_to_a_rotation_a = camera_to_a_rotation * rotation_a;
+    const Eigen::Matrix3d camera_to_b_frame_rotation = camera_to_a_rotation_a * this->a_to_b_.rotation();
+    const Eigen::Matrix3d rotation = camera_to_b_frame_rotation * rotation_b;
+    const Eigen::Vector3d a_origin = this->camera_to_a_ * Eigen::Vector3d(translation_a);
+    const Eigen::Vector3d translation = camera_to_a_rotation_a * (this->a_to_b_ * Eigen::Vector3d(translation_b)) + a_origin;
+
+    // d(camera_point)/d(rotation_a) = -[camera_point - a_origin]x * (camera_to_a_rotation_a * J_r(w_a))
+    // d(camera_point)/d(rotation_b) = -[camera_point - translation]x * (rotation * J_r(w_b))
+    Eigen::Matrix3d rotation_jacobian_a, rotation_jacobian_b;
+    if (jacobians != nullptr)
+    {
+      rotation_jacobian_a = camera_to_a_rotation_a * rightJacobianSO3(Eigen::Map<const Eigen::Vector3d>(pose_a));
+      rotation_jacobian_b = rotation * rightJacobianSO3(Eigen::Map<const Eigen::Vector3d>(pose_b));
+    }
+
+    using JacobianBlock = Eigen::Matrix<double, IMAGE_DIM, 6, Eigen::RowMajor>;
+    for (Eigen::Index i = 0; i < this->target_points_.cols(); ++i)
+    {
+      const Eigen::Vector3d camera_point = rotation * this->target_points_.col(i) + translation;
+      Base::computeResidual(camera_point, i, residuals + IMAGE_DIM * i, std::integral_constant<Eigen::Index, IMAGE_DIM>());
+
+      if (jacobians == nullptr)
+        continue;
+
+      const Eigen::Matrix<double, IMAGE_DIM, 3> projection_jacobian = computeProjectionJacobian(camera_point, std::integral_constant<Eigen::Index, IMAGE_DIM>());
+
+      if (jacobians[0] != nullptr)
+      {
+        Eigen::Map<JacobianBlock> jacobian(jacobians[0] + IMAGE_DIM * 6 * i);
+        jacobian.template leftCols<3>() = projection_jacobian * (-skewSymmetric(camera_point - a_origin) * rotation_jacobian_a);
+        jacobian.template rightCols<3>() = projection_jacobian * camera_to_a_rotation;
+      }
+
+      if (jacobians[1] != nullptr)
+      {
+        Eigen::Map<JacobianBlock> jacobian(jacobians[1] + IMAGE_DIM * 6 * i);
+        jacobian.template leftCols<3>() = projection_jacobian * (-skewSymmetric(camera_point - translation) * rotation_jacobian_b);
+        jacobian.template rightCols<3>() = projection_jacobian * camera_to_b_frame_rotation;
+      }
+    }
+
+    return true;
+  }
+
+protected:
+  /** @brief Jacobian of the pin-hole projection of @ref projectPoint with respect to the point in the camera frame */
+  Eigen::Matrix<double, 2, 3> computeProjectionJacobian(const Eigen::Vector3d& camera_point,
+                                                        std::integral_constant<Eigen::Index, 2>) const
+  {
+    Eigen::Matrix<double, 2, 3> out;
+    if (camera_point.z() == 0.0)
+    {
+      out << this->intr_.fx(), 0.0, 0.0,
+             0.0, this->intr_.fy(), 0.0;
+    }
+    else
+    {
+      const double z_inv = 1.0 / camera_point.z();
+      out << this->intr_.fx() * z_inv, 0.0, -this->intr_.fx() * camera_point.x() * z_inv * z_inv,
+             0.0, this->intr_.fy() * z_inv, -this->intr_.fy() * camera_point.y() * z_inv * z_inv;
+    }
+    return out;
+  }
+
+  /** @brief 3D "images" compare the camera points directly */
+  Eigen::Matrix3d computeProjectionJacobian(const Eigen::Vector3d&, std::integral_constant<Eigen::Index, 3>) const
+  {
+    return Eigen::Matrix3d::Identity();
+  }
+
+public:
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+};
+
+} // namespace rct_optimizations
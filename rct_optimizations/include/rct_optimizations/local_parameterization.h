@@ -3,6 +3,9 @@
 #include <Eigen/Core>
 #include <ceres/problem.h>
 #include <ceres/local_parameterization.h>
+#include <ceres/autodiff_local_parameterization.h>
+#include <ceres/rotation.h>
+#include <rct_optimizations/solver_options.h>
 #include <rct_optimizations/types.h>
 
 // Ceres Solver - A fast non-linear least squares minimizer
@@ -75,6 +78,96 @@ struct EigenQuaternionPlus
   }
 };
 
+/**
+ * @brief Local parameterization of an angle-axis vector on SO(3)
+ *
+ * The increment is a rotation vector which is composed with the orientation (x_plus_delta = log(exp(delta) * exp(x))), rather
+ * than added to the angle-axis vector. The step of the solver is therefore a rotation of the same size wherever the
+ * orientation is, and the resulting angle-axis vector always has an angle of at most pi.
+ */
+struct AngleAxisPlus
+{
+  template<typename T>
+  bool operator()(const T *x, const T *delta, T *x_plus_delta) const
+  {
+    // Ceres quaternions are stored as [w, x, y, z]
+    T q_x[4];
+    T q_delta[4];
+    T q[4];
+    ceres::AngleAxisToQuaternion(x, q_x);
+    ceres::AngleAxisToQuaternion(delta, q_delta);
+    ceres::QuaternionProduct(q_delta, q_x, q);
+    ceres::QuaternionToAngleAxis(q, x_plus_delta);
+    return true;
+  }
+};
+
+/**
+ * @brief Local parameterization of a @ref Pose6d ([rx, ry, rz, x, y, z]) on SE(3)
+ *
+ * The orientation is updated on SO(3) (see @ref AngleAxisPlus) and the translation is updated additively.
+ */
+struct Pose6dPlus
+{
+  template<typename T>
+  bool operator()(const T *x, const T *delta, T *x_plus_delta) const
+  {
+    AngleAxisPlus()(x, delta, x_plus_delta);
+    for (int i = 3; i < 6; ++i)
+      x_plus_delta[i] = x[i] + delta[i];
+    return true;
+  }
+};
+
+/**
+ * @brief Sets the local parameterization of a 3 element angle-axis parameter block of a problem
+ * @param problem - Ceres optimization problem
+ * @param angle_axis - The angle-axis parameter block. Nothing is set if the block is not in the problem
+ * @param parameterization - How the block is updated. Nothing is set for @ref PoseParameterization::ANGLE_AXIS
+ */
+inline void setAngleAxisParameterization(ceres::Problem& problem,
+                                         double* angle_axis,
+                                         const PoseParameterization parameterization)
+{
+  if (parameterization == PoseParameterization::MANIFOLD && problem.HasParameterBlock(angle_axis))
+    problem.SetParameterization(angle_axis, new ceres::AutoDiffLocalParameterization<AngleAxisPlus, 3, 3>());
+}
+
+/**
+ * @brief Sets the local parameterization of the 3 element angle-axis parameter blocks of a problem that have no masked
+ * elements. Masked blocks are left to @ref addSubsetParameterization, since their elements are held constant individually
+ * @param problem - Ceres optimization problem
+ * @param angle_axis_blocks - The angle-axis parameter blocks
+ * @param param_masks - A map of parameter block to the indices of its elements that should be held constant
+ * @param parameterization - How the blocks are updated. Nothing is set for @ref PoseParameterization::ANGLE_AXIS
+ */
+inline void setAngleAxisParameterization(ceres::Problem& problem,
+                                         const std::vector<double*>& angle_axis_blocks,
+                                         const std::map<const double*, std::vector<int>>& param_masks,
+                                         const PoseParameterization parameterization)
+{
+  for (double* angle_axis : angle_axis_blocks)
+  {
+    auto it = param_masks.find(angle_axis);
+    if (it == param_masks.end() || it->second.empty())
+      setAngleAxisParameterization(problem, angle_axis, parameterization);
+  }
+}
+
+/**
+ * @brief Sets the local parameterization of a 6 element @ref Pose6d parameter block of a problem
+ * @param problem - Ceres optimization problem
+ * @param pose - The pose parameter block. Nothing is set if the block is not in the problem
+ * @param parameterization - How the block is updated. Nothing is set for @ref PoseParameterization::ANGLE_AXIS
+ */
+inline void setPose6dParameterization(ceres::Problem& problem,
+                                      double* pose,
+                                      const PoseParameterization parameterization)
+{
+  if (parameterization == PoseParameterization::MANIFOLD && problem.HasParameterBlock(pose))
+    problem.SetParameterization(pose, new ceres::AutoDiffLocalParameterization<Pose6dPlus, 6, 6>());
+}
+
 /**
  * @brief Adds subset parameterization for all parameter blocks for a given problem
  * @param problem - Ceres optimization problem
@@ -83,7 +176,7 @@ struct EigenQuaternionPlus
  *   - If all parameters are masked it sets that block to constant
  * @throws OptimizationException
  */
-void addSubsetParameterization(ceres::Problem& problem, const std::map<const double*, std::vector<int>>& param_masks)
+inline void addSubsetParameterization(ceres::Problem& problem, const std::map<const double*, std::vector<int>>& param_masks)
 {
   if (param_masks.empty())
     return;
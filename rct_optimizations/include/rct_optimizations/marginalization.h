@@ -0,0 +1,81 @@
+#pragma once
+
+#include <Eigen/Core>
+#include <ceres/cost_function.h>
+#include <ceres/problem.h>
+#include <map>
+#include <vector>
+
+namespace rct_optimizations
+{
+/**
+ * @brief Evaluates the residuals of a cost function and its Jacobians with respect to each of its parameter blocks, at the
+ * current values of the parameters
+ * @param jacobians - Output Jacobians (num_residuals x block size), in the order of the parameter blocks
+ * @return The residuals
+ * @throws OptimizationException if the cost function cannot be evaluated
+ */
+Eigen::VectorXd evaluateJacobians(const ceres::CostFunction& cost_fn,
+                                  const std::vector<double*>& parameters,
+                                  std::vector<Eigen::MatrixXd>& jacobians);
+
+/**
+ * @brief Gaussian prior on a set of parameter blocks of a Ceres problem, built by marginalizing residual blocks out of the
+ * problem (e.g. the oldest observations of a sliding window estimator).
+ *
+ * When a residual block is marginalized, its residuals are linearized at the current values of the parameters and combined
+ * with the existing prior:
+ *   information = prior_information + J^T * J
+ *   mean = x - information^-1 * gradient
+ * where the gradient of both terms is evaluated at the current values x. The information matrix is singular until the
+ * marginalized residuals constrain all of the parameters, so it is inverted in the subspace of its non-zero eigenvalues.
+ * The prior is applied to the problem as a @ref MaximumLikelihood cost on the projections of the parameters onto these
+ * eigenvectors, along which they are independent, so that the directions which the marginalized residuals do not constrain
+ * remain free.
+ *
+ * Parameters that are held constant (parameter blocks set constant, and the masked elements of parameter blocks with a
+ * subset parameterization) are treated as constants of the linearized residuals. The prior is defined on the ambient
+ * parameters, so the parameter blocks should not have other local parameterizations.
+ */
+class MarginalizationPrior
+{
+public:
+  /**
+   * @brief Constructor
+   * @param parameters - The parameter blocks of the prior
+   * @param sizes - The size of each of the parameter blocks
+   * @param masks - The indices of the elements of each parameter block that are held constant by a subset parameterization
+   * (see @ref addSubsetParameterization)
+   * @throws OptimizationException if the number of parameter blocks and sizes differ
+   */
+  MarginalizationPrior(const std::vector<double*>& parameters,
+                       const std::vector<int>& sizes,
+                       const std::map<const double*, std::vector<int>>& masks = {});
+
+  /**
+   * @brief Linearizes a residual block of the problem at the current values of its parameters, adds it to the prior and
+   * removes it from the problem. The residual block of the prior in the problem is replaced by one for the updated prior
+   * @throws OptimizationException if the residual block depends on a parameter block that is neither a block of the prior
+   * nor constant, or if its residuals cannot be evaluated
+   */
+  void marginalize(ceres::Problem& problem, const ceres::ResidualBlockId residual_block);
+
+  /** @brief The mean of the parameters, concatenated in the order of the parameter blocks */
+  const Eigen::VectorXd& getMean() const { return mean_; }
+
+  /** @brief The information matrix of the parameters, concatenated in the order of the parameter blocks */
+  const Eigen::MatrixXd& getInformation() const { return information_; }
+
+private:
+  std::vector<double*> parameters_;
+  std::vector<int> sizes_;
+  /** @brief Whether each of the concatenated parameters is held constant by a subset parameterization */
+  std::vector<bool> masked_;
+
+  Eigen::VectorXd mean_;
+  Eigen::MatrixXd information_;
+  /** @brief Residual block of the prior; null until a residual block has been marginalized */
+  ceres::ResidualBlockId residual_block_;
+};
+
+} // namespace rct_optimizations
@@ -0,0 +1,95 @@
+/*
+ * This file defines tools for selecting the most informative subset of the observations of a calibration problem.
+ * Datasets often contain many near-redundant observations (e.g. poses close to one another) which increase the solve time
+ * without reducing the uncertainty of the calibration.
+ *
+ * The observations are selected greedily by D-optimality: at every step, the observation that most increases the
+ * determinant of the information matrix (J^T * J) of the calibrated parameters is added to the subset. The Jacobians of the
+ * observations are computed with the cost functions of the optimizations, evaluated in parallel at the guesses of the
+ * problem, so the guesses should be reasonably close to the solution (e.g. from extrinsic_hand_eye_initialization.h).
+ */
+#pragma once
+
+#include <rct_optimizations/dh_chain_kinematic_calibration.h>
+#include <rct_optimizations/extrinsic_hand_eye.h>
+
+#include <Eigen/Core>
+#include <vector>
+
+namespace rct_optimizations
+{
+struct ObservationSelectionOptions
+{
+  /** @brief Maximum number of observations to select. A value of 0 does not limit the number of observations */
+  std::size_t max_observations = 0;
+  /**
+   * @brief Minimum relative reduction of the uncertainty of the parameters for an observation to be selected. The
+   * uncertainty is the geometric mean of the standard deviations of the parameters, (det(information))^(-1 / (2 * number of
+   * parameters)). Since the information of similar observations adds up, this uncertainty only decreases with the square root
+   * of the number of observations once all of the parameters are constrained; the selection stops when the next
+   * observation would no longer be worth collecting or solving
+   */
+  double min_uncertainty_reduction = 0.01;
+  /**
+   * @brief D-efficiency of the subset at which the selection stops, in (0, 1]. The D-efficiency is
+   * (det(information of the subset) / det(information of all observations))^(1 / number of parameters), i.e. the ratio of
+   * the geometric mean of the variances of the parameters estimated from all of the observations to that from the subset.
+   * The default of 1 only stops the selection once it is as informative as all of the observations
+   */
+  double min_efficiency = 1.0;
+  /** @brief Maximum number of threads with which to evaluate the observations. A value of 0 selects the number of hardware threads */
+  std::size_t num_threads = 0;
+};
+
+struct ObservationSelectionResult
+{
+  /** @brief Indices of the selected observations, in the order in which they were selected */
+  std::vector<std::size_t> selected_observations;
+  /** @brief D-efficiency of the subset after each selection (see @ref ObservationSelectionOptions::min_efficiency) */
+  std::vector<double> efficiency;
+};
+
+/**
+ * @brief Greedily selects the subset of observations that maximizes the determinant of the information matrix, until the
+ * maximum number of observations or the target D-efficiency is reached, or the next observation would not reduce the
+ * uncertainty of the parameters by the minimum amount.
+ * A small multiple of the identity (relative to the information of all of the observations) regularizes the information
+ * matrices so that directions which the observations do not constrain do not make the determinants zero.
+ * @param jacobians - The Jacobian of the residuals of each observation with respect to the calibrated parameters
+ * (size: residuals of the observation x parameters). All of the Jacobians must have the same number of columns
+ * @param options - The selection options
+ * @param prior_information - The information matrix of a prior on the parameters (e.g. from @ref MaximumLikelihood costs)
+ * that applies to every subset. An empty matrix indicates no prior
+ * @throws OptimizationException if the Jacobians and the prior do not have the same number of columns
+ */
+ObservationSelectionResult selectObservations(const std::vector<Eigen::MatrixXd>& jacobians,
+                                              const ObservationSelectionOptions& options = ObservationSelectionOptions(),
+                                              const Eigen::MatrixXd& prior_information = Eigen::MatrixXd());
+
+/**
+ * @brief Computes the Jacobian of the residuals of each observation of a 2D camera hand-eye problem at the guesses, with
+ * respect to the parameters [camera_to_camera_mount, target_mount_to_target] of the optimization (see
+ * @ref AnalyticImageObservationCost)
+ * @param num_threads - The maximum number of threads. A value of 0 selects the number of hardware threads
+ */
+std::vector<Eigen::MatrixXd> computeObservationJacobians(const ExtrinsicHandEyeProblem2D3D& params,
+                                                         const std::size_t num_threads = 0);
+
+/**
+ * @brief Selects the most informative observations of a 2D camera hand-eye problem with respect to the camera mount to
+ * camera and target mount to target transforms
+ */
+ObservationSelectionResult selectObservations(const ExtrinsicHandEyeProblem2D3D& params,
+                                              const ObservationSelectionOptions& options = ObservationSelectionOptions());
+
+/**
+ * @brief Selects the most informative measurements of a kinematic calibration problem with respect to the parameters that
+ * are not masked, with the DH offsets at zero. The costs on the DH offsets (see
+ * @ref KinematicCalibrationProblemPose6D::camera_chain_offset_stdev) are included as a prior
+ * @param orientation_weight - The value by which the orientation residual should be scaled relative to the position residual
+ */
+ObservationSelectionResult selectObservations(const KinematicCalibrationProblemPose6D& params,
+                                              const ObservationSelectionOptions& options = ObservationSelectionOptions(),
+                                              const double orientation_weight = 100.0);
+
+} // namespace rct_optimizations
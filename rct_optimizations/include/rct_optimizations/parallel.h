@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+
+namespace rct_optimizations
+{
+/**
+ * @brief Returns the number of threads to use for a parallel operation
+ * @param num_threads - The requested number of threads. A value of 0 selects the number of hardware threads
+ * @return
+ */
+std::size_t getNumThreads(const std::size_t num_threads = 0);
+
+/**
+ * @brief Calls @ref fn once for every index in the range [0, n) using up to @ref num_threads threads.
+ * The range is split into contiguous chunks, one per thread, and the calling thread processes the first chunk.
+ * The callable must be safe to invoke concurrently for different indices.
+ * @param n - The number of indices
+ * @param fn - The function to call for each index
+ * @param num_threads - The maximum number of threads to use. A value of 0 selects the number of hardware threads
+ * @throws The first exception thrown by @ref fn, once all threads have finished
+ */
+void parallelFor(const std::size_t n, const std::function<void(std::size_t)>& fn, const std::size_t num_threads = 0);
+
+} // namespace rct_optimizations
@@ -2,6 +2,7 @@
 #define RCT_PNP_H
 
 #include <rct_optimizations/covariance_types.h>
+#include <rct_optimizations/solver_options.h>
 #include <rct_optimizations/types.h>
 
 namespace rct_optimizations
@@ -12,7 +13,32 @@ struct PnPProblem
   rct_optimizations::CameraIntrinsics intr;
   Correspondence2D3D::Set correspondences;
 
-  Eigen::Isometry3d camera_to_target_guess;
+  /** @brief Your best guess at the transform from the camera to the target; ignored if @ref use_closed_form_guess is true */
+  Eigen::Isometry3d camera_to_target_guess = Eigen::Isometry3d::Identity();
+
+  /** @brief If true, the guess is estimated in closed form with @ref estimatePlanarPose, which requires a planar target */
+  bool use_closed_form_guess = false;
+
+  /**
+   * @brief Maximum number of iterations of the nonlinear refinement of the guess.
+   * If 0, the guess is returned without refinement (and the result is reported as converged). This is the only iteration
+   * limit of the refinement: it replaces the maximum number of iterations of @ref solver_options, and it is also used by
+   * @ref optimizeBatch, which does not use Ceres
+   */
+  int max_refinement_iterations = 50;
+
+  /** @brief How much of the covariance of the optimized parameters to compute */
+  CovarianceMode covariance_mode = CovarianceMode::FULL;
+
+  /**
+   * @brief Options of the nonlinear least-squares solver. The maximum number of iterations is ignored in favor of
+   * @ref max_refinement_iterations
+   */
+  ceres::Solver::Options solver_options = DefaultSolverOptions();
+  /** @brief How the linear solver, number of threads and elimination ordering of @ref solver_options are chosen */
+  SolverProfile solver_profile = SolverProfile::AUTOMATIC;
+  /** @brief How the solver updates the orientations of the estimated poses */
+  PoseParameterization pose_parameterization = PoseParameterization::ANGLE_AXIS;
 
   std::string label_camera_to_target_guess = "camera_to_target";
   const std::array<std::string, 3> labels_translation = {{"x", "y", "z"}};
@@ -24,7 +50,37 @@ struct PnPProblem3D
 {
   Correspondence3D3D::Set correspondences;
 
-  Eigen::Isometry3d camera_to_target_guess;
+  /** @brief Optional weight of each correspondence (e.g. the inverse variance of the measurement). If empty, all of the
+   * correspondences have unit weight */
+  std::vector<double> weights;
+
+  /** @brief Your best guess at the transform from the camera to the target; ignored if @ref use_closed_form_guess is true */
+  Eigen::Isometry3d camera_to_target_guess = Eigen::Isometry3d::Identity();
+
+  /** @brief If true, the guess is estimated in closed form with @ref estimatePose3D */
+  bool use_closed_form_guess = true;
+
+  /**
+   * @brief Maximum number of iterations of the nonlinear refinement of the guess.
+   * If 0, the guess is returned without refinement (and the result is reported as converged). The closed-form estimate is
+   * already the weighted least-squares solution, so refinement is only necessary when starting from a different guess.
+   * This is the only iteration limit of the refinement: it replaces the maximum number of iterations of
+   * @ref solver_options, and it is also used by @ref optimizeBatch, which does not use Ceres
+   */
+  int max_refinement_iterations = 0;
+
+  /** @brief How much of the covariance of the optimized parameters to compute */
+  CovarianceMode covariance_mode = CovarianceMode::FULL;
+
+  /**
+   * @brief Options of the nonlinear least-squares solver. The maximum number of iterations is ignored in favor of
+   * @ref max_refinement_iterations
+   */
+  ceres::Solver::Options solver_options = DefaultSolverOptions();
+  /** @brief How the linear solver, number of threads and elimination ordering of @ref solver_options are chosen */
+  SolverProfile solver_profile = SolverProfile::AUTOMATIC;
+  /** @brief How the solver updates the orientations of the estimated poses */
+  PoseParameterization pose_parameterization = PoseParameterization::ANGLE_AXIS;
 
   std::string label_camera_to_target_guess = "camera_to_target";
   const std::array<std::string, 3> labels_translation = {{"x", "y", "z"}};
@@ -45,6 +101,60 @@ struct PnPResult
 PnPResult optimize(const PnPProblem& params);
 PnPResult optimize(const PnPProblem3D& params);
 
+/**
+ * @brief Solves a batch of independent PnP problems in parallel.
+ *
+ * Each problem is solved with a small, fixed-size Levenberg-Marquardt solver that uses the same parameterization, cost,
+ * and convergence tolerances as @ref optimize but does not create a Ceres problem, which makes it much faster for the
+ * many small problems of noise qualification and calibration validation. The covariance is computed from the Jacobian
+ * of the solution. Problems that cannot be solved (e.g. the closed-form guess or the covariance cannot be computed) are
+ * reported as not converged with infinite cost rather than throwing an exception.
+ * @param params - The problems to solve
+ * @param num_threads - The maximum number of threads to use. A value of 0 selects the number of hardware threads
+ * @return The result of each problem, in the order of the input problems
+ */
+std::vector<PnPResult> optimizeBatch(const std::vector<PnPProblem>& params, const std::size_t num_threads = 0);
+std::vector<PnPResult> optimizeBatch(const std::vector<PnPProblem3D>& params, const std::size_t num_threads = 0);
+
+/**
+ * @brief Estimates the camera to target transform in closed form for a planar target, without an initial guess.
+ *
+ * The homography between the plane of the target and the normalized image plane is computed with the normalized direct
+ * linear transform and decomposed into a rotation and translation (Zhang, "A Flexible New Technique for Camera Calibration").
+ * The target points may lie on any plane in the target frame; they do not need to have zero z-coordinates.
+ * The result is not a least-squares solution of the reprojection error, but it is close enough to the optimum to
+ * initialize @ref optimize
+ * @param intr - The camera intrinsic parameters
+ * @param correspondences - At least 4 correspondences whose target points lie on a plane
+ * @return The transform from the camera to the target
+ * @throws Exception if there are fewer than 4 correspondences or the target points are not planar
+ */
+Eigen::Isometry3d estimatePlanarPose(const CameraIntrinsics& intr, const Correspondence2D3D::Set& correspondences);
+
+/**
+ * @brief Computes the homography that maps the plane of the target points onto the image (in pixels) with the normalized
+ * direct linear transform. The homography is defined on the x-y plane of a frame whose origin is the centroid of the target
+ * points and whose z-axis is normal to their plane, so the target points do not need to have zero z-coordinates
+ * @param correspondences - At least 4 correspondences whose target points lie on a plane
+ * @param plane_to_target - Output: the transform from the plane frame of the homography to the target frame
+ * @return The homography H (with arbitrary scale) such that [u, v, 1]^T ~ H * [x, y, 1]^T for a point (x, y, 0) in the plane frame
+ * @throws Exception if there are fewer than 4 correspondences or the target points are not planar
+ */
+Eigen::Matrix3d estimateHomography(const Correspondence2D3D::Set& correspondences, Eigen::Isometry3d& plane_to_target);
+
+/**
+ * @brief Computes the camera to target transform that minimizes the (weighted) sum of squared distances between the
+ * measured points and the transformed target points in closed form (Umeyama, "Least-Squares Estimation of Transformation
+ * Parameters Between Two Point Patterns", without scaling)
+ * @param correspondences - At least 3 correspondences whose target points do not lie on a line
+ * @param weights - Optional non-negative weight of each correspondence. If empty, all of the correspondences have unit weight
+ * @return The transform from the camera to the target
+ * @throws Exception if the number of weights does not match the number of correspondences, or if the correspondences do
+ * not determine a unique transform
+ */
+Eigen::Isometry3d estimatePose3D(const Correspondence3D3D::Set& correspondences,
+                                 const std::vector<double>& weights = std::vector<double>());
+
 }
 
 #endif // RCT_PNP_H
@@ -0,0 +1,61 @@
+/*
+ * This file defines a planner of the poses at which to collect the observations of a calibration. Rather than visiting a
+ * fixed pattern of poses, the planner predicts the observation at each candidate pose (e.g. from a sampler of the
+ * workspace of the robot) with the current estimate of the calibration, and orders the candidates by how much they are
+ * predicted to reduce the uncertainty of the calibration (see observation_selection.h). Visiting only the first poses of
+ * the plan reduces the number of robot moves needed for a calibration.
+ */
+#pragma once
+
+#include <rct_optimizations/observation_selection.h>
+
+#include <Eigen/Geometry>
+#include <vector>
+
+namespace rct_optimizations
+{
+/**
+ * @brief A candidate pose of the robot at which an observation could be collected
+ */
+struct PoseCandidate
+{
+  /** @brief The transform from the camera base frame to the camera mount frame */
+  Eigen::Isometry3d to_camera_mount = Eigen::Isometry3d::Identity();
+  /** @brief The transform from the target base frame to the target mount frame */
+  Eigen::Isometry3d to_target_mount = Eigen::Isometry3d::Identity();
+};
+
+struct PosePlannerOptions : public ObservationSelectionOptions
+{
+  /** @brief Width of the image (pixels). Predicted target features outside of the image are not observed. A value of 0
+   * does not limit the image horizontally */
+  unsigned image_width = 0;
+  /** @brief Height of the image (pixels). A value of 0 does not limit the image vertically */
+  unsigned image_height = 0;
+  /** @brief Minimum number of target features that must be observed for a candidate pose to be used */
+  std::size_t min_correspondences = 4;
+};
+
+/**
+ * @brief Plans the poses at which to collect the observations of a 2D camera hand-eye calibration.
+ *
+ * The target features observed at each candidate pose are predicted from the guesses of the problem. The candidates are
+ * then selected greedily by the predicted increase of the determinant of the information matrix of the calibration
+ * (see @ref selectObservations), starting from the information of the observations already in the problem, until the
+ * maximum number of poses or the target D-efficiency (relative to visiting all of the candidates) is reached, or the next
+ * pose would not reduce the uncertainty of the calibration by the minimum amount.
+ * Candidates at which fewer than the minimum number of target features are observed are never selected.
+ *
+ * @param params - The current problem. Its guesses predict the observations, and its observations (if any) are the data
+ * already collected
+ * @param target_points - The positions of the target features in the target frame
+ * @param candidates - The candidate poses
+ * @param options - The planner options
+ * @return The indices of the candidates to visit, in order, and the predicted D-efficiency after each of them
+ */
+ObservationSelectionResult planPoses(const ExtrinsicHandEyeProblem2D3D& params,
+                                     const std::vector<Eigen::Vector3d>& target_points,
+                                     const std::vector<PoseCandidate>& candidates,
+                                     const PosePlannerOptions& options = PosePlannerOptions());
+
+} // namespace rct_optimizations
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+
+namespace rct_optimizations
+{
+/**
+ * @brief Counter-based pseudo-random number generator
+ * Each value is a pure function of a seed, a stream index, and a counter, computed with the SplitMix64 finalizer.
+ * Unlike sequential engines (e.g. std::mt19937), any value of any stream can be computed directly without generating the
+ * values before it. Multiple threads can therefore draw from the same generator (or from different streams of the same
+ * seed) without synchronization and produce results that do not depend on the number of threads or the order of evaluation.
+ *
+ * The stateful call operator satisfies the UniformRandomBitGenerator requirements so the generator can also be used with
+ * the standard library distributions. This interface is not thread-safe for a single instance.
+ */
+class CounterBasedRandomGenerator
+{
+public:
+  using result_type = std::uint64_t;
+
+  /**
+   * @brief Constructor
+   * @param seed - Seed value
+   * @param stream - Index of the stream of values within the seed
+   * @param counter - Counter of the first value returned by the stateful call operator
+   */
+  explicit CounterBasedRandomGenerator(const std::uint64_t seed,
+                                       const std::uint64_t stream = 0,
+                                       const std::uint64_t counter = 0)
+    : counter_(counter)
+    , key_(mix(mix(seed) + (stream + 1) * GOLDEN_GAMMA))
+  {
+  }
+
+  /**
+   * @brief Returns the value of the stream at the input counter, without modifying the state of the generator
+   */
+  inline result_type operator()(const std::uint64_t counter) const
+  {
+    return mix(key_ + (counter + 1) * GOLDEN_GAMMA);
+  }
+
+  /**
+   * @brief Returns the next value of the stream
+   */
+  inline result_type operator()() { return operator()(counter_++); }
+
+  /**
+   * @brief Returns a value uniformly distributed in [@ref min, @ref max) for the input counter
+   */
+  inline double uniform(const std::uint64_t counter, const double min, const double max) const
+  {
+    // Use the upper 53 bits to create a double in [0, 1)
+    const double u = static_cast<double>(operator()(counter) >> 11) * (1.0 / 9007199254740992.0);
+    return min + u * (max - min);
+  }
+
+  static constexpr result_type min() { return std::numeric_limits<result_type>::min(); }
+  static constexpr result_type max() { return std::numeric_limits<result_type>::max(); }
+
+private:
+  static constexpr std::uint64_t GOLDEN_GAMMA = 0x9E3779B97F4A7C15ULL;
+
+  /** @brief SplitMix64 finalizer */
+  static inline std::uint64_t mix(std::uint64_t z)
+  {
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+  }
+
+  std::uint64_t counter_;
+  std::uint64_t key_;
+};
+
+} // namespace rct_optimizations
@@ -0,0 +1,80 @@
+/*
+ * This file defines a random sample consensus (RANSAC) front end for the extrinsic calibration problems. A single bad
+ * observation (e.g. a target whose features were detected in the wrong order) can prevent these optimizations from
+ * converging to the correct answer, so the front end identifies the largest set of observations that are consistent with
+ * a single calibration and optimizes only those observations.
+ *
+ * Each iteration estimates the calibration in closed form from a random minimal subset of observations (see
+ * extrinsic_hand_eye_initialization.h) and scores every observation by its reprojection error. The iterations are
+ * evaluated in parallel; the random subset of each iteration depends only on the seed and the iteration index, so the
+ * results do not depend on the number of threads.
+ */
+#pragma once
+
+#include <rct_optimizations/extrinsic_hand_eye.h>
+#include <rct_optimizations/extrinsic_multi_static_camera.h>
+#include <cstdint>
+#include <vector>
+
+namespace rct_optimizations
+{
+struct RansacOptions
+{
+  /** @brief Number of random minimal subsets of observations to evaluate */
+  std::size_t max_iterations = 500;
+  /** @brief Maximum RMS reprojection error (pixels) of the correspondences of an observation for it to be an inlier */
+  double inlier_threshold = 2.0;
+  /** @brief Seed of the random subset selection */
+  std::uint64_t seed = 0;
+  /** @brief Maximum number of threads with which to evaluate the subsets. A value of 0 selects the number of hardware threads */
+  std::size_t num_threads = 0;
+};
+
+struct ExtrinsicHandEyeRansacResult : public ExtrinsicHandEyeResult
+{
+  /** @brief Indices of the observations of the input problem that were used in the optimization */
+  std::vector<std::size_t> inlier_observations;
+  /** @brief Indices of the observations of the input problem that were rejected as outliers */
+  std::vector<std::size_t> rejected_observations;
+};
+
+struct ExtrinsicMultiStaticCameraMovingTargetRansacResult : public ExtrinsicMultiStaticCameraMovingTargetResult
+{
+  /** @brief Indices of the observations of each camera that were used in the optimization */
+  std::vector<std::vector<std::size_t>> inlier_observations;
+  /** @brief Indices of the observations of each camera that were rejected as outliers */
+  std::vector<std::vector<std::size_t>> rejected_observations;
+  /**
+   * @brief Indices of the cameras for which no consistent set of observations could be found. All of the observations of
+   * these cameras, outliers included, were used in the optimization
+   */
+  std::vector<std::size_t> cameras_without_consensus;
+};
+
+/**
+ * @brief Rejects outlier observations of a hand-eye problem and optimizes the remaining observations.
+ *
+ * The closed-form estimate of the inlier observations replaces the guesses of the input problem.
+ * @throws OptimizationException if no consistent set of at least 3 observations can be found
+ */
+ExtrinsicHandEyeRansacResult optimizeRansac(const ExtrinsicHandEyeProblem2D3D& params,
+                                            const RansacOptions& options = RansacOptions());
+
+/**
+ * @brief Rejects outlier observations of a multi-camera problem and optimizes the remaining observations.
+ *
+ * Each camera is treated as an independent hand-eye problem (a static camera observing a target on the wrist) to find
+ * its inlier observations. The closed-form estimate of each camera replaces its base to camera guess, and the estimate
+ * of the camera with the most inliers replaces the wrist to target guess.
+ *
+ * A camera for which no consistent set of at least 3 observations can be found (e.g. because fewer than 3 of its
+ * observations yield a pose, or because no random subset agrees with 3 observations) keeps all of its observations,
+ * outliers included, and its input guess. These cameras are listed in
+ * @ref ExtrinsicMultiStaticCameraMovingTargetRansacResult::cameras_without_consensus.
+ * @throws OptimizationException if the numbers of intrinsics, wrist pose sets, observation sets and camera guesses, or the
+ * numbers of wrist poses and observations of a camera, do not match
+ */
+ExtrinsicMultiStaticCameraMovingTargetRansacResult optimizeRansac(const ExtrinsicMultiStaticCameraMovingTargetProblem& params,
+                                                                  const RansacOptions& options = RansacOptions());
+
+} // namespace rct_optimizations
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <ceres/problem.h>
+#include <ceres/solver.h>
+
+#include <cstddef>
+
+namespace rct_optimizations
+{
+/**
+ * @brief DefaultSolverOptions An instance of ceres::Solver::Options with values better suited to the optimizations in this library.
+ */
+struct DefaultSolverOptions : ceres::Solver::Options
+{
+  /**
+   * @brief Constructor
+   * @param max_num_iterations - The maximum number of iterations of the solver
+   */
+  explicit DefaultSolverOptions(const int max_num_iterations = 150)
+  {
+    this->max_num_iterations = max_num_iterations;
+  }
+};
+
+/**
+ * @brief Selects how the linear solver, the number of threads and the elimination ordering of an optimization are chosen
+ */
+enum class SolverProfile
+{
+  /** @brief The solver options of the problem are used as they are */
+  MANUAL,
+  /** @brief The linear solver, number of threads and elimination ordering are chosen from the structure and size of the
+   * problem with @ref configureSolverOptions; all other solver options are used as they are */
+  AUTOMATIC
+};
+
+/**
+ * @brief Selects how the solver updates the orientations of the poses of an optimization, which are stored as angle-axis
+ * vectors (e.g. @ref Pose6d). The optimizations default to ANGLE_AXIS; pose_parameterization_benchmark compares the
+ * convergence of both parameterizations
+ */
+enum class PoseParameterization
+{
+  /**
+   * @brief The angle-axis vectors are updated additively. The change in orientation produced by a step then depends on
+   * the orientation itself, and degenerates as the angle grows towards 2 * pi, which slows the convergence from guesses
+   * far from the solution
+   */
+  ANGLE_AXIS,
+  /** @brief The orientations are updated by composing them with a rotation on SO(3) (see @ref AngleAxisPlus) */
+  MANIFOLD
+};
+
+/**
+ * @brief Chooses the linear solver, the number of threads and the elimination ordering for a Ceres problem.
+ *
+ * Only the parameter blocks that are not held constant are considered, and the sizes are those of their local (tangent)
+ * parameterizations.
+ *  - Parameter blocks that are used by few residual blocks and never appear together in a residual block (e.g. the target
+ *    pose of each image in an intrinsic calibration) are eliminated first with a Schur complement solver if there are
+ *    several of them and they make up at least half of the parameters. The reduced system is factorized densely
+ *    (DENSE_SCHUR) unless it is large, in which case it is factorized sparsely (SPARSE_SCHUR) if a sparse linear algebra
+ *    library is available and solved iteratively (ITERATIVE_SCHUR) otherwise.
+ *  - Otherwise, problems with few parameters, or with a dense Jacobian, are solved with DENSE_QR. Large problems with a
+ *    sparse Jacobian are solved with SPARSE_NORMAL_CHOLESKY if a sparse linear algebra library is available.
+ *  - The residuals are evaluated with one thread per fixed amount of work (up to the number of residual blocks and the
+ *    maximum number of threads), so that small problems do not pay the overhead of threading.
+ *
+ * @param problem - The Ceres problem, with all of its residual blocks
+ * @param options - The solver options on which the configuration is based
+ * @param profile - If @ref SolverProfile::MANUAL, @ref options is returned without modification
+ * @param num_threads - The maximum number of threads. A value of 0 selects the number of hardware threads
+ * @return A copy of @ref options with the linear solver type, number of threads and linear solver ordering (and, where
+ * relevant, the sparse linear algebra library and preconditioner) replaced
+ */
+ceres::Solver::Options configureSolverOptions(const ceres::Problem& problem,
+                                              const ceres::Solver::Options& options,
+                                              const SolverProfile profile = SolverProfile::AUTOMATIC,
+                                              const std::size_t num_threads = 0);
+
+} // namespace rct_optimizations
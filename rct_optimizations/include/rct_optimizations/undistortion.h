@@ -0,0 +1,101 @@
+#pragma once
+
+#include <rct_optimizations/types.h>
+
+#include <array>
+#include <Eigen/Dense>
+
+namespace rct_optimizations
+{
+/**
+ * @brief Removes the lens distortion of the radial-tangential (Brown-Conrady) model estimated by the intrinsic calibration,
+ * i.e. the camera intrinsics [fx, fy, cx, cy] and the distortion parameters [k1, k2, p1, p2, k3] (see
+ * @ref RadialTangentialDistortion).
+ *
+ * The distortion has no closed-form inverse. Rather than inverting it iteratively from scratch for every point, the
+ * undistorted normalized coordinates are precomputed at the nodes of a grid over the image. A point is undistorted by
+ * bilinear interpolation of the grid, followed by a fixed number of Newton iterations that are evaluated for all of the
+ * points of a batch at once. Since the interpolated guess is already close to the solution, one or two iterations reach
+ * the accuracy of a full iterative inversion.
+ *
+ * Correspondences that have been undistorted can be used directly with the pin-hole solvers in this library (e.g. PnP or
+ * hand-eye calibration) and the same camera intrinsics, without evaluating the distortion model in their cost functions.
+ */
+class Undistorter
+{
+public:
+  /**
+   * @brief Constructor
+   * @param intr - The camera intrinsics
+   * @param distortion - The distortion parameters [k1, k2, p1, p2, k3]
+   * @param width - The width of the image (pixels)
+   * @param height - The height of the image (pixels)
+   * @param grid_spacing - The distance between the nodes of the lookup table (pixels)
+   * @param refinement_iterations - The number of Newton iterations applied to the interpolated value of each point
+   * @throws OptimizationException if the image size or grid spacing is not positive, or if the distortion cannot be
+   * inverted at a node of the grid (i.e. it is not monotonic over the image)
+   */
+  Undistorter(const CameraIntrinsics& intr,
+              const std::array<double, 5>& distortion,
+              const int width,
+              const int height,
+              const double grid_spacing = 8.0,
+              const unsigned refinement_iterations = 2);
+
+  /**
+   * @brief Computes the undistorted normalized image coordinates (i.e. on the plane z = 1 of the camera frame) of a batch
+   * of distorted image points
+   * @param image_points - 2 x N matrix of distorted image points (pixels)
+   * @return 2 x N matrix of undistorted normalized coordinates
+   */
+  Eigen::Matrix2Xd undistortPoints(const Eigen::Matrix2Xd& image_points) const;
+
+  /**
+   * @brief Computes the undistorted normalized image coordinates of a single distorted image point
+   */
+  Eigen::Vector2d undistortPoint(const Eigen::Vector2d& image_point) const;
+
+  /**
+   * @brief Undistorts the image features of a set of correspondences. The undistorted features are expressed in pixels
+   * of a pin-hole camera with the same intrinsics (i.e. they are the projections of the target features without distortion)
+   */
+  Correspondence2D3D::Set undistort(const Correspondence2D3D::Set& correspondences) const;
+
+  /**
+   * @brief Undistorts the image features of several sets of correspondences (e.g. the observations of a calibration) in a
+   * single batch
+   */
+  std::vector<Correspondence2D3D::Set> undistort(const std::vector<Correspondence2D3D::Set>& correspondence_sets) const;
+
+  /**
+   * @brief Applies the distortion to a batch of undistorted normalized image coordinates
+   * @param normalized_points - 2 x N matrix of undistorted normalized coordinates
+   * @return 2 x N matrix of distorted normalized coordinates
+   */
+  Eigen::Matrix2Xd distortPoints(const Eigen::Matrix2Xd& normalized_points) const;
+
+private:
+  /**
+   * @brief Refines the undistorted normalized coordinates of a batch of points with Newton's method
+   * @param distorted - The distorted normalized coordinates
+   * @param undistorted - Input: the initial guess. Output: the refined coordinates
+   * @param iterations - The number of iterations
+   */
+  void refine(const Eigen::Matrix2Xd& distorted, Eigen::Matrix2Xd& undistorted, const unsigned iterations) const;
+
+  /** @brief Converts image points (pixels) to distorted normalized coordinates */
+  Eigen::Matrix2Xd normalize(const Eigen::Matrix2Xd& image_points) const;
+
+  CameraIntrinsics intr_;
+  std::array<double, 5> distortion_;
+  double grid_spacing_;
+  unsigned refinement_iterations_;
+
+  /** @brief Number of grid nodes in the x and y directions */
+  Eigen::Index grid_cols_;
+  Eigen::Index grid_rows_;
+  /** @brief Undistorted normalized coordinates of the grid nodes; node (col, row) is column col + row * grid_cols_ */
+  Eigen::Matrix2Xd grid_;
+};
+
+} // namespace rct_optimizations
@@ -1,137 +1,30 @@
 #include "rct_optimizations/experimental/camera_intrinsic.h"
 
+#include <rct_optimizations/camera_model.h>
 #include <rct_optimizations/ceres_math_utilities.h>
 #include <rct_optimizations/covariance_analysis.h>
 #include <rct_optimizations/eigen_conversions.h>
+#include <rct_optimizations/local_parameterization.h>
+#include <rct_optimizations/parallel.h>
 #include <rct_optimizations/pnp.h>
 
 #include <ceres/ceres.h>
+#include <Eigen/Eigenvalues>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <sstream>
+#include <type_traits>
 
-namespace
-{
-
-template <typename T>
-struct CalibCameraIntrinsics
-{
-  const T* data;
-
-  CalibCameraIntrinsics(const T* data) : data(data) {}
-
-  const T& fx() const { return data[0]; }
-  const T& fy() const { return data[1]; }
-  const T& cx() const { return data[2]; }
-  const T& cy() const { return data[3]; }
-
-  const T& k1() const { return data[4]; }
-  const T& k2() const { return data[5]; }
-  const T& p1() const { return data[6]; }
-  const T& p2() const { return data[7]; }
-  const T& k3() const { return data[8]; }
-
-  constexpr static std::size_t size(){ return 9; }
-};
-
-template <typename T>
-struct MutableCalibCameraIntrinsics
-{
-  T* data;
-
-  MutableCalibCameraIntrinsics(T* data) : data(data) {}
-
-  const T& fx() const { return data[0]; }
-  const T& fy() const { return data[1]; }
-  const T& cx() const { return data[2]; }
-  const T& cy() const { return data[3]; }
-
-  const T& k1() const { return data[4]; }
-  const T& k2() const { return data[5]; }
-  const T& p1() const { return data[6]; }
-  const T& p2() const { return data[7]; }
-  const T& k3() const { return data[8]; }
-
-   T& fx()  { return data[0]; }
-   T& fy()  { return data[1]; }
-   T& cx()  { return data[2]; }
-   T& cy()  { return data[3]; }
-
-   T& k1()  { return data[4]; }
-   T& k2()  { return data[5]; }
-   T& p1()  { return data[6]; }
-   T& p2()  { return data[7]; }
-   T& k3()  { return data[8]; }
-
-  constexpr static std::size_t size(){ return 9; }
-};
-
-template <typename T>
-void projectPoints2(const T* const camera_intr, const T* const pt_in_camera, T* pt_in_image)
-{
-  T xp1 = pt_in_camera[0];
-  T yp1 = pt_in_camera[1];
-  T zp1 = pt_in_camera[2];
-
-  CalibCameraIntrinsics<T> intr (camera_intr);
-
-  // Scale into the image plane by distance away from camera
-  T xp;
-  T yp;
-  if (zp1 == T(0)) // Avoid dividing by zero.
-  {
-    xp = xp1;
-    yp = yp1;
-  }
-  else
-  {
-    xp = xp1 / zp1;
-    yp = yp1 / zp1;
-  }
-
-  // Temporary variables for distortion model.
-  T xp2 = xp * xp;    // x^2
-  T yp2 = yp * yp;    // y^2
-  T r2  = xp2 + yp2;  // r^2 radius squared
-  T r4  = r2 * r2;    // r^4
-  T r6  = r2 * r4;    // r^6
-
-  // Apply the distortion coefficients to refine pixel location
-  T xpp = xp
-    + intr.k1() * r2 * xp    // 2nd order term
-    + intr.k2() * r4 * xp    // 4th order term
-    + intr.k3() * r6 * xp    // 6th order term
-    + intr.p2() * (r2 + T(2.0) * xp2) // tangential
-    + intr.p1() * xp * yp * T(2.0); // other tangential term
-
-  T ypp = yp
-    + intr.k1() * r2 * yp    // 2nd order term
-    + intr.k2() * r4 * yp    // 4th order term
-    + intr.k3() * r6 * yp    // 6th order term
-    + intr.p1() * (r2 + T(2.0) * yp2) // tangential term
-    + intr.p2() * xp * yp * T(2.0); // other tangential term
-
-  // Perform projection using focal length and camera center into image plane
-  pt_in_image[0] = intr.fx() * xpp + intr.cx();
-  pt_in_image[1] = intr.fy() * ypp + intr.cy();
-}
+using namespace rct_optimizations;
 
-static rct_optimizations::Pose6d solvePnP(const rct_optimizations::CameraIntrinsics& intr,
-                                          const rct_optimizations::Correspondence2D3D::Set& obs,
-                                          const rct_optimizations::Pose6d& guess)
+namespace
 {
-  using namespace rct_optimizations;
-
-  PnPProblem problem;
-  problem.camera_to_target_guess = poseCalToEigen(guess);
-  problem.intr = intr;
-  problem.correspondences = obs;
-
-  PnPResult result = optimize(problem);
-
-  if (!result.converged) throw std::runtime_error("unable to solve PnP sub-problem");
-
-  return poseEigenToCal(result.camera_to_target);
-}
-
-
+/**
+ * @brief Reprojection error of a target point for a target pose and a camera parameter block ordered
+ * [fx, fy, cx, cy, distortion...] as defined by the camera model
+ */
+template<typename CameraModelT>
 class IntrinsicCostFunction
 {
 public:
@@ -140,7 +33,7 @@ public:
   {}
 
   template<typename T>
-  bool operator()(const T* const target_pose, const T* const camera_intr, T* const residual) const
+  bool operator()(const T* const target_pose, const T* const camera_params, T* const residual) const
   {
     const T* target_angle_axis = target_pose + 0;
     const T* target_position = target_pose + 3;
@@ -152,10 +45,10 @@ public:
     target_pt[2] = T(in_target_(2));
 
     T camera_point[3];  // Point in camera coordinates
-    rct_optimizations::transformPoint(target_angle_axis, target_position, target_pt, camera_point);
+    transformPoint(target_angle_axis, target_position, target_pt, camera_point);
 
     T xy_image[2];
-    projectPoints2(camera_intr, camera_point, xy_image);
+    CameraModelT::project(camera_params, camera_params + CameraModelT::NUM_INTRINSIC_PARAMS, camera_point, xy_image);
 
     residual[0] = xy_image[0] - in_image_.x();
     residual[1] = xy_image[1] - in_image_.y();
@@ -168,46 +61,90 @@ private:
   Eigen::Vector2d in_image_;
 };
 
-}
-
-static rct_optimizations::Pose6d guessInitialPose()
+/**
+ * @brief Computes the row of the linear system of Zhang's method that corresponds to the constraint h_i^T * B * h_j, where
+ * h_i and h_j are columns of a homography and B is the image of the absolute conic. With zero skew B12 = 0, so the unknowns
+ * are b = [B11, B22, B13, B23, B33]
+ */
+Eigen::Matrix<double, 1, 5> computeConicConstraint(const Eigen::Matrix3d& H, const Eigen::Index i, const Eigen::Index j)
 {
-  Eigen::Isometry3d guess = Eigen::Translation3d(0, 0, 0.5) * Eigen::AngleAxisd(M_PI, Eigen::Vector3d::UnitX());
-  return rct_optimizations::poseEigenToCal(guess);
+  Eigen::Matrix<double, 1, 5> v;
+  v << H(0, i) * H(0, j),
+       H(1, i) * H(1, j),
+       H(2, i) * H(0, j) + H(0, i) * H(2, j),
+       H(2, i) * H(1, j) + H(1, i) * H(2, j),
+       H(2, i) * H(2, j);
+  return v;
 }
 
-rct_optimizations::IntrinsicEstimationResult
-rct_optimizations::optimize(const rct_optimizations::IntrinsicEstimationProblem& params)
+/**
+ * @brief Intrinsic calibration with a compile-time camera model; the camera parameters are a single block ordered
+ * [fx, fy, cx, cy, distortion...]
+ */
+template<typename CameraModelT>
+IntrinsicEstimationResult optimizeIntrinsics(const IntrinsicEstimationProblem& params)
 {
-  // Prepare data structure for the camera parameters to optimize
-  std::array<double, CalibCameraIntrinsics<double>::size()> internal_intrinsics_data;
-  for (int i = 0; i < 9; ++i) internal_intrinsics_data[i] = 0.0;
+  // Prepare data structure for the camera parameters to optimize: [fx, fy, cx, cy, distortion...]
+  std::array<double, CameraModelT::NUM_PARAMS> camera_params;
+  camera_params.fill(0.0);
+
+  // Without a guess, estimate the intrinsics in closed form. The closed-form estimate of the radial distortion (k1, k2)
+  // only applies to the radial-tangential model; the other distortion models start from zero
+  CameraIntrinsics intrinsics_guess;
+  if (params.intrinsics_guess)
+  {
+    intrinsics_guess = *params.intrinsics_guess;
+  }
+  else
+  {
+    const bool estimate_distortion = std::is_same<typename CameraModelT::Distortion, RadialTangentialDistortion>::value;
+    const ClosedFormIntrinsicsResult closed_form = estimateIntrinsics(params.image_observations, estimate_distortion);
+    intrinsics_guess = closed_form.intrinsics;
+    std::copy_n(closed_form.distortions.begin(), CameraModelT::NUM_DISTORTION_PARAMS,
+                camera_params.begin() + CameraModelT::NUM_INTRINSIC_PARAMS);
+  }
 
-  MutableCalibCameraIntrinsics<double> internal_intrinsics (internal_intrinsics_data.data());
-  internal_intrinsics.fx() = params.intrinsics_guess.fx();
-  internal_intrinsics.fy() = params.intrinsics_guess.fy();
-  internal_intrinsics.cx() = params.intrinsics_guess.cx();
-  internal_intrinsics.cy() = params.intrinsics_guess.cy();
+  std::copy(intrinsics_guess.values.begin(), intrinsics_guess.values.end(), camera_params.begin());
 
   // Prepare space for the target poses to estimate (1 for each observation set)
   std::vector<Pose6d> internal_poses(params.image_observations.size());
   std::vector<std::size_t> valid_idx;
 
-  // All of the target poses are seeded to be "in front of" and "looking at" the camera
+  if (params.use_extrinsic_guesses && params.extrinsic_guesses.size() != params.image_observations.size())
+    throw OptimizationException("The number of extrinsic guesses does not match the number of observation sets");
+
+  // Estimate the pose of the target in each observation set from the intrinsics guess, in parallel. Unless guesses are
+  // provided, start from the closed-form pose of the planar target so no assumption about the target placement is required
+  std::vector<PnPProblem> pnp_problems(params.image_observations.size());
   for (std::size_t i = 0; i < params.image_observations.size(); ++i)
   {
-    try
-    {
-      internal_poses[i] = solvePnP(params.intrinsics_guess, params.image_observations[i], guessInitialPose());
-      valid_idx.push_back(i);
-    }
-    catch (const std::exception&)
+    if (params.use_extrinsic_guesses)
+      pnp_problems[i].camera_to_target_guess = params.extrinsic_guesses[i];
+    else
+      pnp_problems[i].use_closed_form_guess = true;
+    pnp_problems[i].covariance_mode = CovarianceMode::NONE;
+    pnp_problems[i].intr = intrinsics_guess;
+    pnp_problems[i].correspondences = params.image_observations[i];
+  }
+
+  // Observation sets whose pose cannot be estimated are excluded from the calibration and reported in the result
+  std::vector<std::size_t> failed_idx;
+  const std::vector<PnPResult> pnp_results = optimizeBatch(pnp_problems, params.num_threads);
+  for (std::size_t i = 0; i < pnp_results.size(); ++i)
+  {
+    if (!pnp_results[i].converged)
     {
-      std::cout << "PnP failed for image " << i << std::endl;
+      failed_idx.push_back(i);
       continue;
     }
+
+    internal_poses[i] = poseEigenToCal(pnp_results[i].camera_to_target);
+    valid_idx.push_back(i);
   }
 
+  if (valid_idx.empty())
+    throw OptimizationException("Failed to estimate the target pose of any observation set");
+
   ceres::Problem problem;
 
   // Create a set of cost functions for each observation set
@@ -221,36 +158,36 @@ rct_optimizations::optimize(const rct_optimizations::IntrinsicEstimationProblem&
 
       // Allocate Ceres data structures - ownership is taken by the ceres
       // Problem data structure
-      auto* cost_fn = new IntrinsicCostFunction(point_in_target, point_in_image);
+      auto* cost_fn = new IntrinsicCostFunction<CameraModelT>(point_in_target, point_in_image);
 
-      auto* cost_block = new ceres::AutoDiffCostFunction<IntrinsicCostFunction, 2, 6, 9>(cost_fn);
+      auto* cost_block = new ceres::AutoDiffCostFunction<IntrinsicCostFunction<CameraModelT>, 2, 6, CameraModelT::NUM_PARAMS>(cost_fn);
 
-      problem.AddResidualBlock(cost_block, NULL, internal_poses[i].values.data(),
-                               internal_intrinsics_data.data());
+      problem.AddResidualBlock(cost_block, NULL, internal_poses[i].values.data(), camera_params.data());
     }
   }
 
-  std::vector<const double*> param_blocks;
+  // The covariance of the intrinsic parameters is marginalized over the target poses, which are nuisance parameters
+  const std::vector<const double*> param_blocks = { camera_params.data() };
   std::map<const double*, std::vector<std::string>> param_labels;
+  const auto distortion_labels = CameraModelT::Distortion::labels();
+  std::vector<std::string>& camera_param_labels = param_labels[camera_params.data()];
+  camera_param_labels.assign(params.labels_intrinsic_params.begin(), params.labels_intrinsic_params.end());
+  camera_param_labels.insert(camera_param_labels.end(), distortion_labels.begin(), distortion_labels.end());
 
-  param_blocks.emplace_back(internal_intrinsics_data.data());
-  param_labels[internal_intrinsics_data.data()] = std::vector<std::string>(params.labels_intrinsic_params.begin(), params.labels_intrinsic_params.end());
+  std::vector<const double*> nuisance_blocks;
+  nuisance_blocks.reserve(valid_idx.size());
+  for (std::size_t i : valid_idx)
+    nuisance_blocks.push_back(internal_poses[i].values.data());
 
-  for (std::size_t i = 0; i < internal_poses.size(); i++)
-  {
-    param_blocks.emplace_back(internal_poses[i].values.data());
-    std::vector<std::string> labels;
-    // compose labels poseN_x, etc.
-    for (auto label_extr : params.labels_isometry3d)
-    {
-      labels.push_back(params.label_extr + std::to_string(i) + "_" + label_extr);
-    }
-    param_labels[internal_poses[i].values.data()] = labels;
-  }
+  for (std::size_t i : valid_idx)
+    setPose6dParameterization(problem, internal_poses[i].values.data(), params.pose_parameterization);
 
   // Solve
-  ceres::Solver::Options options;
-  options.max_num_iterations = 1000;
+  // This is a bundle adjustment problem: every residual depends on one target pose and on the shared intrinsics. The
+  // automatic solver profile eliminates the target poses first so that the reduced linear system only contains the
+  // intrinsic parameters, and solves that small system with a dense factorization (DENSE_SCHUR)
+  const ceres::Solver::Options options =
+      configureSolverOptions(problem, params.solver_options, params.solver_profile, params.num_threads);
   ceres::Solver::Summary summary;
   ceres::Solve(options, &problem, &summary);
 
@@ -258,21 +195,180 @@ rct_optimizations::optimize(const rct_optimizations::IntrinsicEstimationProblem&
   IntrinsicEstimationResult result;
   result.converged = summary.termination_type == ceres::CONVERGENCE;
 
-  result.intrinsics.fx() = internal_intrinsics.fx();
-  result.intrinsics.fy() = internal_intrinsics.fy();
-  result.intrinsics.cx() = internal_intrinsics.cx();
-  result.intrinsics.cy() = internal_intrinsics.cy();
+  std::copy_n(camera_params.begin(), CameraModelT::NUM_INTRINSIC_PARAMS, result.intrinsics.values.begin());
 
-  result.distortions[0] = internal_intrinsics_data[4];
-  result.distortions[1] = internal_intrinsics_data[5];
-  result.distortions[2] = internal_intrinsics_data[6];
-  result.distortions[3] = internal_intrinsics_data[7];
-  result.distortions[4] = internal_intrinsics_data[8];
+  result.distortions.fill(0.0);
+  std::copy_n(camera_params.begin() + CameraModelT::NUM_INTRINSIC_PARAMS, CameraModelT::NUM_DISTORTION_PARAMS,
+              result.distortions.begin());
+
+  result.target_transforms.resize(internal_poses.size(), Eigen::Isometry3d::Identity());
+  for (std::size_t i : valid_idx)
+    result.target_transforms[i] = poseCalToEigen(internal_poses[i]);
+  result.failed_observation_sets = failed_idx;
 
   result.initial_cost_per_obs = summary.initial_cost / summary.num_residuals;
   result.final_cost_per_obs = summary.final_cost / summary.num_residuals;
 
-  result.covariance = rct_optimizations::computeCovariance(problem, param_blocks, param_labels);
+  result.covariance = computeMarginalCovariance(problem,
+                                                param_blocks,
+                                                param_labels,
+                                                nuisance_blocks,
+                                                params.covariance_mode);
+
+  return result;
+}
+
+}  // namespace
+
+rct_optimizations::IntrinsicEstimationResult
+rct_optimizations::optimize(const rct_optimizations::IntrinsicEstimationProblem& params)
+{
+  switch (params.camera_model)
+  {
+    case CameraModelType::PINHOLE:
+      return optimizeIntrinsics<PinholeModel>(params);
+    case CameraModelType::RADIAL_TANGENTIAL:
+      return optimizeIntrinsics<RadialTangentialModel>(params);
+    case CameraModelType::FISHEYE:
+      return optimizeIntrinsics<FisheyeModel>(params);
+    default:
+      throw OptimizationException("Unsupported camera model");
+  }
+}
+
+rct_optimizations::ClosedFormIntrinsicsResult
+rct_optimizations::estimateIntrinsics(const std::vector<Correspondence2D3D::Set>& observations,
+                                      const bool estimate_distortion)
+{
+  ClosedFormIntrinsicsResult result;
+
+  // Compute the homography from the target plane to the image of each observation set
+  std::vector<Eigen::Matrix3d> homographies;
+  std::vector<std::size_t> valid_idx;
+  for (std::size_t i = 0; i < observations.size(); ++i)
+  {
+    try
+    {
+      Eigen::Isometry3d plane_to_target;
+      homographies.push_back(estimateHomography(observations[i], plane_to_target));
+      valid_idx.push_back(i);
+    }
+    catch (const std::exception&)
+    {
+      result.failed_observation_sets.push_back(i);
+    }
+  }
+
+  if (homographies.size() < 2)
+  {
+    std::stringstream ss;
+    ss << "At least 2 valid observation sets are required to estimate the intrinsics in closed form (" << homographies.size()
+       << " provided)";
+    throw OptimizationException(ss.str());
+  }
+
+  // Condition the linear system by mapping the image points to their centroid and scaling them to an average distance of
+  // sqrt(2) from the origin. The normalized intrinsics are K' = N * K, which still has zero skew
+  Eigen::Vector2d centroid(Eigen::Vector2d::Zero());
+  std::size_t n_points = 0;
+  for (std::size_t i : valid_idx)
+  {
+    for (const Correspondence2D3D& corr : observations[i])
+      centroid += corr.in_image;
+    n_points += observations[i].size();
+  }
+  centroid /= static_cast<double>(n_points);
+
+  double mean_distance = 0.0;
+  for (std::size_t i : valid_idx)
+  {
+    for (const Correspondence2D3D& corr : observations[i])
+      mean_distance += (corr.in_image - centroid).norm();
+  }
+  mean_distance /= static_cast<double>(n_points);
+  const double scale = mean_distance > std::numeric_limits<double>::epsilon() ? std::sqrt(2.0) / mean_distance : 1.0;
+
+  Eigen::Matrix3d normalization;
+  normalization << scale, 0.0, -scale * centroid.x(),
+                   0.0, scale, -scale * centroid.y(),
+                   0.0, 0.0, 1.0;
+
+  // Each homography H = K * [r1, r2, t] provides two constraints on B = K^-T * K^-1, since r1 and r2 are orthonormal:
+  //   h1^T * B * h2 = 0
+  //   h1^T * B * h1 - h2^T * B * h2 = 0
+  Eigen::Matrix<double, 5, 5> vtv(Eigen::Matrix<double, 5, 5>::Zero());
+  for (const Eigen::Matrix3d& H : homographies)
+  {
+    Eigen::Matrix3d H_normalized = normalization * H;
+    H_normalized /= H_normalized.norm();
+
+    const Eigen::Matrix<double, 1, 5> v12 = computeConicConstraint(H_normalized, 0, 1);
+    const Eigen::Matrix<double, 1, 5> v11_v22 = computeConicConstraint(H_normalized, 0, 0)
+                                                - computeConicConstraint(H_normalized, 1, 1);
+    vtv.noalias() += v12.transpose() * v12;
+    vtv.noalias() += v11_v22.transpose() * v11_v22;
+  }
+
+  // The solution is the eigenvector of the smallest eigenvalue, which must be unique
+  Eigen::SelfAdjointEigenSolver<Eigen::Matrix<double, 5, 5>> solver(vtv);
+  if (solver.eigenvalues()(1) <= 1.0e-12 * solver.eigenvalues()(4))
+    throw OptimizationException("The observations do not constrain the intrinsics; the orientation of the target must vary "
+                                "between the observation sets");
+
+  Eigen::Matrix<double, 5, 1> b = solver.eigenvectors().col(0);
+  if (b(0) < 0.0)
+    b = -b;
+
+  const double B11 = b(0), B22 = b(1), B13 = b(2), B23 = b(3), B33 = b(4);
+  const double lambda = B33 - B13 * B13 / B11 - B23 * B23 / B22;
+  if (B11 <= 0.0 || B22 <= 0.0 || lambda <= 0.0)
+    throw OptimizationException("Failed to estimate the intrinsics in closed form: the image of the absolute conic is not "
+                                "positive definite");
+
+  // Remove the normalization
+  result.intrinsics.fx() = std::sqrt(lambda / B11) / scale;
+  result.intrinsics.fy() = std::sqrt(lambda / B22) / scale;
+  result.intrinsics.cx() = -B13 / B11 / scale + centroid.x();
+  result.intrinsics.cy() = -B23 / B22 / scale + centroid.y();
+
+  if (!estimate_distortion)
+    return result;
+
+  // Given the intrinsics and the target pose of each observation set, the radial distortion moves each ideal (undistorted)
+  // image point away from the principal point linearly in k1 and k2:
+  //   u - u_ideal = fx * x * (k1 * r^2 + k2 * r^4)
+  //   v - v_ideal = fy * y * (k1 * r^2 + k2 * r^4)
+  Eigen::Matrix2d ata(Eigen::Matrix2d::Zero());
+  Eigen::Vector2d atb(Eigen::Vector2d::Zero());
+  for (std::size_t i : valid_idx)
+  {
+    const Eigen::Isometry3d camera_to_target = estimatePlanarPose(result.intrinsics, observations[i]);
+    for (const Correspondence2D3D& corr : observations[i])
+    {
+      const Eigen::Vector3d in_camera = camera_to_target * corr.in_target;
+      const double x = in_camera.x() / in_camera.z();
+      const double y = in_camera.y() / in_camera.z();
+      const double r2 = x * x + y * y;
+
+      Eigen::Matrix2d a;
+      a << result.intrinsics.fx() * x * r2, result.intrinsics.fx() * x * r2 * r2,
+           result.intrinsics.fy() * y * r2, result.intrinsics.fy() * y * r2 * r2;
+      const Eigen::Vector2d ideal(result.intrinsics.fx() * x + result.intrinsics.cx(),
+                                  result.intrinsics.fy() * y + result.intrinsics.cy());
+
+      ata.noalias() += a.transpose() * a;
+      atb.noalias() += a.transpose() * (corr.in_image - ideal);
+    }
+  }
+
+  // The distortion is not observable if all of the points are close to the principal point
+  Eigen::LDLT<Eigen::Matrix2d> ldlt(ata);
+  if (ldlt.info() == Eigen::Success && ldlt.isPositive() && ldlt.vectorD().minCoeff() > 1.0e-12 * ldlt.vectorD().maxCoeff())
+  {
+    const Eigen::Vector2d k = ldlt.solve(atb);
+    result.distortions[0] = k(0);
+    result.distortions[1] = k(1);
+  }
 
   return result;
 }
@@ -31,9 +31,7 @@ rct_optimizations::optimize(const rct_optimizations::CircleFitProblem& params)
     problem.AddResidualBlock(cost_block, loss_fn, circle_params.data());
   }
 
-  ceres::Solver::Options options;
-  options.max_num_iterations = 500;
-  options.linear_solver_type = ceres::DENSE_QR;
+  const ceres::Solver::Options options = configureSolverOptions(problem, params.solver_options, params.solver_profile);
   ceres::Solver::Summary summary;
   ceres::Solve(options, &problem, &summary);
 
@@ -49,7 +47,11 @@ rct_optimizations::optimize(const rct_optimizations::CircleFitProblem& params)
   result.radius = pow(circle_params[2], 2);
   result.initial_cost_per_obs = summary.initial_cost / summary.num_residuals;
   result.final_cost_per_obs = summary.final_cost / summary.num_residuals;
-  result.covariance = rct_optimizations::computeCovariance(problem, param_block_labels);
+  result.covariance = rct_optimizations::computeCovariance(problem,
+                                                           param_block_labels,
+                                                           std::map<const double *, std::vector<int>>(),
+                                                           DefaultCovarianceOptions(),
+                                                           params.covariance_mode);
 
   return result;
 }
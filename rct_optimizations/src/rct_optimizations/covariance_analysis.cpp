@@ -1,4 +1,5 @@
 ﻿#include <rct_optimizations/covariance_analysis.h>
+#include <boost/dynamic_bitset.hpp>
 #include <sstream>
 
 namespace rct_optimizations
@@ -9,28 +10,22 @@ Eigen::MatrixXd computeCorrelationsFromCovariance(const Eigen::MatrixXd& covaria
   if(covariance_matrix.rows() != covariance_matrix.cols())
     throw CovarianceException("Cannot compute correlations from a non-square matrix");
 
-  Eigen::Index num_vars = covariance_matrix.rows();
+  const Eigen::Index num_vars = covariance_matrix.rows();
 
-  Eigen::MatrixXd out(num_vars, num_vars);
-
-  for (Eigen::Index i = 0; i < num_vars; i++)
-  {
-    double sigma_i = sqrt(fabs(covariance_matrix(i, i)));  // standard deviation at the diagonal element in row i
+  // Standard deviation of each variable, computed once
+  const Eigen::VectorXd sigma = covariance_matrix.diagonal().cwiseAbs().cwiseSqrt();
 
-    for (Eigen::Index j = 0; j < num_vars; j++)
-    {
-      double sigma_j = sqrt(fabs(covariance_matrix(j, j)));  // standard deviation at the diagonal element in column j
+  // Denominators of the correlation coefficients; a zero standard deviation is replaced by 1 to avoid division by zero
+  const Eigen::VectorXd denom = sigma.unaryExpr(
+      [](const double s) { return s < std::numeric_limits<double>::epsilon() ? 1.0 : s; });
 
-      if (i == j)  // if out(i,j) is a diagonal element
-        out(static_cast<Eigen::Index>(i), static_cast<Eigen::Index>(j)) = sigma_i;
-      else
-      {
-        if (sigma_i < std::numeric_limits<double>::epsilon()) sigma_i = 1;
-        if (sigma_j < std::numeric_limits<double>::epsilon()) sigma_j = 1;
+  Eigen::MatrixXd out(num_vars, num_vars);
+  for (Eigen::Index j = 0; j < num_vars; j++)
+  {
+    for (Eigen::Index i = 0; i < num_vars; i++)
+      out(i, j) = covariance_matrix(i, j) / (denom(i) * denom(j));
 
-        out(static_cast<Eigen::Index>(i), static_cast<Eigen::Index>(j)) = covariance_matrix(i, j) / (sigma_i * sigma_j);
-      }
-    }
+    out(j, j) = sigma(j);  // diagonal elements are the standard deviations
   }
 
   return out;
@@ -53,54 +48,37 @@ CovarianceResult computeCovarianceResults(const Eigen::MatrixXd& cov_matrix, con
   Eigen::MatrixXd correlation_matrix = computeCorrelationsFromCovariance(cov_matrix);
   res.correlation_matrix = correlation_matrix;
 
-  // 2. Create NamedParams for covariance and correlation results, which include labels and values for the parameters. Uses top-right triangular part of matrix.
-  Eigen::Index col_start = 0;
-  for (Eigen::Index row = 0; row < correlation_matrix.rows(); row++)
+  // 2. Save the labels; the named standard deviations, covariances, and correlation coefficients are generated on demand
+  if (static_cast<Eigen::Index>(parameter_names.size()) != cov_matrix.rows())
   {
-    for (Eigen::Index col = col_start; col < correlation_matrix.rows(); col++)
-    {
-      NamedParam p_corr;
-      p_corr.value = correlation_matrix(row, col);
-
-      if (row == col)  // diagonal element, standard deviation
-      {
-        p_corr.names = std::make_pair(parameter_names[static_cast<std::size_t>(row)], "");
-        res.standard_deviations.push_back(p_corr);
-        continue;
-      }
-
-      // otherwise off-diagonal element, correlation coefficient
-      p_corr.names = std::make_pair(parameter_names[static_cast<std::size_t>(row)], parameter_names[static_cast<std::size_t>(col)]);
-      res.correlation_coeffs.push_back(p_corr);
-
-      // for off-diagonal elements also get covariance
-      NamedParam p_cov;
-      p_cov.value = cov_matrix(row, col);
-      p_cov.names = std::make_pair(parameter_names[static_cast<std::size_t>(row)], parameter_names[static_cast<std::size_t>(col)]);
-      res.covariances.push_back(p_cov);
-    }
-    col_start++;
+    std::stringstream ss;
+    ss << "Number of parameter labels (" << parameter_names.size() << ") does not match size of covariance matrix ("
+       << cov_matrix.rows() << ")";
+    throw CovarianceException(ss.str());
   }
+  res.labels = parameter_names;
 
   return res;
 }
 
 CovarianceResult computeCovariance(ceres::Problem &problem,
                                    const std::map<const double *, std::vector<int> > &param_masks,
-                                   const ceres::Covariance::Options& options)
+                                   const ceres::Covariance::Options& options,
+                                   const CovarianceMode mode)
 {
   std::vector<double *> blocks;
   problem.GetParameterBlocks(&blocks);
 
   const std::vector<const double *> blocks_const(blocks.begin(), blocks.end());
 
-  return computeCovariance(problem, blocks_const, param_masks, options);
+  return computeCovariance(problem, blocks_const, param_masks, options, mode);
 }
 
 CovarianceResult computeCovariance(ceres::Problem &problem,
                                    const std::vector<const double *>& parameter_blocks,
                                    const std::map<const double *, std::vector<int> > &param_masks,
-                                   const ceres::Covariance::Options& options)
+                                   const ceres::Covariance::Options& options,
+                                   const CovarianceMode mode)
 {
   std::map<const double *, std::vector<std::string>> dummy_param_names;
   for (std::size_t block_index = 0; block_index < parameter_blocks.size(); block_index++)
@@ -115,14 +93,15 @@ CovarianceResult computeCovariance(ceres::Problem &problem,
     dummy_param_names[parameter_blocks[block_index]] = block_names;
   }
 
-  return computeCovariance(problem, parameter_blocks, dummy_param_names, param_masks, options);
+  return computeCovariance(problem, parameter_blocks, dummy_param_names, param_masks, options, mode);
 
 }
 
 CovarianceResult computeCovariance(ceres::Problem &problem,
                                    const std::map<const double *, std::vector<std::string> > &param_names,
                                    const std::map<const double *, std::vector<int> > &param_masks,
-                                   const ceres::Covariance::Options& options)
+                                   const ceres::Covariance::Options& options,
+                                   const CovarianceMode mode)
 {
   // Get all parameter blocks for the problem
   std::vector<double *> parameter_blocks(static_cast<std::size_t>(problem.NumParameterBlocks()));
@@ -130,75 +109,275 @@ CovarianceResult computeCovariance(ceres::Problem &problem,
 
   const std::vector<const double *> param_blocks_const(parameter_blocks.begin(), parameter_blocks.end());
 
-  return computeCovariance(problem, param_blocks_const, param_names, param_masks, options);
+  return computeCovariance(problem, param_blocks_const, param_names, param_masks, options, mode);
 }
 
 CovarianceResult computeCovariance(ceres::Problem &problem,
                                    const std::vector<const double *>& parameter_blocks,
                                    const std::map<const double*, std::vector<std::string>>& param_names,
                                    const std::map<const double*, std::vector<int>>& param_masks,
-                                   const ceres::Covariance::Options& options)
+                                   const ceres::Covariance::Options& options,
+                                   const CovarianceMode mode)
 {
+  if (mode == CovarianceMode::NONE)
+    return CovarianceResult();
+
   // 0. Check user-specified arguments
   if (parameter_blocks.size() != param_names.size())
     throw CovarianceException("Provided vector parameter_names is not same length as provided number of parameter blocks");
 
-  Eigen::Index n_params_in_selected = 0;
-  std::vector<Eigen::Index> tangent_space_indices;
+  // Find the parameters of each block in the tangent space (i.e. the parameters that are not masked). Only the blocks that
+  // have at least one parameter in the tangent space are included in the covariance calculation
+  struct TangentSpaceBlock
+  {
+    const double* block;
+    int size;
+    std::vector<Eigen::Index> indices;  // indices of the parameters in the tangent space, relative to the start of the block
+    Eigen::Index offset;  // index of the first parameter of the block in the tangent space covariance matrix
+  };
+  std::vector<TangentSpaceBlock> tangent_space_blocks;
+  tangent_space_blocks.reserve(parameter_blocks.size());
   std::vector<std::string> tangent_space_labels;
+
   for (const double* b : parameter_blocks)
   {
-    int block_size = problem.ParameterBlockSize(b);
-    if (static_cast<std::size_t>(block_size) != param_names.at(b).size())
+    const int block_size = problem.ParameterBlockSize(b);
+    const std::vector<std::string>& label = param_names.at(b);
+    if (static_cast<std::size_t>(block_size) != label.size())
     {
       std::stringstream ss;
       ss << "Number of parameter labels provided for block does not match actual number of parameters in that block: " \
-         << "have " << param_names.at(b).size() << " labels and " << block_size << " parameters";
+         << "have " << label.size() << " labels and " << block_size << " parameters";
       throw CovarianceException(ss.str());
     }
 
-    // Extract tangent space
-    std::vector<int> masks;
+    // Mark the masked parameters with a bit set, so the mask can be applied in a single pass over the block
+    boost::dynamic_bitset<> masked(static_cast<std::size_t>(block_size));
     auto it = param_masks.find(b);
     if (it != param_masks.end())
-      masks = it->second;
+    {
+      for (const int idx : it->second)
+      {
+        if (idx < 0 || idx >= block_size)
+        {
+          std::stringstream ss;
+          ss << "Mask index " << idx << " is out of range for a parameter block of size " << block_size;
+          throw CovarianceException(ss.str());
+        }
+        masked.set(static_cast<std::size_t>(idx));
+      }
+    }
 
-    const std::vector<std::string>& label = param_names.at(b);
+    if (masked.all())
+      continue;
+
+    TangentSpaceBlock tsb;
+    tsb.block = b;
+    tsb.size = block_size;
+    tsb.offset = static_cast<Eigen::Index>(tangent_space_labels.size());
     for (std::size_t i = 0; i < static_cast<std::size_t>(block_size); ++i)
     {
-      if (std::find(masks.begin(), masks.end(), i) == masks.end())
+      if (!masked.test(i))
       {
-        tangent_space_indices.push_back(n_params_in_selected + static_cast<Eigen::Index>(i));
-        tangent_space_labels.push_back(label.at(i));
+        tsb.indices.push_back(static_cast<Eigen::Index>(i));
+        tangent_space_labels.push_back(label[i]);
       }
     }
+    tangent_space_blocks.push_back(std::move(tsb));
+  }
 
-    n_params_in_selected += block_size;
+  // 1. Compute the covariance of the pairs of blocks in the tangent space. Only the upper triangle of block pairs is
+  // computed (and only the diagonal blocks in DIAGONAL mode); the lower triangle follows from symmetry
+  std::vector<std::pair<const double *, const double *>> block_pairs;
+  for (std::size_t i = 0; i < tangent_space_blocks.size(); ++i)
+  {
+    const std::size_t j_end = mode == CovarianceMode::DIAGONAL ? i + 1 : tangent_space_blocks.size();
+    for (std::size_t j = i; j < j_end; ++j)
+      block_pairs.emplace_back(tangent_space_blocks[i].block, tangent_space_blocks[j].block);
   }
 
-  // 1. Compute covariance matrix
   ceres::Covariance covariance(options);
-
-  if(!covariance.Compute(parameter_blocks, &problem))
+  if(!covariance.Compute(block_pairs, &problem))
     throw CovarianceException("Could not compute covariance in computeCovariance()");
 
-  Eigen::MatrixXd cov_matrix(n_params_in_selected, n_params_in_selected);
-  if (!covariance.GetCovarianceMatrix(parameter_blocks, cov_matrix.data()))
+  // 2. Assemble the tangent space covariance matrix directly from the covariance blocks
+  const Eigen::Index n = static_cast<Eigen::Index>(tangent_space_labels.size());
+  Eigen::MatrixXd tangent_space_cov_matrix = Eigen::MatrixXd::Zero(n, n);
+  using RowMajorMatrixXd = Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>;
+  for (std::size_t i = 0; i < tangent_space_blocks.size(); ++i)
+  {
+    const TangentSpaceBlock& bi = tangent_space_blocks[i];
+    const std::size_t j_end = mode == CovarianceMode::DIAGONAL ? i + 1 : tangent_space_blocks.size();
+    for (std::size_t j = i; j < j_end; ++j)
+    {
+      const TangentSpaceBlock& bj = tangent_space_blocks[j];
+
+      // Ceres returns the covariance block in row-major order
+      RowMajorMatrixXd block(bi.size, bj.size);
+      if (!covariance.GetCovarianceBlock(bi.block, bj.block, block.data()))
+        throw CovarianceException("GetCovarianceBlock failed in computeCovariance()");
+
+      for (std::size_t r = 0; r < bi.indices.size(); ++r)
+      {
+        const Eigen::Index row = bi.offset + static_cast<Eigen::Index>(r);
+        if (mode == CovarianceMode::DIAGONAL)
+        {
+          tangent_space_cov_matrix(row, row) = block(bi.indices[r], bi.indices[r]);
+          continue;
+        }
+
+        for (std::size_t c = 0; c < bj.indices.size(); ++c)
+        {
+          const Eigen::Index col = bj.offset + static_cast<Eigen::Index>(c);
+          tangent_space_cov_matrix(row, col) = block(bi.indices[r], bj.indices[c]);
+          tangent_space_cov_matrix(col, row) = tangent_space_cov_matrix(row, col);
+        }
+      }
+    }
+  }
+
+  // 3. Get the covariance results
+  return computeCovarianceResults(tangent_space_cov_matrix, tangent_space_labels);
+}
+
+CovarianceResult computeMarginalCovariance(ceres::Problem &problem,
+                                           const std::vector<const double *>& parameter_blocks,
+                                           const std::map<const double*, std::vector<std::string>>& param_names,
+                                           const std::vector<const double *>& nuisance_blocks,
+                                           const CovarianceMode mode,
+                                           const double min_reciprocal_condition_number)
+{
+  if (mode == CovarianceMode::NONE)
+    return CovarianceResult();
+
+  // 0. Check user-specified arguments and collect the labels and sizes of the parameter blocks of interest
+  if (parameter_blocks.size() != param_names.size())
+    throw CovarianceException("Provided vector parameter_names is not same length as provided number of parameter blocks");
+
+  // Ceres::Problem::Evaluate requires non-const pointers, although the parameters are not modified
+  std::vector<double *> eval_blocks;
+  std::vector<std::string> labels;
+  for (const double* b : parameter_blocks)
+  {
+    if (problem.IsParameterBlockConstant(b))
+      throw CovarianceException("Cannot compute the marginal covariance of a constant parameter block");
+
+    const int block_size = problem.ParameterBlockLocalSize(b);
+    const std::vector<std::string>& label = param_names.at(b);
+    if (static_cast<std::size_t>(block_size) != label.size())
+    {
+      std::stringstream ss;
+      ss << "Number of parameter labels provided for block does not match actual number of parameters in that block: " \
+         << "have " << label.size() << " labels and " << block_size << " parameters";
+      throw CovarianceException(ss.str());
+    }
+    eval_blocks.push_back(const_cast<double *>(b));
+    labels.insert(labels.end(), label.begin(), label.end());
+  }
+  const Eigen::Index n_c = static_cast<Eigen::Index>(labels.size());
+
+  // Map each column of the nuisance part of the Jacobian to its nuisance block. Constant nuisance blocks do not contribute
+  std::vector<Eigen::Index> nuisance_sizes;
+  std::vector<Eigen::Index> nuisance_offsets;
+  std::vector<std::size_t> column_to_nuisance;
+  for (const double* b : nuisance_blocks)
+  {
+    if (problem.IsParameterBlockConstant(b))
+      continue;
+
+    const int block_size = problem.ParameterBlockLocalSize(b);
+    nuisance_offsets.push_back(static_cast<Eigen::Index>(column_to_nuisance.size()));
+    nuisance_sizes.push_back(block_size);
+    column_to_nuisance.insert(column_to_nuisance.end(), static_cast<std::size_t>(block_size), nuisance_sizes.size() - 1);
+    eval_blocks.push_back(const_cast<double *>(b));
+  }
+
+  // 1. Evaluate the sparse Jacobian of all of the residuals with respect to the selected blocks
+  ceres::Problem::EvaluateOptions eval_options;
+  eval_options.parameter_blocks = eval_blocks;
+  ceres::CRSMatrix jacobian;
+  if (!problem.Evaluate(eval_options, nullptr, nullptr, nullptr, &jacobian))
+    throw CovarianceException("Could not evaluate the Jacobian in computeMarginalCovariance()");
+
+  // 2. Accumulate the blocks of the normal matrix, one residual at a time. Each residual may depend on at most one nuisance
+  // block, so the nuisance part of the normal matrix is block diagonal
+  Eigen::MatrixXd h_cc = Eigen::MatrixXd::Zero(n_c, n_c);
+  std::vector<Eigen::MatrixXd> h_cp(nuisance_sizes.size());
+  std::vector<Eigen::MatrixXd> h_pp(nuisance_sizes.size());
+  for (std::size_t k = 0; k < nuisance_sizes.size(); ++k)
   {
-    throw CovarianceException("GetCovarianceMatrix failed in computeCovariance()");
+    h_cp[k] = Eigen::MatrixXd::Zero(n_c, nuisance_sizes[k]);
+    h_pp[k] = Eigen::MatrixXd::Zero(nuisance_sizes[k], nuisance_sizes[k]);
   }
 
-  // 2. Extract the tangent space cov matrix
-  Eigen::MatrixXd tangent_space_cov_matrix(tangent_space_labels.size(), tangent_space_labels.size());
-  for (std::size_t r = 0; r < tangent_space_indices.size(); ++r)
+  for (int row = 0; row < jacobian.num_rows; ++row)
   {
-    for (std::size_t c = 0; c < tangent_space_indices.size(); ++c)
+    const int begin = jacobian.rows[static_cast<std::size_t>(row)];
+    const int end = jacobian.rows[static_cast<std::size_t>(row) + 1];
+
+    // Find the nuisance block of this residual, if any
+    std::size_t k = nuisance_sizes.size();
+    for (int idx = begin; idx < end; ++idx)
+    {
+      const Eigen::Index col = jacobian.cols[static_cast<std::size_t>(idx)];
+      if (col < n_c)
+        continue;
+
+      const std::size_t col_k = column_to_nuisance[static_cast<std::size_t>(col - n_c)];
+      if (k != nuisance_sizes.size() && k != col_k)
+        throw CovarianceException("A residual depends on more than one nuisance parameter block");
+      k = col_k;
+    }
+
+    for (int a = begin; a < end; ++a)
     {
-      tangent_space_cov_matrix(r, c) = cov_matrix(tangent_space_indices[r], tangent_space_indices[c]);
+      const Eigen::Index col_a = jacobian.cols[static_cast<std::size_t>(a)];
+      const double val_a = jacobian.values[static_cast<std::size_t>(a)];
+      for (int b = begin; b < end; ++b)
+      {
+        const Eigen::Index col_b = jacobian.cols[static_cast<std::size_t>(b)];
+        const double val_ab = val_a * jacobian.values[static_cast<std::size_t>(b)];
+        if (col_a < n_c && col_b < n_c)
+          h_cc(col_a, col_b) += val_ab;
+        else if (col_a < n_c)
+          h_cp[k](col_a, col_b - n_c - nuisance_offsets[k]) += val_ab;
+        else if (col_b >= n_c)
+          h_pp[k](col_a - n_c - nuisance_offsets[k], col_b - n_c - nuisance_offsets[k]) += val_ab;
+      }
     }
   }
 
-  // 3. Get the covariance results
-  return computeCovarianceResults(tangent_space_cov_matrix, tangent_space_labels);
+  // 3. Eliminate the nuisance blocks with the Schur complement: S = H_cc - sum(H_cp * H_pp^-1 * H_cp^T)
+  Eigen::MatrixXd schur = h_cc;
+  for (std::size_t k = 0; k < nuisance_sizes.size(); ++k)
+  {
+    Eigen::LDLT<Eigen::MatrixXd> ldlt(h_pp[k]);
+    if (ldlt.info() != Eigen::Success || !ldlt.isPositive() ||
+        ldlt.vectorD().minCoeff() <= min_reciprocal_condition_number * ldlt.vectorD().cwiseAbs().maxCoeff())
+    {
+      throw CovarianceException("A nuisance parameter block is not observable; its normal matrix is singular");
+    }
+    schur.noalias() -= h_cp[k] * ldlt.solve(h_cp[k].transpose());
+  }
+
+  // 4. Invert the (symmetric) Schur complement to get the marginal covariance of the parameters of interest
+  Eigen::SelfAdjointEigenSolver<Eigen::MatrixXd> solver(schur);
+  if (solver.info() != Eigen::Success)
+    throw CovarianceException("Could not decompose the Schur complement in computeMarginalCovariance()");
+
+  const Eigen::VectorXd& eigenvalues = solver.eigenvalues();
+  if (n_c > 0 && eigenvalues(0) <= min_reciprocal_condition_number * eigenvalues(n_c - 1))
+    throw CovarianceException("The Schur complement is rank deficient; the parameters of interest are not observable");
+
+  Eigen::MatrixXd cov_matrix;
+  if (mode == CovarianceMode::DIAGONAL)
+  {
+    const Eigen::VectorXd variances = solver.eigenvectors().array().square().matrix() * eigenvalues.cwiseInverse();
+    cov_matrix = variances.asDiagonal();
+  }
+  else
+    cov_matrix = solver.eigenvectors() * eigenvalues.cwiseInverse().asDiagonal() * solver.eigenvectors().transpose();
+
+  return computeCovarianceResults(cov_matrix, labels);
 }
 }  // namespace rct_optimizations
@@ -1,17 +1,35 @@
 #include <rct_optimizations/dh_chain.h>
+#include <rct_optimizations/parallel.h>
+#include <rct_optimizations/random_generator.h>
+#include <atomic>
 #include <random>
 
 namespace rct_optimizations
 {
+namespace
+{
+/**
+ * @brief Creates a unique seed for a DH transform constructed without one.
+ * The random device is only queried once per process; subsequent seeds are derived from it with a counter
+ */
+std::size_t createDefaultSeed()
+{
+  static const std::uint64_t process_seed = std::random_device{}();
+  static std::atomic<std::uint64_t> counter(0);
+  return static_cast<std::size_t>(CounterBasedRandomGenerator(process_seed)(counter++));
+}
+
+} // namespace anonymous
+
 // DH Transform
 
 DHTransform::DHTransform(const Eigen::Vector4d& params_, DHJointType type_)
-  : DHTransform(params_, type_, "joint", std::random_device{}())
+  : DHTransform(params_, type_, "joint", createDefaultSeed())
 {
 }
 
 DHTransform::DHTransform(const Eigen::Vector4d &params_, DHJointType type_, const std::string& name_)
-  : DHTransform(params_, type_, name_, std::random_device{}())
+  : DHTransform(params_, type_, name_, createDefaultSeed())
 {
 }
 
@@ -25,13 +43,12 @@ DHTransform::DHTransform(const Eigen::Vector4d& params_, DHJointType type_, cons
 
 double DHTransform::createRandomJointValue() const
 {
-  // Create a static random number generator so that this object does not get continuously re-instantiated
-  static std::mt19937 mt_rand = std::mt19937(random_seed);
-
-  // Create a new uniform distribution object with the current min and max values
-  std::uniform_real_distribution<double> dist(min, max);
+  return createRandomJointValue(random_counter_++);
+}
 
-  return dist(mt_rand);
+double DHTransform::createRandomJointValue(const std::uint64_t counter, const std::uint64_t stream) const
+{
+  return CounterBasedRandomGenerator(random_seed, stream).uniform(counter, min, max);
 }
 
 std::array<std::string, 4> DHTransform::getParamLabels() const
@@ -67,14 +84,32 @@ DHChain::DHChain(const DHChain& other, const Eigen::MatrixX4d& dh_offsets)
 
 Eigen::VectorXd DHChain::createUniformlyRandomPose() const
 {
+  // Draw each joint from a different stream so that transforms with the same seed produce independent values
+  const std::uint64_t counter = random_pose_counter_++;
   Eigen::VectorXd joints(transforms_.size());
   for (std::size_t i = 0; i < transforms_.size(); ++i)
   {
-    joints[i] = transforms_[i].createRandomJointValue();
+    joints[i] = transforms_[i].createRandomJointValue(counter, i);
   }
   return joints;
 }
 
+std::vector<Eigen::VectorXd> DHChain::createUniformlyRandomPoses(const std::size_t n, const std::size_t num_threads) const
+{
+  // Reserve the counters of the poses so that subsequent calls continue the sequence
+  const std::uint64_t first_counter = random_pose_counter_;
+  random_pose_counter_ += n;
+
+  std::vector<Eigen::VectorXd> poses(n);
+  parallelFor(n, [&](const std::size_t i) {
+    poses[i].resize(transforms_.size());
+    for (std::size_t j = 0; j < transforms_.size(); ++j)
+      poses[i][j] = transforms_[j].createRandomJointValue(first_counter + i, j);
+  }, num_threads);
+
+  return poses;
+}
+
 std::size_t DHChain::dof() const
 {
   return transforms_.size();
@@ -4,6 +4,8 @@
 #include <rct_optimizations/covariance_analysis.h>
 #include <rct_optimizations/maximum_likelihood.h>
 #include <rct_optimizations/local_parameterization.h>
+#include <rct_optimizations/parallel.h>
+#include <rct_optimizations/random_generator.h>
 
 #include <ceres/ceres.h>
 
@@ -221,6 +223,9 @@ KinematicCalibrationResult optimize(const KinematicCalibrationProblem2D3D &param
   // Add subset parameterization to mask variables that shouldn't be optimized
   addSubsetParameterization(problem, param_masks);
 
+  // Update the orientations that have no masked elements on SO(3)
+  setAngleAxisParameterization(problem, { parameters[3], parameters[5], parameters[7] }, param_masks, params.pose_parameterization);
+
   // Add a cost to drive the camera chain DH parameters towards an expected mean
   if (params.camera_chain.dof() != 0 && !problem.IsParameterBlockConstant(parameters[0]))
   {
@@ -260,14 +265,9 @@ KinematicCalibrationResult optimize(const KinematicCalibrationProblem2D3D &param
   // Print optimization parameter labels
   printOptimizationLabels(problem, param_names, param_labels, param_masks);
 
-  // Setup the Ceres optimization parameters
-  ceres::Solver::Options options;
-  options.max_num_iterations = 150;
-  options.num_threads = 4;
-  options.minimizer_progress_to_stdout = true;
-  ceres::Solver::Summary summary;
-
   // Solve the optimization
+  const ceres::Solver::Options options = configureSolverOptions(problem, params.solver_options, params.solver_profile);
+  ceres::Solver::Summary summary;
   ceres::Solve(options, &problem, &summary);
 
   // Report and save the results
@@ -293,229 +293,360 @@ KinematicCalibrationResult optimize(const KinematicCalibrationProblem2D3D &param
   else
     result.target_chain_dh_offsets = target_chain_dh_offsets;
 
-  ceres::Covariance::Options cov_options = rct_optimizations::DefaultCovarianceOptions();
-  cov_options.null_space_rank = -1;  // automatically drop terms below min_reciprocal_condition_number
-
-  result.covariance = computeCovariance(problem, param_labels, param_masks, cov_options);
+  result.covariance =
+      computeCovariance(problem, param_labels, param_masks, params.covariance_options, params.covariance_mode);
 
   return result;
 }
 
-KinematicCalibrationResult optimize(const KinematicCalibrationProblemPose6D &params,
-                                    const double orientation_weight,
-                                    const ceres::Solver::Options& options)
+/**
+ * @brief Creates the DH offsets of a chain and their labels, with a placeholder set of DH offsets for chains with DoF == 0
+ */
+static Eigen::MatrixX4d createDHOffsets(const DHChain& chain,
+                                        const std::string& placeholder_name,
+                                        std::vector<std::array<std::string, 4>>& labels)
 {
-  // Initialize the optimization variables
-  // Camera mount to camera (cm_to_c) quaternion and translation
-  Eigen::Vector3d t_cm_to_c(params.camera_mount_to_camera_guess.translation());
-  Eigen::AngleAxisd rot_cm_to_c(params.camera_mount_to_camera_guess.rotation());
-  Eigen::Vector3d aa_cm_to_c(rot_cm_to_c.angle() * rot_cm_to_c.axis());
-
-  std::array<std::string, 3> t_cm_to_c_labels({params.label_camera_mount_to_camera + "_x",
-                                               params.label_camera_mount_to_camera + "_y",
-                                               params.label_camera_mount_to_camera + "_z"});
-  std::array<std::string, 3> aa_cm_to_c_labels({params.label_camera_mount_to_camera + "_rx",
-                                                params.label_camera_mount_to_camera + "_ry",
-                                                params.label_camera_mount_to_camera + "_rz"});
-
-  // Target mount to target (tm_to_t) quaternion and translation
-  Eigen::Vector3d t_tm_to_t(params.target_mount_to_target_guess.translation());
-  Eigen::AngleAxisd rot_tm_to_t(params.target_mount_to_target_guess.rotation());
-  Eigen::Vector3d aa_tm_to_t(rot_tm_to_t.angle() * rot_tm_to_t.axis());
-
-  std::array<std::string, 3> t_tm_to_t_labels({params.label_target_mount_to_target + "_x",
-                                               params.label_target_mount_to_target + "_y",
-                                               params.label_target_mount_to_target + "_z"});
-  std::array<std::string, 3> aa_tm_to_t_labels({params.label_target_mount_to_target + "_rx",
-                                                params.label_target_mount_to_target + "_ry",
-                                                params.label_target_mount_to_target + "_rz"});
-
-  // Camera chain base to target_chain_base (ccb_to_tcb) quaternion and translation
-  Eigen::Vector3d t_ccb_to_tcb(params.camera_base_to_target_base_guess.translation());
-  Eigen::AngleAxisd rot_ccb_to_tcb(params.camera_base_to_target_base_guess.rotation());
-  Eigen::Vector3d aa_ccb_to_tcb(rot_ccb_to_tcb.angle() * rot_ccb_to_tcb.axis());
-
-  std::array<std::string, 3> t_ccb_to_tcb_labels({params.label_camera_base_to_target + "_x",
-                                                  params.label_camera_base_to_target + "_y",
-                                                  params.label_camera_base_to_target + "_z"});
-  std::array<std::string, 3> aa_ccb_to_tcb_labels({params.label_camera_base_to_target + "_rx",
-                                                   params.label_camera_base_to_target + "_ry",
-                                                   params.label_camera_base_to_target + "_rz"});
-
-  // Create containers for the kinematic chain DH offsets
-  // Ceres will not work with parameter blocks of size zero, so create a dummy set of DH offsets for chains with DoF == 0
-  Eigen::MatrixX4d camera_chain_dh_offsets;
-  std::vector<std::array<std::string, 4>> camera_chain_param_labels;
-  if (params.camera_chain.dof() != 0)
-  {
-    camera_chain_dh_offsets = Eigen::MatrixX4d::Zero(params.camera_chain.dof(), 4);
-    camera_chain_param_labels = params.camera_chain.getParamLabels();
-  }
-  else
+  if (chain.dof() != 0)
   {
-    camera_chain_dh_offsets = Eigen::MatrixX4d::Zero(1, 4);
-    camera_chain_param_labels = {{"camera_chain_placeholder_d", "camera_chain_placeholder_theta", "camera_chain_placeholder_r", "camera_chain_placeholder_alpha"}};
+    labels = chain.getParamLabels();
+    return Eigen::MatrixX4d::Zero(chain.dof(), 4);
   }
 
+  labels = { { placeholder_name + "_d", placeholder_name + "_theta", placeholder_name + "_r", placeholder_name + "_alpha" } };
+  return Eigen::MatrixX4d::Zero(1, 4);
+}
 
-  Eigen::MatrixX4d target_chain_dh_offsets;
-  std::vector<std::array<std::string, 4>> target_chain_param_labels;
-  if (params.target_chain.dof() != 0)
-  {
-    target_chain_dh_offsets = Eigen::MatrixX4d::Zero(params.target_chain.dof(), 4);
-    target_chain_param_labels = params.target_chain.getParamLabels();
-  }
-  else
-  {
-    target_chain_dh_offsets = Eigen::MatrixX4d::Zero(1, 4);
-    target_chain_param_labels = {{"target_chain_placeholder_d", "target_chain_placeholder_theta", "target_chain_placeholder_r", "target_chain_placeholder_alpha"}};
-  }
-
-  // Create a vector of the pointers to the optimization variables in the order that the cost function expects them
-  std::vector<double *> parameters
-    = DualDHChainCostPose6D::constructParameters(camera_chain_dh_offsets,
-                                                 target_chain_dh_offsets,
-                                                 t_cm_to_c,
-                                                 aa_cm_to_c,
-                                                 t_tm_to_t,
-                                                 aa_tm_to_t,
-                                                 t_ccb_to_tcb,
-                                                 aa_ccb_to_tcb);
-
-  std::map<const double*, std::vector<std::string>> param_labels
-      = DualDHChainCostPose6D::constructParameterLabels(parameters,
-                                                        camera_chain_param_labels,
-                                                        target_chain_param_labels,
-                                                        t_cm_to_c_labels,
-                                                        aa_cm_to_c_labels,
-                                                        t_tm_to_t_labels,
-                                                        aa_tm_to_t_labels,
-                                                        t_ccb_to_tcb_labels,
-                                                        aa_ccb_to_tcb_labels);
-
-  std::map<const double *, std::vector<int>> param_masks
-      = DualDHChainCostPose6D::constructParameterMasks(parameters, params.mask);
-
-  std::map<const double *, std::string> param_names
-      = DualDHChainCost2D3D::constructParameterNames(parameters);
-
-
-  // Set up the problem
-  ceres::Problem problem;
-
-  for (const auto &observation : params.observations)
-  {
-    // Allocate Ceres data structures - ownership is taken by the ceres
-    // Problem data structure
-    auto* cost_fn = new DualDHChainCostPose6D(observation, params.camera_chain, params.target_chain, orientation_weight);
+static Eigen::Vector3d toAngleAxis(const Eigen::Isometry3d& transform)
+{
+  Eigen::AngleAxisd rot(transform.rotation());
+  return rot.angle() * rot.axis();
+}
 
-    auto *cost_block = new ceres::DynamicAutoDiffCostFunction<DualDHChainCostPose6D>(cost_fn);
+static std::array<std::string, 3> createLabels(const std::string& prefix,
+                                               const std::string& x,
+                                               const std::string& y,
+                                               const std::string& z)
+{
+  return { { prefix + "_" + x, prefix + "_" + y, prefix + "_" + z } };
+}
 
-    // Add the optimization parameters
-    // DH parameters for both kinematic chains
-    cost_block->AddParameterBlock(camera_chain_dh_offsets.size());
-    cost_block->AddParameterBlock(target_chain_dh_offsets.size());
+/**
+ * @brief Adds a cost to drive the DH offsets of a chain towards an expected mean of zero
+ */
+static void addDHOffsetPrior(ceres::Problem& problem, Eigen::MatrixX4d& dh_offsets, const double stdev)
+{
+  Eigen::ArrayXXd mean(Eigen::ArrayXXd::Zero(dh_offsets.rows(), dh_offsets.cols()));
+  Eigen::ArrayXXd stdevs(Eigen::ArrayXXd::Constant(dh_offsets.rows(), dh_offsets.cols(), stdev));
 
-    // Camera mount to camera transform
-    cost_block->AddParameterBlock(3);
-    cost_block->AddParameterBlock(3);
+  auto *fn = new MaximumLikelihood(mean, stdevs);
+  auto *cost_block = new ceres::DynamicAutoDiffCostFunction<MaximumLikelihood>(fn);
+  cost_block->AddParameterBlock(dh_offsets.size());
+  cost_block->SetNumResiduals(dh_offsets.size());
 
-    // Target mount to target transform
-    cost_block->AddParameterBlock(3);
-    cost_block->AddParameterBlock(3);
+  problem.AddResidualBlock(cost_block, nullptr, dh_offsets.data());
+}
 
-    // Camera kinematic chain to target kinematic chain transform
-    cost_block->AddParameterBlock(3);
-    cost_block->AddParameterBlock(3);
+KinematicCalibrationVariablesPose6D::KinematicCalibrationVariablesPose6D(const KinematicCalibrationProblemPose6D& params)
+  : camera_chain(params.camera_chain)
+  , target_chain(params.target_chain)
+  , t_cm_to_c(params.camera_mount_to_camera_guess.translation())
+  , aa_cm_to_c(toAngleAxis(params.camera_mount_to_camera_guess))
+  , t_tm_to_t(params.target_mount_to_target_guess.translation())
+  , aa_tm_to_t(toAngleAxis(params.target_mount_to_target_guess))
+  , t_ccb_to_tcb(params.camera_base_to_target_base_guess.translation())
+  , aa_ccb_to_tcb(toAngleAxis(params.camera_base_to_target_base_guess))
+  , camera_chain_offset_stdev(params.camera_chain_offset_stdev)
+  , target_chain_offset_stdev(params.target_chain_offset_stdev)
+{
+  std::vector<std::array<std::string, 4>> camera_chain_param_labels;
+  std::vector<std::array<std::string, 4>> target_chain_param_labels;
+  camera_chain_dh_offsets = createDHOffsets(camera_chain, "camera_chain_placeholder", camera_chain_param_labels);
+  target_chain_dh_offsets = createDHOffsets(target_chain, "target_chain_placeholder", target_chain_param_labels);
 
-    // Residual error
-    cost_block->SetNumResiduals(4);
+  // Create a vector of the pointers to the optimization variables in the order that the cost function expects them
+  parameters = DualDHChainCostPose6D::constructParameters(camera_chain_dh_offsets,
+                                                          target_chain_dh_offsets,
+                                                          t_cm_to_c,
+                                                          aa_cm_to_c,
+                                                          t_tm_to_t,
+                                                          aa_tm_to_t,
+                                                          t_ccb_to_tcb,
+                                                          aa_ccb_to_tcb);
+
+  param_labels = DualDHChainCostPose6D::constructParameterLabels(
+      parameters,
+      camera_chain_param_labels,
+      target_chain_param_labels,
+      createLabels(params.label_camera_mount_to_camera, "x", "y", "z"),
+      createLabels(params.label_camera_mount_to_camera, "rx", "ry", "rz"),
+      createLabels(params.label_target_mount_to_target, "x", "y", "z"),
+      createLabels(params.label_target_mount_to_target, "rx", "ry", "rz"),
+      createLabels(params.label_camera_base_to_target, "x", "y", "z"),
+      createLabels(params.label_camera_base_to_target, "rx", "ry", "rz"));
+
+  param_masks = DualDHChainCostPose6D::constructParameterMasks(parameters, params.mask);
+  param_names = DualDHChainCostPose6D::constructParameterNames(parameters);
+}
 
-    // Add the residual block to the problem
-    problem.AddResidualBlock(cost_block, nullptr, parameters);
-  }
+void KinematicCalibrationVariablesPose6D::addParameterBlocks(ceres::Problem& problem,
+                                                             const PoseParameterization pose_parameterization)
+{
+  const std::vector<int> block_sizes = sizes();
+  for (std::size_t i = 0; i < parameters.size(); ++i)
+    problem.AddParameterBlock(parameters[i], block_sizes[i]);
 
   // Tell the optimization to keep constant the dummy DH offsets that might have been added to the 0-DoF chains
-  if (params.camera_chain.dof() == 0)
+  if (camera_chain.dof() == 0)
     problem.SetParameterBlockConstant(camera_chain_dh_offsets.data());
-  if (params.target_chain.dof() == 0)
+  if (target_chain.dof() == 0)
     problem.SetParameterBlockConstant(target_chain_dh_offsets.data());
 
   // Add subset parameterization to mask variables that shouldn't be optimized
   addSubsetParameterization(problem, param_masks);
 
-  // Add a cost to drive the camera chain DH parameters towards an expected mean
-  if (params.camera_chain.dof() != 0 && !problem.IsParameterBlockConstant(parameters[0]))
-  {
-    Eigen::ArrayXXd mean(
-      Eigen::ArrayXXd::Zero(camera_chain_dh_offsets.rows(), camera_chain_dh_offsets.cols()));
+  // Update the orientations that have no masked elements with the selected parameterization
+  setAngleAxisParameterization(problem, { parameters[3], parameters[5], parameters[7] }, param_masks, pose_parameterization);
 
-    Eigen::ArrayXXd stdev(Eigen::ArrayXXd::Constant(camera_chain_dh_offsets.rows(),
-                                                    camera_chain_dh_offsets.cols(),
-                                                    params.camera_chain_offset_stdev));
+  // Add costs to drive the DH parameters of the chains towards an expected mean
+  if (camera_chain.dof() != 0 && !problem.IsParameterBlockConstant(parameters[0]))
+    addDHOffsetPrior(problem, camera_chain_dh_offsets, camera_chain_offset_stdev);
+  if (target_chain.dof() != 0 && !problem.IsParameterBlockConstant(parameters[1]))
+    addDHOffsetPrior(problem, target_chain_dh_offsets, target_chain_offset_stdev);
+}
 
-    auto *fn = new MaximumLikelihood(mean, stdev);
-    auto *cost_block = new ceres::DynamicAutoDiffCostFunction<MaximumLikelihood>(fn);
-    cost_block->AddParameterBlock(camera_chain_dh_offsets.size());
-    cost_block->SetNumResiduals(camera_chain_dh_offsets.size());
+ceres::ResidualBlockId KinematicCalibrationVariablesPose6D::addMeasurement(ceres::Problem& problem,
+                                                                           const KinematicMeasurement& measurement,
+                                                                           const double orientation_weight)
+{
+  // Allocate Ceres data structures - ownership is taken by the ceres
+  // Problem data structure
+  auto* cost_fn = new DualDHChainCostPose6D(measurement, camera_chain, target_chain, orientation_weight);
 
-    problem.AddResidualBlock(cost_block, nullptr, camera_chain_dh_offsets.data());
-  }
+  auto *cost_block = new ceres::DynamicAutoDiffCostFunction<DualDHChainCostPose6D>(cost_fn);
 
-  // Add a cost to drive the target chain DH parameters towards an expected mean
-  if (params.target_chain.dof() != 0 && !problem.IsParameterBlockConstant(parameters[1]))
-  {
-    Eigen::ArrayXXd mean(
-      Eigen::ArrayXXd::Zero(target_chain_dh_offsets.rows(), target_chain_dh_offsets.cols()));
+  // Add the optimization parameters: the DH parameters of both kinematic chains, then the position and angle axis of the
+  // camera mount to camera, target mount to target and camera chain base to target chain base transforms
+  for (const int size : sizes())
+    cost_block->AddParameterBlock(size);
 
-    Eigen::ArrayXXd stdev(Eigen::ArrayXXd::Constant(target_chain_dh_offsets.rows(),
-                                                    target_chain_dh_offsets.cols(),
-                                                    params.target_chain_offset_stdev));
+  // Residual error
+  cost_block->SetNumResiduals(4);
 
-    auto *fn = new MaximumLikelihood(mean, stdev);
-    auto *cost_block = new ceres::DynamicAutoDiffCostFunction<MaximumLikelihood>(fn);
-    cost_block->AddParameterBlock(target_chain_dh_offsets.size());
-    cost_block->SetNumResiduals(target_chain_dh_offsets.size());
+  return problem.AddResidualBlock(cost_block, nullptr, parameters);
+}
 
-    problem.AddResidualBlock(cost_block, nullptr, target_chain_dh_offsets.data());
-  }
+std::vector<int> KinematicCalibrationVariablesPose6D::sizes() const
+{
+  return { static_cast<int>(camera_chain_dh_offsets.size()), static_cast<int>(target_chain_dh_offsets.size()), 3, 3, 3, 3, 3, 3 };
+}
+
+void KinematicCalibrationVariablesPose6D::getResult(KinematicCalibrationResult& result) const
+{
+  // Save the transforms
+  result.camera_mount_to_camera = createTransform(t_cm_to_c, aa_cm_to_c);
+  result.target_mount_to_target = createTransform(t_tm_to_t, aa_tm_to_t);
+  result.camera_base_to_target_base = createTransform(t_ccb_to_tcb, aa_ccb_to_tcb);
+
+  // Save the DH parameter offsets, without the placeholders of the 0-DoF chains
+  result.camera_chain_dh_offsets = camera_chain_dh_offsets.topRows(camera_chain.dof());
+  result.target_chain_dh_offsets = target_chain_dh_offsets.topRows(target_chain.dof());
+}
+
+/**
+ * @brief Solves the kinematic calibration with 6D pose measurements
+ * @param num_threads - The maximum number of threads of the solver when the solver profile of the problem is automatic
+ * @param verbose - Whether to print the labels of the optimized parameters
+ */
+static KinematicCalibrationResult solvePose6D(const KinematicCalibrationProblemPose6D &params,
+                                              const double orientation_weight,
+                                              const ceres::Solver::Options& options,
+                                              const std::size_t num_threads,
+                                              const bool verbose)
+{
+  // Set up the problem
+  KinematicCalibrationVariablesPose6D variables(params);
+  ceres::Problem problem;
+  variables.addParameterBlocks(problem, params.pose_parameterization);
+
+  for (const auto &observation : params.observations)
+    variables.addMeasurement(problem, observation, orientation_weight);
 
   // Print optimization parameter labels
-  printOptimizationLabels(problem, param_names, param_labels, param_masks);
+  if (verbose)
+    printOptimizationLabels(problem, variables.param_names, variables.param_labels, variables.param_masks);
 
   // Solve the optimization
   ceres::Solver::Summary summary;
-  ceres::Solve(options, &problem, &summary);
+  ceres::Solve(configureSolverOptions(problem, options, params.solver_profile, num_threads), &problem, &summary);
 
   // Report and save the results
   KinematicCalibrationResult result;
   result.initial_cost_per_obs = summary.initial_cost / summary.num_residuals;
   result.converged = summary.termination_type == ceres::CONVERGENCE;
   result.final_cost_per_obs = summary.final_cost / summary.num_residuals;
+  variables.getResult(result);
 
-  // Save the transforms
-  result.camera_mount_to_camera = createTransform(t_cm_to_c, aa_cm_to_c);
-  result.target_mount_to_target = createTransform(t_tm_to_t, aa_tm_to_t);
-  result.camera_base_to_target_base = createTransform(t_ccb_to_tcb, aa_ccb_to_tcb);
+  result.covariance = computeCovariance(
+      problem, variables.param_labels, variables.param_masks, params.covariance_options, params.covariance_mode);
 
-  // Save the DH parameter offsets
-  if (params.camera_chain.dof() == 0)
-    result.camera_chain_dh_offsets = Eigen::MatrixX4d::Zero(params.camera_chain.dof(), 4);
-  else
-    result.camera_chain_dh_offsets = camera_chain_dh_offsets;
+  return result;
+}
 
-  if (params.target_chain.dof() == 0)
-    result.target_chain_dh_offsets = Eigen::MatrixX4d::Zero(params.target_chain.dof(), 4);
+KinematicCalibrationResult optimize(const KinematicCalibrationProblemPose6D &params,
+                                    const double orientation_weight)
+{
+  return optimize(params, orientation_weight, params.solver_options);
+}
+
+KinematicCalibrationResult optimize(const KinematicCalibrationProblemPose6D &params,
+                                    const double orientation_weight,
+                                    const ceres::Solver::Options& options)
+{
+  return solvePose6D(params, orientation_weight, options, 0, true);
+}
+
+/**
+ * @brief Randomly perturbs a transform guess, leaving the masked components of its translation and angle axis unchanged
+ * @param counter - The counter of the next value of the random generator, incremented for every value drawn
+ */
+static Eigen::Isometry3d perturbGuess(const Eigen::Isometry3d& guess,
+                                      const std::vector<int>& position_mask,
+                                      const std::vector<int>& rotation_mask,
+                                      const MultiStartOptions& options,
+                                      const CounterBasedRandomGenerator& rng,
+                                      std::uint64_t& counter)
+{
+  Eigen::Quaterniond rotation;
+  if (options.max_rotation >= M_PI)
+  {
+    // Uniformly distributed orientation on SO(3) (K. Shoemake, Uniform random rotations, Graphics Gems III, 1992)
+    const double u1 = rng.uniform(counter++, 0.0, 1.0);
+    const double u2 = rng.uniform(counter++, 0.0, 2.0 * M_PI);
+    const double u3 = rng.uniform(counter++, 0.0, 2.0 * M_PI);
+    rotation = Eigen::Quaterniond(std::sqrt(u1) * std::cos(u3),
+                                  std::sqrt(1.0 - u1) * std::sin(u2),
+                                  std::sqrt(1.0 - u1) * std::cos(u2),
+                                  std::sqrt(u1) * std::sin(u3));
+  }
   else
-    result.target_chain_dh_offsets = target_chain_dh_offsets;
+  {
+    // Rotation about a uniformly distributed axis, by a uniformly distributed angle
+    const double z = rng.uniform(counter++, -1.0, 1.0);
+    const double phi = rng.uniform(counter++, 0.0, 2.0 * M_PI);
+    const double angle = rng.uniform(counter++, 0.0, options.max_rotation);
+    const double r = std::sqrt(1.0 - z * z);
+    rotation = Eigen::AngleAxisd(angle, Eigen::Vector3d(r * std::cos(phi), r * std::sin(phi), z));
+  }
+
+  Eigen::Vector3d translation;
+  for (Eigen::Index i = 0; i < 3; ++i)
+    translation(i) = rng.uniform(counter++, -options.max_translation, options.max_translation);
+
+  // Restore the masked components, which the optimization holds constant
+  Eigen::Vector3d t(guess.translation() + translation);
+  const Eigen::AngleAxisd aa_guess(guess.rotation());
+  const Eigen::AngleAxisd aa_perturbed(guess.rotation() * rotation.toRotationMatrix());
+  Eigen::Vector3d aa(aa_perturbed.angle() * aa_perturbed.axis());
+
+  for (const int i : position_mask)
+    t(i) = guess.translation()(i);
+  for (const int i : rotation_mask)
+    aa(i) = aa_guess.angle() * aa_guess.axis()(i);
+
+  return createTransform(t, aa);
+}
 
-  ceres::Covariance::Options cov_options = rct_optimizations::DefaultCovarianceOptions();
-  cov_options.null_space_rank = -1;  // automatically drop terms below min_reciprocal_condition_number
+KinematicCalibrationMultiStartResult optimizeMultiStart(const KinematicCalibrationProblemPose6D &params,
+                                                        const MultiStartOptions& options,
+                                                        const double orientation_weight)
+{
+  if (options.num_starts == 0)
+    throw OptimizationException("The multi-start optimization requires at least one start");
+
+  std::vector<KinematicCalibrationResult> results(options.num_starts);
+  std::vector<char> solved(options.num_starts, 0);
+
+  // The starts are solved concurrently, with a single solver thread each
+  parallelFor(options.num_starts,
+              [&](const std::size_t start) {
+                // The covariance is only computed for the best start
+                KinematicCalibrationProblemPose6D problem(params);
+                problem.covariance_mode = CovarianceMode::NONE;
+
+                // The first start is the unperturbed guesses
+                if (start > 0)
+                {
+                  const CounterBasedRandomGenerator rng(options.seed, start);
+                  std::uint64_t counter = 0;
+                  problem.camera_mount_to_camera_guess = perturbGuess(
+                      params.camera_mount_to_camera_guess, params.mask[2], params.mask[3], options, rng, counter);
+                  problem.target_mount_to_target_guess = perturbGuess(
+                      params.target_mount_to_target_guess, params.mask[4], params.mask[5], options, rng, counter);
+                  problem.camera_base_to_target_base_guess = perturbGuess(
+                      params.camera_base_to_target_base_guess, params.mask[6], params.mask[7], options, rng, counter);
+                }
+
+                try
+                {
+                  results[start] = solvePose6D(problem, orientation_weight, problem.solver_options, 1, false);
+                  solved[start] = 1;
+                }
+                catch (const std::exception&)
+                {
+                }
+              },
+              options.num_threads);
+
+  KinematicCalibrationMultiStartResult result;
+  result.final_costs_per_obs.assign(options.num_starts, std::numeric_limits<double>::infinity());
+  result.start_converged.assign(options.num_starts, false);
+
+  // Select the converged start with the lowest cost, or the start with the lowest cost if none converged
+  bool found = false;
+  for (std::size_t start = 0; start < options.num_starts; ++start)
+  {
+    if (!solved[start])
+      continue;
+
+    result.final_costs_per_obs[start] = results[start].final_cost_per_obs;
+    result.start_converged[start] = results[start].converged;
+
+    const KinematicCalibrationResult& best = results[result.best_start];
+    if (!found || (results[start].converged && !best.converged) ||
+        (results[start].converged == best.converged && results[start].final_cost_per_obs < best.final_cost_per_obs))
+    {
+      result.best_start = start;
+      found = true;
+    }
+  }
+
+  if (!found)
+    throw OptimizationException("None of the starts of the multi-start optimization could be solved");
+
+  static_cast<KinematicCalibrationResult&>(result) = results[result.best_start];
 
-  result.covariance = computeCovariance(problem, param_labels, param_masks, cov_options);
+  // Compute the covariance at the solution of the best start
+  if (params.covariance_mode != CovarianceMode::NONE)
+  {
+    KinematicCalibrationProblemPose6D best_problem(params);
+    best_problem.camera_mount_to_camera_guess = result.camera_mount_to_camera;
+    best_problem.target_mount_to_target_guess = result.target_mount_to_target;
+    best_problem.camera_base_to_target_base_guess = result.camera_base_to_target_base;
+
+    KinematicCalibrationVariablesPose6D variables(best_problem);
+    variables.camera_chain_dh_offsets.topRows(params.camera_chain.dof()) = result.camera_chain_dh_offsets;
+    variables.target_chain_dh_offsets.topRows(params.target_chain.dof()) = result.target_chain_dh_offsets;
+
+    ceres::Problem problem;
+    variables.addParameterBlocks(problem, params.pose_parameterization);
+    for (const auto &observation : params.observations)
+      variables.addMeasurement(problem, observation, orientation_weight);
+
+    result.covariance = computeCovariance(
+        problem, variables.param_labels, variables.param_masks, params.covariance_options, params.covariance_mode);
+  }
 
   return result;
 }
 
 } // namespace rct_optimizations
-
@@ -0,0 +1,113 @@
+#include <rct_optimizations/dh_chain_kinematic_sliding_window.h>
+#include <rct_optimizations/covariance_analysis.h>
+
+#include <ceres/ceres.h>
+
+using namespace rct_optimizations;
+
+namespace
+{
+ceres::Problem::Options createProblemOptions()
+{
+  ceres::Problem::Options options;
+  // Residual blocks are removed from the sliding window on every update
+  options.enable_fast_removal = true;
+  return options;
+}
+
+} // namespace anonymous
+
+namespace rct_optimizations
+{
+KinematicCalibrationSlidingWindowPose6D::KinematicCalibrationSlidingWindowPose6D(
+    const KinematicCalibrationProblemPose6D& params,
+    const std::size_t window_size,
+    const double max_update_time,
+    const double orientation_weight)
+  : variables_(params)
+  , orientation_weight_(orientation_weight)
+  , problem_(createProblemOptions())
+  , solver_options_(params.solver_options)
+  , solver_profile_(params.solver_profile)
+  , covariance_options_(params.covariance_options)
+  , covariance_mode_(params.covariance_mode)
+  , window_size_(window_size)
+  , max_update_time_(max_update_time)
+  , num_marginalized_(0)
+  , prior_(variables_.parameters, variables_.sizes(), variables_.param_masks)
+{
+  if (window_size_ == 0)
+    throw OptimizationException("The size of the sliding window must be positive");
+  if (max_update_time_ <= 0.0)
+    throw OptimizationException("The maximum update time must be positive");
+
+  // Add the parameter blocks explicitly so that they can be configured before any measurement is added. The marginalization
+  // prior is a quadratic in the angle-axis values, so the orientations are always updated additively
+  variables_.addParameterBlocks(problem_, PoseParameterization::ANGLE_AXIS);
+
+  for (const KinematicMeasurement& measurement : params.observations)
+    addToWindow(measurement);
+
+  // Solve the initial measurements from the guesses, then reduce them to the size of the window
+  if (!window_.empty())
+  {
+    solve(solver_options_);
+    while (window_.size() > window_size_)
+      marginalizeOldest();
+  }
+}
+
+KinematicCalibrationResult KinematicCalibrationSlidingWindowPose6D::update(const KinematicMeasurement& measurement)
+{
+  addToWindow(measurement);
+
+  // Marginalize at the previous estimate, before the new measurement changes it
+  while (window_.size() > window_size_)
+    marginalizeOldest();
+
+  ceres::Solver::Options options = solver_options_;
+  options.max_solver_time_in_seconds = max_update_time_;
+  return solve(options);
+}
+
+std::size_t KinematicCalibrationSlidingWindowPose6D::numMeasurements() const
+{
+  return window_.size();
+}
+
+std::size_t KinematicCalibrationSlidingWindowPose6D::numMarginalizedMeasurements() const
+{
+  return num_marginalized_;
+}
+
+void KinematicCalibrationSlidingWindowPose6D::addToWindow(const KinematicMeasurement& measurement)
+{
+  window_.push_back(variables_.addMeasurement(problem_, measurement, orientation_weight_));
+}
+
+void KinematicCalibrationSlidingWindowPose6D::marginalizeOldest()
+{
+  prior_.marginalize(problem_, window_.front());
+  window_.pop_front();
+  ++num_marginalized_;
+}
+
+KinematicCalibrationResult KinematicCalibrationSlidingWindowPose6D::solve(const ceres::Solver::Options& options)
+{
+  ceres::Solver::Summary summary;
+  ceres::Solve(configureSolverOptions(problem_, options, solver_profile_), &problem_, &summary);
+
+  KinematicCalibrationResult result;
+  result.initial_cost_per_obs = summary.initial_cost / summary.num_residuals;
+  result.converged = summary.termination_type == ceres::CONVERGENCE;
+  result.final_cost_per_obs = summary.final_cost / summary.num_residuals;
+
+  variables_.getResult(result);
+
+  result.covariance =
+      computeCovariance(problem_, variables_.param_labels, variables_.param_masks, covariance_options_, covariance_mode_);
+
+  return result;
+}
+
+} // namespace rct_optimizations
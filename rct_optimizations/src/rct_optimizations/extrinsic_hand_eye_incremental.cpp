@@ -0,0 +1,304 @@
+#include <rct_optimizations/extrinsic_hand_eye_incremental.h>
+
+#include <rct_optimizations/covariance_analysis.h>
+#include <rct_optimizations/eigen_conversions.h>
+#include <rct_optimizations/image_observation_cost.h>
+#include <rct_optimizations/local_parameterization.h>
+
+#include <ceres/ceres.h>
+#include <memory>
+
+using namespace rct_optimizations;
+
+namespace
+{
+/**
+ * @brief Checks that all of the target features of an observation lie in front of the camera
+ */
+bool arePointsVisible(const Pose6d &camera_to_camera_mount,
+                      const Pose6d &target_mount_to_target,
+                      const AnalyticImageObservationCost<2> *cost_fn)
+{
+  const Eigen::Matrix3Xd camera_points = cost_fn->getTargetPointsInCamera(camera_to_camera_mount.values.data(),
+                                                                          target_mount_to_target.values.data());
+
+  // Return whether or not the projected points' Z values are greater than zero
+  return (camera_points.row(2).array() > 0.0).all();
+}
+
+/**
+ * @brief Creates the cost of an observation (one residual block for all of its correspondences)
+ * @throws std::runtime_error if the target features of the observation lie behind the camera at the input parameters
+ */
+std::unique_ptr<AnalyticImageObservationCost<2>> createObservationCost(const Observation2D3D& observation,
+                                                                       const CameraIntrinsics& intr,
+                                                                       const Pose6d& camera_to_camera_mount,
+                                                                       const Pose6d& target_mount_to_target)
+{
+  // camera_point = camera_to_camera_mount * (camera_mount_to_base * base_to_target_mount) * target_mount_to_target * target_point
+  const Eigen::Isometry3d camera_mount_to_target_mount = observation.to_camera_mount.inverse() * observation.to_target_mount;
+
+  // The cost computes its Jacobians analytically
+  std::unique_ptr<AnalyticImageObservationCost<2>> cost_block(
+    new AnalyticImageObservationCost<2>(observation.correspondence_set,
+                                        intr,
+                                        Eigen::Isometry3d::Identity(),
+                                        camera_mount_to_target_mount));
+
+  // Check that the target features in camera coordinates are visible by the camera
+  // Target features that project behind the camera tend to prevent the optimization from converging
+  if (!arePointsVisible(camera_to_camera_mount, target_mount_to_target, cost_block.get()))
+  {
+    throw std::runtime_error(
+      "Projected target feature lies behind the image plane using the "
+      "current target mount and camera mount transform guesses. Try updating the initial "
+      "transform guesses to more accurately represent the problem");
+  }
+
+  return cost_block;
+}
+
+/**
+ * @brief Composes the labels of the parameters ("camera_mount_to_camera_x", etc.)
+ */
+std::map<const double*, std::vector<std::string>> createParamLabels(const ExtrinsicHandEyeProblem2D3D& params,
+                                                                    const Pose6d& camera_to_camera_mount,
+                                                                    const Pose6d& target_mount_to_target)
+{
+  std::map<const double*, std::vector<std::string>> param_labels;
+
+  std::vector<std::string>& labels_camera_mount_to_camera = param_labels[camera_to_camera_mount.values.data()];
+  for (auto label_isometry : params.labels_isometry3d)
+  {
+    labels_camera_mount_to_camera.emplace_back(params.label_camera_mount_to_camera + "_" + label_isometry);
+  }
+
+  std::vector<std::string>& labels_target_mount_to_target = param_labels[target_mount_to_target.values.data()];
+  for (auto label_isometry : params.labels_isometry3d)
+  {
+    labels_target_mount_to_target.emplace_back(params.label_target_mount_to_target + "_" + label_isometry);
+  }
+
+  return param_labels;
+}
+
+ceres::Problem::Options createProblemOptions()
+{
+  ceres::Problem::Options options;
+  // Residual blocks are removed from the sliding window on every update
+  options.enable_fast_removal = true;
+  return options;
+}
+
+} // namespace anonymous
+
+namespace rct_optimizations
+{
+ExtrinsicHandEyeIncremental2D3D::ExtrinsicHandEyeIncremental2D3D(const ExtrinsicHandEyeProblem2D3D& params,
+                                                                 const int max_incremental_iterations)
+  : intr_(params.intr)
+  , camera_to_camera_mount_(poseEigenToCal(params.camera_mount_to_camera_guess.inverse()))
+  , target_mount_to_target_(poseEigenToCal(params.target_mount_to_target_guess))
+  , solver_options_(params.solver_options)
+  , solver_profile_(params.solver_profile)
+  , covariance_mode_(params.covariance_mode)
+  , max_incremental_iterations_(max_incremental_iterations)
+  , solved_(false)
+  , param_labels_(createParamLabels(params, camera_to_camera_mount_, target_mount_to_target_))
+{
+  problem_.AddParameterBlock(camera_to_camera_mount_.values.data(), 6);
+  problem_.AddParameterBlock(target_mount_to_target_.values.data(), 6);
+  setPose6dParameterization(problem_, camera_to_camera_mount_.values.data(), params.pose_parameterization);
+  setPose6dParameterization(problem_, target_mount_to_target_.values.data(), params.pose_parameterization);
+
+  addObservations(params.observations);
+}
+
+void ExtrinsicHandEyeIncremental2D3D::addObservation(const Observation2D3D& observation)
+{
+  addObservations(Observation2D3D::Set(1, observation));
+}
+
+void ExtrinsicHandEyeIncremental2D3D::addObservations(const Observation2D3D::Set& observations)
+{
+  // Create all of the cost functions before modifying the problem, so that no observation is added if any is invalid
+  std::vector<std::unique_ptr<AnalyticImageObservationCost<2>>> cost_blocks;
+  cost_blocks.reserve(observations.size());
+
+  for (const auto &observation : observations)
+  {
+    if (observation.correspondence_set.empty())
+      continue;
+
+    cost_blocks.push_back(createObservationCost(observation, intr_, camera_to_camera_mount_, target_mount_to_target_));
+  }
+
+  // Ownership of the cost functions is taken by the Ceres problem
+  for (auto& cost_block : cost_blocks)
+  {
+    problem_.AddResidualBlock(cost_block.release(), NULL, camera_to_camera_mount_.values.data(),
+                              target_mount_to_target_.values.data());
+  }
+}
+
+ExtrinsicHandEyeResult ExtrinsicHandEyeIncremental2D3D::solve()
+{
+  if (problem_.NumResidualBlocks() == 0)
+    throw OptimizationException("The hand-eye calibration does not have any observations");
+
+  ceres::Solver::Options options = configureSolverOptions(problem_, solver_options_, solver_profile_);
+
+  // Subsequent solves start from the previous solution, which the new observations only perturb slightly
+  if (solved_)
+    options.max_num_iterations = max_incremental_iterations_;
+
+  ceres::Solver::Summary summary;
+  ceres::Solve(options, &problem_, &summary);
+  solved_ = true;
+
+  ExtrinsicHandEyeResult result;
+  result.converged = summary.termination_type == ceres::CONVERGENCE;
+  result.target_mount_to_target = getTargetMountToTarget();
+  result.camera_mount_to_camera = getCameraMountToCamera();
+  result.initial_cost_per_obs = summary.initial_cost / summary.num_residuals;
+  result.final_cost_per_obs = summary.final_cost / summary.num_residuals;
+
+  result.covariance = rct_optimizations::computeCovariance(problem_,
+                                                           param_labels_,
+                                                           std::map<const double *, std::vector<int>>(),
+                                                           DefaultCovarianceOptions(),
+                                                           covariance_mode_);
+
+  return result;
+}
+
+std::size_t ExtrinsicHandEyeIncremental2D3D::numObservations() const
+{
+  return static_cast<std::size_t>(problem_.NumResidualBlocks());
+}
+
+Eigen::Isometry3d ExtrinsicHandEyeIncremental2D3D::getCameraMountToCamera() const
+{
+  return poseCalToEigen(camera_to_camera_mount_).inverse();
+}
+
+Eigen::Isometry3d ExtrinsicHandEyeIncremental2D3D::getTargetMountToTarget() const
+{
+  return poseCalToEigen(target_mount_to_target_);
+}
+
+ExtrinsicHandEyeSlidingWindow2D3D::ExtrinsicHandEyeSlidingWindow2D3D(const ExtrinsicHandEyeProblem2D3D& params,
+                                                                     const std::size_t window_size,
+                                                                     const int max_update_iterations)
+  : intr_(params.intr)
+  , camera_to_camera_mount_(poseEigenToCal(params.camera_mount_to_camera_guess.inverse()))
+  , target_mount_to_target_(poseEigenToCal(params.target_mount_to_target_guess))
+  , problem_(createProblemOptions())
+  , solver_options_(params.solver_options)
+  , solver_profile_(params.solver_profile)
+  , covariance_mode_(params.covariance_mode)
+  , window_size_(window_size)
+  , max_update_iterations_(max_update_iterations)
+  , num_marginalized_(0)
+  , prior_({ camera_to_camera_mount_.values.data(), target_mount_to_target_.values.data() }, { 6, 6 })
+  , param_labels_(createParamLabels(params, camera_to_camera_mount_, target_mount_to_target_))
+{
+  if (window_size_ == 0)
+    throw OptimizationException("The size of the sliding window must be positive");
+
+  // The marginalization prior is a quadratic in the angle-axis values, so the orientations are always updated additively
+  problem_.AddParameterBlock(camera_to_camera_mount_.values.data(), 6);
+  problem_.AddParameterBlock(target_mount_to_target_.values.data(), 6);
+
+  for (const Observation2D3D& observation : params.observations)
+    addToWindow(observation);
+
+  // Solve the initial observations from the guesses, then reduce them to the size of the window
+  if (!window_.empty())
+  {
+    solve(solver_options_.max_num_iterations);
+    while (window_.size() > window_size_)
+      marginalizeOldest();
+  }
+}
+
+ExtrinsicHandEyeResult ExtrinsicHandEyeSlidingWindow2D3D::update(const Observation2D3D& observation)
+{
+  addToWindow(observation);
+
+  // Marginalize at the previous estimate, before the new observation changes it
+  while (window_.size() > window_size_)
+    marginalizeOldest();
+
+  return solve(max_update_iterations_);
+}
+
+std::size_t ExtrinsicHandEyeSlidingWindow2D3D::numObservations() const
+{
+  return window_.size();
+}
+
+std::size_t ExtrinsicHandEyeSlidingWindow2D3D::numMarginalizedObservations() const
+{
+  return num_marginalized_;
+}
+
+Eigen::Isometry3d ExtrinsicHandEyeSlidingWindow2D3D::getCameraMountToCamera() const
+{
+  return poseCalToEigen(camera_to_camera_mount_).inverse();
+}
+
+Eigen::Isometry3d ExtrinsicHandEyeSlidingWindow2D3D::getTargetMountToTarget() const
+{
+  return poseCalToEigen(target_mount_to_target_);
+}
+
+void ExtrinsicHandEyeSlidingWindow2D3D::addToWindow(const Observation2D3D& observation)
+{
+  if (observation.correspondence_set.empty())
+    return;
+
+  std::unique_ptr<AnalyticImageObservationCost<2>> cost_block =
+    createObservationCost(observation, intr_, camera_to_camera_mount_, target_mount_to_target_);
+
+  // Ownership of the cost function is taken by the Ceres problem
+  window_.push_back(problem_.AddResidualBlock(cost_block.release(), NULL, camera_to_camera_mount_.values.data(),
+                                              target_mount_to_target_.values.data()));
+}
+
+void ExtrinsicHandEyeSlidingWindow2D3D::marginalizeOldest()
+{
+  // Linearize the oldest observation at the current estimate and replace it with the updated prior
+  prior_.marginalize(problem_, window_.front());
+  window_.pop_front();
+  ++num_marginalized_;
+}
+
+ExtrinsicHandEyeResult ExtrinsicHandEyeSlidingWindow2D3D::solve(const int max_iterations)
+{
+  if (problem_.NumResidualBlocks() == 0)
+    throw OptimizationException("The hand-eye calibration does not have any observations");
+
+  ceres::Solver::Options options = configureSolverOptions(problem_, solver_options_, solver_profile_);
+  options.max_num_iterations = max_iterations;
+
+  ceres::Solver::Summary summary;
+  ceres::Solve(options, &problem_, &summary);
+
+  ExtrinsicHandEyeResult result;
+  result.converged = summary.termination_type == ceres::CONVERGENCE;
+  result.target_mount_to_target = getTargetMountToTarget();
+  result.camera_mount_to_camera = getCameraMountToCamera();
+  result.initial_cost_per_obs = summary.initial_cost / summary.num_residuals;
+  result.final_cost_per_obs = summary.final_cost / summary.num_residuals;
+
+  result.covariance = rct_optimizations::computeCovariance(problem_,
+                                                           param_labels_,
+                                                           std::map<const double *, std::vector<int>>(),
+                                                           DefaultCovarianceOptions(),
+                                                           covariance_mode_);
+
+  return result;
+}
+
+} // namespace rct_optimizations
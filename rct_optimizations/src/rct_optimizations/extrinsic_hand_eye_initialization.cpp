@@ -0,0 +1,176 @@
+#include <rct_optimizations/extrinsic_hand_eye_initialization.h>
+#include <rct_optimizations/parallel.h>
+#include <rct_optimizations/pnp.h>
+#include <rct_optimizations/validation/noise_qualification.h>
+
+#include <Eigen/SVD>
+#include <limits>
+#include <sstream>
+
+namespace
+{
+/** @brief Maximum rotation angle of a motion used to estimate the rotation of X; the axis of a rotation by pi is ambiguous */
+const double MAX_ROTATION_ANGLE = 0.95 * M_PI;
+
+/**
+ * @brief Estimates the camera to target pose of each observation of a hand-eye problem with the input estimator and
+ * initializes the guesses of the problem from these poses
+ */
+template<typename ProblemT, typename PoseEstimatorT>
+void initializeGuessesFromPoses(ProblemT& problem, const PoseEstimatorT& estimate_pose)
+{
+  using namespace rct_optimizations;
+  const std::size_t n = problem.observations.size();
+
+  // Estimate the camera to target pose of each image independently
+  std::vector<Eigen::Isometry3d> poses(n);
+  std::vector<char> valid(n, 0);
+  parallelFor(n, [&](const std::size_t i) {
+    // Observations whose correspondences do not constrain the pose (e.g. too few points, or points on a single line)
+    // are not used
+    try
+    {
+      poses[i] = estimate_pose(problem.observations[i]);
+      valid[i] = 1;
+    }
+    catch (const std::runtime_error&)
+    {
+    }
+  });
+
+  std::vector<Eigen::Isometry3d> to_camera_mount, to_target_mount, camera_to_target;
+  for (std::size_t i = 0; i < n; ++i)
+  {
+    if (!valid[i])
+      continue;
+
+    to_camera_mount.push_back(problem.observations[i].to_camera_mount);
+    to_target_mount.push_back(problem.observations[i].to_target_mount);
+    camera_to_target.push_back(poses[i]);
+  }
+
+  estimateHandEye(to_camera_mount,
+                  to_target_mount,
+                  camera_to_target,
+                  problem.camera_mount_to_camera_guess,
+                  problem.target_mount_to_target_guess);
+}
+
+} // namespace anonymous
+
+namespace rct_optimizations
+{
+Eigen::Isometry3d solveAXXB(const std::vector<Eigen::Isometry3d>& a, const std::vector<Eigen::Isometry3d>& b)
+{
+  if (a.size() != b.size())
+  {
+    std::stringstream ss;
+    ss << "Number of A motions (" << a.size() << ") does not match number of B motions (" << b.size() << ")";
+    throw std::runtime_error(ss.str());
+  }
+
+  // Rotation: R_A * R_X = R_X * R_B implies log(R_A) = R_X * log(R_B)
+  // Find the rotation that best aligns the angle-axis vectors of B to those of A (Kabsch)
+  Eigen::Matrix3d correlation = Eigen::Matrix3d::Zero();
+  for (std::size_t i = 0; i < a.size(); ++i)
+  {
+    const Eigen::AngleAxisd angle_axis_a(a[i].rotation());
+    const Eigen::AngleAxisd angle_axis_b(b[i].rotation());
+    if (angle_axis_a.angle() > MAX_ROTATION_ANGLE || angle_axis_b.angle() > MAX_ROTATION_ANGLE)
+      continue;
+
+    correlation += (angle_axis_b.angle() * angle_axis_b.axis()) * (angle_axis_a.angle() * angle_axis_a.axis()).transpose();
+  }
+
+  Eigen::JacobiSVD<Eigen::Matrix3d> svd(correlation, Eigen::ComputeFullU | Eigen::ComputeFullV);
+  const Eigen::Vector3d& singular_values = svd.singularValues();
+  if (singular_values(0) <= std::numeric_limits<double>::epsilon() || singular_values(1) <= 1.0e-6 * singular_values(0))
+    throw std::runtime_error("The motions must include rotations about at least two non-parallel axes to solve AX = XB");
+
+  Eigen::Matrix3d d = Eigen::Matrix3d::Identity();
+  d(2, 2) = (svd.matrixV() * svd.matrixU().transpose()).determinant() < 0.0 ? -1.0 : 1.0;
+  const Eigen::Matrix3d rotation = svd.matrixV() * d * svd.matrixU().transpose();
+
+  // Translation: (R_A - I) * t_X = R_X * t_B - t_A, solved with the normal equations
+  Eigen::Matrix3d lhs = Eigen::Matrix3d::Zero();
+  Eigen::Vector3d rhs = Eigen::Vector3d::Zero();
+  for (std::size_t i = 0; i < a.size(); ++i)
+  {
+    const Eigen::Matrix3d c = a[i].linear() - Eigen::Matrix3d::Identity();
+    lhs += c.transpose() * c;
+    rhs += c.transpose() * (rotation * b[i].translation() - a[i].translation());
+  }
+
+  Eigen::Isometry3d x(Eigen::Isometry3d::Identity());
+  x.linear() = rotation;
+  x.translation() = lhs.ldlt().solve(rhs);
+  return x;
+}
+
+void estimateHandEye(const std::vector<Eigen::Isometry3d>& to_camera_mount,
+                     const std::vector<Eigen::Isometry3d>& to_target_mount,
+                     const std::vector<Eigen::Isometry3d>& camera_to_target,
+                     Eigen::Isometry3d& camera_mount_to_camera,
+                     Eigen::Isometry3d& target_mount_to_target)
+{
+  const std::size_t n = camera_to_target.size();
+  if (to_camera_mount.size() != n || to_target_mount.size() != n)
+    throw std::runtime_error("The number of camera mount, target mount, and camera to target poses must match");
+
+  if (n < 3)
+  {
+    std::stringstream ss;
+    ss << "At least 3 observations are required to estimate the hand-eye transforms (" << n << " provided)";
+    throw std::runtime_error(ss.str());
+  }
+
+  // G_i = target_mount_to_camera_mount, such that G_i * X * C_i = Y for all observations
+  std::vector<Eigen::Isometry3d> target_mount_to_camera_mount;
+  target_mount_to_camera_mount.reserve(n);
+  for (std::size_t i = 0; i < n; ++i)
+    target_mount_to_camera_mount.push_back(to_target_mount[i].inverse() * to_camera_mount[i]);
+
+  // G_i * X * C_i = G_j * X * C_j  =>  (G_j^-1 * G_i) * X = X * (C_j * C_i^-1)
+  std::vector<Eigen::Isometry3d> a, b;
+  a.reserve(n * (n - 1) / 2);
+  b.reserve(n * (n - 1) / 2);
+  for (std::size_t i = 0; i < n; ++i)
+  {
+    for (std::size_t j = i + 1; j < n; ++j)
+    {
+      a.push_back(target_mount_to_camera_mount[j].inverse() * target_mount_to_camera_mount[i]);
+      b.push_back(camera_to_target[j] * camera_to_target[i].inverse());
+    }
+  }
+
+  camera_mount_to_camera = solveAXXB(a, b);
+
+  // Average the estimates of Y = G_i * X * C_i
+  Eigen::Vector3d translation = Eigen::Vector3d::Zero();
+  std::vector<Eigen::Quaterniond> orientations;
+  orientations.reserve(n);
+  for (std::size_t i = 0; i < n; ++i)
+  {
+    const Eigen::Isometry3d y = target_mount_to_camera_mount[i] * camera_mount_to_camera * camera_to_target[i];
+    translation += y.translation();
+    orientations.emplace_back(y.linear());
+  }
+
+  target_mount_to_target = Eigen::Isometry3d::Identity();
+  target_mount_to_target.linear() = computeQuaternionMean(orientations).normalized().toRotationMatrix();
+  target_mount_to_target.translation() = translation / static_cast<double>(n);
+}
+
+void initializeGuesses(ExtrinsicHandEyeProblem2D3D& problem)
+{
+  initializeGuessesFromPoses(problem, [&problem](const Observation2D3D& obs) {
+    return estimatePlanarPose(problem.intr, obs.correspondence_set);
+  });
+}
+
+void initializeGuesses(ExtrinsicHandEyeProblem3D3D& problem)
+{
+  initializeGuessesFromPoses(problem, [](const Observation3D3D& obs) { return estimatePose3D(obs.correspondence_set); });
+}
+
+} // namespace rct_optimizations
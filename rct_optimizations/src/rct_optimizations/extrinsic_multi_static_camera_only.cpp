@@ -1,6 +1,9 @@
 #include "rct_optimizations/extrinsic_multi_static_camera_only.h"
 #include "rct_optimizations/ceres_math_utilities.h"
+#include "rct_optimizations/covariance_analysis.h"
 #include "rct_optimizations/eigen_conversions.h"
+#include "rct_optimizations/image_observation_cost.h"
+#include "rct_optimizations/local_parameterization.h"
 #include "rct_optimizations/types.h"
 
 #include <ceres/ceres.h>
@@ -8,97 +11,6 @@
 
 using namespace rct_optimizations;
 
-namespace
-{
-
-class ReprojectionFreeCameraCost
-{
-public:
-  ReprojectionFreeCameraCost(const Eigen::Vector2d& obs, const CameraIntrinsics& intr, const Eigen::Vector3d& point_in_target)
-    : obs_(obs), intr_(intr), target_pt_(point_in_target)
-  {}
-
-  template <typename T>
-  bool operator() (const T* const pose_camera_to_base, const T* pose_base_to_target, T* residual) const
-  {
-    const T* camera_angle_axis = pose_camera_to_base + 0;
-    const T* camera_position = pose_camera_to_base + 3;
-
-    const T* target_angle_axis = pose_base_to_target + 0;
-    const T* target_position = pose_base_to_target + 3;
-
-    T world_point[3]; // Point in world coordinates (base of robot)
-    T camera_point[3]; // Point in camera coordinates
-
-    // Transform points into camera coordinates
-    T target_pt[3];
-    target_pt[0] = T(target_pt_(0));
-    target_pt[1] = T(target_pt_(1));
-    target_pt[2] = T(target_pt_(2));
-
-    transformPoint(target_angle_axis, target_position, target_pt, world_point);
-    transformPoint(camera_angle_axis, camera_position, world_point, camera_point);
-
-    // Compute projected point into image plane and compute residual
-    T xy_image[2];
-    projectPoint(intr_, camera_point, xy_image);
-
-    residual[0] = xy_image[0] - obs_.x();
-    residual[1] = xy_image[1] - obs_.y();
-
-    return true;
-  }
-
-private:
-  Eigen::Vector2d obs_;
-  CameraIntrinsics intr_;
-  Eigen::Vector3d target_pt_;
-};
-
-class ReprojectionFixedCameraCost
-{
-public:
-  ReprojectionFixedCameraCost(const Eigen::Vector2d& obs, const CameraIntrinsics& intr, const Eigen::Isometry3d& base_to_camera, const Eigen::Vector3d& point_in_target)
-    : obs_(obs), intr_(intr), camera_to_base_(poseEigenToCal(base_to_camera.inverse())), target_pt_(point_in_target)
-  {}
-
-  template <typename T>
-  bool operator() (const T* const pose_base_to_target, T* residual) const
-  {
-    const T* target_angle_axis = pose_base_to_target + 0;
-    const T* target_position = pose_base_to_target + 3;
-
-    T world_point[3]; // Point in world coordinates (base of robot)
-    T camera_point[3]; // Point in camera coordinates
-
-    // Transform points into camera coordinates
-    T target_pt[3];
-    target_pt[0] = T(target_pt_(0));
-    target_pt[1] = T(target_pt_(1));
-    target_pt[2] = T(target_pt_(2));
-
-    transformPoint(target_angle_axis, target_position, target_pt, world_point);
-    poseTransformPoint(camera_to_base_, world_point, camera_point);
-
-    // Compute projected point into image plane and compute residual
-    T xy_image[2];
-    projectPoint(intr_, camera_point, xy_image);
-
-    residual[0] = xy_image[0] - obs_.x();
-    residual[1] = xy_image[1] - obs_.y();
-
-    return true;
-  }
-
-private:
-  Eigen::Vector2d obs_;
-  CameraIntrinsics intr_;
-  Pose6d camera_to_base_;
-  Eigen::Vector3d target_pt_;
-};
-
-}
-
 rct_optimizations::ExtrinsicMultiStaticCameraOnlyResult
 rct_optimizations::optimize(const rct_optimizations::ExtrinsicMultiStaticCameraOnlyProblem& params)
 {
@@ -117,37 +29,41 @@ rct_optimizations::optimize(const rct_optimizations::ExtrinsicMultiStaticCameraO
       assert(params.image_observations[c].size() == params.base_to_target_guess.size());
       internal_camera_to_base[c] = poseEigenToCal(params.base_to_camera_guess[c].inverse());
 
-      for (std::size_t j = 0; j < params.image_observations[c][i].size(); ++j) // For each 3D point seen in the 2D image
+      if (params.image_observations[c][i].empty())
+        continue;
+
+      // Create one residual block for all of the 3D points seen in the 2D image
+      const auto& intr = params.intr[c];
+
+      // Allocate Ceres data structures - ownership is taken by the ceres
+      // Problem data structure
+      if (params.fix_first_camera && (c == 0))
+      {
+        // camera_point = camera_to_base * base_to_target * target_point
+        auto* cost_fn = new ImageObservationCost<2>(params.image_observations[c][i], intr, params.base_to_camera_guess[c].inverse());
+
+        auto* cost_block = new ceres::AutoDiffCostFunction<ImageObservationCost<2>, ceres::DYNAMIC, 6>(cost_fn, cost_fn->numResiduals());
+
+        problem.AddResidualBlock(cost_block, NULL, internal_base_to_target[i].values.data());
+      }
+      else
       {
-        // Define
-        const auto& img_obs = params.image_observations[c][i][j].in_image;
-        const auto& point_in_target = params.image_observations[c][i][j].in_target;
-        const auto& intr = params.intr[c];
-
-        // Allocate Ceres data structures - ownership is taken by the ceres
-        // Problem data structure
-        if (params.fix_first_camera && (c == 0))
-        {
-          auto* cost_fn = new ReprojectionFixedCameraCost(img_obs, intr, params.base_to_camera_guess[c], point_in_target);
-
-          auto* cost_block = new ceres::AutoDiffCostFunction<ReprojectionFixedCameraCost, 2, 6>(cost_fn);
-
-          problem.AddResidualBlock(cost_block, NULL, internal_base_to_target[i].values.data());
-        }
-        else
-        {
-          auto* cost_fn = new ReprojectionFreeCameraCost(img_obs, intr, point_in_target);
-
-          auto* cost_block = new ceres::AutoDiffCostFunction<ReprojectionFreeCameraCost, 2, 6, 6>(cost_fn);
-
-          problem.AddResidualBlock(cost_block, NULL, internal_camera_to_base[c].values.data(),
-                                   internal_base_to_target[i].values.data());
-        }
+        auto* cost_fn = new ImageObservationCost<2>(params.image_observations[c][i], intr);
+
+        auto* cost_block = new ceres::AutoDiffCostFunction<ImageObservationCost<2>, ceres::DYNAMIC, 6, 6>(cost_fn, cost_fn->numResiduals());
+
+        problem.AddResidualBlock(cost_block, NULL, internal_camera_to_base[c].values.data(),
+                                 internal_base_to_target[i].values.data());
       }
     } // for each wrist pose
   } // end for each camera
 
-  ceres::Solver::Options options;
+  for (Pose6d& camera_to_base : internal_camera_to_base)
+    setPose6dParameterization(problem, camera_to_base.values.data(), params.pose_parameterization);
+  for (Pose6d& base_to_target : internal_base_to_target)
+    setPose6dParameterization(problem, base_to_target.values.data(), params.pose_parameterization);
+
+  const ceres::Solver::Options options = configureSolverOptions(problem, params.solver_options, params.solver_profile);
   ceres::Solver::Summary summary;
 
   ceres::Solve(options, &problem, &summary);
@@ -166,5 +82,36 @@ rct_optimizations::optimize(const rct_optimizations::ExtrinsicMultiStaticCameraO
   result.initial_cost_per_obs = summary.initial_cost / summary.num_residuals;
   result.final_cost_per_obs = summary.final_cost / summary.num_residuals;
 
+  // Unless the first camera is fixed, the problem has an unobservable choice of base frame and no covariance
+  if (!params.fix_first_camera)
+    return result;
+
+  // The covariance of the camera poses is marginalized over the target poses, which are nuisance parameters
+  std::vector<const double*> param_blocks;
+  std::map<const double*, std::vector<std::string>> param_labels;
+  for (std::size_t c = 0; c < internal_camera_to_base.size(); ++c)
+  {
+    const double* block = internal_camera_to_base[c].values.data();
+    if (!problem.HasParameterBlock(block))
+      continue;
+
+    // compose labels "base_to_camera0_x", etc.
+    std::vector<std::string> labels;
+    for (auto label_isometry : params.labels_isometry3d)
+      labels.emplace_back(params.label_base_to_camera + std::to_string(c) + "_" + label_isometry);
+
+    param_blocks.push_back(block);
+    param_labels[block] = labels;
+  }
+
+  std::vector<const double*> nuisance_blocks;
+  for (const Pose6d& pose : internal_base_to_target)
+  {
+    if (problem.HasParameterBlock(pose.values.data()))
+      nuisance_blocks.push_back(pose.values.data());
+  }
+
+  result.covariance = computeMarginalCovariance(problem, param_blocks, param_labels, nuisance_blocks, params.covariance_mode);
+
   return result;
 }
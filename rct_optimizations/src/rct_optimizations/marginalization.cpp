@@ -0,0 +1,200 @@
+#include <rct_optimizations/marginalization.h>
+#include <rct_optimizations/maximum_likelihood.h>
+#include <rct_optimizations/types.h>
+
+#include <ceres/ceres.h>
+#include <Eigen/Eigenvalues>
+#include <algorithm>
+#include <cstdint>
+#include <numeric>
+
+namespace
+{
+/**
+ * @brief Cost of the prior. The parameter blocks are concatenated and projected onto the eigenvectors of the information
+ * matrix of the prior, and the projections are constrained with a @ref MaximumLikelihood cost
+ */
+class MarginalizationPriorCost
+{
+public:
+  MarginalizationPriorCost(const std::vector<int>& sizes,
+                           const Eigen::MatrixXd& basis,
+                           const Eigen::ArrayXXd& mean,
+                           const Eigen::ArrayXXd& stdev)
+    : sizes_(sizes)
+    , basis_(basis)
+    , likelihood_(mean, stdev)
+  {
+  }
+
+  template<typename T>
+  bool operator()(T const *const *parameters, T *residual) const
+  {
+    Eigen::Matrix<T, Eigen::Dynamic, 1> x(basis_.rows());
+    Eigen::Index offset = 0;
+    for (std::size_t i = 0; i < sizes_.size(); ++i)
+    {
+      x.segment(offset, sizes_[i]) = Eigen::Map<const Eigen::Matrix<T, Eigen::Dynamic, 1>>(parameters[i], sizes_[i]);
+      offset += sizes_[i];
+    }
+
+    const Eigen::Matrix<T, Eigen::Dynamic, 1> projection = basis_.cast<T>().transpose() * x;
+    const T* const projection_data = projection.data();
+    return likelihood_(&projection_data, residual);
+  }
+
+private:
+  std::vector<int> sizes_;
+  /** @brief Eigenvectors of the information matrix with non-zero eigenvalues (n x k) */
+  Eigen::MatrixXd basis_;
+  rct_optimizations::MaximumLikelihood likelihood_;
+};
+
+} // namespace anonymous
+
+namespace rct_optimizations
+{
+Eigen::VectorXd evaluateJacobians(const ceres::CostFunction& cost_fn,
+                                  const std::vector<double*>& parameters,
+                                  std::vector<Eigen::MatrixXd>& jacobians)
+{
+  using JacobianBlock = Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>;
+  const int m = cost_fn.num_residuals();
+  const std::vector<int32_t>& block_sizes = cost_fn.parameter_block_sizes();
+  if (parameters.size() != block_sizes.size())
+    throw OptimizationException("The number of parameter blocks does not match the cost function");
+
+  // Ceres writes the Jacobians in row-major order
+  Eigen::VectorXd residual(m);
+  std::vector<JacobianBlock> block_jacobians;
+  std::vector<double*> jacobian_data;
+  block_jacobians.reserve(block_sizes.size());
+  for (const int32_t size : block_sizes)
+  {
+    block_jacobians.emplace_back(m, size);
+    jacobian_data.push_back(block_jacobians.back().data());
+  }
+
+  if (!cost_fn.Evaluate(parameters.data(), residual.data(), jacobian_data.data()))
+    throw OptimizationException("Failed to evaluate the residuals and Jacobians of the cost function");
+
+  jacobians.assign(block_jacobians.begin(), block_jacobians.end());
+  return residual;
+}
+
+MarginalizationPrior::MarginalizationPrior(const std::vector<double*>& parameters,
+                                           const std::vector<int>& sizes,
+                                           const std::map<const double*, std::vector<int>>& masks)
+  : parameters_(parameters)
+  , sizes_(sizes)
+  , residual_block_(nullptr)
+{
+  if (parameters_.size() != sizes_.size())
+    throw OptimizationException("The number of parameter blocks and parameter block sizes of the prior are not the same");
+
+  const int n = std::accumulate(sizes_.begin(), sizes_.end(), 0);
+  masked_.assign(static_cast<std::size_t>(n), false);
+  mean_ = Eigen::VectorXd::Zero(n);
+  information_ = Eigen::MatrixXd::Zero(n, n);
+
+  int offset = 0;
+  for (std::size_t i = 0; i < parameters_.size(); ++i)
+  {
+    auto it = masks.find(parameters_[i]);
+    if (it != masks.end())
+    {
+      for (const int index : it->second)
+        masked_.at(static_cast<std::size_t>(offset + index)) = true;
+    }
+    offset += sizes_[i];
+  }
+}
+
+void MarginalizationPrior::marginalize(ceres::Problem& problem, const ceres::ResidualBlockId residual_block)
+{
+  const ceres::CostFunction* cost_fn = problem.GetCostFunctionForResidualBlock(residual_block);
+  std::vector<double*> blocks;
+  problem.GetParameterBlocksForResidualBlock(residual_block, &blocks);
+
+  for (double* block : blocks)
+  {
+    if (std::find(parameters_.begin(), parameters_.end(), block) == parameters_.end() &&
+        !problem.IsParameterBlockConstant(block))
+      throw OptimizationException("The residual block to marginalize depends on a parameter block outside of the prior");
+  }
+
+  // Linearize the residuals at the current values of the parameters
+  std::vector<Eigen::MatrixXd> block_jacobians;
+  const Eigen::VectorXd residual = evaluateJacobians(*cost_fn, blocks, block_jacobians);
+  const Eigen::Index m = residual.size();
+
+  // Arrange the Jacobian in the order of the parameters of the prior
+  const Eigen::Index n = mean_.size();
+  Eigen::MatrixXd jacobian = Eigen::MatrixXd::Zero(m, n);
+  Eigen::VectorXd x(n);
+  Eigen::Index offset = 0;
+  for (std::size_t i = 0; i < parameters_.size(); ++i)
+  {
+    x.segment(offset, sizes_[i]) = Eigen::Map<const Eigen::VectorXd>(parameters_[i], sizes_[i]);
+
+    auto it = std::find(blocks.begin(), blocks.end(), parameters_[i]);
+    if (it != blocks.end() && !problem.IsParameterBlockConstant(parameters_[i]))
+      jacobian.middleCols(offset, sizes_[i]) = block_jacobians[static_cast<std::size_t>(it - blocks.begin())];
+
+    offset += sizes_[i];
+  }
+
+  // Masked parameters are constants of the linearized residuals
+  for (Eigen::Index i = 0; i < n; ++i)
+  {
+    if (masked_[static_cast<std::size_t>(i)])
+      jacobian.col(i).setZero();
+  }
+
+  const Eigen::VectorXd gradient = information_ * (x - mean_) + jacobian.transpose() * residual;
+  information_ += jacobian.transpose() * jacobian;
+
+  Eigen::SelfAdjointEigenSolver<Eigen::MatrixXd> solver(information_);
+  const Eigen::VectorXd& eigenvalues = solver.eigenvalues();
+  const double threshold = 1.0e-12 * eigenvalues.cwiseAbs().maxCoeff();
+
+  std::vector<Eigen::Index> constrained;
+  for (Eigen::Index i = 0; i < eigenvalues.size(); ++i)
+  {
+    if (eigenvalues(i) > threshold)
+      constrained.push_back(i);
+  }
+
+  const Eigen::Index k = static_cast<Eigen::Index>(constrained.size());
+  Eigen::MatrixXd basis(n, k);
+  Eigen::VectorXd lambda(k);
+  for (Eigen::Index i = 0; i < k; ++i)
+  {
+    basis.col(i) = solver.eigenvectors().col(constrained[i]);
+    lambda(i) = eigenvalues(constrained[i]);
+  }
+
+  mean_ = x - basis * (basis.transpose() * gradient).cwiseQuotient(lambda);
+  const Eigen::VectorXd projected_mean = basis.transpose() * mean_;
+
+  // Replace the marginalized residuals and the previous prior with the updated prior
+  problem.RemoveResidualBlock(residual_block);
+  if (residual_block_ != nullptr)
+  {
+    problem.RemoveResidualBlock(residual_block_);
+    residual_block_ = nullptr;
+  }
+
+  if (k > 0)
+  {
+    auto* prior = new MarginalizationPriorCost(sizes_, basis, projected_mean.array(), lambda.array().sqrt().inverse());
+    auto* cost_block = new ceres::DynamicAutoDiffCostFunction<MarginalizationPriorCost>(prior);
+    for (const int size : sizes_)
+      cost_block->AddParameterBlock(size);
+    cost_block->SetNumResiduals(static_cast<int>(k));
+
+    residual_block_ = problem.AddResidualBlock(cost_block, nullptr, parameters_);
+  }
+}
+
+} // namespace rct_optimizations
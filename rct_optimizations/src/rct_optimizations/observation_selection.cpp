@@ -0,0 +1,232 @@
+#include <rct_optimizations/observation_selection.h>
+#include <rct_optimizations/eigen_conversions.h>
+#include <rct_optimizations/image_observation_cost.h>
+#include <rct_optimizations/marginalization.h>
+#include <rct_optimizations/parallel.h>
+
+#include <ceres/ceres.h>
+#include <Eigen/Cholesky>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+using namespace rct_optimizations;
+
+namespace
+{
+/** @brief Scale of the regularization of the information matrices, relative to their mean diagonal element */
+const double RELATIVE_REGULARIZATION = 1.0e-9;
+
+/**
+ * @brief Log-determinant of a symmetric positive definite matrix
+ */
+double logDeterminant(const Eigen::MatrixXd& m)
+{
+  const Eigen::LLT<Eigen::MatrixXd> llt(m);
+  if (llt.info() != Eigen::Success)
+    return -std::numeric_limits<double>::infinity();
+
+  return 2.0 * llt.matrixL().toDenseMatrix().diagonal().array().log().sum();
+}
+
+/**
+ * @brief Evaluates the Jacobian of a cost function with respect to all of its parameter blocks, concatenated in order
+ */
+Eigen::MatrixXd evaluateJacobian(const ceres::CostFunction& cost_fn, const std::vector<double*>& parameters)
+{
+  std::vector<Eigen::MatrixXd> block_jacobians;
+  evaluateJacobians(cost_fn, parameters, block_jacobians);
+
+  Eigen::MatrixXd jacobian(cost_fn.num_residuals(), 0);
+  for (const Eigen::MatrixXd& block : block_jacobians)
+  {
+    jacobian.conservativeResize(Eigen::NoChange, jacobian.cols() + block.cols());
+    jacobian.rightCols(block.cols()) = block;
+  }
+
+  return jacobian;
+}
+
+} // namespace anonymous
+
+namespace rct_optimizations
+{
+ObservationSelectionResult selectObservations(const std::vector<Eigen::MatrixXd>& jacobians,
+                                              const ObservationSelectionOptions& options,
+                                              const Eigen::MatrixXd& prior_information)
+{
+  ObservationSelectionResult result;
+  if (jacobians.empty() || jacobians.front().cols() == 0)
+    return result;
+
+  const Eigen::Index n = jacobians.front().cols();
+  for (const Eigen::MatrixXd& jacobian : jacobians)
+  {
+    if (jacobian.cols() != n)
+      throw OptimizationException("The Jacobians of the observations do not have the same number of columns");
+  }
+  if (prior_information.size() != 0 && (prior_information.rows() != n || prior_information.cols() != n))
+    throw OptimizationException("The prior information matrix does not match the number of parameters");
+
+  // Compute the information of each observation
+  std::vector<Eigen::MatrixXd> information(jacobians.size());
+  parallelFor(jacobians.size(), [&](const std::size_t i) {
+    information[i] = jacobians[i].transpose() * jacobians[i];
+  }, options.num_threads);
+
+  Eigen::MatrixXd total = Eigen::MatrixXd::Zero(n, n);
+  for (const Eigen::MatrixXd& info : information)
+    total += info;
+  if (prior_information.size() != 0)
+    total += prior_information;
+
+  // Regularize the information so that unconstrained directions do not make the determinants zero
+  const double mean_diagonal = total.trace() / static_cast<double>(n);
+  const double regularization = mean_diagonal > 0.0 ? RELATIVE_REGULARIZATION * mean_diagonal : 1.0;
+  total.diagonal().array() += regularization;
+  const double total_log_det = logDeterminant(total);
+
+  Eigen::MatrixXd selected_information = Eigen::MatrixXd::Identity(n, n) * regularization;
+  if (prior_information.size() != 0)
+    selected_information += prior_information;
+
+  const std::size_t max_observations =
+      options.max_observations == 0 ? jacobians.size() : std::min(options.max_observations, jacobians.size());
+  std::vector<char> selected(jacobians.size(), 0);
+  std::vector<double> gains(jacobians.size());
+
+  while (result.selected_observations.size() < max_observations)
+  {
+    /* The increase of the log-determinant of the information from adding observation i is
+     *   log det(H + J_i^T * J_i) - log det(H) = log det(I + J_i * H^-1 * J_i^T)
+     * which is cheaper to evaluate in the second form if the observation has fewer residuals than there are parameters */
+    const Eigen::LLT<Eigen::MatrixXd> llt(selected_information);
+    const Eigen::MatrixXd covariance = llt.solve(Eigen::MatrixXd::Identity(n, n));
+    const double log_det = logDeterminant(selected_information);
+
+    parallelFor(jacobians.size(), [&](const std::size_t i) {
+      gains[i] = -std::numeric_limits<double>::infinity();
+      if (selected[i])
+        return;
+
+      const Eigen::MatrixXd& jacobian = jacobians[i];
+      if (jacobian.rows() < n)
+      {
+        const Eigen::MatrixXd s = Eigen::MatrixXd::Identity(jacobian.rows(), jacobian.rows()) +
+                                  jacobian * covariance * jacobian.transpose();
+        gains[i] = logDeterminant(s);
+      }
+      else
+      {
+        gains[i] = logDeterminant(selected_information + information[i]) - log_det;
+      }
+    }, options.num_threads);
+
+    const auto best = std::max_element(gains.begin(), gains.end());
+    if (!std::isfinite(*best))
+      break;
+
+    // The geometric mean of the standard deviations of the parameters is proportional to det(H)^(-1 / 2n)
+    const double uncertainty_reduction = 1.0 - std::exp(-*best / (2.0 * static_cast<double>(n)));
+    if (uncertainty_reduction < options.min_uncertainty_reduction)
+      break;
+
+    const std::size_t index = static_cast<std::size_t>(best - gains.begin());
+    selected[index] = 1;
+    selected_information += information[index];
+    result.selected_observations.push_back(index);
+
+    const double efficiency = std::exp((logDeterminant(selected_information) - total_log_det) / static_cast<double>(n));
+    result.efficiency.push_back(efficiency);
+    if (efficiency >= options.min_efficiency)
+      break;
+  }
+
+  return result;
+}
+
+std::vector<Eigen::MatrixXd> computeObservationJacobians(const ExtrinsicHandEyeProblem2D3D& params,
+                                                         const std::size_t num_threads)
+{
+  // Parameters of the hand-eye cost: [camera_to_camera_mount, target_mount_to_target]
+  Pose6d camera_to_camera_mount = poseEigenToCal(params.camera_mount_to_camera_guess.inverse());
+  Pose6d target_mount_to_target = poseEigenToCal(params.target_mount_to_target_guess);
+  const std::vector<double*> parameters = { camera_to_camera_mount.values.data(), target_mount_to_target.values.data() };
+
+  std::vector<Eigen::MatrixXd> jacobians(params.observations.size());
+  parallelFor(params.observations.size(), [&](const std::size_t i) {
+    const Observation2D3D& observation = params.observations[i];
+    const Eigen::Isometry3d camera_mount_to_target_mount = observation.to_camera_mount.inverse() * observation.to_target_mount;
+
+    const AnalyticImageObservationCost<2> cost_fn(observation.correspondence_set,
+                                                  params.intr,
+                                                  Eigen::Isometry3d::Identity(),
+                                                  camera_mount_to_target_mount);
+    jacobians[i] = evaluateJacobian(cost_fn, parameters);
+  }, num_threads);
+
+  return jacobians;
+}
+
+ObservationSelectionResult selectObservations(const ExtrinsicHandEyeProblem2D3D& params,
+                                              const ObservationSelectionOptions& options)
+{
+  return selectObservations(computeObservationJacobians(params, options.num_threads), options);
+}
+
+ObservationSelectionResult selectObservations(const KinematicCalibrationProblemPose6D& params,
+                                              const ObservationSelectionOptions& options,
+                                              const double orientation_weight)
+{
+  // Initialize the optimization variables from the guesses, with zero DH offsets
+  KinematicCalibrationVariablesPose6D variables(params);
+  const std::vector<int> sizes = variables.sizes();
+
+  // Get the columns of the parameters that are optimized (i.e. not masked and not placeholders), and the information of
+  // the costs on the DH offsets
+  std::vector<Eigen::Index> free_columns;
+  std::vector<double> prior_diagonal;
+  Eigen::Index offset = 0;
+  for (std::size_t b = 0; b < variables.parameters.size(); ++b)
+  {
+    const bool placeholder = (b == 0 && variables.camera_chain.dof() == 0) || (b == 1 && variables.target_chain.dof() == 0);
+    const auto mask_it = variables.param_masks.find(variables.parameters[b]);
+    for (int j = 0; j < sizes[b]; ++j)
+    {
+      if (placeholder ||
+          (mask_it != variables.param_masks.end() &&
+           std::find(mask_it->second.begin(), mask_it->second.end(), j) != mask_it->second.end()))
+        continue;
+
+      free_columns.push_back(offset + j);
+      if (b == 0)
+        prior_diagonal.push_back(1.0 / (variables.camera_chain_offset_stdev * variables.camera_chain_offset_stdev));
+      else if (b == 1)
+        prior_diagonal.push_back(1.0 / (variables.target_chain_offset_stdev * variables.target_chain_offset_stdev));
+      else
+        prior_diagonal.push_back(0.0);
+    }
+    offset += sizes[b];
+  }
+
+  std::vector<Eigen::MatrixXd> jacobians(params.observations.size());
+  parallelFor(params.observations.size(), [&](const std::size_t i) {
+    auto* cost_fn = new DualDHChainCostPose6D(params.observations[i], variables.camera_chain, variables.target_chain,
+                                              orientation_weight);
+    ceres::DynamicAutoDiffCostFunction<DualDHChainCostPose6D> cost_block(cost_fn);
+    for (const int size : sizes)
+      cost_block.AddParameterBlock(size);
+    cost_block.SetNumResiduals(4);
+
+    const Eigen::MatrixXd jacobian = evaluateJacobian(cost_block, variables.parameters);
+    jacobians[i].resize(jacobian.rows(), static_cast<Eigen::Index>(free_columns.size()));
+    for (std::size_t c = 0; c < free_columns.size(); ++c)
+      jacobians[i].col(static_cast<Eigen::Index>(c)) = jacobian.col(free_columns[c]);
+  }, options.num_threads);
+
+  const Eigen::VectorXd prior = Eigen::Map<const Eigen::VectorXd>(prior_diagonal.data(),
+                                                                  static_cast<Eigen::Index>(prior_diagonal.size()));
+  return selectObservations(jacobians, options, Eigen::MatrixXd(prior.asDiagonal()));
+}
+
+} // namespace rct_optimizations
@@ -0,0 +1,67 @@
+#include <rct_optimizations/parallel.h>
+#include <algorithm>
+#include <exception>
+#include <thread>
+#include <vector>
+
+namespace rct_optimizations
+{
+std::size_t getNumThreads(const std::size_t num_threads)
+{
+  if (num_threads > 0)
+    return num_threads;
+
+  // hardware_concurrency may return 0 if the value cannot be determined
+  return std::max(static_cast<std::size_t>(std::thread::hardware_concurrency()), static_cast<std::size_t>(1));
+}
+
+void parallelFor(const std::size_t n, const std::function<void(std::size_t)>& fn, const std::size_t num_threads)
+{
+  if (n == 0)
+    return;
+
+  const std::size_t n_threads = std::min(getNumThreads(num_threads), n);
+  if (n_threads == 1)
+  {
+    for (std::size_t i = 0; i < n; ++i)
+      fn(i);
+    return;
+  }
+
+  // Split the range into contiguous chunks of (nearly) equal size
+  const std::size_t chunk = n / n_threads;
+  const std::size_t remainder = n % n_threads;
+
+  std::vector<std::exception_ptr> errors(n_threads);
+  auto run = [&](const std::size_t thread_idx) {
+    const std::size_t begin = thread_idx * chunk + std::min(thread_idx, remainder);
+    const std::size_t end = begin + chunk + (thread_idx < remainder ? 1 : 0);
+    try
+    {
+      for (std::size_t i = begin; i < end; ++i)
+        fn(i);
+    }
+    catch (...)
+    {
+      errors[thread_idx] = std::current_exception();
+    }
+  };
+
+  std::vector<std::thread> threads;
+  threads.reserve(n_threads - 1);
+  for (std::size_t t = 1; t < n_threads; ++t)
+    threads.emplace_back(run, t);
+
+  run(0);
+
+  for (std::thread& t : threads)
+    t.join();
+
+  for (const std::exception_ptr& e : errors)
+  {
+    if (e)
+      std::rethrow_exception(e);
+  }
+}
+
+} // namespace rct_optimizations
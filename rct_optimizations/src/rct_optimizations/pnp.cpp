@@ -1,84 +1,439 @@
 #include "rct_optimizations/pnp.h"
 #include "rct_optimizations/ceres_math_utilities.h"
 #include "rct_optimizations/covariance_analysis.h"
+#include "rct_optimizations/image_observation_cost.h"
+#include "rct_optimizations/local_parameterization.h"
+#include "rct_optimizations/parallel.h"
 #include <ceres/ceres.h>
+#include <Eigen/Eigenvalues>
+#include <Eigen/SVD>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <sstream>
 
 namespace
 {
+/**
+ * @brief Adapts the image observation cost to the separate angle-axis and translation parameter blocks of the PnP problem
+ */
+template<Eigen::Index IMAGE_DIM>
 struct SolvePnPCostFunc
 {
-  public:
-  SolvePnPCostFunc(const rct_optimizations::CameraIntrinsics& intr,
-                   const Eigen::Vector3d& pt_in_target,
-                   const Eigen::Vector2d& pt_in_image)
-    : intr_(intr), in_target_(pt_in_target), in_image_(pt_in_image)
+public:
+  SolvePnPCostFunc(const rct_optimizations::ImageObservationCost<IMAGE_DIM>& cost)
+    : cost_(cost)
   {
   }
 
   template<typename T>
   bool operator()(const T *const cam_to_tgt_angle_axis_ptr, const T *const cam_to_tgt_translation_ptr, T *const residual) const
   {
-    using Isometry3 = Eigen::Transform<T, 3, Eigen::Isometry>;
-    using Vector3 = Eigen::Matrix<T, 3, 1>;
-    using Vector2 = Eigen::Matrix<T, 2, 1>;
+    const T pose[6] = { cam_to_tgt_angle_axis_ptr[0], cam_to_tgt_angle_axis_ptr[1], cam_to_tgt_angle_axis_ptr[2],
+                        cam_to_tgt_translation_ptr[0], cam_to_tgt_translation_ptr[1], cam_to_tgt_translation_ptr[2] };
+    return cost_(pose, residual);
+  }
 
-    Eigen::Map<const Vector3> cam_to_tgt_angle_axis(cam_to_tgt_angle_axis_ptr);
-    Eigen::Map<const Vector3> cam_to_tgt_translation(cam_to_tgt_translation_ptr);
-    Isometry3 camera_to_target = Isometry3::Identity();
-    camera_to_target = Eigen::Translation<T, 3>(cam_to_tgt_translation)
-                       * Eigen::AngleAxis<T>(cam_to_tgt_angle_axis.norm(),
-                                             cam_to_tgt_angle_axis.normalized());
+  rct_optimizations::ImageObservationCost<IMAGE_DIM> cost_;
 
-    // Transform points into camera coordinates
-    Vector3 camera_pt = camera_to_target * in_target_.cast<T>();
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+};
 
-    Vector2 xy_image = projectPoint(intr_, camera_pt);
+/**
+ * @brief Computes the similarity transform that translates a set of 2D points to their centroid and scales them to an
+ * average distance of sqrt(2) from the origin (Hartley normalization)
+ */
+Eigen::Matrix3d computeNormalizingTransform(const Eigen::Matrix2Xd& points)
+{
+  const Eigen::Vector2d centroid = points.rowwise().mean();
+  const double mean_distance = (points.colwise() - centroid).colwise().norm().mean();
+  const double scale = mean_distance > std::numeric_limits<double>::epsilon() ? std::sqrt(2.0) / mean_distance : 1.0;
+
+  Eigen::Matrix3d out;
+  out << scale, 0.0, -scale * centroid.x(),
+         0.0, scale, -scale * centroid.y(),
+         0.0, 0.0, 1.0;
+  return out;
+}
 
-    residual[0] = xy_image[0] - in_image_.x();
-    residual[1] = xy_image[1] - in_image_.y();
+/**
+ * @brief Computes the homography H such that to ~ H * from using the normalized direct linear transform
+ */
+Eigen::Matrix3d computeHomography(const Eigen::Matrix2Xd& from, const Eigen::Matrix2Xd& to)
+{
+  const Eigen::Matrix3d from_normalization = computeNormalizingTransform(from);
+  const Eigen::Matrix3d to_normalization = computeNormalizingTransform(to);
 
-    return true;
+  // Accumulate the normal matrix A^T * A of the DLT equations A * h = 0 rather than forming the 2n x 9 matrix A
+  Eigen::Matrix<double, 9, 9> ata = Eigen::Matrix<double, 9, 9>::Zero();
+  for (Eigen::Index i = 0; i < from.cols(); ++i)
+  {
+    const Eigen::Vector3d p = from_normalization * from.col(i).homogeneous();
+    const Eigen::Vector3d q = to_normalization * to.col(i).homogeneous();
+
+    Eigen::Matrix<double, 9, 1> row_u, row_v;
+    row_u << -p.x(), -p.y(), -1.0, 0.0, 0.0, 0.0, q.x() * p.x(), q.x() * p.y(), q.x();
+    row_v << 0.0, 0.0, 0.0, -p.x(), -p.y(), -1.0, q.y() * p.x(), q.y() * p.y(), q.y();
+    ata.noalias() += row_u * row_u.transpose();
+    ata.noalias() += row_v * row_v.transpose();
   }
 
-  rct_optimizations::CameraIntrinsics intr_;
-  Eigen::Vector3d in_target_;
-  Eigen::Vector2d in_image_;
-};
+  // The solution is the eigenvector of the smallest eigenvalue (eigenvalues are sorted in increasing order)
+  Eigen::SelfAdjointEigenSolver<Eigen::Matrix<double, 9, 9>> solver(ata);
+  const Eigen::Matrix<double, 9, 1> h = solver.eigenvectors().col(0);
+  const Eigen::Matrix<double, 3, 3, Eigen::RowMajor> h_normalized(h.data());
+
+  // Remove the normalization
+  return to_normalization.inverse() * h_normalized * from_normalization;
+}
 
-struct SolvePnPCostFunc3D
+/**
+ * @brief Finds the plane of the target points of a set of correspondences and computes the 2D coordinates of the target
+ * points in that plane. The origin of the plane frame is the centroid of the points and its z-axis is the direction of
+ * least variance
+ * @param correspondences - At least 4 correspondences whose target points lie on a plane (and not on a line)
+ * @param plane_points - Output: the coordinates of the target points in the x-y plane of the plane frame
+ * @return The transform from the plane frame to the target frame (i.e. plane_points = (plane_to_target * target_points).topRows<2>())
+ */
+Eigen::Isometry3d computePlaneCoordinates(const rct_optimizations::Correspondence2D3D::Set& correspondences,
+                                          Eigen::Matrix2Xd& plane_points)
 {
-public:
-  SolvePnPCostFunc3D(const Eigen::Vector3d& pt_in_target,
-                     const Eigen::Vector3d& pt_in_image)
-    :in_target_(pt_in_target), in_image_(pt_in_image)
-  {}
+  if (correspondences.size() < 4)
+  {
+    std::stringstream ss;
+    ss << "At least 4 correspondences are required to estimate a homography (" << correspondences.size() << " provided)";
+    throw std::runtime_error(ss.str());
+  }
 
-  template<typename T>
-  bool operator()(const T *const cam_to_tgt_angle_axis_ptr, const T *const cam_to_tgt_translation_ptr, T *const residual) const
+  const Eigen::Index n = static_cast<Eigen::Index>(correspondences.size());
+  Eigen::Matrix3Xd target_points(3, n);
+  for (Eigen::Index i = 0; i < n; ++i)
+    target_points.col(i) = correspondences[i].in_target;
+
+  const Eigen::Vector3d centroid = target_points.rowwise().mean();
+  const Eigen::Matrix3Xd centered = target_points.colwise() - centroid;
+  Eigen::JacobiSVD<Eigen::Matrix3d> svd(centered * centered.transpose(), Eigen::ComputeFullU);
+  if (svd.singularValues()(1) <= std::numeric_limits<double>::epsilon() ||
+      svd.singularValues()(2) > 1.0e-6 * svd.singularValues()(1))
+    throw std::runtime_error("Target points must lie on a plane (and not on a line) to estimate a homography");
+
+  Eigen::Matrix3d plane_axes = svd.matrixU();
+  if (plane_axes.determinant() < 0.0)
+    plane_axes.col(2) *= -1.0;
+
+  // Transform from the plane frame to the target frame, i.e. the pose of the target in the plane frame, which maps the
+  // target points into plane coordinates
+  Eigen::Isometry3d plane_to_target(Eigen::Isometry3d::Identity());
+  plane_to_target.linear() = plane_axes.transpose();
+  plane_to_target.translation() = -plane_axes.transpose() * centroid;
+
+  plane_points = (plane_to_target * target_points).topRows<2>();
+  return plane_to_target;
+}
+
+using Matrix6d = Eigen::Matrix<double, 6, 6>;
+using Vector6d = Eigen::Matrix<double, 6, 1>;
+
+/**
+ * @brief Computes the residual of a 2D-3D correspondence (the reprojection error) and its Jacobian with respect to the
+ * point in the camera frame, using the projection of @ref projectPoint
+ */
+inline Eigen::Vector2d computeResidual(const rct_optimizations::CameraIntrinsics& intr,
+                                       const rct_optimizations::Correspondence2D3D& corr,
+                                       const Eigen::Vector3d& camera_point,
+                                       Eigen::Matrix<double, 2, 3>& jacobian)
+{
+  if (camera_point.z() == 0.0)
   {
-    using Isometry3 = Eigen::Transform<T, 3, Eigen::Isometry>;
-    using Vector3 = Eigen::Matrix<T, 3, 1>;
+    jacobian << intr.fx(), 0.0, 0.0,
+                0.0, intr.fy(), 0.0;
+    return Eigen::Vector2d(intr.fx() * camera_point.x() + intr.cx() - corr.in_image.x(),
+                           intr.fy() * camera_point.y() + intr.cy() - corr.in_image.y());
+  }
+
+  const double z_inv = 1.0 / camera_point.z();
+  const double x = camera_point.x() * z_inv;
+  const double y = camera_point.y() * z_inv;
+  jacobian << intr.fx() * z_inv, 0.0, -intr.fx() * x * z_inv,
+              0.0, intr.fy() * z_inv, -intr.fy() * y * z_inv;
+  return Eigen::Vector2d(intr.fx() * x + intr.cx() - corr.in_image.x(), intr.fy() * y + intr.cy() - corr.in_image.y());
+}
 
-    Eigen::Map<const Vector3> cam_to_tgt_angle_axis(cam_to_tgt_angle_axis_ptr);
-    Eigen::Map<const Vector3> cam_to_tgt_translation(cam_to_tgt_translation_ptr);
-    Isometry3 camera_to_target = Isometry3::Identity();
-    camera_to_target = Eigen::Translation<T, 3>(cam_to_tgt_translation)
-                       * Eigen::AngleAxis<T>(cam_to_tgt_angle_axis.norm(),
-                                             cam_to_tgt_angle_axis.normalized());
+/**
+ * @brief Computes the residual of a 3D-3D correspondence and its Jacobian with respect to the point in the camera frame
+ */
+inline Eigen::Vector3d computeResidual(const rct_optimizations::CameraIntrinsics&,
+                                       const rct_optimizations::Correspondence3D3D& corr,
+                                       const Eigen::Vector3d& camera_point,
+                                       Eigen::Matrix3d& jacobian)
+{
+  jacobian.setIdentity();
+  return camera_point - corr.in_image;
+}
+
+/**
+ * @brief Small, fixed-size Levenberg-Marquardt solver for the 6-DOF camera to target pose of a single PnP problem.
+ *
+ * The pose is parameterized by its translation and angle-axis rotation (in that order), like the Ceres problems of
+ * @ref optimize, and the cost is one half of the (weighted) sum of squared residuals. The normal equations are accumulated
+ * directly from the correspondences, so no memory is allocated while solving
+ */
+template<Eigen::Index IMAGE_DIM>
+class PnPSolver
+{
+public:
+  using CorrespondenceSet = typename rct_optimizations::Correspondence<IMAGE_DIM, 3>::Set;
+
+  PnPSolver(const rct_optimizations::CameraIntrinsics& intr,
+            const CorrespondenceSet& correspondences,
+            const std::vector<double>& weights)
+    : intr_(intr)
+    , correspondences_(correspondences)
+    , weights_(weights)
+  {
+  }
 
-    // Transform points into camera coordinates
-    Vector3 camera_pt = camera_to_target * in_target_.cast<T>();
+  /**
+   * @brief Computes the cost of a pose and, optionally, the normal equations J^T * W * J and J^T * W * r
+   * @return The cost, or infinity if the cost is not finite
+   */
+  double linearize(const Vector6d& x, Matrix6d* jtj, Vector6d* jtr) const
+  {
+    const Eigen::Vector3d translation = x.head<3>();
+    const Eigen::Vector3d angle_axis = x.tail<3>();
+    const double angle = angle_axis.norm();
+    const Eigen::Matrix3d rotation = angle > std::numeric_limits<double>::epsilon()
+                                       ? Eigen::AngleAxisd(angle, angle_axis / angle).toRotationMatrix()
+                                       : Eigen::Matrix3d::Identity();
+
+    Eigen::Matrix3d rotation_jacobian;
+    if (jtj)
+    {
+      rotation_jacobian = rotation * rct_optimizations::rightJacobianSO3(angle_axis);
+      jtj->setZero();
+      jtr->setZero();
+    }
+
+    double cost = 0.0;
+    ProjectionJacobian projection_jacobian;
+    for (std::size_t i = 0; i < correspondences_.size(); ++i)
+    {
+      const double w = weights_.empty() ? 1.0 : weights_[i];
+      const Eigen::Vector3d rotated_point = rotation * correspondences_[i].in_target;
+      const Residual residual = computeResidual(intr_, correspondences_[i], rotated_point + translation, projection_jacobian);
+      cost += w * residual.squaredNorm();
+
+      if (jtj)
+      {
+        Eigen::Matrix<double, IMAGE_DIM, 6> jacobian;
+        jacobian.template leftCols<3>() = projection_jacobian;
+        jacobian.template rightCols<3>() = projection_jacobian * (-rct_optimizations::skewSymmetric(rotated_point) * rotation_jacobian);
+
+        jtj->noalias() += w * jacobian.transpose() * jacobian;
+        jtr->noalias() += w * jacobian.transpose() * residual;
+      }
+    }
+
+    cost *= 0.5;
+    return std::isfinite(cost) ? cost : std::numeric_limits<double>::infinity();
+  }
 
-    residual[0] = camera_pt[0] - in_image_.x();
-    residual[1] = camera_pt[1] - in_image_.y();
-    residual[2] = camera_pt[2] - in_image_.z();
-    return true;
+  /**
+   * @brief Minimizes the cost starting from the input pose with the tolerances of the default Ceres solver options
+   * @param x - Input guess and output solution
+   * @param max_iterations - Maximum number of iterations. If 0, the cost and normal equations are only evaluated at the guess
+   * @return True if the solver converged (or no iterations were requested)
+   */
+  bool solve(Vector6d& x, const int max_iterations, double& initial_cost, double& final_cost, Matrix6d& jtj) const
+  {
+    Vector6d jtr;
+    double cost = linearize(x, &jtj, &jtr);
+    initial_cost = cost;
+    final_cost = cost;
+
+    if (max_iterations <= 0)
+      return true;
+    if (!std::isfinite(cost))
+      return false;
+
+    double lambda = 1.0e-4;
+    double nu = 2.0;
+    for (int iteration = 0; iteration < max_iterations; ++iteration)
+    {
+      if (jtr.lpNorm<Eigen::Infinity>() <= GRADIENT_TOLERANCE)
+        return true;
+
+      Matrix6d augmented(jtj);
+      augmented.diagonal() += lambda * jtj.diagonal().cwiseMax(1.0e-6);
+      const Vector6d step = augmented.ldlt().solve(-jtr);
+
+      if (step.norm() <= PARAMETER_TOLERANCE * (x.norm() + PARAMETER_TOLERANCE))
+        return true;
+
+      const Vector6d candidate = x + step;
+      const double candidate_cost = linearize(candidate, nullptr, nullptr);
+      const double model_reduction = -(step.dot(jtr) + 0.5 * step.dot(jtj * step));
+      const double rho = (cost - candidate_cost) / model_reduction;
+
+      if (model_reduction > 0.0 && std::isfinite(candidate_cost) && rho > 1.0e-3)
+      {
+        const bool function_converged = (cost - candidate_cost) <= FUNCTION_TOLERANCE * cost;
+        x = candidate;
+        cost = linearize(x, &jtj, &jtr);
+        final_cost = cost;
+        if (function_converged)
+          return true;
+
+        lambda *= std::max(1.0 / 3.0, 1.0 - std::pow(2.0 * rho - 1.0, 3));
+        nu = 2.0;
+      }
+      else
+      {
+        lambda *= nu;
+        nu *= 2.0;
+      }
+    }
+
+    return false;
   }
 
-  Eigen::Vector3d in_target_;
-  Eigen::Vector3d in_image_;
+private:
+  using Residual = Eigen::Matrix<double, IMAGE_DIM, 1>;
+  using ProjectionJacobian = Eigen::Matrix<double, IMAGE_DIM, 3>;
+
+  static constexpr double FUNCTION_TOLERANCE = 1.0e-6;
+  static constexpr double GRADIENT_TOLERANCE = 1.0e-10;
+  static constexpr double PARAMETER_TOLERANCE = 1.0e-8;
+
+  const rct_optimizations::CameraIntrinsics& intr_;
+  const CorrespondenceSet& correspondences_;
+  const std::vector<double>& weights_;
 };
 
+/**
+ * @brief Computes the covariance (J^T * W * J)^-1 of a pose from its normal matrix
+ * @throws CovarianceException if the Jacobian is rank deficient
+ */
+Matrix6d invertNormalMatrix(const Matrix6d& jtj)
+{
+  // The Jacobian must have full rank (the eigenvalues of J^T * J are the squared singular values of J)
+  Eigen::SelfAdjointEigenSolver<Matrix6d> solver(jtj);
+  const Vector6d eigenvalues = solver.eigenvalues();
+  if (eigenvalues(0) <= 0.0 || std::sqrt(eigenvalues(0) / eigenvalues(5)) < 1.0e-14)
+    throw rct_optimizations::CovarianceException("Could not compute covariance in invertNormalMatrix()");
+
+  return solver.eigenvectors() * eigenvalues.cwiseInverse().asDiagonal() * solver.eigenvectors().transpose();
+}
+
+/**
+ * @brief Composes the covariance labels of the translation and rotation of a PnP problem ("camera_to_target_x", etc.)
+ */
+template<typename ProblemT>
+std::vector<std::string> composeLabels(const ProblemT& params)
+{
+  std::vector<std::string> labels;
+  labels.reserve(params.labels_translation.size() + params.labels_rotation.size());
+  for (const std::string& label_t : params.labels_translation)
+    labels.emplace_back(params.label_camera_to_target_guess + "_" + label_t);
+  for (const std::string& label_r : params.labels_rotation)
+    labels.emplace_back(params.label_camera_to_target_guess + "_" + label_r);
+  return labels;
+}
+
+/**
+ * @brief Composes the covariance labels of the translation and rotation parameter blocks of a PnP problem
+ */
+template<typename ProblemT>
+std::map<const double*, std::vector<std::string>> composeLabels(const ProblemT& params,
+                                                                const double* translation,
+                                                                const double* rotation)
+{
+  const std::vector<std::string> labels = composeLabels(params);
+  const auto rotation_labels = labels.begin() + static_cast<std::ptrdiff_t>(params.labels_translation.size());
+
+  std::map<const double*, std::vector<std::string>> param_labels;
+  param_labels[translation] = std::vector<std::string>(labels.begin(), rotation_labels);
+  param_labels[rotation] = std::vector<std::string>(rotation_labels, labels.end());
+  return param_labels;
+}
+
+/**
+ * @brief Solves a PnP problem from the input guess with @ref PnPSolver and computes the covariance of the solution
+ */
+template<Eigen::Index IMAGE_DIM, typename ProblemT>
+rct_optimizations::PnPResult solvePnP(const ProblemT& params,
+                                      const rct_optimizations::CameraIntrinsics& intr,
+                                      const std::vector<double>& weights,
+                                      const Eigen::Isometry3d& camera_to_target_guess)
+{
+  const Eigen::AngleAxisd rotation(camera_to_target_guess.rotation());
+  Vector6d x;
+  x << camera_to_target_guess.translation(), rotation.angle() * rotation.axis();
+
+  double initial_cost, final_cost;
+  Matrix6d jtj;
+  const PnPSolver<IMAGE_DIM> solver(intr, params.correspondences, weights);
+
+  rct_optimizations::PnPResult result;
+  result.converged = solver.solve(x, params.max_refinement_iterations, initial_cost, final_cost, jtj);
+
+  const double num_residuals = static_cast<double>(IMAGE_DIM * params.correspondences.size());
+  result.initial_cost_per_obs = initial_cost / num_residuals;
+  result.final_cost_per_obs = final_cost / num_residuals;
+
+  const double angle = x.tail<3>().norm();
+  result.camera_to_target = Eigen::Translation3d(x.head<3>())
+                            * (angle > std::numeric_limits<double>::epsilon()
+                                 ? Eigen::AngleAxisd(angle, x.tail<3>() / angle)
+                                 : Eigen::AngleAxisd::Identity());
+
+  switch (params.covariance_mode)
+  {
+    case rct_optimizations::CovarianceMode::NONE:
+      break;
+    case rct_optimizations::CovarianceMode::DIAGONAL:
+    {
+      const Matrix6d cov = invertNormalMatrix(jtj).diagonal().asDiagonal();
+      result.covariance = rct_optimizations::computeCovarianceResults(cov, composeLabels(params));
+      break;
+    }
+    case rct_optimizations::CovarianceMode::FULL:
+      result.covariance = rct_optimizations::computeCovarianceResults(invertNormalMatrix(jtj), composeLabels(params));
+      break;
+  }
+
+  return result;
+}
+
+/**
+ * @brief Solves a batch of independent PnP problems in parallel. Problems that cannot be solved are reported as not
+ * converged with infinite cost
+ */
+template<typename ProblemT, typename SolveFunctionT>
+std::vector<rct_optimizations::PnPResult> solveBatch(const std::vector<ProblemT>& params,
+                                                     const SolveFunctionT& solve,
+                                                     const std::size_t num_threads)
+{
+  std::vector<rct_optimizations::PnPResult> results(params.size());
+  rct_optimizations::parallelFor(params.size(),
+                                 [&](const std::size_t i) {
+                                   try
+                                   {
+                                     results[i] = solve(params[i]);
+                                   }
+                                   catch (const std::runtime_error&)
+                                   {
+                                     // The guess or the covariance could not be computed
+                                     results[i].converged = false;
+                                     results[i].initial_cost_per_obs = std::numeric_limits<double>::infinity();
+                                     results[i].final_cost_per_obs = std::numeric_limits<double>::infinity();
+                                     results[i].camera_to_target = Eigen::Isometry3d::Identity();
+                                   }
+                                 },
+                                 num_threads);
+  return results;
+}
+
 } // namespace anonymous
 
 namespace rct_optimizations
@@ -86,84 +441,120 @@ namespace rct_optimizations
 
 PnPResult optimize(const PnPProblem &params)
 {
+  const Eigen::Isometry3d camera_to_target_guess = params.use_closed_form_guess
+                                                     ? estimatePlanarPose(params.intr, params.correspondences)
+                                                     : params.camera_to_target_guess;
+
   // Create the optimization variables from the input guess
-  Eigen::AngleAxisd cam_to_tgt_rotation(params.camera_to_target_guess.rotation());
+  Eigen::AngleAxisd cam_to_tgt_rotation(camera_to_target_guess.rotation());
   Eigen::Vector3d cam_to_tgt_angle_axis = cam_to_tgt_rotation.angle() * cam_to_tgt_rotation.axis();
-  Eigen::Vector3d cam_to_tgt_translation(params.camera_to_target_guess.translation());
+  Eigen::Vector3d cam_to_tgt_translation(camera_to_target_guess.translation());
 
   ceres::Problem problem;
 
-  // For each 3D point seen in the 2D image
-  for (const auto& corr : params.correspondences)
-  {
-    // Allocate Ceres data structures - ownership is taken by the ceres
-    // Problem data structure
-    auto *cost_fn = new SolvePnPCostFunc(params.intr, corr.in_target, corr.in_image);
-
-    auto *cost_block = new ceres::AutoDiffCostFunction<SolvePnPCostFunc, 2, 3, 3>(cost_fn);
+  // Create one residual block for all of the 3D points seen in the 2D image
+  // Allocate Ceres data structures - ownership is taken by the ceres
+  // Problem data structure
+  auto *cost_fn = new SolvePnPCostFunc<2>(ImageObservationCost<2>(params.correspondences, params.intr));
 
-    problem.AddResidualBlock(cost_block, nullptr, cam_to_tgt_angle_axis.data(), cam_to_tgt_translation.data());
-  }
+  auto *cost_block = new ceres::AutoDiffCostFunction<SolvePnPCostFunc<2>, ceres::DYNAMIC, 3, 3>(cost_fn, cost_fn->cost_.numResiduals());
 
-  ceres::Solver::Summary summary;
-  ceres::Solver::Options options;
-  ceres::Solve(options, &problem, &summary);
+  problem.AddResidualBlock(cost_block, nullptr, cam_to_tgt_angle_axis.data(), cam_to_tgt_translation.data());
+  setAngleAxisParameterization(problem, cam_to_tgt_angle_axis.data(), params.pose_parameterization);
 
   PnPResult result;
-  result.converged = summary.termination_type == ceres::CONVERGENCE;
-  result.initial_cost_per_obs = summary.initial_cost / summary.num_residuals;
-  result.final_cost_per_obs = summary.final_cost / summary.num_residuals;
-  result.camera_to_target = Eigen::Translation3d(cam_to_tgt_translation)
-                            * Eigen::AngleAxisd(cam_to_tgt_angle_axis.norm(),
-                                                cam_to_tgt_angle_axis.normalized());
-
-  // compose labels "camera_to_target_x", etc.
-  std::vector<std::string> labels_camera_to_target_guess_translation;
-  for (auto label_t : params.labels_translation)
+  if (params.max_refinement_iterations > 0)
   {
-    labels_camera_to_target_guess_translation.emplace_back(params.label_camera_to_target_guess + "_" + label_t);
+    ceres::Solver::Summary summary;
+    ceres::Solver::Options options = configureSolverOptions(problem, params.solver_options, params.solver_profile);
+    options.max_num_iterations = params.max_refinement_iterations;
+    ceres::Solve(options, &problem, &summary);
+
+    result.converged = summary.termination_type == ceres::CONVERGENCE;
+    result.initial_cost_per_obs = summary.initial_cost / summary.num_residuals;
+    result.final_cost_per_obs = summary.final_cost / summary.num_residuals;
   }
-
-  // compose labels "camera_to_target_qx", etc.
-  std::vector<std::string> labels_camera_to_target_guess_quaternion;
-  for (auto label_r : params.labels_rotation)
+  else
   {
-    labels_camera_to_target_guess_quaternion.emplace_back(params.label_camera_to_target_guess + "_" + label_r);
+    // Only evaluate the cost of the guess
+    double cost;
+    problem.Evaluate(ceres::Problem::EvaluateOptions(), &cost, nullptr, nullptr, nullptr);
+
+    result.converged = true;
+    result.initial_cost_per_obs = cost / problem.NumResiduals();
+    result.final_cost_per_obs = result.initial_cost_per_obs;
   }
-  std::map<const double*, std::vector<std::string>> param_labels;
-  param_labels[cam_to_tgt_translation.data()] = labels_camera_to_target_guess_translation;
-  param_labels[cam_to_tgt_angle_axis.data()] = labels_camera_to_target_guess_quaternion;
+  result.camera_to_target = Eigen::Translation3d(cam_to_tgt_translation)
+                            * Eigen::AngleAxisd(cam_to_tgt_angle_axis.norm(),
+                                                cam_to_tgt_angle_axis.normalized());
+
+  const std::map<const double*, std::vector<std::string>> param_labels =
+      composeLabels(params, cam_to_tgt_translation.data(), cam_to_tgt_angle_axis.data());
 
   result.covariance = rct_optimizations::computeCovariance(problem,
                                                            std::vector<const double *>({cam_to_tgt_translation.data(), cam_to_tgt_angle_axis.data()}),
-                                                           param_labels);
+                                                           param_labels,
+                                                           std::map<const double *, std::vector<int>>(),
+                                                           DefaultCovarianceOptions(),
+                                                           params.covariance_mode);
 
   return result;
 }
 
 PnPResult optimize(const rct_optimizations::PnPProblem3D& params)
 {
+  if (!params.weights.empty() && params.weights.size() != params.correspondences.size())
+  {
+    std::stringstream ss;
+    ss << "Number of weights (" << params.weights.size() << ") does not match number of correspondences ("
+       << params.correspondences.size() << ")";
+    throw std::runtime_error(ss.str());
+  }
+
+  const Eigen::Isometry3d camera_to_target_guess = params.use_closed_form_guess
+                                                     ? estimatePose3D(params.correspondences, params.weights)
+                                                     : params.camera_to_target_guess;
+
+  // The closed-form estimate is the least-squares solution, so its cost and covariance can be computed directly
+  if (params.max_refinement_iterations <= 0)
+    return solvePnP<3>(params, CameraIntrinsics(), params.weights, camera_to_target_guess);
+
   // Create the optimization variables from the input guess
-  Eigen::AngleAxisd cam_to_tgt_rotation(params.camera_to_target_guess.rotation());
+  Eigen::AngleAxisd cam_to_tgt_rotation(camera_to_target_guess.rotation());
   Eigen::Vector3d cam_to_tgt_angle_axis(cam_to_tgt_rotation.angle() * cam_to_tgt_rotation.axis());
-  Eigen::Vector3d cam_to_tgt_translation(params.camera_to_target_guess.translation());
+  Eigen::Vector3d cam_to_tgt_translation(camera_to_target_guess.translation());
 
   ceres::Problem problem;
 
-  //only one loop, for correspondences
-  for (const auto& corr : params.correspondences) // For each 3D point seen in the 3D image
+  if (params.weights.empty())
   {
+    // Create one residual block for all of the 3D points seen in the 3D image
     // Allocate Ceres data structures - ownership is taken by the ceres
     // Problem data structure
+    auto* cost_fn = new SolvePnPCostFunc<3>(ImageObservationCost<3>(params.correspondences));
 
-    auto* cost_fn = new SolvePnPCostFunc3D(corr.in_target, corr.in_image);
-
-    auto* cost_block = new ceres::AutoDiffCostFunction<SolvePnPCostFunc3D, 3, 3, 3>(cost_fn);
+    auto* cost_block = new ceres::AutoDiffCostFunction<SolvePnPCostFunc<3>, ceres::DYNAMIC, 3, 3>(cost_fn, cost_fn->cost_.numResiduals());
 
     problem.AddResidualBlock(cost_block, nullptr, cam_to_tgt_angle_axis.data(), cam_to_tgt_translation.data());
   }
+  else
+  {
+    // Weight each correspondence with its own residual block
+    for (std::size_t i = 0; i < params.correspondences.size(); ++i)
+    {
+      auto* cost_fn = new SolvePnPCostFunc<3>(ImageObservationCost<3>(Correspondence3D3D::Set(1, params.correspondences[i])));
+
+      auto* cost_block = new ceres::AutoDiffCostFunction<SolvePnPCostFunc<3>, ceres::DYNAMIC, 3, 3>(cost_fn, cost_fn->cost_.numResiduals());
+
+      auto* loss = new ceres::ScaledLoss(nullptr, params.weights[i], ceres::TAKE_OWNERSHIP);
+
+      problem.AddResidualBlock(cost_block, loss, cam_to_tgt_angle_axis.data(), cam_to_tgt_translation.data());
+    }
+  }
+  setAngleAxisParameterization(problem, cam_to_tgt_angle_axis.data(), params.pose_parameterization);
 
-  ceres::Solver::Options options;
+  ceres::Solver::Options options = configureSolverOptions(problem, params.solver_options, params.solver_profile);
+  options.max_num_iterations = params.max_refinement_iterations;
   ceres::Solver::Summary summary;
   ceres::Solve(options, &problem, &summary);
 
@@ -175,27 +566,160 @@ PnPResult optimize(const rct_optimizations::PnPProblem3D& params)
                             * Eigen::AngleAxisd(cam_to_tgt_angle_axis.norm(),
                                                 cam_to_tgt_angle_axis.normalized());
 
-  // compose labels "camera_to_target_x", etc.
-  std::vector<std::string> labels_camera_to_target_guess_translation;
-  for (auto label_t : params.labels_translation)
+  const std::map<const double*, std::vector<std::string>> param_labels =
+      composeLabels(params, cam_to_tgt_translation.data(), cam_to_tgt_angle_axis.data());
+
+  result.covariance = rct_optimizations::computeCovariance(problem,
+                                                           std::vector<const double *>({cam_to_tgt_translation.data(), cam_to_tgt_angle_axis.data()}),
+                                                           param_labels,
+                                                           std::map<const double *, std::vector<int>>(),
+                                                           DefaultCovarianceOptions(),
+                                                           params.covariance_mode);
+
+  return result;
+}
+
+std::vector<PnPResult> optimizeBatch(const std::vector<PnPProblem>& params, const std::size_t num_threads)
+{
+  const std::vector<double> weights;
+  return solveBatch(params,
+                    [&weights](const PnPProblem& problem) {
+                      const Eigen::Isometry3d guess = problem.use_closed_form_guess
+                                                        ? estimatePlanarPose(problem.intr, problem.correspondences)
+                                                        : problem.camera_to_target_guess;
+                      return solvePnP<2>(problem, problem.intr, weights, guess);
+                    },
+                    num_threads);
+}
+
+std::vector<PnPResult> optimizeBatch(const std::vector<PnPProblem3D>& params, const std::size_t num_threads)
+{
+  return solveBatch(params,
+                    [](const PnPProblem3D& problem) {
+                      if (!problem.weights.empty() && problem.weights.size() != problem.correspondences.size())
+                        throw std::runtime_error("Number of weights does not match number of correspondences");
+
+                      const Eigen::Isometry3d guess = problem.use_closed_form_guess
+                                                        ? estimatePose3D(problem.correspondences, problem.weights)
+                                                        : problem.camera_to_target_guess;
+                      return solvePnP<3>(problem, CameraIntrinsics(), problem.weights, guess);
+                    },
+                    num_threads);
+}
+
+Eigen::Isometry3d estimatePlanarPose(const CameraIntrinsics& intr, const Correspondence2D3D::Set& correspondences)
+{
+  const Eigen::Index n = static_cast<Eigen::Index>(correspondences.size());
+  Eigen::Matrix2Xd image_points(2, n);
+  for (Eigen::Index i = 0; i < n; ++i)
   {
-    labels_camera_to_target_guess_translation.emplace_back(params.label_camera_to_target_guess + "_" + label_t);
+    // Convert the image points to normalized image coordinates
+    image_points.col(i) << (correspondences[i].in_image.x() - intr.cx()) / intr.fx(),
+                           (correspondences[i].in_image.y() - intr.cy()) / intr.fy();
   }
 
-  // compose labels "camera_to_target_qx", etc.
-  std::vector<std::string> labels_camera_to_target_guess_quaternion;
-  for (auto label_r : params.labels_rotation)
+  Eigen::Matrix2Xd plane_points;
+  const Eigen::Isometry3d plane_to_target = computePlaneCoordinates(correspondences, plane_points);
+
+  // The homography is proportional to [r1, r2, t] of the camera to plane transform
+  const Eigen::Matrix3d H = computeHomography(plane_points, image_points);
+
+  double lambda = 2.0 / (H.col(0).norm() + H.col(1).norm());
+
+  // The target must be in front of the camera
+  if (H(2, 2) < 0.0)
+    lambda = -lambda;
+
+  Eigen::Matrix3d rotation;
+  rotation.col(0) = lambda * H.col(0);
+  rotation.col(1) = lambda * H.col(1);
+  rotation.col(2) = rotation.col(0).cross(rotation.col(1));
+
+  // Find the closest rotation matrix
+  Eigen::JacobiSVD<Eigen::Matrix3d> rotation_svd(rotation, Eigen::ComputeFullU | Eigen::ComputeFullV);
+  Eigen::Matrix3d camera_to_plane_rotation = rotation_svd.matrixU() * rotation_svd.matrixV().transpose();
+  if (camera_to_plane_rotation.determinant() < 0.0)
   {
-    labels_camera_to_target_guess_quaternion.emplace_back(params.label_camera_to_target_guess + "_" + label_r);
+    Eigen::Matrix3d d = Eigen::Matrix3d::Identity();
+    d(2, 2) = -1.0;
+    camera_to_plane_rotation = rotation_svd.matrixU() * d * rotation_svd.matrixV().transpose();
   }
-  std::map<const double*, std::vector<std::string>> param_labels;
-  param_labels[cam_to_tgt_translation.data()] = labels_camera_to_target_guess_translation;
-  param_labels[cam_to_tgt_angle_axis.data()] = labels_camera_to_target_guess_quaternion;
 
-  result.covariance = rct_optimizations::computeCovariance(problem,
-                                                           std::vector<const double *>({cam_to_tgt_translation.data(), cam_to_tgt_angle_axis.data()}),
-                                                           param_labels);
+  Eigen::Isometry3d camera_to_plane(Eigen::Isometry3d::Identity());
+  camera_to_plane.linear() = camera_to_plane_rotation;
+  camera_to_plane.translation() = lambda * H.col(2);
 
-  return result;
+  return camera_to_plane * plane_to_target;
 }
+
+Eigen::Matrix3d estimateHomography(const Correspondence2D3D::Set& correspondences, Eigen::Isometry3d& plane_to_target)
+{
+  Eigen::Matrix2Xd plane_points;
+  plane_to_target = computePlaneCoordinates(correspondences, plane_points);
+
+  const Eigen::Index n = static_cast<Eigen::Index>(correspondences.size());
+  Eigen::Matrix2Xd image_points(2, n);
+  for (Eigen::Index i = 0; i < n; ++i)
+    image_points.col(i) = correspondences[i].in_image;
+
+  return computeHomography(plane_points, image_points);
+}
+
+Eigen::Isometry3d estimatePose3D(const Correspondence3D3D::Set& correspondences, const std::vector<double>& weights)
+{
+  if (!weights.empty() && weights.size() != correspondences.size())
+  {
+    std::stringstream ss;
+    ss << "Number of weights (" << weights.size() << ") does not match number of correspondences ("
+       << correspondences.size() << ")";
+    throw std::runtime_error(ss.str());
+  }
+
+  // Weighted centroids of the target and measured points
+  double total_weight = 0.0;
+  Eigen::Vector3d target_centroid(Eigen::Vector3d::Zero());
+  Eigen::Vector3d camera_centroid(Eigen::Vector3d::Zero());
+  for (std::size_t i = 0; i < correspondences.size(); ++i)
+  {
+    const double w = weights.empty() ? 1.0 : weights[i];
+    if (w < 0.0)
+      throw std::runtime_error("Correspondence weights must be non-negative");
+
+    total_weight += w;
+    target_centroid += w * correspondences[i].in_target;
+    camera_centroid += w * correspondences[i].in_image;
+  }
+
+  if (total_weight <= 0.0)
+    throw std::runtime_error("At least 3 correspondences with positive weight are required to estimate a 3D pose");
+
+  target_centroid /= total_weight;
+  camera_centroid /= total_weight;
+
+  // Cross-covariance of the centered point sets
+  Eigen::Matrix3d cross_covariance(Eigen::Matrix3d::Zero());
+  for (std::size_t i = 0; i < correspondences.size(); ++i)
+  {
+    const double w = weights.empty() ? 1.0 : weights[i];
+    cross_covariance.noalias() += w * (correspondences[i].in_image - camera_centroid)
+                                    * (correspondences[i].in_target - target_centroid).transpose();
+  }
+
+  // The rotation is unique if the cross-covariance has rank 2 or more (i.e. the target points do not lie on a line)
+  Eigen::JacobiSVD<Eigen::Matrix3d> svd(cross_covariance, Eigen::ComputeFullU | Eigen::ComputeFullV);
+  if (svd.singularValues()(1) <= 1.0e-12 * svd.singularValues()(0) || svd.singularValues()(0) <= 0.0)
+    throw std::runtime_error("Correspondences must contain at least 3 points that do not lie on a line to estimate a 3D pose");
+
+  // Closest proper rotation
+  Eigen::Matrix3d d(Eigen::Matrix3d::Identity());
+  if ((svd.matrixU() * svd.matrixV().transpose()).determinant() < 0.0)
+    d(2, 2) = -1.0;
+
+  Eigen::Isometry3d camera_to_target(Eigen::Isometry3d::Identity());
+  camera_to_target.linear() = svd.matrixU() * d * svd.matrixV().transpose();
+  camera_to_target.translation() = camera_centroid - camera_to_target.linear() * target_centroid;
+
+  return camera_to_target;
+}
+
 } // namespace rct_optimizations
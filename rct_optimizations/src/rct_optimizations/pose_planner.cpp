@@ -0,0 +1,70 @@
+#include <rct_optimizations/pose_planner.h>
+#include <rct_optimizations/parallel.h>
+
+#include <utility>
+
+namespace rct_optimizations
+{
+ObservationSelectionResult planPoses(const ExtrinsicHandEyeProblem2D3D& params,
+                                     const std::vector<Eigen::Vector3d>& target_points,
+                                     const std::vector<PoseCandidate>& candidates,
+                                     const PosePlannerOptions& options)
+{
+  // Predict the observation at each candidate pose with the guesses
+  ExtrinsicHandEyeProblem2D3D predicted(params);
+  predicted.observations.assign(candidates.size(), Observation2D3D());
+
+  parallelFor(candidates.size(), [&](const std::size_t i) {
+    Observation2D3D& observation = predicted.observations[i];
+    observation.to_camera_mount = candidates[i].to_camera_mount;
+    observation.to_target_mount = candidates[i].to_target_mount;
+
+    const Eigen::Isometry3d camera_to_target = (observation.to_camera_mount * params.camera_mount_to_camera_guess).inverse()
+                                               * observation.to_target_mount * params.target_mount_to_target_guess;
+
+    for (const Eigen::Vector3d& point : target_points)
+    {
+      const Eigen::Vector3d in_camera = camera_to_target * point;
+      if (in_camera.z() <= 0.0)
+        continue;
+
+      const Eigen::Vector2d in_image(params.intr.fx() * in_camera.x() / in_camera.z() + params.intr.cx(),
+                                     params.intr.fy() * in_camera.y() / in_camera.z() + params.intr.cy());
+      if ((options.image_width > 0 && (in_image.x() < 0.0 || in_image.x() >= options.image_width)) ||
+          (options.image_height > 0 && (in_image.y() < 0.0 || in_image.y() >= options.image_height)))
+        continue;
+
+      observation.correspondence_set.emplace_back(in_image, point);
+    }
+
+    if (observation.correspondence_set.size() < options.min_correspondences)
+      observation.correspondence_set.clear();
+  }, options.num_threads);
+
+  // Only the candidates with enough observed features are considered
+  std::vector<std::size_t> usable;
+  Observation2D3D::Set usable_observations;
+  for (std::size_t i = 0; i < candidates.size(); ++i)
+  {
+    if (!predicted.observations[i].correspondence_set.empty())
+    {
+      usable.push_back(i);
+      usable_observations.push_back(std::move(predicted.observations[i]));
+    }
+  }
+  predicted.observations = std::move(usable_observations);
+  const std::vector<Eigen::MatrixXd> jacobians = computeObservationJacobians(predicted, options.num_threads);
+
+  // The observations already collected are a prior on the calibration
+  Eigen::MatrixXd prior_information = Eigen::MatrixXd::Zero(12, 12);
+  for (const Eigen::MatrixXd& jacobian : computeObservationJacobians(params, options.num_threads))
+    prior_information += jacobian.transpose() * jacobian;
+
+  ObservationSelectionResult result = selectObservations(jacobians, options, prior_information);
+  for (std::size_t& index : result.selected_observations)
+    index = usable[index];
+
+  return result;
+}
+
+} // namespace rct_optimizations
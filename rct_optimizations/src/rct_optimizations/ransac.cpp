@@ -0,0 +1,337 @@
+#include <rct_optimizations/ransac.h>
+#include <rct_optimizations/ceres_math_utilities.h>
+#include <rct_optimizations/extrinsic_hand_eye_initialization.h>
+#include <rct_optimizations/parallel.h>
+#include <rct_optimizations/pnp.h>
+#include <rct_optimizations/random_generator.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+
+using namespace rct_optimizations;
+
+namespace
+{
+/** @brief Number of observations in a minimal subset: two relative motions are required to solve AX = XB */
+const std::size_t MINIMAL_SUBSET_SIZE = 3;
+
+/**
+ * @brief The observation data of a hand-eye problem:
+ *   to_camera_mount_i * camera_mount_to_camera * camera_to_target_i = to_target_mount_i * target_mount_to_target
+ */
+struct HandEyeData
+{
+  std::vector<Eigen::Isometry3d> to_camera_mount;
+  std::vector<Eigen::Isometry3d> to_target_mount;
+  std::vector<const Correspondence2D3D::Set*> correspondences;
+};
+
+struct HandEyeConsensus
+{
+  std::vector<std::size_t> inliers;
+  Eigen::Isometry3d camera_mount_to_camera;
+  Eigen::Isometry3d target_mount_to_target;
+};
+
+/**
+ * @brief Computes the RMS reprojection error of a set of correspondences; points behind the camera have infinite error
+ */
+double computeReprojectionError(const CameraIntrinsics& intr,
+                                const Correspondence2D3D::Set& correspondences,
+                                const Eigen::Isometry3d& camera_to_target)
+{
+  if (correspondences.empty())
+    return std::numeric_limits<double>::infinity();
+
+  double sum = 0.0;
+  for (const Correspondence2D3D& corr : correspondences)
+  {
+    const Eigen::Vector3d camera_point = camera_to_target * corr.in_target;
+    if (camera_point.z() <= 0.0)
+      return std::numeric_limits<double>::infinity();
+
+    sum += (projectPoint(intr, camera_point) - corr.in_image).squaredNorm();
+  }
+
+  return std::sqrt(sum / static_cast<double>(correspondences.size()));
+}
+
+class HandEyeRansac
+{
+public:
+  HandEyeRansac(const CameraIntrinsics& intr, const HandEyeData& data, const RansacOptions& options)
+    : intr_(intr)
+    , data_(data)
+    , options_(options)
+    , camera_to_target_(data.correspondences.size())
+  {
+    // Estimate the camera to target pose of each observation independently
+    const std::size_t n = data_.correspondences.size();
+    std::vector<char> valid(n, 0);
+    parallelFor(n,
+                [&](const std::size_t i) {
+                  try
+                  {
+                    camera_to_target_[i] = estimatePlanarPose(intr_, *data_.correspondences[i]);
+                    valid[i] = 1;
+                  }
+                  catch (const std::runtime_error&)
+                  {
+                  }
+                },
+                options_.num_threads);
+
+    for (std::size_t i = 0; i < n; ++i)
+    {
+      if (valid[i])
+        candidates_.push_back(i);
+    }
+  }
+
+  bool findConsensus(HandEyeConsensus& consensus) const
+  {
+    if (candidates_.size() < MINIMAL_SUBSET_SIZE || options_.max_iterations == 0)
+      return false;
+
+    // Evaluate the hypothesis of each iteration
+    std::vector<std::size_t> n_inliers(options_.max_iterations, 0);
+    std::vector<double> errors(options_.max_iterations, std::numeric_limits<double>::infinity());
+    parallelFor(options_.max_iterations,
+                [&](const std::size_t iteration) {
+                  Eigen::Isometry3d x, y;
+                  if (!hypothesize(iteration, x, y))
+                    return;
+
+                  std::vector<std::size_t> inliers;
+                  errors[iteration] = score(x, y, inliers);
+                  n_inliers[iteration] = inliers.size();
+                },
+                options_.num_threads);
+
+    // Select the hypothesis with the most inliers and, among those, the smallest total error
+    std::size_t best = 0;
+    for (std::size_t i = 1; i < options_.max_iterations; ++i)
+    {
+      if (n_inliers[i] > n_inliers[best] || (n_inliers[i] == n_inliers[best] && errors[i] < errors[best]))
+        best = i;
+    }
+
+    if (n_inliers[best] < MINIMAL_SUBSET_SIZE)
+      return false;
+
+    hypothesize(best, consensus.camera_mount_to_camera, consensus.target_mount_to_target);
+    score(consensus.camera_mount_to_camera, consensus.target_mount_to_target, consensus.inliers);
+
+    // Re-estimate the calibration from all of the inliers
+    std::vector<std::size_t> subset;
+    std::set_intersection(consensus.inliers.begin(), consensus.inliers.end(), candidates_.begin(), candidates_.end(),
+                          std::back_inserter(subset));
+
+    Eigen::Isometry3d x, y;
+    std::vector<std::size_t> inliers;
+    if (estimate(subset, x, y) && score(x, y, inliers) < std::numeric_limits<double>::infinity() &&
+        inliers.size() >= consensus.inliers.size())
+    {
+      consensus.camera_mount_to_camera = x;
+      consensus.target_mount_to_target = y;
+      consensus.inliers = inliers;
+    }
+
+    return true;
+  }
+
+private:
+  /**
+   * @brief Estimates the calibration from the minimal subset of observations of an iteration
+   */
+  bool hypothesize(const std::size_t iteration, Eigen::Isometry3d& x, Eigen::Isometry3d& y) const
+  {
+    // The random subset depends only on the seed and the iteration
+    const CounterBasedRandomGenerator gen(options_.seed, iteration);
+
+    std::vector<std::size_t> subset;
+    subset.reserve(MINIMAL_SUBSET_SIZE);
+    for (std::uint64_t counter = 0; subset.size() < MINIMAL_SUBSET_SIZE; ++counter)
+    {
+      const std::size_t idx = candidates_[gen(counter) % candidates_.size()];
+      if (std::find(subset.begin(), subset.end(), idx) == subset.end())
+        subset.push_back(idx);
+    }
+
+    return estimate(subset, x, y);
+  }
+
+  bool estimate(const std::vector<std::size_t>& subset, Eigen::Isometry3d& x, Eigen::Isometry3d& y) const
+  {
+    std::vector<Eigen::Isometry3d> to_camera_mount, to_target_mount, camera_to_target;
+    to_camera_mount.reserve(subset.size());
+    to_target_mount.reserve(subset.size());
+    camera_to_target.reserve(subset.size());
+    for (std::size_t idx : subset)
+    {
+      to_camera_mount.push_back(data_.to_camera_mount[idx]);
+      to_target_mount.push_back(data_.to_target_mount[idx]);
+      camera_to_target.push_back(camera_to_target_[idx]);
+    }
+
+    try
+    {
+      estimateHandEye(to_camera_mount, to_target_mount, camera_to_target, x, y);
+    }
+    catch (const std::runtime_error&)
+    {
+      // Degenerate subset
+      return false;
+    }
+    return true;
+  }
+
+  /**
+   * @brief Finds the observations that are consistent with a calibration
+   * @param inliers - Output (sorted) indices of the inlier observations
+   * @return The sum of the reprojection errors of the inlier observations
+   */
+  double score(const Eigen::Isometry3d& x, const Eigen::Isometry3d& y, std::vector<std::size_t>& inliers) const
+  {
+    inliers.clear();
+    double total_error = 0.0;
+    for (std::size_t i = 0; i < data_.correspondences.size(); ++i)
+    {
+      const Eigen::Isometry3d camera_to_target = (data_.to_camera_mount[i] * x).inverse() * data_.to_target_mount[i] * y;
+      const double error = computeReprojectionError(intr_, *data_.correspondences[i], camera_to_target);
+      if (error <= options_.inlier_threshold)
+      {
+        inliers.push_back(i);
+        total_error += error;
+      }
+    }
+    return total_error;
+  }
+
+  const CameraIntrinsics& intr_;
+  const HandEyeData& data_;
+  const RansacOptions& options_;
+
+  /** @brief Closed-form camera to target pose estimate of each observation */
+  std::vector<Eigen::Isometry3d> camera_to_target_;
+  /** @brief Indices of the observations with a valid camera to target pose estimate (sorted) */
+  std::vector<std::size_t> candidates_;
+};
+
+std::vector<std::size_t> getRejected(const std::size_t n, const std::vector<std::size_t>& inliers)
+{
+  std::vector<std::size_t> rejected;
+  std::size_t j = 0;
+  for (std::size_t i = 0; i < n; ++i)
+  {
+    if (j < inliers.size() && inliers[j] == i)
+      ++j;
+    else
+      rejected.push_back(i);
+  }
+  return rejected;
+}
+
+} // namespace anonymous
+
+namespace rct_optimizations
+{
+ExtrinsicHandEyeRansacResult optimizeRansac(const ExtrinsicHandEyeProblem2D3D& params, const RansacOptions& options)
+{
+  HandEyeData data;
+  for (const Observation2D3D& obs : params.observations)
+  {
+    data.to_camera_mount.push_back(obs.to_camera_mount);
+    data.to_target_mount.push_back(obs.to_target_mount);
+    data.correspondences.push_back(&obs.correspondence_set);
+  }
+
+  HandEyeConsensus consensus;
+  if (!HandEyeRansac(params.intr, data, options).findConsensus(consensus))
+    throw OptimizationException("Failed to find a consistent set of at least 3 observations");
+
+  // Keep all of the settings of the input problem and only replace the guesses and observations
+  ExtrinsicHandEyeProblem2D3D inlier_problem(params);
+  inlier_problem.camera_mount_to_camera_guess = consensus.camera_mount_to_camera;
+  inlier_problem.target_mount_to_target_guess = consensus.target_mount_to_target;
+  inlier_problem.observations.clear();
+  inlier_problem.observations.reserve(consensus.inliers.size());
+  for (std::size_t idx : consensus.inliers)
+    inlier_problem.observations.push_back(params.observations[idx]);
+
+  ExtrinsicHandEyeRansacResult result;
+  static_cast<ExtrinsicHandEyeResult&>(result) = optimize(inlier_problem);
+  result.inlier_observations = consensus.inliers;
+  result.rejected_observations = getRejected(params.observations.size(), consensus.inliers);
+
+  return result;
+}
+
+ExtrinsicMultiStaticCameraMovingTargetRansacResult optimizeRansac(const ExtrinsicMultiStaticCameraMovingTargetProblem& params,
+                                                                  const RansacOptions& options)
+{
+  const std::size_t n_cameras = params.base_to_camera_guess.size();
+  if (params.intr.size() != n_cameras || params.wrist_poses.size() != n_cameras || params.image_observations.size() != n_cameras)
+    throw OptimizationException("The number of intrinsics, wrist pose sets, observation sets, and camera guesses must match");
+
+  // Keep all of the settings of the input problem and only replace the guesses and observations
+  ExtrinsicMultiStaticCameraMovingTargetProblem inlier_problem(params);
+  inlier_problem.wrist_poses.assign(n_cameras, {});
+  inlier_problem.image_observations.assign(n_cameras, {});
+
+  ExtrinsicMultiStaticCameraMovingTargetRansacResult result;
+  result.inlier_observations.resize(n_cameras);
+  result.rejected_observations.resize(n_cameras);
+
+  std::size_t max_inliers = 0;
+  for (std::size_t c = 0; c < n_cameras; ++c)
+  {
+    const std::size_t n = params.image_observations[c].size();
+    if (params.wrist_poses[c].size() != n)
+      throw OptimizationException("The number of wrist poses and observations must match for each camera");
+
+    // Each static camera is a hand-eye problem: base * base_to_camera * camera_to_target = wrist * wrist_to_target
+    HandEyeData data;
+    data.to_camera_mount.assign(n, Eigen::Isometry3d::Identity());
+    data.to_target_mount = params.wrist_poses[c];
+    for (const Correspondence2D3D::Set& correspondences : params.image_observations[c])
+      data.correspondences.push_back(&correspondences);
+
+    HandEyeConsensus consensus;
+    if (HandEyeRansac(params.intr[c], data, options).findConsensus(consensus))
+    {
+      inlier_problem.base_to_camera_guess[c] = consensus.camera_mount_to_camera;
+      if (consensus.inliers.size() > max_inliers)
+      {
+        max_inliers = consensus.inliers.size();
+        inlier_problem.wrist_to_target_guess = consensus.target_mount_to_target;
+      }
+    }
+    else
+    {
+      // Keep all of the observations of cameras for which no consensus can be found, and report them to the caller
+      consensus.inliers.resize(n);
+      for (std::size_t i = 0; i < n; ++i)
+        consensus.inliers[i] = i;
+      result.cameras_without_consensus.push_back(c);
+    }
+
+    for (std::size_t idx : consensus.inliers)
+    {
+      inlier_problem.wrist_poses[c].push_back(params.wrist_poses[c][idx]);
+      inlier_problem.image_observations[c].push_back(params.image_observations[c][idx]);
+    }
+
+    result.inlier_observations[c] = consensus.inliers;
+    result.rejected_observations[c] = getRejected(n, consensus.inliers);
+  }
+
+  static_cast<ExtrinsicMultiStaticCameraMovingTargetResult&>(result) = optimize(inlier_problem);
+
+  return result;
+}
+
+} // namespace rct_optimizations
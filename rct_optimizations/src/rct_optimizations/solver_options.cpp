@@ -0,0 +1,176 @@
+#include <rct_optimizations/solver_options.h>
+#include <rct_optimizations/parallel.h>
+
+#include <ceres/ceres.h>
+#include <algorithm>
+#include <map>
+#include <set>
+#include <vector>
+
+namespace
+{
+/** @brief Maximum number of parameters of a linear system that is factorized densely */
+const int MAX_DENSE_PARAMETERS = 200;
+
+/** @brief Maximum fraction of nonzero elements for a Jacobian to be treated as sparse */
+const double MAX_SPARSE_JACOBIAN_DENSITY = 0.1;
+
+/** @brief Minimum number of residuals evaluated by each thread */
+const int MIN_RESIDUALS_PER_THREAD = 1000;
+
+/**
+ * @brief Gets the first available sparse linear algebra library
+ * @return False if Ceres was built without a sparse linear algebra library
+ */
+bool getSparseLibrary(ceres::SparseLinearAlgebraLibraryType& type)
+{
+  for (const ceres::SparseLinearAlgebraLibraryType t : { ceres::SUITE_SPARSE, ceres::EIGEN_SPARSE })
+  {
+    if (ceres::IsSparseLinearAlgebraLibraryTypeAvailable(t))
+    {
+      type = t;
+      return true;
+    }
+  }
+  return false;
+}
+
+} // namespace anonymous
+
+namespace rct_optimizations
+{
+ceres::Solver::Options configureSolverOptions(const ceres::Problem& problem,
+                                              const ceres::Solver::Options& options,
+                                              const SolverProfile profile,
+                                              const std::size_t num_threads)
+{
+  ceres::Solver::Options out(options);
+  if (profile == SolverProfile::MANUAL)
+    return out;
+
+  // Get the size of the free parameter blocks
+  std::vector<double*> parameter_blocks;
+  problem.GetParameterBlocks(&parameter_blocks);
+
+  std::map<const double*, int> free_block_sizes;
+  int num_free_params = 0;
+  for (double* block : parameter_blocks)
+  {
+    if (problem.IsParameterBlockConstant(block))
+      continue;
+
+    const int size = problem.ParameterBlockLocalSize(block);
+    free_block_sizes[block] = size;
+    num_free_params += size;
+  }
+
+  // Get the free parameter blocks on which each residual block depends, and the size of the Jacobian
+  std::vector<ceres::ResidualBlockId> residual_blocks;
+  problem.GetResidualBlocks(&residual_blocks);
+
+  std::map<const double*, std::vector<std::size_t>> block_residuals;
+  int num_residuals = 0;
+  double num_jacobian_nonzeros = 0.0;
+  for (std::size_t i = 0; i < residual_blocks.size(); ++i)
+  {
+    std::vector<double*> blocks;
+    problem.GetParameterBlocksForResidualBlock(residual_blocks[i], &blocks);
+
+    const int rows = problem.GetCostFunctionForResidualBlock(residual_blocks[i])->num_residuals();
+    num_residuals += rows;
+
+    for (const double* block : blocks)
+    {
+      auto it = free_block_sizes.find(block);
+      if (it == free_block_sizes.end())
+        continue;
+
+      num_jacobian_nonzeros += static_cast<double>(rows) * it->second;
+      block_residuals[block].push_back(i);
+    }
+  }
+
+  // Use one thread per fixed amount of work; threading is not worth its overhead for small problems
+  const int max_threads = static_cast<int>(getNumThreads(num_threads));
+  out.num_threads = std::max(1, std::min({ max_threads,
+                                           static_cast<int>(residual_blocks.size()),
+                                           num_residuals / MIN_RESIDUALS_PER_THREAD }));
+  out.linear_solver_ordering.reset();
+  out.linear_solver_type = ceres::DENSE_QR;
+
+  if (num_free_params == 0)
+    return out;
+
+  /* Greedily select an independent set of parameter blocks to eliminate (i.e. no two of them appear in the same residual
+   * block), starting with the blocks that are used by the fewest residual blocks. The blocks used by many residual blocks
+   * (e.g. intrinsics or mount transforms shared by all observations) remain in the reduced system */
+  std::vector<double*> candidates;
+  for (double* block : parameter_blocks)
+  {
+    if (block_residuals.count(block) > 0)
+      candidates.push_back(block);
+  }
+  std::stable_sort(candidates.begin(), candidates.end(), [&block_residuals](const double* lhs, const double* rhs) {
+    return block_residuals.at(lhs).size() < block_residuals.at(rhs).size();
+  });
+
+  std::vector<bool> has_eliminated_block(residual_blocks.size(), false);
+  std::set<const double*> eliminated_blocks;
+  int num_eliminated_params = 0;
+  for (double* block : candidates)
+  {
+    const std::vector<std::size_t>& residuals = block_residuals.at(block);
+    const bool independent = std::none_of(residuals.begin(), residuals.end(), [&has_eliminated_block](const std::size_t i) {
+      return has_eliminated_block[i];
+    });
+    if (!independent)
+      continue;
+
+    for (const std::size_t i : residuals)
+      has_eliminated_block[i] = true;
+    eliminated_blocks.insert(block);
+    num_eliminated_params += free_block_sizes.at(block);
+  }
+
+  const int num_reduced_params = num_free_params - num_eliminated_params;
+  ceres::SparseLinearAlgebraLibraryType sparse_library;
+  const bool sparse_available = getSparseLibrary(sparse_library);
+
+  // Elimination only pays off if there are several blocks to eliminate and they make up most of the problem
+  if (eliminated_blocks.size() > 1 && num_reduced_params > 0 && num_eliminated_params >= num_reduced_params)
+  {
+    // Eliminate the selected blocks first with the Schur complement
+    auto* ordering = new ceres::ParameterBlockOrdering;
+    for (double* block : parameter_blocks)
+      ordering->AddElementToGroup(block, eliminated_blocks.count(block) > 0 ? 0 : 1);
+    out.linear_solver_ordering.reset(ordering);
+
+    if (num_reduced_params <= MAX_DENSE_PARAMETERS)
+    {
+      out.linear_solver_type = ceres::DENSE_SCHUR;
+    }
+    else if (sparse_available)
+    {
+      out.linear_solver_type = ceres::SPARSE_SCHUR;
+      out.sparse_linear_algebra_library_type = sparse_library;
+    }
+    else
+    {
+      out.linear_solver_type = ceres::ITERATIVE_SCHUR;
+      out.preconditioner_type = ceres::SCHUR_JACOBI;
+    }
+  }
+  else
+  {
+    const double density = num_jacobian_nonzeros / (static_cast<double>(num_residuals) * num_free_params);
+    if (num_free_params > MAX_DENSE_PARAMETERS && density <= MAX_SPARSE_JACOBIAN_DENSITY && sparse_available)
+    {
+      out.linear_solver_type = ceres::SPARSE_NORMAL_CHOLESKY;
+      out.sparse_linear_algebra_library_type = sparse_library;
+    }
+  }
+
+  return out;
+}
+
+} // namespace rct_optimizations
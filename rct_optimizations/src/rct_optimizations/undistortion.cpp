@@ -0,0 +1,185 @@
+#include <rct_optimizations/undistortion.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <sstream>
+
+namespace rct_optimizations
+{
+Undistorter::Undistorter(const CameraIntrinsics& intr,
+                         const std::array<double, 5>& distortion,
+                         const int width,
+                         const int height,
+                         const double grid_spacing,
+                         const unsigned refinement_iterations)
+  : intr_(intr)
+  , distortion_(distortion)
+  , grid_spacing_(grid_spacing)
+  , refinement_iterations_(refinement_iterations)
+{
+  if (width <= 0 || height <= 0)
+    throw OptimizationException("The image size must be positive");
+  if (!(grid_spacing > 0.0))
+    throw OptimizationException("The grid spacing of the undistortion lookup table must be positive");
+
+  // The grid covers the whole image, including its far edges
+  grid_cols_ = static_cast<Eigen::Index>(std::ceil(width / grid_spacing_)) + 1;
+  grid_rows_ = static_cast<Eigen::Index>(std::ceil(height / grid_spacing_)) + 1;
+
+  Eigen::Matrix2Xd node_pixels(2, grid_cols_ * grid_rows_);
+  for (Eigen::Index row = 0; row < grid_rows_; ++row)
+  {
+    for (Eigen::Index col = 0; col < grid_cols_; ++col)
+      node_pixels.col(col + row * grid_cols_) << col * grid_spacing_, row * grid_spacing_;
+  }
+
+  // Invert the distortion at the nodes to full precision, starting from the distorted coordinates
+  const Eigen::Matrix2Xd distorted = normalize(node_pixels);
+  grid_ = distorted;
+
+  const double tolerance = 1.0e-12;
+  const unsigned max_iterations = 50;
+  double error = std::numeric_limits<double>::infinity();
+  for (unsigned i = 0; i < max_iterations && !(error < tolerance); ++i)
+  {
+    refine(distorted, grid_, 1);
+    error = (distortPoints(grid_) - distorted).cwiseAbs().maxCoeff();
+  }
+
+  if (!(error < tolerance))
+  {
+    std::stringstream ss;
+    ss << "Failed to invert the lens distortion over the image (maximum error " << error
+       << "); the distortion must be monotonic within the image";
+    throw OptimizationException(ss.str());
+  }
+}
+
+Eigen::Matrix2Xd Undistorter::undistortPoints(const Eigen::Matrix2Xd& image_points) const
+{
+  // Bilinear interpolation of the lookup table. Points outside of the image are extrapolated from the nearest grid cell
+  Eigen::Matrix2Xd undistorted(2, image_points.cols());
+  for (Eigen::Index i = 0; i < image_points.cols(); ++i)
+  {
+    const double gx = image_points(0, i) / grid_spacing_;
+    const double gy = image_points(1, i) / grid_spacing_;
+    const Eigen::Index col = std::min(std::max(static_cast<Eigen::Index>(std::floor(gx)), Eigen::Index(0)), grid_cols_ - 2);
+    const Eigen::Index row = std::min(std::max(static_cast<Eigen::Index>(std::floor(gy)), Eigen::Index(0)), grid_rows_ - 2);
+    const double tx = gx - static_cast<double>(col);
+    const double ty = gy - static_cast<double>(row);
+
+    const Eigen::Index idx = col + row * grid_cols_;
+    undistorted.col(i) = (1.0 - ty) * ((1.0 - tx) * grid_.col(idx) + tx * grid_.col(idx + 1))
+                         + ty * ((1.0 - tx) * grid_.col(idx + grid_cols_) + tx * grid_.col(idx + grid_cols_ + 1));
+  }
+
+  refine(normalize(image_points), undistorted, refinement_iterations_);
+  return undistorted;
+}
+
+Eigen::Vector2d Undistorter::undistortPoint(const Eigen::Vector2d& image_point) const
+{
+  return undistortPoints(image_point);
+}
+
+Correspondence2D3D::Set Undistorter::undistort(const Correspondence2D3D::Set& correspondences) const
+{
+  return undistort(std::vector<Correspondence2D3D::Set>{ correspondences }).front();
+}
+
+std::vector<Correspondence2D3D::Set>
+Undistorter::undistort(const std::vector<Correspondence2D3D::Set>& correspondence_sets) const
+{
+  std::size_t n = 0;
+  for (const Correspondence2D3D::Set& set : correspondence_sets)
+    n += set.size();
+
+  Eigen::Matrix2Xd image_points(2, n);
+  Eigen::Index idx = 0;
+  for (const Correspondence2D3D::Set& set : correspondence_sets)
+  {
+    for (const Correspondence2D3D& corr : set)
+      image_points.col(idx++) = corr.in_image;
+  }
+
+  const Eigen::Matrix2Xd undistorted = undistortPoints(image_points);
+
+  // Project the undistorted coordinates with the pin-hole model
+  std::vector<Correspondence2D3D::Set> out(correspondence_sets);
+  idx = 0;
+  for (Correspondence2D3D::Set& set : out)
+  {
+    for (Correspondence2D3D& corr : set)
+    {
+      corr.in_image << intr_.fx() * undistorted(0, idx) + intr_.cx(), intr_.fy() * undistorted(1, idx) + intr_.cy();
+      ++idx;
+    }
+  }
+
+  return out;
+}
+
+Eigen::Matrix2Xd Undistorter::distortPoints(const Eigen::Matrix2Xd& normalized_points) const
+{
+  const double k1 = distortion_[0], k2 = distortion_[1], p1 = distortion_[2], p2 = distortion_[3], k3 = distortion_[4];
+
+  const Eigen::ArrayXd x = normalized_points.row(0).transpose().array();
+  const Eigen::ArrayXd y = normalized_points.row(1).transpose().array();
+  const Eigen::ArrayXd x2 = x.square();
+  const Eigen::ArrayXd y2 = y.square();
+  const Eigen::ArrayXd xy = x * y;
+  const Eigen::ArrayXd r2 = x2 + y2;
+  const Eigen::ArrayXd radial = 1.0 + r2 * (k1 + r2 * (k2 + r2 * k3));
+
+  Eigen::Matrix2Xd out(2, normalized_points.cols());
+  out.row(0) = (x * radial + 2.0 * p1 * xy + p2 * (r2 + 2.0 * x2)).matrix().transpose();
+  out.row(1) = (y * radial + p1 * (r2 + 2.0 * y2) + 2.0 * p2 * xy).matrix().transpose();
+  return out;
+}
+
+void Undistorter::refine(const Eigen::Matrix2Xd& distorted, Eigen::Matrix2Xd& undistorted, const unsigned iterations) const
+{
+  const double k1 = distortion_[0], k2 = distortion_[1], p1 = distortion_[2], p2 = distortion_[3], k3 = distortion_[4];
+
+  const Eigen::ArrayXd target_x = distorted.row(0).transpose().array();
+  const Eigen::ArrayXd target_y = distorted.row(1).transpose().array();
+  Eigen::ArrayXd x = undistorted.row(0).transpose().array();
+  Eigen::ArrayXd y = undistorted.row(1).transpose().array();
+
+  for (unsigned it = 0; it < iterations; ++it)
+  {
+    const Eigen::ArrayXd x2 = x.square();
+    const Eigen::ArrayXd y2 = y.square();
+    const Eigen::ArrayXd xy = x * y;
+    const Eigen::ArrayXd r2 = x2 + y2;
+    const Eigen::ArrayXd radial = 1.0 + r2 * (k1 + r2 * (k2 + r2 * k3));
+    const Eigen::ArrayXd d_radial = k1 + r2 * (2.0 * k2 + 3.0 * k3 * r2);  // d(radial) / d(r^2)
+
+    // Error of the distorted coordinates
+    const Eigen::ArrayXd ex = x * radial + 2.0 * p1 * xy + p2 * (r2 + 2.0 * x2) - target_x;
+    const Eigen::ArrayXd ey = y * radial + p1 * (r2 + 2.0 * y2) + 2.0 * p2 * xy - target_y;
+
+    // Jacobian [a, b; b, d] of the distortion with respect to the undistorted coordinates (it is symmetric)
+    const Eigen::ArrayXd a = radial + 2.0 * x2 * d_radial + 2.0 * p1 * y + 6.0 * p2 * x;
+    const Eigen::ArrayXd b = 2.0 * xy * d_radial + 2.0 * p1 * x + 2.0 * p2 * y;
+    const Eigen::ArrayXd d = radial + 2.0 * y2 * d_radial + 6.0 * p1 * y + 2.0 * p2 * x;
+    const Eigen::ArrayXd det_inv = 1.0 / (a * d - b * b);
+
+    x -= (d * ex - b * ey) * det_inv;
+    y -= (a * ey - b * ex) * det_inv;
+  }
+
+  undistorted.row(0) = x.matrix().transpose();
+  undistorted.row(1) = y.matrix().transpose();
+}
+
+Eigen::Matrix2Xd Undistorter::normalize(const Eigen::Matrix2Xd& image_points) const
+{
+  Eigen::Matrix2Xd out(2, image_points.cols());
+  out.row(0) = (image_points.row(0).array() - intr_.cx()) / intr_.fx();
+  out.row(1) = (image_points.row(1).array() - intr_.cy()) / intr_.fy();
+  return out;
+}
+
+} // namespace rct_optimizations
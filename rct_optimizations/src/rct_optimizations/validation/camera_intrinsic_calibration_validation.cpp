@@ -2,48 +2,60 @@
 #include <boost/accumulators/accumulators.hpp>
 #include <boost/accumulators/statistics.hpp>
 
-namespace rct_optimizations
+namespace
 {
-VirtualCorrespondenceResult measureVirtualTargetDiff(const Correspondence2D3D::Set &correspondences,
-                                                     const CameraIntrinsics &intr,
-                                                     const Eigen::Isometry3d &camera_to_target_guess,
-                                                     const double pnp_sq_error_threshold)
+using namespace rct_optimizations;
+
+/**
+ * @brief Creates the PnP problems of the two virtual targets made of the first and second halves of a correspondence set
+ */
+std::vector<PnPProblem> createVirtualTargetProblems(const Correspondence2D3D::Set &correspondences,
+                                                    const CameraIntrinsics &intr,
+                                                    const Eigen::Isometry3d &camera_to_target_guess)
 {
-  // Create a lambda for doing the PnP optimization
-  auto solve_pnp = [&intr, &camera_to_target_guess, &pnp_sq_error_threshold](
-                     const Correspondence2D3D::Set &corr) -> Eigen::Isometry3d {
-    // Create the first virtual target PnP problem
-    PnPProblem problem;
+  // Calculate the size of half of the correspondence set
+  std::size_t half_size = correspondences.size() / 2;
+
+  // Create two half sets of correspondences
+  std::vector<PnPProblem> problems(2);
+  problems[0].correspondences.assign(correspondences.begin(), correspondences.begin() + half_size);
+  problems[1].correspondences.assign(correspondences.begin() + half_size, correspondences.end());
+
+  for (PnPProblem &problem : problems)
+  {
     problem.intr = intr;
-    problem.correspondences = corr;
     problem.camera_to_target_guess = camera_to_target_guess;
+    problem.covariance_mode = CovarianceMode::NONE;
+  }
 
-    PnPResult result = optimize(problem);
-    if (!result.converged || result.final_cost_per_obs > pnp_sq_error_threshold)
+  return problems;
+}
+
+/**
+ * @brief Checks the PnP results of the two virtual targets and computes the difference between them
+ */
+VirtualCorrespondenceResult computeVirtualTargetDiff(const PnPResult &result_1,
+                                                     const PnPResult &result_2,
+                                                     const double pnp_sq_error_threshold)
+{
+  for (const PnPResult *result : { &result_1, &result_2 })
+  {
+    if (!result->converged || result->final_cost_per_obs > pnp_sq_error_threshold)
     {
       std::stringstream ss;
-      ss << "PnP optimization " << (result.converged ? "converged" : "did not converge")
-         << " with residual error of " << result.final_cost_per_obs << " ("
+      ss << "PnP optimization " << (result->converged ? "converged" : "did not converge")
+         << " with residual error of " << result->final_cost_per_obs << " ("
          << pnp_sq_error_threshold << " max)";
       throw std::runtime_error(ss.str());
     }
-
-    return result.camera_to_target;
-  };
-
-  // Calculate the size of half of the correspondence set
-  std::size_t half_size = correspondences.size() / 2;
-
-  // Create two half sets of correspondences
-  Correspondence2D3D::Set set_1(correspondences.begin(), correspondences.begin() + half_size);
-  Correspondence2D3D::Set set_2(correspondences.begin() + half_size, correspondences.end());
+  }
 
   /* Get the camera to target transformation for each half set
    * Note: these transforms are from the camera to the origin of each virtual target.
    *   The origin of the second virtual target is still the same as the first virtual target,
    *   so the two transforms should be the same, given perfect camera intrinsics */
-  Eigen::Isometry3d camera_to_target_1 = solve_pnp(set_1);
-  Eigen::Isometry3d camera_to_target_2 = solve_pnp(set_2);
+  const Eigen::Isometry3d &camera_to_target_1 = result_1.camera_to_target;
+  const Eigen::Isometry3d &camera_to_target_2 = result_2.camera_to_target;
 
   VirtualCorrespondenceResult res;
 
@@ -57,6 +69,20 @@ VirtualCorrespondenceResult measureVirtualTargetDiff(const Correspondence2D3D::S
   return res;
 }
 
+} // namespace anonymous
+
+namespace rct_optimizations
+{
+VirtualCorrespondenceResult measureVirtualTargetDiff(const Correspondence2D3D::Set &correspondences,
+                                                     const CameraIntrinsics &intr,
+                                                     const Eigen::Isometry3d &camera_to_target_guess,
+                                                     const double pnp_sq_error_threshold)
+{
+  // Solve the two small problems on the calling thread
+  const std::vector<PnPResult> results = optimizeBatch(createVirtualTargetProblems(correspondences, intr, camera_to_target_guess), 1);
+  return computeVirtualTargetDiff(results[0], results[1], pnp_sq_error_threshold);
+}
+
 IntrinsicCalibrationAccuracyResult measureIntrinsicCalibrationAccuracy(
   const Observation2D3D::Set &observations,
   const CameraIntrinsics &intr,
@@ -88,7 +114,9 @@ IntrinsicCalibrationAccuracyResult measureIntrinsicCalibrationAccuracy(
   ba::accumulator_set<double, ba::features<ba::stats<ba::tag::mean>, ba::stats<ba::tag::variance>>>
     ang_acc;
 
-  // Accumulate the position vector of the transformation
+  // Create the virtual target problems of all of the observations and solve them in parallel
+  std::vector<PnPProblem> problems;
+  problems.reserve(2 * observations.size());
   for (const auto &obs : observations)
   {
     Eigen::Isometry3d camera_base_to_camera = obs.to_camera_mount * camera_mount_to_camera;
@@ -97,10 +125,17 @@ IntrinsicCalibrationAccuracyResult measureIntrinsicCalibrationAccuracy(
 
     Eigen::Isometry3d camera_to_target = camera_base_to_camera.inverse() * camera_base_to_target;
 
-    VirtualCorrespondenceResult res = measureVirtualTargetDiff(obs.correspondence_set,
-                                                               intr,
-                                                               camera_to_target,
-                                                               pnp_sq_error_threshold);
+    // Note: PnPProblem is not assignable, so the problems must be appended one at a time
+    for (const PnPProblem &problem : createVirtualTargetProblems(obs.correspondence_set, intr, camera_to_target))
+      problems.push_back(problem);
+  }
+
+  const std::vector<PnPResult> results = optimizeBatch(problems);
+
+  // Accumulate the position vector of the transformation
+  for (std::size_t i = 0; i < observations.size(); ++i)
+  {
+    VirtualCorrespondenceResult res = computeVirtualTargetDiff(results[2 * i], results[2 * i + 1], pnp_sq_error_threshold);
     pos_acc(res.positional_error);
     ang_acc(res.angular_error);
   }
@@ -84,12 +84,11 @@ PnPNoiseStat qualifyNoise2D(const std::vector<PnPProblem>& params)
   ba::accumulator_set<double, ba::stats<ba::tag::mean, ba::tag::variance>> y_acc;
   ba::accumulator_set<double, ba::stats<ba::tag::mean, ba::tag::variance>> z_acc;
 
-  for (auto& prob : params)
-  {
-    rct_optimizations::PnPResult result;
-
-    result = rct_optimizations::optimize(prob);
+  // Solve all of the problems in parallel
+  const std::vector<PnPResult> results = optimizeBatch(params);
 
+  for (const PnPResult& result : results)
+  {
     if (result.converged)
     {
       //we will save the full result here for debugging purposes
@@ -130,12 +129,11 @@ PnPNoiseStat qualifyNoise3D(const std::vector<PnPProblem3D>& params)
   ba::accumulator_set<double, ba::stats<ba::tag::mean, ba::tag::variance>> y_acc;
   ba::accumulator_set<double, ba::stats<ba::tag::mean, ba::tag::variance>> z_acc;
 
-  for (auto& prob : params)
-  {
-    rct_optimizations::PnPResult result;
-
-    result = rct_optimizations::optimize(prob);
+  // Solve all of the problems in parallel
+  const std::vector<PnPResult> results = optimizeBatch(params);
 
+  for (const PnPResult& result : results)
+  {
     if (result.converged)
     {
       //we will save the full result here for debugging purposes
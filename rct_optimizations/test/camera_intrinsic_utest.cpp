@@ -0,0 +1,102 @@
+#include <gtest/gtest.h>
+#include <rct_optimizations/experimental/camera_intrinsic.h>
+#include <rct_optimizations/pnp.h>
+#include <rct_optimizations_tests/observation_creator.h>
+#include <rct_optimizations_tests/pose_generator.h>
+#include <rct_optimizations_tests/utilities.h>
+
+using namespace rct_optimizations;
+
+class CameraIntrinsicTest : public ::testing::Test
+{
+public:
+  CameraIntrinsicTest()
+    : camera(test::makeKinectCamera())
+    , target(5, 7, 0.025)
+  {
+    camera.intr.fy() = 540.0;
+    camera.intr.cx() = 330.0;
+    camera.intr.cy() = 235.0;
+
+    // Observe the target from a cone of camera poses looking at its center
+    Eigen::Isometry3d target_center(Eigen::Isometry3d::Identity());
+    target_center.translation() = target.center;
+
+    test::ConicalPoseGenerator pose_gen(0.3, 0.5, 8);
+    for (const Eigen::Isometry3d& camera_pose : pose_gen.generate(target_center))
+      observations.push_back(test::getCorrespondences(camera_pose, Eigen::Isometry3d::Identity(), camera, target, true));
+  }
+
+  test::Camera camera;
+  test::Target target;
+  std::vector<Correspondence2D3D::Set> observations;
+};
+
+TEST_F(CameraIntrinsicTest, ClosedFormEstimate)
+{
+  // The closed-form solution should be exact for noise-free observations without distortion
+  ClosedFormIntrinsicsResult result = estimateIntrinsics(observations, true);
+  EXPECT_TRUE(Eigen::Vector4d(result.intrinsics.values.data()).isApprox(Eigen::Vector4d(camera.intr.values.data()), 1.0e-6));
+  EXPECT_NEAR(result.distortions[0], 0.0, 1.0e-6);
+  EXPECT_NEAR(result.distortions[1], 0.0, 1.0e-6);
+  EXPECT_TRUE(result.failed_observation_sets.empty());
+
+  // Observation sets whose homography cannot be estimated are excluded and reported
+  std::vector<Correspondence2D3D::Set> observations_with_failure(observations);
+  observations_with_failure.push_back(Correspondence2D3D::Set(observations.front().begin(), observations.front().begin() + 3));
+  result = estimateIntrinsics(observations_with_failure);
+  EXPECT_TRUE(Eigen::Vector4d(result.intrinsics.values.data()).isApprox(Eigen::Vector4d(camera.intr.values.data()), 1.0e-6));
+  ASSERT_EQ(result.failed_observation_sets.size(), 1);
+  EXPECT_EQ(result.failed_observation_sets.front(), observations.size());
+
+  // Too few observation sets
+  EXPECT_THROW(estimateIntrinsics(std::vector<Correspondence2D3D::Set>(observations.begin(), observations.begin() + 1)),
+               OptimizationException);
+
+  // Observation sets with the same orientation of the target do not constrain the intrinsics
+  EXPECT_THROW(estimateIntrinsics(std::vector<Correspondence2D3D::Set>(3, observations.front())), OptimizationException);
+}
+
+TEST_F(CameraIntrinsicTest, OptimizeWithoutGuess)
+{
+  // Without an intrinsics guess, the optimization should be initialized with the closed-form estimate
+  IntrinsicEstimationProblem problem;
+  problem.image_observations = observations;
+  problem.covariance_mode = CovarianceMode::NONE;
+
+  IntrinsicEstimationResult result = optimize(problem);
+  EXPECT_TRUE(result.converged);
+  EXPECT_TRUE(result.failed_observation_sets.empty());
+  EXPECT_LT(result.final_cost_per_obs, 1.0e-12);
+  EXPECT_TRUE(Eigen::Vector4d(result.intrinsics.values.data()).isApprox(Eigen::Vector4d(camera.intr.values.data()), 1.0e-6));
+}
+
+TEST_F(CameraIntrinsicTest, FisheyeModel)
+{
+  // Observe the target with a fisheye camera
+  const std::array<double, 4> distortion = {{0.05, -0.02, 0.005, -0.001}};
+  std::vector<Correspondence2D3D::Set> fisheye_observations(observations);
+  for (std::size_t i = 0; i < observations.size(); ++i)
+  {
+    const Eigen::Isometry3d camera_to_target = estimatePlanarPose(camera.intr, observations[i]);
+    for (Correspondence2D3D& corr : fisheye_observations[i])
+    {
+      const Eigen::Vector3d in_camera = camera_to_target * corr.in_target;
+      FisheyeModel::project(camera.intr.values.data(), distortion.data(), in_camera.data(), corr.in_image.data());
+    }
+  }
+
+  IntrinsicEstimationProblem problem;
+  problem.image_observations = fisheye_observations;
+  problem.intrinsics_guess = camera.intr;
+  problem.camera_model = CameraModelType::FISHEYE;
+  problem.covariance_mode = CovarianceMode::NONE;
+
+  IntrinsicEstimationResult result = optimize(problem);
+  EXPECT_TRUE(result.converged);
+  EXPECT_LT(result.final_cost_per_obs, 1.0e-12);
+  EXPECT_TRUE(Eigen::Vector4d(result.intrinsics.values.data()).isApprox(Eigen::Vector4d(camera.intr.values.data()), 1.0e-6));
+  for (std::size_t i = 0; i < distortion.size(); ++i)
+    EXPECT_NEAR(result.distortions[i], distortion[i], 1.0e-6);
+  EXPECT_DOUBLE_EQ(result.distortions[4], 0.0);
+}
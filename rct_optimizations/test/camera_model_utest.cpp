@@ -0,0 +1,140 @@
+#include <rct_optimizations/camera_model.h>
+#include <rct_optimizations/ceres_math_utilities.h>
+#include <rct_optimizations/eigen_conversions.h>
+#include <rct_optimizations/image_observation_cost.h>
+#include <rct_optimizations_tests/observation_creator.h>
+#include <rct_optimizations_tests/utilities.h>
+
+#include <ceres/jet.h>
+#include <gtest/gtest.h>
+
+using namespace rct_optimizations;
+
+class CameraModelTest : public ::testing::Test
+{
+public:
+  CameraModelTest()
+    : camera(test::makeKinectCamera())
+    , points(3, 5)
+  {
+    points << 0.0, 0.1, -0.2, 0.3, -0.25,
+              0.0, -0.15, 0.05, 0.2, -0.3,
+              1.0, 0.9, 1.1, 0.8, 0.7;
+  }
+
+  test::Camera camera;
+  Eigen::Matrix3Xd points;
+};
+
+TEST_F(CameraModelTest, Pinhole)
+{
+  for (Eigen::Index i = 0; i < points.cols(); ++i)
+  {
+    const Eigen::Vector3d p = points.col(i);
+    const Eigen::Vector2d expected(camera.intr.fx() * p.x() / p.z() + camera.intr.cx(),
+                                   camera.intr.fy() * p.y() / p.z() + camera.intr.cy());
+
+    Eigen::Vector2d uv;
+    PinholeModel::project<double>(camera.intr.values.data(), nullptr, p.data(), uv.data());
+    EXPECT_TRUE(uv.isApprox(expected));
+    EXPECT_TRUE(projectPoint(camera.intr, p).isApprox(expected));
+
+    // The distortion models reduce to the pin-hole model when all of the distortion parameters are zero
+    const std::array<double, RadialTangentialModel::NUM_DISTORTION_PARAMS> zero{};
+    RadialTangentialModel::project(camera.intr.values.data(), zero.data(), p.data(), uv.data());
+    EXPECT_TRUE(uv.isApprox(expected));
+  }
+
+  // Points in the plane of the camera are not scaled
+  const Eigen::Vector3d p(0.1, 0.2, 0.0);
+  EXPECT_TRUE(projectPoint(camera.intr, p).isApprox(Eigen::Vector2d(camera.intr.fx() * p.x() + camera.intr.cx(),
+                                                                    camera.intr.fy() * p.y() + camera.intr.cy())));
+}
+
+TEST_F(CameraModelTest, RadialTangential)
+{
+  const std::array<double, 5> d = {{-0.2, 0.05, 0.001, -0.002, 0.01}};
+  for (Eigen::Index i = 0; i < points.cols(); ++i)
+  {
+    const Eigen::Vector3d p = points.col(i);
+    const double x = p.x() / p.z();
+    const double y = p.y() / p.z();
+    const double r2 = x * x + y * y;
+    const double radial = 1.0 + d[0] * r2 + d[1] * r2 * r2 + d[4] * r2 * r2 * r2;
+    const double x_d = x * radial + 2.0 * d[2] * x * y + d[3] * (r2 + 2.0 * x * x);
+    const double y_d = y * radial + d[2] * (r2 + 2.0 * y * y) + 2.0 * d[3] * x * y;
+    const Eigen::Vector2d expected(camera.intr.fx() * x_d + camera.intr.cx(), camera.intr.fy() * y_d + camera.intr.cy());
+
+    Eigen::Vector2d uv;
+    RadialTangentialModel::project(camera.intr.values.data(), d.data(), p.data(), uv.data());
+    EXPECT_TRUE(uv.isApprox(expected));
+  }
+}
+
+TEST_F(CameraModelTest, Fisheye)
+{
+  const std::array<double, 4> d = {{0.1, -0.05, 0.01, -0.002}};
+  for (Eigen::Index i = 0; i < points.cols(); ++i)
+  {
+    const Eigen::Vector3d p = points.col(i);
+    Eigen::Vector2d uv;
+    FisheyeModel::project(camera.intr.values.data(), d.data(), p.data(), uv.data());
+
+    // The distance of the normalized projection from the principal point is the distorted angle from the optical axis
+    const double theta = std::atan2(p.head<2>().norm(), p.z());
+    const double theta_d = theta * (1.0 + d[0] * std::pow(theta, 2) + d[1] * std::pow(theta, 4) + d[2] * std::pow(theta, 6)
+                                    + d[3] * std::pow(theta, 8));
+    const Eigen::Vector2d normalized((uv.x() - camera.intr.cx()) / camera.intr.fx(),
+                                     (uv.y() - camera.intr.cy()) / camera.intr.fy());
+    EXPECT_NEAR(normalized.norm(), theta_d, 1.0e-12);
+
+    // The direction of the projection is not changed by the distortion
+    if (p.head<2>().norm() > 0.0)
+      EXPECT_TRUE(normalized.normalized().isApprox(p.head<2>().normalized()));
+  }
+
+  // The derivatives are finite on the optical axis
+  using Jet = ceres::Jet<double, 3>;
+  const Jet point[3] = { Jet(0.0, 0), Jet(0.0, 1), Jet(1.0, 2) };
+  Jet uv[2];
+  FisheyeModel::project(camera.intr.values.data(), d.data(), point, uv);
+  EXPECT_TRUE(uv[0].v.allFinite());
+  EXPECT_TRUE(uv[1].v.allFinite());
+  EXPECT_DOUBLE_EQ(uv[0].v(0), camera.intr.fx());
+  EXPECT_DOUBLE_EQ(uv[1].v(1), camera.intr.fy());
+}
+
+TEST_F(CameraModelTest, ImageObservationCost)
+{
+  test::Target target(5, 7, 0.025);
+  Eigen::Isometry3d camera_to_target(Eigen::Isometry3d::Identity());
+  camera_to_target.translate(Eigen::Vector3d(0.0, 0.0, 0.5));
+  camera_to_target.rotate(Eigen::AngleAxisd(M_PI, Eigen::Vector3d::UnitX()));
+  camera_to_target.translate(-target.center);
+
+  // Observe the target with a distorted camera
+  const std::array<double, 5> d = {{-0.2, 0.05, 0.001, -0.002, 0.01}};
+  Correspondence2D3D::Set correspondences;
+  for (const Eigen::Vector3d& pt : target.points)
+  {
+    Correspondence2D3D corr;
+    corr.in_target = pt;
+    const Eigen::Vector3d in_camera = camera_to_target * pt;
+    RadialTangentialModel::project(camera.intr.values.data(), d.data(), in_camera.data(), corr.in_image.data());
+    correspondences.push_back(corr);
+  }
+
+  const Pose6d pose = poseEigenToCal(camera_to_target);
+  std::vector<double> residuals(2 * correspondences.size());
+
+  // The residuals of the distortion model should be zero at the true pose
+  ImageObservationCost<2, RadialTangentialModel> cost(correspondences, camera.intr, d);
+  ASSERT_TRUE(cost(pose.values.data(), residuals.data()));
+  for (double r : residuals)
+    EXPECT_NEAR(r, 0.0, 1.0e-10);
+
+  // The pin-hole model should not fit the distorted observations
+  ImageObservationCost<2> pinhole_cost(correspondences, camera.intr);
+  ASSERT_TRUE(pinhole_cost(pose.values.data(), residuals.data()));
+  EXPECT_GT(Eigen::Map<const Eigen::VectorXd>(residuals.data(), residuals.size()).cwiseAbs().maxCoeff(), 1.0);
+}
@@ -0,0 +1,72 @@
+/**
+ * Micro-benchmark comparing the cost of applying a constant transform to ceres::Jet points with @ref poseTransformPoint
+ * (angle-axis rotation of a Pose6d promoted to Jets) and with @ref ConstantTransform (pre-computed 3x4 matrix)
+ */
+#include <rct_optimizations/ceres_math_utilities.h>
+#include <rct_optimizations/eigen_conversions.h>
+
+#include <ceres/jet.h>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace rct_optimizations;
+
+// Jet size of a cost function with two 6-DoF pose parameters
+using Jet = ceres::Jet<double, 12>;
+
+template<typename Function>
+double timePerIteration(const std::size_t n_iterations, Function fn)
+{
+  const auto start = std::chrono::steady_clock::now();
+  for (std::size_t i = 0; i < n_iterations; ++i)
+    fn(i);
+  const auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(end - start).count() / static_cast<double>(n_iterations);
+}
+
+int main(int argc, char **argv)
+{
+  const std::size_t n_iterations = argc > 1 ? std::stoul(argv[1]) : 1000000;
+
+  Eigen::Isometry3d transform(Eigen::Isometry3d::Identity());
+  transform.translate(Eigen::Vector3d(0.1, 0.2, 0.3));
+  transform.rotate(Eigen::AngleAxisd(0.5, Eigen::Vector3d(1.0, 2.0, 3.0).normalized()));
+  const Pose6d pose = poseEigenToCal(transform);
+  const ConstantTransform constant_transform(transform);
+
+  // Create a set of points with non-zero derivatives
+  std::vector<std::array<Jet, 3>> points(64);
+  for (std::size_t i = 0; i < points.size(); ++i)
+  {
+    for (int j = 0; j < 3; ++j)
+    {
+      points[i][j] = Jet(0.01 * static_cast<double>(i + j));
+      points[i][j].v.setConstant(1.0);
+    }
+  }
+
+  Jet sink(0.0);
+
+  const double pose_ns = timePerIteration(n_iterations, [&](const std::size_t i) {
+    Jet out[3];
+    poseTransformPoint(pose, points[i % points.size()].data(), out);
+    sink += out[2];
+  });
+
+  const double constant_ns = timePerIteration(n_iterations, [&](const std::size_t i) {
+    Jet out[3];
+    constant_transform.transformPoint(points[i % points.size()].data(), out);
+    sink += out[2];
+  });
+
+  std::cout << "poseTransformPoint: " << pose_ns << " ns/point" << std::endl;
+  std::cout << "ConstantTransform:  " << constant_ns << " ns/point" << std::endl;
+  std::cout << "Speed-up:           " << pose_ns / constant_ns << "x" << std::endl;
+
+  // Print the accumulated value so the computation cannot be optimized away
+  std::cout << "(" << sink.a << ")" << std::endl;
+
+  return 0;
+}
@@ -0,0 +1,49 @@
+#include <rct_optimizations/ceres_math_utilities.h>
+#include <rct_optimizations/eigen_conversions.h>
+#include <rct_optimizations_tests/utilities.h>
+
+#include <gtest/gtest.h>
+
+using namespace rct_optimizations;
+
+TEST(ConstantTransform, TransformPoint)
+{
+  const Eigen::Isometry3d transform = test::perturbPose(Eigen::Isometry3d::Identity(), 0.5, 1.0);
+  const Pose6d pose = poseEigenToCal(transform);
+
+  const ConstantTransform from_isometry(transform);
+  const ConstantTransform from_pose(pose);
+  EXPECT_TRUE(from_isometry.matrix().isApprox(from_pose.matrix()));
+  EXPECT_TRUE(from_isometry.toIsometry().isApprox(transform));
+
+  const Eigen::Vector3d point(0.1, -0.2, 0.3);
+
+  // Compare against the angle-axis transformation of a pose
+  Eigen::Vector3d expected;
+  poseTransformPoint(pose, point.data(), expected.data());
+
+  Eigen::Vector3d actual;
+  from_pose.transformPoint(point.data(), actual.data());
+  EXPECT_TRUE(actual.isApprox(expected));
+  EXPECT_TRUE((from_pose * point).isApprox(expected));
+  EXPECT_TRUE(from_pose.rotate(point).isApprox(transform.linear() * point));
+}
+
+TEST(ConstantTransform, Composition)
+{
+  const Eigen::Isometry3d a = test::perturbPose(Eigen::Isometry3d::Identity(), 0.5, 1.0);
+  const Eigen::Isometry3d b = test::perturbPose(Eigen::Isometry3d::Identity(), 0.5, 1.0);
+  const ConstantTransform const_a(a);
+  const ConstantTransform const_b(b);
+
+  EXPECT_TRUE((const_a * const_b).toIsometry().isApprox(a * b));
+  EXPECT_TRUE(const_a.inverse().toIsometry().isApprox(a.inverse()));
+  EXPECT_TRUE((const_a * b).isApprox(a * b));
+  EXPECT_TRUE(const_a.rotate(Eigen::Matrix3d(b.linear())).isApprox(a.linear() * b.linear()));
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
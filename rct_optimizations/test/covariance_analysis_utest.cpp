@@ -0,0 +1,128 @@
+#include <rct_optimizations/covariance_analysis.h>
+#include <rct_optimizations/circle_fit.h>
+
+#include <ceres/ceres.h>
+#include <gtest/gtest.h>
+#include <array>
+#include <cmath>
+#include <random>
+
+TEST(CovarianceAnalysis, SparseAndMaskedCovariance)
+{
+  // Fit a circle, with its center and the square root of its radius as separate parameter blocks, to points on the unit
+  // circle
+  std::vector<double> params_internal = { 0.1, -0.1, 1.05 };
+
+  ceres::Problem problem;
+  const std::size_t n_obs = 50;
+  for (std::size_t i = 0; i < n_obs; ++i)
+  {
+    const double angle = 2.0 * M_PI * static_cast<double>(i) / static_cast<double>(n_obs);
+    auto* cost_fn = new rct_optimizations::CircleDistCost(std::cos(angle), std::sin(angle));
+    auto* cost_block = new ceres::AutoDiffCostFunction<rct_optimizations::CircleDistCost, 1, 1, 1, 1>(cost_fn);
+    problem.AddResidualBlock(cost_block, nullptr, params_internal.data(), params_internal.data() + 1, params_internal.data() + 2);
+  }
+
+  ceres::Solver::Options options;
+  options.linear_solver_type = ceres::DENSE_QR;
+  ceres::Solver::Summary summary;
+  ceres::Solve(options, &problem, &summary);
+  ASSERT_EQ(summary.termination_type, ceres::CONVERGENCE);
+
+  std::map<const double*, std::vector<std::string>> labels_all;
+  labels_all[params_internal.data()] = {"circle_x"};
+  labels_all[params_internal.data() + 1] = {"circle_y"};
+  labels_all[params_internal.data() + 2] = {"circle_r"};
+
+  const rct_optimizations::CovarianceResult dense = rct_optimizations::computeCovariance(problem, labels_all);
+  ASSERT_EQ(dense.covariance_matrix.rows(), 3);
+
+  // the sparse covariance of a full-rank problem matches the dense covariance
+  rct_optimizations::CovarianceResult sparse = rct_optimizations::computeCovariance(problem,
+                                                                                   labels_all,
+                                                                                   std::map<const double *, std::vector<int>>(),
+                                                                                   rct_optimizations::SparseCovarianceOptions(2));
+  EXPECT_TRUE(sparse.covariance_matrix.isApprox(dense.covariance_matrix, 1e-6));
+
+  // masked parameters are excluded, and fully masked blocks are skipped
+  std::map<const double*, std::vector<int>> mask_y;
+  mask_y[params_internal.data() + 1] = {0};
+  rct_optimizations::CovarianceResult masked = rct_optimizations::computeCovariance(problem, labels_all, mask_y);
+  ASSERT_EQ(masked.labels.size(), 2);
+  EXPECT_EQ(masked.labels[0], "circle_x");
+  EXPECT_EQ(masked.labels[1], "circle_r");
+  EXPECT_NEAR(masked.covariance_matrix(0, 1), dense.covariance_matrix(0, 2), 1e-10);
+
+  // expect exception if a mask index is out of range
+  std::map<const double*, std::vector<int>> mask_out_of_range;
+  mask_out_of_range[params_internal.data()] = {1};
+  EXPECT_THROW(rct_optimizations::computeCovariance(problem, labels_all, mask_out_of_range), rct_optimizations::CovarianceException);
+}
+
+/** @brief Linear residual of a shared 2D parameter block and a 2D nuisance parameter block */
+struct SharedNuisanceCost
+{
+  SharedNuisanceCost(const Eigen::Vector4d& a, const double b) : a_(a), b_(b) {}
+
+  template <typename T>
+  bool operator()(const T* const shared, const T* const nuisance, T* residual) const
+  {
+    residual[0] = a_(0) * shared[0] + a_(1) * shared[1] + a_(2) * nuisance[0] + a_(3) * nuisance[1] - b_;
+    return true;
+  }
+
+  Eigen::Vector4d a_;
+  double b_;
+};
+
+TEST(CovarianceAnalysis, MarginalCovariance)
+{
+  std::array<double, 2> shared = {{0.0, 0.0}};
+  std::vector<std::array<double, 2>> nuisance(20, {{0.0, 0.0}});
+
+  // Random, but fixed, linear residuals
+  std::mt19937 rand_gen(RCT_RANDOM_SEED);
+  std::normal_distribution<double> dist(0.0, 1.0);
+
+  ceres::Problem problem;
+  for (std::array<double, 2>& n : nuisance)
+  {
+    for (std::size_t i = 0; i < 4; ++i)
+    {
+      const Eigen::Vector4d a(dist(rand_gen), dist(rand_gen), dist(rand_gen), dist(rand_gen));
+      auto* cost = new ceres::AutoDiffCostFunction<SharedNuisanceCost, 1, 2, 2>(new SharedNuisanceCost(a, dist(rand_gen)));
+      problem.AddResidualBlock(cost, nullptr, shared.data(), n.data());
+    }
+  }
+
+  std::vector<const double*> nuisance_blocks;
+  for (const std::array<double, 2>& n : nuisance)
+    nuisance_blocks.push_back(n.data());
+
+  std::map<const double*, std::vector<std::string>> labels;
+  labels[shared.data()] = {"a", "b"};
+
+  // The marginal covariance matches the corresponding block of the full covariance
+  rct_optimizations::CovarianceResult full = rct_optimizations::computeCovariance(problem, {shared.data()}, labels);
+  rct_optimizations::CovarianceResult marginal =
+      rct_optimizations::computeMarginalCovariance(problem, {shared.data()}, labels, nuisance_blocks);
+  ASSERT_EQ(marginal.labels, full.labels);
+  EXPECT_TRUE(marginal.covariance_matrix.isApprox(full.covariance_matrix, 1e-8));
+
+  rct_optimizations::CovarianceResult diagonal = rct_optimizations::computeMarginalCovariance(
+      problem, {shared.data()}, labels, nuisance_blocks, rct_optimizations::CovarianceMode::DIAGONAL);
+  EXPECT_TRUE(diagonal.covariance_matrix.diagonal().isApprox(full.covariance_matrix.diagonal(), 1e-8));
+  EXPECT_DOUBLE_EQ(diagonal.covariance_matrix(0, 1), 0.0);
+
+  // expect exception if a residual depends on two nuisance blocks
+  auto* cost = new ceres::AutoDiffCostFunction<SharedNuisanceCost, 1, 2, 2>(new SharedNuisanceCost(Eigen::Vector4d::Ones(), 0.0));
+  problem.AddResidualBlock(cost, nullptr, nuisance[0].data(), nuisance[1].data());
+  EXPECT_THROW(rct_optimizations::computeMarginalCovariance(problem, {shared.data()}, labels, nuisance_blocks),
+               rct_optimizations::CovarianceException);
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,211 @@
+/**
+ * Benchmark comparing the covariance calculation of @ref computeCovariance with the previous implementation, which computed
+ * the dense covariance matrix of all of the parameter blocks and then extracted the tangent space with a linear search of
+ * the mask for every element. The test problem resembles a kinematic calibration: ~100 parameters, thousands of residuals,
+ * and a few masked parameters
+ */
+#include <rct_optimizations/covariance_analysis.h>
+
+#include <ceres/autodiff_cost_function.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace rct_optimizations;
+
+static const int BLOCK_SIZE = 4;
+
+/** @brief Linear residual of two parameter blocks */
+struct LinearCost
+{
+  LinearCost(const Eigen::Matrix<double, 1, 2 * BLOCK_SIZE>& a, const double b) : a_(a), b_(b) {}
+
+  template <typename T>
+  bool operator()(const T* const x0, const T* const x1, T* residual) const
+  {
+    residual[0] = T(-b_);
+    for (int i = 0; i < BLOCK_SIZE; ++i)
+      residual[0] += a_(i) * x0[i] + a_(BLOCK_SIZE + i) * x1[i];
+    return true;
+  }
+
+  Eigen::Matrix<double, 1, 2 * BLOCK_SIZE> a_;
+  double b_;
+};
+
+/** @brief Previous implementation: dense covariance of all blocks, then tangent space extraction with std::find */
+Eigen::MatrixXd computeCovarianceLegacy(ceres::Problem& problem,
+                                        const std::vector<const double*>& blocks,
+                                        const std::map<const double*, std::vector<int>>& masks,
+                                        const ceres::Covariance::Options& options)
+{
+  Eigen::Index n = 0;
+  std::vector<Eigen::Index> tangent_space_indices;
+  for (const double* b : blocks)
+  {
+    const int block_size = problem.ParameterBlockSize(b);
+    std::vector<int> mask;
+    auto it = masks.find(b);
+    if (it != masks.end())
+      mask = it->second;
+
+    for (int i = 0; i < block_size; ++i)
+    {
+      if (std::find(mask.begin(), mask.end(), i) == mask.end())
+        tangent_space_indices.push_back(n + i);
+    }
+    n += block_size;
+  }
+
+  ceres::Covariance covariance(options);
+  if (!covariance.Compute(blocks, &problem))
+    throw CovarianceException("Could not compute covariance");
+
+  Eigen::MatrixXd cov(n, n);
+  if (!covariance.GetCovarianceMatrix(blocks, cov.data()))
+    throw CovarianceException("GetCovarianceMatrix failed");
+
+  const Eigen::Index n_tangent = static_cast<Eigen::Index>(tangent_space_indices.size());
+  Eigen::MatrixXd out(n_tangent, n_tangent);
+  for (Eigen::Index r = 0; r < n_tangent; ++r)
+    for (Eigen::Index c = 0; c < n_tangent; ++c)
+      out(r, c) = cov(tangent_space_indices[r], tangent_space_indices[c]);
+
+  return out;
+}
+
+/** @brief Previous implementation of @ref computeCorrelationsFromCovariance */
+Eigen::MatrixXd computeCorrelationsLegacy(const Eigen::MatrixXd& covariance_matrix)
+{
+  const Eigen::Index num_vars = covariance_matrix.rows();
+  Eigen::MatrixXd out(num_vars, num_vars);
+  for (Eigen::Index i = 0; i < num_vars; i++)
+  {
+    double sigma_i = sqrt(fabs(covariance_matrix(i, i)));
+    for (Eigen::Index j = 0; j < num_vars; j++)
+    {
+      double sigma_j = sqrt(fabs(covariance_matrix(j, j)));
+      if (i == j)
+        out(i, j) = sigma_i;
+      else
+      {
+        if (sigma_i < std::numeric_limits<double>::epsilon()) sigma_i = 1;
+        if (sigma_j < std::numeric_limits<double>::epsilon()) sigma_j = 1;
+        out(i, j) = covariance_matrix(i, j) / (sigma_i * sigma_j);
+      }
+    }
+  }
+  return out;
+}
+
+template<typename Function>
+double timeMilliseconds(const std::size_t n_iterations, Function fn)
+{
+  const auto start = std::chrono::steady_clock::now();
+  for (std::size_t i = 0; i < n_iterations; ++i)
+    fn();
+  const auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::milli>(end - start).count() / static_cast<double>(n_iterations);
+}
+
+int main(int argc, char **argv)
+{
+  const std::size_t n_blocks = argc > 1 ? std::stoul(argv[1]) : 25;
+  const std::size_t n_residuals = argc > 2 ? std::stoul(argv[2]) : 5000;
+  const std::size_t n_iterations = argc > 3 ? std::stoul(argv[3]) : 5;
+
+  // Create a problem with random linear residuals between pairs of blocks
+  std::mt19937 mt_rand(0);
+  std::normal_distribution<double> dist;
+  std::uniform_int_distribution<std::size_t> block_dist(0, n_blocks - 1);
+
+  std::vector<std::vector<double>> params(n_blocks, std::vector<double>(BLOCK_SIZE, 0.0));
+  ceres::Problem problem;
+  for (std::size_t i = 0; i < n_residuals; ++i)
+  {
+    const std::size_t b0 = block_dist(mt_rand);
+    std::size_t b1 = block_dist(mt_rand);
+    while (b1 == b0)
+      b1 = block_dist(mt_rand);
+
+    Eigen::Matrix<double, 1, 2 * BLOCK_SIZE> a;
+    for (Eigen::Index j = 0; j < a.size(); ++j)
+      a(j) = dist(mt_rand);
+
+    auto* cost = new ceres::AutoDiffCostFunction<LinearCost, 1, BLOCK_SIZE, BLOCK_SIZE>(new LinearCost(a, dist(mt_rand)));
+    problem.AddResidualBlock(cost, nullptr, params[b0].data(), params[b1].data());
+  }
+
+  std::vector<const double*> blocks;
+  std::map<const double*, std::vector<std::string>> labels;
+  std::map<const double*, std::vector<int>> masks;
+  for (std::size_t i = 0; i < n_blocks; ++i)
+  {
+    const double* b = params[i].data();
+    blocks.push_back(b);
+    for (int j = 0; j < BLOCK_SIZE; ++j)
+      labels[b].push_back("block" + std::to_string(i) + "_" + std::to_string(j));
+
+    // Mask one parameter of every third block
+    if (i % 3 == 0)
+      masks[b] = { static_cast<int>(i % BLOCK_SIZE) };
+  }
+
+  // A few blocks of interest for the restricted calculation
+  const std::vector<const double*> subset(blocks.begin(), blocks.begin() + std::min<std::size_t>(3, n_blocks));
+  std::map<const double*, std::vector<std::string>> subset_labels;
+  for (const double* b : subset)
+    subset_labels[b] = labels[b];
+
+  std::cout << "Problem: " << n_blocks * BLOCK_SIZE << " parameters, " << n_residuals << " residuals" << std::endl;
+
+  Eigen::MatrixXd legacy_cov, new_cov, sparse_cov;
+  const double legacy_ms = timeMilliseconds(n_iterations, [&]() {
+    legacy_cov = computeCovarianceLegacy(problem, blocks, masks, DefaultCovarianceOptions());
+  });
+  const double new_ms = timeMilliseconds(n_iterations, [&]() {
+    new_cov = computeCovariance(problem, blocks, labels, masks, DefaultCovarianceOptions()).covariance_matrix;
+  });
+  const double sparse_1_ms = timeMilliseconds(n_iterations, [&]() {
+    sparse_cov = computeCovariance(problem, blocks, labels, masks, SparseCovarianceOptions(1)).covariance_matrix;
+  });
+  const double sparse_n_ms = timeMilliseconds(n_iterations, [&]() {
+    sparse_cov = computeCovariance(problem, blocks, labels, masks, SparseCovarianceOptions()).covariance_matrix;
+  });
+
+  std::cout << "All blocks" << std::endl;
+  std::cout << "  Previous (dense SVD):      " << legacy_ms << " ms" << std::endl;
+  std::cout << "  Current (dense SVD):       " << new_ms << " ms (max diff " << (new_cov - legacy_cov).cwiseAbs().maxCoeff() << ")" << std::endl;
+  std::cout << "  Current (sparse QR, 1 th): " << sparse_1_ms << " ms (max diff " << (sparse_cov - legacy_cov).cwiseAbs().maxCoeff() << ")" << std::endl;
+  std::cout << "  Current (sparse QR, " << getNumThreads() << " th): " << sparse_n_ms << " ms" << std::endl;
+
+  // Previously, the covariance of a subset of blocks was extracted from the covariance of all blocks
+  Eigen::MatrixXd legacy_subset_cov, subset_cov;
+  const double legacy_subset_ms = timeMilliseconds(n_iterations, [&]() {
+    const Eigen::MatrixXd cov = computeCovarianceLegacy(problem, blocks, {}, DefaultCovarianceOptions());
+    legacy_subset_cov = cov.topLeftCorner(subset.size() * BLOCK_SIZE, subset.size() * BLOCK_SIZE);
+  });
+  const double subset_ms = timeMilliseconds(n_iterations, [&]() {
+    subset_cov = computeCovariance(problem, subset, subset_labels, {}, SparseCovarianceOptions()).covariance_matrix;
+  });
+
+  std::cout << "Subset of " << subset.size() << " blocks" << std::endl;
+  std::cout << "  Previous (all blocks, dense SVD): " << legacy_subset_ms << " ms" << std::endl;
+  std::cout << "  Current (subset, sparse QR):      " << subset_ms << " ms (max diff " << (subset_cov - legacy_subset_cov).cwiseAbs().maxCoeff() << ")" << std::endl;
+
+  // Correlation matrix
+  const std::size_t n_corr_iterations = 100 * n_iterations;
+  Eigen::MatrixXd legacy_corr, new_corr;
+  const double legacy_corr_ms = timeMilliseconds(n_corr_iterations, [&]() { legacy_corr = computeCorrelationsLegacy(legacy_cov); });
+  const double new_corr_ms = timeMilliseconds(n_corr_iterations, [&]() { new_corr = computeCorrelationsFromCovariance(legacy_cov); });
+
+  std::cout << "Correlation matrix" << std::endl;
+  std::cout << "  Previous: " << legacy_corr_ms << " ms" << std::endl;
+  std::cout << "  Current:  " << new_corr_ms << " ms (max diff " << (new_corr - legacy_corr).cwiseAbs().maxCoeff() << ")" << std::endl;
+
+  return 0;
+}
@@ -270,48 +270,48 @@ TEST_F(CircleFitUnit_PerfectObservations_RandomGuess, FitCircleToPerfectObs)
 
   // checks for NamedParam output
   // expect three parameters for standard deviations
-  ASSERT_EQ(result.covariance.standard_deviations.size(), 3);
+  ASSERT_EQ(result.covariance.getStandardDeviations().size(), 3);
 
   // expect three parameters for off-diagonal covariance
-  ASSERT_EQ(result.covariance.covariances.size(), 3);
+  ASSERT_EQ(result.covariance.getCovariances().size(), 3);
 
   // expect three parameters for off-diagonal correlation coefficients
-  ASSERT_EQ(result.covariance.correlation_coeffs.size(), 3);
+  ASSERT_EQ(result.covariance.getCorrelationCoeffs().size(), 3);
 
   // expect names to match what was set in the problem
-  EXPECT_EQ(result.covariance.standard_deviations[0].names.first, problem.labels[0]);
-  EXPECT_EQ(result.covariance.standard_deviations[0].names.second, "");
-  EXPECT_EQ(result.covariance.standard_deviations[1].names.first, problem.labels[1]);
-  EXPECT_EQ(result.covariance.standard_deviations[1].names.second, "");
-  EXPECT_EQ(result.covariance.standard_deviations[2].names.first, problem.labels[2]);
-  EXPECT_EQ(result.covariance.standard_deviations[2].names.second, "");
-
-  EXPECT_EQ(result.covariance.covariances[0].names.first, problem.labels[0]);
-  EXPECT_EQ(result.covariance.covariances[0].names.second, problem.labels[1]);
-  EXPECT_EQ(result.covariance.covariances[1].names.first, problem.labels[0]);
-  EXPECT_EQ(result.covariance.covariances[1].names.second, problem.labels[2]);
-  EXPECT_EQ(result.covariance.covariances[2].names.first, problem.labels[1]);
-  EXPECT_EQ(result.covariance.covariances[2].names.second, problem.labels[2]);
-
-  EXPECT_EQ(result.covariance.correlation_coeffs[0].names.first, problem.labels[0]);
-  EXPECT_EQ(result.covariance.correlation_coeffs[0].names.second, problem.labels[1]);
-  EXPECT_EQ(result.covariance.correlation_coeffs[1].names.first, problem.labels[0]);
-  EXPECT_EQ(result.covariance.correlation_coeffs[1].names.second, problem.labels[2]);
-  EXPECT_EQ(result.covariance.correlation_coeffs[2].names.first, problem.labels[1]);
-  EXPECT_EQ(result.covariance.correlation_coeffs[2].names.second, problem.labels[2]);
+  EXPECT_EQ(result.covariance.getStandardDeviations()[0].names.first, problem.labels[0]);
+  EXPECT_EQ(result.covariance.getStandardDeviations()[0].names.second, "");
+  EXPECT_EQ(result.covariance.getStandardDeviations()[1].names.first, problem.labels[1]);
+  EXPECT_EQ(result.covariance.getStandardDeviations()[1].names.second, "");
+  EXPECT_EQ(result.covariance.getStandardDeviations()[2].names.first, problem.labels[2]);
+  EXPECT_EQ(result.covariance.getStandardDeviations()[2].names.second, "");
+
+  EXPECT_EQ(result.covariance.getCovariances()[0].names.first, problem.labels[0]);
+  EXPECT_EQ(result.covariance.getCovariances()[0].names.second, problem.labels[1]);
+  EXPECT_EQ(result.covariance.getCovariances()[1].names.first, problem.labels[0]);
+  EXPECT_EQ(result.covariance.getCovariances()[1].names.second, problem.labels[2]);
+  EXPECT_EQ(result.covariance.getCovariances()[2].names.first, problem.labels[1]);
+  EXPECT_EQ(result.covariance.getCovariances()[2].names.second, problem.labels[2]);
+
+  EXPECT_EQ(result.covariance.getCorrelationCoeffs()[0].names.first, problem.labels[0]);
+  EXPECT_EQ(result.covariance.getCorrelationCoeffs()[0].names.second, problem.labels[1]);
+  EXPECT_EQ(result.covariance.getCorrelationCoeffs()[1].names.first, problem.labels[0]);
+  EXPECT_EQ(result.covariance.getCorrelationCoeffs()[1].names.second, problem.labels[2]);
+  EXPECT_EQ(result.covariance.getCorrelationCoeffs()[2].names.first, problem.labels[1]);
+  EXPECT_EQ(result.covariance.getCorrelationCoeffs()[2].names.second, problem.labels[2]);
 
   // expect values to match contents of matrices
-  EXPECT_EQ(result.covariance.standard_deviations[0].value, result.covariance.correlation_matrix(0, 0));
-  EXPECT_EQ(result.covariance.standard_deviations[1].value, result.covariance.correlation_matrix(1, 1));
-  EXPECT_EQ(result.covariance.standard_deviations[2].value, result.covariance.correlation_matrix(2, 2));
+  EXPECT_EQ(result.covariance.getStandardDeviations()[0].value, result.covariance.correlation_matrix(0, 0));
+  EXPECT_EQ(result.covariance.getStandardDeviations()[1].value, result.covariance.correlation_matrix(1, 1));
+  EXPECT_EQ(result.covariance.getStandardDeviations()[2].value, result.covariance.correlation_matrix(2, 2));
 
-  EXPECT_EQ(result.covariance.covariances[0].value, result.covariance.covariance_matrix(0, 1));
-  EXPECT_EQ(result.covariance.covariances[1].value, result.covariance.covariance_matrix(0, 2));
-  EXPECT_EQ(result.covariance.covariances[2].value, result.covariance.covariance_matrix(1, 2));
+  EXPECT_EQ(result.covariance.getCovariances()[0].value, result.covariance.covariance_matrix(0, 1));
+  EXPECT_EQ(result.covariance.getCovariances()[1].value, result.covariance.covariance_matrix(0, 2));
+  EXPECT_EQ(result.covariance.getCovariances()[2].value, result.covariance.covariance_matrix(1, 2));
 
-  EXPECT_EQ(result.covariance.correlation_coeffs[0].value, result.covariance.correlation_matrix(0, 1));
-  EXPECT_EQ(result.covariance.correlation_coeffs[1].value, result.covariance.correlation_matrix(0, 2));
-  EXPECT_EQ(result.covariance.correlation_coeffs[2].value, result.covariance.correlation_matrix(1, 2));
+  EXPECT_EQ(result.covariance.getCorrelationCoeffs()[0].value, result.covariance.correlation_matrix(0, 1));
+  EXPECT_EQ(result.covariance.getCorrelationCoeffs()[1].value, result.covariance.correlation_matrix(0, 2));
+  EXPECT_EQ(result.covariance.getCorrelationCoeffs()[2].value, result.covariance.correlation_matrix(1, 2));
 }
 
 TEST_F(CircleFitUnit_ClusteredObservations, FitCircleToClusteredObs)
@@ -574,55 +574,55 @@ TEST(CovarianceAnalysis, CovarianceAnalysisFunctions)
 
   rct_optimizations::CovarianceResult covariance_labeled = rct_optimizations::computeCovariance(problem, labels_all);
 
-  EXPECT_EQ(covariance_labeled.standard_deviations.size(), 3);
-  EXPECT_EQ(covariance_labeled.covariances.size(), 3);
-  EXPECT_EQ(covariance_labeled.correlation_coeffs.size(), 3);
+  EXPECT_EQ(covariance_labeled.getStandardDeviations().size(), 3);
+  EXPECT_EQ(covariance_labeled.getCovariances().size(), 3);
+  EXPECT_EQ(covariance_labeled.getCorrelationCoeffs().size(), 3);
 
   rct_optimizations::CovarianceResult covariance_generic_names = rct_optimizations::computeCovariance(problem);
 
-  EXPECT_EQ(covariance_generic_names.standard_deviations.size(), 3);
-  EXPECT_EQ(covariance_generic_names.covariances.size(), 3);
-  EXPECT_EQ(covariance_generic_names.correlation_coeffs.size(), 3);
+  EXPECT_EQ(covariance_generic_names.getStandardDeviations().size(), 3);
+  EXPECT_EQ(covariance_generic_names.getCovariances().size(), 3);
+  EXPECT_EQ(covariance_generic_names.getCorrelationCoeffs().size(), 3);
 
   rct_optimizations::CovarianceResult cov_x_r_generic_names = rct_optimizations::computeCovariance(problem, param_blocks_x_r);
 
-  EXPECT_EQ(cov_x_r_generic_names.standard_deviations.size(), 2);
-  EXPECT_EQ(cov_x_r_generic_names.covariances.size(), 1);
-  EXPECT_EQ(cov_x_r_generic_names.correlation_coeffs.size(), 1);
+  EXPECT_EQ(cov_x_r_generic_names.getStandardDeviations().size(), 2);
+  EXPECT_EQ(cov_x_r_generic_names.getCovariances().size(), 1);
+  EXPECT_EQ(cov_x_r_generic_names.getCorrelationCoeffs().size(), 1);
 
-  EXPECT_EQ(cov_x_r_generic_names.standard_deviations[0].names.first, "block0_element0");
-  EXPECT_EQ(cov_x_r_generic_names.standard_deviations[0].value, covariance_labeled.standard_deviations[0].value);
+  EXPECT_EQ(cov_x_r_generic_names.getStandardDeviations()[0].names.first, "block0_element0");
+  EXPECT_EQ(cov_x_r_generic_names.getStandardDeviations()[0].value, covariance_labeled.getStandardDeviations()[0].value);
 
-  EXPECT_EQ(cov_x_r_generic_names.standard_deviations[1].names.first, "block1_element0");
-  EXPECT_EQ(cov_x_r_generic_names.standard_deviations[1].value, covariance_labeled.standard_deviations[2].value);
+  EXPECT_EQ(cov_x_r_generic_names.getStandardDeviations()[1].names.first, "block1_element0");
+  EXPECT_EQ(cov_x_r_generic_names.getStandardDeviations()[1].value, covariance_labeled.getStandardDeviations()[2].value);
 
-  EXPECT_EQ(cov_x_r_generic_names.covariances[0].names.first, "block0_element0");
-  EXPECT_EQ(cov_x_r_generic_names.covariances[0].names.second, "block1_element0");
-  EXPECT_EQ(cov_x_r_generic_names.covariances[0].value, covariance_labeled.covariances[1].value);
+  EXPECT_EQ(cov_x_r_generic_names.getCovariances()[0].names.first, "block0_element0");
+  EXPECT_EQ(cov_x_r_generic_names.getCovariances()[0].names.second, "block1_element0");
+  EXPECT_EQ(cov_x_r_generic_names.getCovariances()[0].value, covariance_labeled.getCovariances()[1].value);
 
-  EXPECT_EQ(cov_x_r_generic_names.correlation_coeffs[0].names.first, "block0_element0");
-  EXPECT_EQ(cov_x_r_generic_names.correlation_coeffs[0].names.second, "block1_element0");
-  EXPECT_EQ(cov_x_r_generic_names.correlation_coeffs[0].value, covariance_labeled.correlation_coeffs[1].value);
+  EXPECT_EQ(cov_x_r_generic_names.getCorrelationCoeffs()[0].names.first, "block0_element0");
+  EXPECT_EQ(cov_x_r_generic_names.getCorrelationCoeffs()[0].names.second, "block1_element0");
+  EXPECT_EQ(cov_x_r_generic_names.getCorrelationCoeffs()[0].value, covariance_labeled.getCorrelationCoeffs()[1].value);
 
   rct_optimizations::CovarianceResult cov_x_r_labeled = rct_optimizations::computeCovariance(problem, param_blocks_x_r, labels_x_r);
 
-  EXPECT_EQ(cov_x_r_labeled.standard_deviations.size(), 2);
-  EXPECT_EQ(cov_x_r_labeled.covariances.size(), 1);
-  EXPECT_EQ(cov_x_r_labeled.correlation_coeffs.size(), 1);
+  EXPECT_EQ(cov_x_r_labeled.getStandardDeviations().size(), 2);
+  EXPECT_EQ(cov_x_r_labeled.getCovariances().size(), 1);
+  EXPECT_EQ(cov_x_r_labeled.getCorrelationCoeffs().size(), 1);
 
-  EXPECT_EQ(cov_x_r_labeled.standard_deviations[0].names.first, covariance_labeled.standard_deviations[0].names.first);
-  EXPECT_EQ(cov_x_r_labeled.standard_deviations[0].value, covariance_labeled.standard_deviations[0].value);
+  EXPECT_EQ(cov_x_r_labeled.getStandardDeviations()[0].names.first, covariance_labeled.getStandardDeviations()[0].names.first);
+  EXPECT_EQ(cov_x_r_labeled.getStandardDeviations()[0].value, covariance_labeled.getStandardDeviations()[0].value);
 
-  EXPECT_EQ(cov_x_r_labeled.standard_deviations[1].names.first, covariance_labeled.standard_deviations[2].names.first);
-  EXPECT_EQ(cov_x_r_labeled.standard_deviations[1].value, covariance_labeled.standard_deviations[2].value);
+  EXPECT_EQ(cov_x_r_labeled.getStandardDeviations()[1].names.first, covariance_labeled.getStandardDeviations()[2].names.first);
+  EXPECT_EQ(cov_x_r_labeled.getStandardDeviations()[1].value, covariance_labeled.getStandardDeviations()[2].value);
 
-  EXPECT_EQ(cov_x_r_labeled.covariances[0].names.first, covariance_labeled.covariances[1].names.first);
-  EXPECT_EQ(cov_x_r_labeled.covariances[0].names.second, covariance_labeled.covariances[1].names.second);
-  EXPECT_EQ(cov_x_r_labeled.covariances[0].value, covariance_labeled.covariances[1].value);
+  EXPECT_EQ(cov_x_r_labeled.getCovariances()[0].names.first, covariance_labeled.getCovariances()[1].names.first);
+  EXPECT_EQ(cov_x_r_labeled.getCovariances()[0].names.second, covariance_labeled.getCovariances()[1].names.second);
+  EXPECT_EQ(cov_x_r_labeled.getCovariances()[0].value, covariance_labeled.getCovariances()[1].value);
 
-  EXPECT_EQ(cov_x_r_labeled.correlation_coeffs[0].names.first, covariance_labeled.correlation_coeffs[1].names.first);
-  EXPECT_EQ(cov_x_r_labeled.correlation_coeffs[0].names.second, covariance_labeled.correlation_coeffs[1].names.second);
-  EXPECT_EQ(cov_x_r_labeled.correlation_coeffs[0].value, covariance_labeled.correlation_coeffs[1].value);
+  EXPECT_EQ(cov_x_r_labeled.getCorrelationCoeffs()[0].names.first, covariance_labeled.getCorrelationCoeffs()[1].names.first);
+  EXPECT_EQ(cov_x_r_labeled.getCorrelationCoeffs()[0].names.second, covariance_labeled.getCorrelationCoeffs()[1].names.second);
+  EXPECT_EQ(cov_x_r_labeled.getCorrelationCoeffs()[0].value, covariance_labeled.getCorrelationCoeffs()[1].value);
 
   std::cout << "covariance_labeled\n" << covariance_labeled.toString() << std::endl;
   std::cout << "covariance_generic_names\n" <<  covariance_generic_names.toString() << std::endl;
@@ -643,6 +643,33 @@ TEST(CovarianceAnalysis, CovarianceAnalysisFunctions)
 
   // expect exception with empty labels vector
   EXPECT_THROW(rct_optimizations::computeCovariance(problem, param_blocks_x_r, std::map<const double*, std::vector<std::string>>()), rct_optimizations::CovarianceException);
+
+  // no covariance is computed in NONE mode
+  rct_optimizations::CovarianceResult cov_none = rct_optimizations::computeCovariance(problem,
+                                                                                     labels_all,
+                                                                                     std::map<const double *, std::vector<int>>(),
+                                                                                     rct_optimizations::DefaultCovarianceOptions(),
+                                                                                     rct_optimizations::CovarianceMode::NONE);
+  EXPECT_EQ(cov_none.covariance_matrix.size(), 0);
+  EXPECT_TRUE(cov_none.getStandardDeviations().empty());
+  EXPECT_TRUE(cov_none.getCovariances().empty());
+
+  // only the variances are computed in DIAGONAL mode
+  rct_optimizations::CovarianceResult cov_diagonal = rct_optimizations::computeCovariance(problem,
+                                                                                         labels_all,
+                                                                                         std::map<const double *, std::vector<int>>(),
+                                                                                         rct_optimizations::DefaultCovarianceOptions(),
+                                                                                         rct_optimizations::CovarianceMode::DIAGONAL);
+  ASSERT_EQ(cov_diagonal.covariance_matrix.rows(), 3);
+  ASSERT_EQ(cov_diagonal.covariance_matrix.cols(), 3);
+  EXPECT_TRUE(cov_diagonal.covariance_matrix.diagonal().isApprox(covariance_labeled.covariance_matrix.diagonal()));
+  EXPECT_DOUBLE_EQ((cov_diagonal.covariance_matrix - Eigen::MatrixXd(cov_diagonal.covariance_matrix.diagonal().asDiagonal())).norm(), 0.0);
+  ASSERT_EQ(cov_diagonal.getStandardDeviations().size(), 3);
+  for (std::size_t i = 0; i < 3; ++i)
+  {
+    EXPECT_EQ(cov_diagonal.getStandardDeviations()[i].names.first, covariance_labeled.getStandardDeviations()[i].names.first);
+    EXPECT_NEAR(cov_diagonal.getStandardDeviations()[i].value, covariance_labeled.getStandardDeviations()[i].value, 1e-12);
+  }
 }
 
 int main(int argc, char **argv)
@@ -1,4 +1,5 @@
 #include <rct_optimizations/dh_chain_kinematic_calibration.h>
+#include <rct_optimizations/dh_chain_kinematic_sliding_window.h>
 #include <rct_optimizations/local_parameterization.h>
 #include <rct_optimizations_tests/dh_chain_observation_creator.h>
 #include <rct_optimizations_tests/utilities.h>
@@ -336,6 +337,71 @@ TEST_F(DHChainMeasurementTest_PerturbedDH_PertubedGuess, PerturbedDHPerturbedGue
   analyzeResults(result);
 }
 
+TEST_F(DHChainMeasurementTest_PerturbedDH, SlidingWindow)
+{
+  // Solve the first measurements in batch, then stream the rest through the window
+  const std::size_t n_initial = 50;
+  const std::size_t window_size = 20;
+  KinematicMeasurement::Set stream(problem.observations.begin() + n_initial, problem.observations.end());
+  problem.observations.resize(n_initial);
+  problem.solver_options = options;
+  problem.solver_options.minimizer_progress_to_stdout = false;
+
+  KinematicCalibrationSlidingWindowPose6D window(problem, window_size, 1.0, orientation_weight);
+  EXPECT_EQ(window.numMeasurements(), window_size);
+  EXPECT_EQ(window.numMarginalizedMeasurements(), n_initial - window_size);
+
+  KinematicCalibrationResult result;
+  for (const KinematicMeasurement& measurement : stream)
+  {
+    result = window.update(measurement);
+
+    // Every update reports the DH offsets and their covariance
+    EXPECT_EQ(result.camera_chain_dh_offsets.rows(), problem.camera_chain.dof());
+    EXPECT_GT(result.covariance.covariance_matrix.rows(), 0);
+  }
+
+  EXPECT_EQ(window.numMeasurements(), window_size);
+  EXPECT_EQ(window.numMarginalizedMeasurements(), n_observations - window_size);
+  analyzeResults(result);
+
+  EXPECT_THROW(KinematicCalibrationSlidingWindowPose6D(problem, 0), OptimizationException);
+}
+
+TEST_F(DHChainMeasurementTest_PerturbedDH_PertubedGuess, MultiStart)
+{
+  problem.solver_options = options;
+  problem.solver_options.minimizer_progress_to_stdout = false;
+
+  MultiStartOptions multi_start_options;
+  multi_start_options.num_starts = 8;
+  multi_start_options.max_rotation = 0.2;
+  multi_start_options.max_translation = 0.05;
+  KinematicCalibrationMultiStartResult result = optimizeMultiStart(problem, multi_start_options, orientation_weight);
+  analyzeResults(result);
+
+  // The result is the converged start with the lowest cost
+  ASSERT_EQ(result.final_costs_per_obs.size(), multi_start_options.num_starts);
+  ASSERT_EQ(result.start_converged.size(), multi_start_options.num_starts);
+  EXPECT_TRUE(result.start_converged[result.best_start]);
+  EXPECT_DOUBLE_EQ(result.final_cost_per_obs, result.final_costs_per_obs[result.best_start]);
+  for (std::size_t i = 0; i < multi_start_options.num_starts; ++i)
+  {
+    if (result.start_converged[i])
+      EXPECT_LE(result.final_cost_per_obs, result.final_costs_per_obs[i]);
+  }
+
+  // The perturbations do not depend on the number of threads
+  multi_start_options.num_threads = 1;
+  const KinematicCalibrationMultiStartResult serial_result =
+      optimizeMultiStart(problem, multi_start_options, orientation_weight);
+  EXPECT_EQ(serial_result.best_start, result.best_start);
+  EXPECT_EQ(serial_result.start_converged, result.start_converged);
+
+  multi_start_options.num_starts = 0;
+  EXPECT_THROW(optimizeMultiStart(problem, multi_start_options, orientation_weight), OptimizationException);
+}
+
 int main(int argc, char **argv)
 {
   testing::InitGoogleTest(&argc, argv);
@@ -61,6 +61,90 @@ TEST(DHChain, FKWithJointSubsetTest)
   EXPECT_THROW(robot.getFK<double>(Eigen::VectorXd::Zero(robot.dof() + 1)), std::runtime_error);
 }
 
+TEST(DHChain, RandomPoseTest)
+{
+  // All joints of this chain share the same random seed
+  DHChain robot = test::createABBIRB2400();
+
+  const Eigen::VectorXd pose_1 = robot.createUniformlyRandomPose();
+  const Eigen::VectorXd pose_2 = robot.createUniformlyRandomPose();
+  ASSERT_EQ(pose_1.size(), static_cast<Eigen::Index>(robot.dof()));
+
+  // Consecutive poses should be different
+  EXPECT_FALSE(pose_1.isApprox(pose_2));
+
+  // Joints with the same seed and limits should not produce the same values
+  for (Eigen::Index i = 1; i < pose_1.size(); ++i)
+  {
+    EXPECT_NE(pose_1[0], pose_1[i]);
+  }
+}
+
+/**
+ * @brief Creates a copy of a chain whose transforms all use the input random seed
+ */
+DHChain createSeededChain(const DHChain& chain, const std::size_t seed)
+{
+  const Eigen::MatrixX4d dh_table = chain.getDHTable();
+  const std::vector<DHJointType> joint_types = chain.getJointTypes();
+
+  std::vector<DHTransform> transforms;
+  for (std::size_t i = 0; i < chain.dof(); ++i)
+    transforms.emplace_back(dh_table.row(i).transpose(), joint_types[i], "j" + std::to_string(i + 1), seed);
+
+  return DHChain(transforms, chain.getBaseOffset());
+}
+
+TEST(DHChain, RandomPosesTest)
+{
+  const std::size_t n = 1000;
+
+  // Chains with the same seeds should produce identical poses, regardless of the number of threads
+  DHChain robot = test::createABBIRB2400();
+  DHChain same_seed_robot = test::createABBIRB2400();
+  const std::vector<Eigen::VectorXd> poses = robot.createUniformlyRandomPoses(n, 1);
+  const std::vector<Eigen::VectorXd> poses_parallel = same_seed_robot.createUniformlyRandomPoses(n, 4);
+  ASSERT_EQ(poses.size(), n);
+  ASSERT_EQ(poses_parallel.size(), n);
+
+  // The poses should be the same as those of consecutive calls to createUniformlyRandomPose
+  DHChain sequential_robot = test::createABBIRB2400();
+
+  for (std::size_t i = 0; i < n; ++i)
+  {
+    ASSERT_EQ(poses[i].size(), static_cast<Eigen::Index>(robot.dof()));
+    EXPECT_TRUE(poses[i] == poses_parallel[i]);
+    EXPECT_TRUE(poses[i] == sequential_robot.createUniformlyRandomPose());
+
+    // Check the joint limits
+    EXPECT_TRUE((poses[i].array() >= -M_PI).all());
+    EXPECT_TRUE((poses[i].array() < M_PI).all());
+  }
+
+  // Subsequent poses should continue the sequence rather than repeat it
+  const Eigen::VectorXd next_pose = robot.createUniformlyRandomPose();
+  EXPECT_TRUE(next_pose == same_seed_robot.createUniformlyRandomPoses(1).front());
+  EXPECT_FALSE(next_pose.isApprox(poses.front()));
+
+  // The poses should be uniformly distributed with a mean of ~0 and a variance of ~(2 * pi)^2 / 12
+  Eigen::VectorXd mean = Eigen::VectorXd::Zero(robot.dof());
+  for (const Eigen::VectorXd& pose : poses)
+    mean += pose;
+  mean /= static_cast<double>(n);
+
+  Eigen::VectorXd variance = Eigen::VectorXd::Zero(robot.dof());
+  for (const Eigen::VectorXd& pose : poses)
+    variance += (pose - mean).array().square().matrix();
+  variance /= static_cast<double>(n - 1);
+
+  EXPECT_LT(mean.cwiseAbs().maxCoeff(), 0.25);
+  EXPECT_LT((variance.array() - std::pow(2.0 * M_PI, 2.0) / 12.0).abs().maxCoeff(), 0.5);
+
+  // A different seed should produce different poses
+  DHChain other_robot = createSeededChain(test::createABBIRB2400(), RCT_RANDOM_SEED + 1);
+  EXPECT_FALSE(other_robot.createUniformlyRandomPoses(1).front().isApprox(poses.front()));
+}
+
 TEST(DHChain, generateObservations3D)
 {
   const std::size_t n = 100;
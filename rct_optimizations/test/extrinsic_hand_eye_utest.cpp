@@ -1,10 +1,14 @@
 #include <gtest/gtest.h>
 #include <rct_optimizations/extrinsic_hand_eye.h>
+#include <rct_optimizations/extrinsic_hand_eye_incremental.h>
+#include <rct_optimizations/extrinsic_hand_eye_initialization.h>
 #include <rct_optimizations/ceres_math_utilities.h>
+#include <rct_optimizations/ransac.h>
 
 // Test utilities
 #include <rct_optimizations_tests/utilities.h>
 #include <rct_optimizations_tests/observation_creator.h>
+#include <algorithm>
 #include <memory>
 
 using namespace rct_optimizations;
@@ -185,9 +189,9 @@ TYPED_TEST(HandEyeTest, PerfectInitialConditions)
 
   EXPECT_EQ(result.covariance.covariance_matrix.rows(), 12);
   EXPECT_EQ(result.covariance.covariance_matrix.cols(), 12);
-  EXPECT_EQ(result.covariance.standard_deviations.size(), 12);
-  EXPECT_EQ(result.covariance.covariances.size(), 66);
-  EXPECT_EQ(result.covariance.correlation_coeffs.size(), 66);
+  EXPECT_EQ(result.covariance.getStandardDeviations().size(), 12);
+  EXPECT_EQ(result.covariance.getCovariances().size(), 66);
+  EXPECT_EQ(result.covariance.getCorrelationCoeffs().size(), 66);
 
   this->printResults(result);
 }
@@ -233,9 +237,9 @@ TYPED_TEST(HandEyeTest, RandomAroundAnswerInitialConditions)
 
     EXPECT_EQ(result.covariance.covariance_matrix.rows(), 12);
     EXPECT_EQ(result.covariance.covariance_matrix.cols(), 12);
-    EXPECT_EQ(result.covariance.standard_deviations.size(), 12);
-    EXPECT_EQ(result.covariance.covariances.size(), 66);
-    EXPECT_EQ(result.covariance.correlation_coeffs.size(), 66);
+    EXPECT_EQ(result.covariance.getStandardDeviations().size(), 12);
+    EXPECT_EQ(result.covariance.getCovariances().size(), 66);
+    EXPECT_EQ(result.covariance.getCorrelationCoeffs().size(), 66);
 
     this->printResults(result);
   }
@@ -290,9 +294,9 @@ TYPED_TEST(HandEyeTest, RandomAroundAnswerInitialConditions_MoreHemispheres)
 
     EXPECT_EQ(result.covariance.covariance_matrix.rows(), 12);
     EXPECT_EQ(result.covariance.covariance_matrix.cols(), 12);
-    EXPECT_EQ(result.covariance.standard_deviations.size(), 12);
-    EXPECT_EQ(result.covariance.covariances.size(), 66);
-    EXPECT_EQ(result.covariance.correlation_coeffs.size(), 66);
+    EXPECT_EQ(result.covariance.getStandardDeviations().size(), 12);
+    EXPECT_EQ(result.covariance.getCovariances().size(), 66);
+    EXPECT_EQ(result.covariance.getCorrelationCoeffs().size(), 66);
 
     this->printResults(result);
   }
@@ -300,6 +304,330 @@ TYPED_TEST(HandEyeTest, RandomAroundAnswerInitialConditions_MoreHemispheres)
   EXPECT_LT(count, max_attempts);
 }
 
+TEST(HandEyeInitialization, SolveAXXB)
+{
+  Eigen::Isometry3d x(Eigen::AngleAxisd(1.0, Eigen::Vector3d(1.0, -2.0, 0.5).normalized()));
+  x.translation() = Eigen::Vector3d(0.1, -0.2, 0.3);
+
+  // Create motions about different axes
+  std::vector<Eigen::Isometry3d> a, b;
+  for (std::size_t i = 0; i < 10; ++i)
+  {
+    const double v = static_cast<double>(i);
+    Eigen::Isometry3d motion(Eigen::AngleAxisd(0.2 + 0.1 * v, Eigen::Vector3d(std::cos(v), std::sin(v), 0.5).normalized()));
+    motion.translation() = Eigen::Vector3d(0.1 * v, -0.05 * v, 0.5);
+    b.push_back(motion);
+    a.push_back(x * motion * x.inverse());
+  }
+
+  EXPECT_TRUE(solveAXXB(a, b).isApprox(x, 1.0e-8));
+
+  // Motions about a single axis do not constrain X
+  std::vector<Eigen::Isometry3d> a_degenerate, b_degenerate;
+  for (std::size_t i = 1; i < 5; ++i)
+  {
+    Eigen::Isometry3d motion(Eigen::AngleAxisd(0.2 * static_cast<double>(i), Eigen::Vector3d::UnitZ()));
+    motion.translation() = Eigen::Vector3d(0.1 * static_cast<double>(i), 0.0, 0.0);
+    b_degenerate.push_back(motion);
+    a_degenerate.push_back(x * motion * x.inverse());
+  }
+  EXPECT_THROW(solveAXXB(a_degenerate, b_degenerate), std::runtime_error);
+
+  // Mismatched inputs
+  EXPECT_THROW(solveAXXB(a, b_degenerate), std::runtime_error);
+}
+
+TEST(HandEyeInitialization, InitializeGuesses2D3D)
+{
+  Eigen::Isometry3d true_target_mount_to_target(Eigen::Isometry3d::Identity());
+  true_target_mount_to_target.translate(Eigen::Vector3d(1.0, 0, 0.0));
+
+  Eigen::Isometry3d true_camera_mount_to_camera(Eigen::Isometry3d::Identity());
+  true_camera_mount_to_camera.translation() = Eigen::Vector3d(0.05, 0, 0.1);
+  true_camera_mount_to_camera.linear() << 0, 0, 1, -1, 0, 0, 0, -1, 0;
+
+  auto pg = std::make_shared<test::HemispherePoseGenerator>();
+  ExtrinsicHandEyeProblem2D3D prob = ProblemCreator<ExtrinsicHandEyeProblem2D3D>::createProblem(true_target_mount_to_target,
+                                                                                                true_camera_mount_to_camera,
+                                                                                                pg,
+                                                                                                test::Target(5, 7, 0.025),
+                                                                                                InitialConditions::PERFECT);
+
+  // Start without any knowledge of the transforms
+  prob.target_mount_to_target_guess = Eigen::Isometry3d::Identity();
+  prob.camera_mount_to_camera_guess = Eigen::Isometry3d::Identity();
+  ASSERT_NO_THROW(initializeGuesses(prob));
+
+  // The closed-form estimate should be exact for noise-free observations
+  EXPECT_TRUE(prob.target_mount_to_target_guess.isApprox(true_target_mount_to_target, 1.0e-6));
+  EXPECT_TRUE(prob.camera_mount_to_camera_guess.isApprox(true_camera_mount_to_camera, 1.0e-6));
+
+  ExtrinsicHandEyeResult result;
+  ASSERT_NO_THROW(result = optimize(prob));
+  EXPECT_TRUE(result.converged);
+  EXPECT_LT(result.initial_cost_per_obs, 1.0e-10);
+  EXPECT_TRUE(result.target_mount_to_target.isApprox(true_target_mount_to_target, 1e-6));
+  EXPECT_TRUE(result.camera_mount_to_camera.isApprox(true_camera_mount_to_camera, 1e-6));
+}
+
+TEST(HandEyeInitialization, InitializeGuesses3D3D)
+{
+  Eigen::Isometry3d true_target_mount_to_target(Eigen::Isometry3d::Identity());
+  true_target_mount_to_target.translate(Eigen::Vector3d(1.0, 0, 0.0));
+
+  Eigen::Isometry3d true_camera_mount_to_camera(Eigen::Isometry3d::Identity());
+  true_camera_mount_to_camera.translation() = Eigen::Vector3d(0.05, 0, 0.1);
+  true_camera_mount_to_camera.linear() << 0, 0, 1, -1, 0, 0, 0, -1, 0;
+
+  auto pg = std::make_shared<test::HemispherePoseGenerator>();
+  ExtrinsicHandEyeProblem3D3D prob = ProblemCreator<ExtrinsicHandEyeProblem3D3D>::createProblem(true_target_mount_to_target,
+                                                                                                true_camera_mount_to_camera,
+                                                                                                pg,
+                                                                                                test::Target(5, 7, 0.025),
+                                                                                                InitialConditions::PERFECT);
+
+  // Start without any knowledge of the transforms
+  prob.target_mount_to_target_guess = Eigen::Isometry3d::Identity();
+  prob.camera_mount_to_camera_guess = Eigen::Isometry3d::Identity();
+  ASSERT_NO_THROW(initializeGuesses(prob));
+
+  // The closed-form estimate should be exact for noise-free observations
+  EXPECT_TRUE(prob.target_mount_to_target_guess.isApprox(true_target_mount_to_target, 1.0e-6));
+  EXPECT_TRUE(prob.camera_mount_to_camera_guess.isApprox(true_camera_mount_to_camera, 1.0e-6));
+
+  ExtrinsicHandEyeResult result;
+  ASSERT_NO_THROW(result = optimize(prob));
+  EXPECT_TRUE(result.converged);
+  EXPECT_LT(result.initial_cost_per_obs, 1.0e-12);
+  EXPECT_TRUE(result.target_mount_to_target.isApprox(true_target_mount_to_target, 1e-6));
+  EXPECT_TRUE(result.camera_mount_to_camera.isApprox(true_camera_mount_to_camera, 1e-6));
+}
+
+TEST(HandEyeRansac, RejectOutlierObservations)
+{
+  Eigen::Isometry3d true_target_mount_to_target(Eigen::Isometry3d::Identity());
+  true_target_mount_to_target.translate(Eigen::Vector3d(1.0, 0, 0.0));
+
+  Eigen::Isometry3d true_camera_mount_to_camera(Eigen::Isometry3d::Identity());
+  true_camera_mount_to_camera.translation() = Eigen::Vector3d(0.05, 0, 0.1);
+  true_camera_mount_to_camera.linear() << 0, 0, 1, -1, 0, 0, 0, -1, 0;
+
+  auto pg = std::make_shared<test::HemispherePoseGenerator>();
+  ExtrinsicHandEyeProblem2D3D prob = ProblemCreator<ExtrinsicHandEyeProblem2D3D>::createProblem(true_target_mount_to_target,
+                                                                                                true_camera_mount_to_camera,
+                                                                                                pg,
+                                                                                                test::Target(5, 7, 0.025),
+                                                                                                InitialConditions::PERFECT);
+
+  // Observations without correspondences cannot be scored, so remove them from the problem
+  prob.observations.erase(std::remove_if(prob.observations.begin(),
+                                         prob.observations.end(),
+                                         [](const Observation2D3D &obs) { return obs.correspondence_set.empty(); }),
+                          prob.observations.end());
+
+  // Corrupt two observations that see the entire target
+  std::vector<std::size_t> corrupted;
+  for (std::size_t i = 0; i < prob.observations.size() && corrupted.size() < 2; ++i)
+  {
+    if (prob.observations[i].correspondence_set.size() == 35)
+      corrupted.push_back(i);
+  }
+  ASSERT_EQ(corrupted.size(), 2);
+
+  // Detect the target features in the reverse order (i.e. as if the target were rotated by 180 degrees)
+  Correspondence2D3D::Set &reversed = prob.observations[corrupted[0]].correspondence_set;
+  for (std::size_t i = 0; i < reversed.size() / 2; ++i)
+    std::swap(reversed[i].in_target, reversed[reversed.size() - 1 - i].in_target);
+
+  // Record the wrong robot pose
+  prob.observations[corrupted[1]].to_target_mount.translate(Eigen::Vector3d(0.1, 0.0, 0.0));
+
+  // Start without any knowledge of the transforms
+  prob.target_mount_to_target_guess = Eigen::Isometry3d::Identity();
+  prob.camera_mount_to_camera_guess = Eigen::Isometry3d::Identity();
+
+  RansacOptions options;
+  options.max_iterations = 100;
+
+  ExtrinsicHandEyeRansacResult result;
+  ASSERT_NO_THROW(result = optimizeRansac(prob, options));
+  EXPECT_EQ(result.rejected_observations, corrupted);
+  EXPECT_EQ(result.inlier_observations.size() + corrupted.size(), prob.observations.size());
+  EXPECT_TRUE(result.converged);
+  EXPECT_LT(result.initial_cost_per_obs, 1.0e-10);
+  EXPECT_TRUE(result.target_mount_to_target.isApprox(true_target_mount_to_target, 1e-6));
+  EXPECT_TRUE(result.camera_mount_to_camera.isApprox(true_camera_mount_to_camera, 1e-6));
+
+  // The result should not depend on the number of threads
+  options.num_threads = 1;
+  ExtrinsicHandEyeRansacResult single_threaded_result = optimizeRansac(prob, options);
+  EXPECT_EQ(single_threaded_result.inlier_observations, result.inlier_observations);
+}
+
+TEST(HandEyeIncremental, AddObservations)
+{
+  Eigen::Isometry3d true_target_mount_to_target(Eigen::Isometry3d::Identity());
+  true_target_mount_to_target.translate(Eigen::Vector3d(1.0, 0, 0.0));
+
+  Eigen::Isometry3d true_camera_mount_to_camera(Eigen::Isometry3d::Identity());
+  true_camera_mount_to_camera.translation() = Eigen::Vector3d(0.05, 0, 0.1);
+  true_camera_mount_to_camera.linear() << 0, 0, 1, -1, 0, 0, 0, -1, 0;
+
+  auto pg = std::make_shared<test::HemispherePoseGenerator>();
+  ExtrinsicHandEyeProblem2D3D prob = ProblemCreator<ExtrinsicHandEyeProblem2D3D>::createProblem(true_target_mount_to_target,
+                                                                                                true_camera_mount_to_camera,
+                                                                                                pg,
+                                                                                                test::Target(5, 7, 0.025),
+                                                                                                InitialConditions::PERFECT);
+  prob.observations.erase(std::remove_if(prob.observations.begin(),
+                                         prob.observations.end(),
+                                         [](const Observation2D3D &obs) { return obs.correspondence_set.empty(); }),
+                          prob.observations.end());
+  prob.target_mount_to_target_guess = test::perturbPose(true_target_mount_to_target, 0.01, 0.05);
+  prob.camera_mount_to_camera_guess = test::perturbPose(true_camera_mount_to_camera, 0.01, 0.05);
+  prob.covariance_mode = CovarianceMode::NONE;
+
+  // Start the calibration with the first few observations
+  const Observation2D3D::Set all_observations = prob.observations;
+  const std::size_t n_initial = 4;
+  ASSERT_GT(all_observations.size(), n_initial + 1);
+  prob.observations.resize(n_initial);
+
+  ExtrinsicHandEyeIncremental2D3D calibration(prob, 5);
+  EXPECT_EQ(calibration.numObservations(), n_initial);
+  ExtrinsicHandEyeResult result = calibration.solve();
+  EXPECT_TRUE(result.converged);
+
+  // An observation whose target features lie behind the camera at the current solution should not be added
+  Observation2D3D behind = all_observations[n_initial];
+  const Eigen::Isometry3d base_to_camera = behind.to_camera_mount * true_camera_mount_to_camera;
+  behind.to_camera_mount = base_to_camera * Eigen::AngleAxisd(M_PI, Eigen::Vector3d::UnitX())
+                           * true_camera_mount_to_camera.inverse();
+  EXPECT_THROW(calibration.addObservations({ all_observations[n_initial], behind }), std::runtime_error);
+  EXPECT_EQ(calibration.numObservations(), n_initial);
+
+  // Add the remaining observations and re-solve from the previous solution
+  calibration.addObservations(Observation2D3D::Set(all_observations.begin() + n_initial, all_observations.end()));
+  EXPECT_EQ(calibration.numObservations(), all_observations.size());
+  result = calibration.solve();
+  EXPECT_TRUE(result.final_cost_per_obs < ProblemCreator<ExtrinsicHandEyeProblem2D3D>::max_cost_per_obs);
+  EXPECT_TRUE(result.target_mount_to_target.isApprox(true_target_mount_to_target, 1e-6));
+  EXPECT_TRUE(result.camera_mount_to_camera.isApprox(true_camera_mount_to_camera, 1e-6));
+  EXPECT_TRUE(calibration.getCameraMountToCamera().isApprox(result.camera_mount_to_camera));
+
+  // The incremental result should match the batch optimization of all of the observations
+  prob.observations = all_observations;
+  const ExtrinsicHandEyeResult batch_result = optimize(prob);
+  EXPECT_TRUE(result.target_mount_to_target.isApprox(batch_result.target_mount_to_target, 1e-6));
+  EXPECT_TRUE(result.camera_mount_to_camera.isApprox(batch_result.camera_mount_to_camera, 1e-6));
+
+  // A calibration without observations cannot be solved
+  prob.observations.clear();
+  ExtrinsicHandEyeIncremental2D3D empty_calibration(prob);
+  EXPECT_THROW(empty_calibration.solve(), OptimizationException);
+}
+
+TEST(HandEyeIncremental, SlidingWindow)
+{
+  Eigen::Isometry3d true_target_mount_to_target(Eigen::Isometry3d::Identity());
+  true_target_mount_to_target.translate(Eigen::Vector3d(1.0, 0, 0.0));
+
+  Eigen::Isometry3d true_camera_mount_to_camera(Eigen::Isometry3d::Identity());
+  true_camera_mount_to_camera.translation() = Eigen::Vector3d(0.05, 0, 0.1);
+  true_camera_mount_to_camera.linear() << 0, 0, 1, -1, 0, 0, 0, -1, 0;
+
+  auto pg = std::make_shared<test::HemispherePoseGenerator>();
+  ExtrinsicHandEyeProblem2D3D prob = ProblemCreator<ExtrinsicHandEyeProblem2D3D>::createProblem(true_target_mount_to_target,
+                                                                                                true_camera_mount_to_camera,
+                                                                                                pg,
+                                                                                                test::Target(5, 7, 0.025),
+                                                                                                InitialConditions::PERFECT);
+  prob.observations.erase(std::remove_if(prob.observations.begin(),
+                                         prob.observations.end(),
+                                         [](const Observation2D3D &obs) { return obs.correspondence_set.empty(); }),
+                          prob.observations.end());
+  prob.target_mount_to_target_guess = test::perturbPose(true_target_mount_to_target, 0.01, 0.05);
+  prob.camera_mount_to_camera_guess = test::perturbPose(true_camera_mount_to_camera, 0.01, 0.05);
+  prob.covariance_mode = CovarianceMode::NONE;
+
+  // Initialize the estimator with more observations than fit in the window
+  const std::size_t window_size = 4;
+  const std::size_t n_initial = 6;
+  const Observation2D3D::Set all_observations = prob.observations;
+  ASSERT_GT(all_observations.size(), n_initial + window_size);
+  prob.observations.resize(n_initial);
+
+  EXPECT_THROW(ExtrinsicHandEyeSlidingWindow2D3D(prob, 0), OptimizationException);
+
+  ExtrinsicHandEyeSlidingWindow2D3D estimator(prob, window_size);
+  EXPECT_EQ(estimator.numObservations(), window_size);
+  EXPECT_EQ(estimator.numMarginalizedObservations(), n_initial - window_size);
+
+  // Stream the remaining observations; the window size stays fixed and the marginalized observations remain in the prior
+  ExtrinsicHandEyeResult result;
+  for (std::size_t i = n_initial; i < all_observations.size(); ++i)
+  {
+    result = estimator.update(all_observations[i]);
+    EXPECT_EQ(estimator.numObservations(), window_size);
+    EXPECT_EQ(estimator.numMarginalizedObservations(), i + 1 - window_size);
+  }
+
+  EXPECT_TRUE(result.final_cost_per_obs < ProblemCreator<ExtrinsicHandEyeProblem2D3D>::max_cost_per_obs);
+  EXPECT_TRUE(result.target_mount_to_target.isApprox(true_target_mount_to_target, 1e-6));
+  EXPECT_TRUE(result.camera_mount_to_camera.isApprox(true_camera_mount_to_camera, 1e-6));
+  EXPECT_TRUE(estimator.getCameraMountToCamera().isApprox(result.camera_mount_to_camera));
+
+  // Observations without correspondences do not change the window
+  Observation2D3D empty = all_observations.front();
+  empty.correspondence_set.clear();
+  EXPECT_NO_THROW(estimator.update(empty));
+  EXPECT_EQ(estimator.numObservations(), window_size);
+  EXPECT_EQ(estimator.numMarginalizedObservations(), all_observations.size() - window_size);
+}
+
+TEST(HandEyeIncremental, SlidingWindowRotationNearPi)
+{
+  Eigen::Isometry3d true_target_mount_to_target(Eigen::Isometry3d::Identity());
+  true_target_mount_to_target.translate(Eigen::Vector3d(1.0, 0, 0.0));
+
+  // The angle-axis representation of the camera pose wraps around within the perturbation of the guess
+  Eigen::Isometry3d true_camera_mount_to_camera(Eigen::Isometry3d::Identity());
+  true_camera_mount_to_camera.translation() = Eigen::Vector3d(0.05, 0, 0.1);
+  true_camera_mount_to_camera.linear() = Eigen::AngleAxisd(M_PI - 0.01, Eigen::Vector3d(1.0, 1.0, 0.0).normalized()).toRotationMatrix();
+
+  auto pg = std::make_shared<test::HemispherePoseGenerator>();
+  ExtrinsicHandEyeProblem2D3D prob = ProblemCreator<ExtrinsicHandEyeProblem2D3D>::createProblem(true_target_mount_to_target,
+                                                                                                true_camera_mount_to_camera,
+                                                                                                pg,
+                                                                                                test::Target(5, 7, 0.025),
+                                                                                                InitialConditions::PERFECT);
+  prob.observations.erase(std::remove_if(prob.observations.begin(),
+                                         prob.observations.end(),
+                                         [](const Observation2D3D &obs) { return obs.correspondence_set.empty(); }),
+                          prob.observations.end());
+  prob.target_mount_to_target_guess = test::perturbPose(true_target_mount_to_target, 0.01, 0.05);
+  prob.camera_mount_to_camera_guess = test::perturbPose(true_camera_mount_to_camera, 0.01, 0.05);
+  prob.covariance_mode = CovarianceMode::NONE;
+
+  // The sliding window ignores the manifold parameterization, which is incompatible with its prior on the angle-axis values
+  prob.pose_parameterization = PoseParameterization::MANIFOLD;
+
+  const std::size_t window_size = 4;
+  const Observation2D3D::Set all_observations = prob.observations;
+  ASSERT_GT(all_observations.size(), 2 * window_size);
+  prob.observations.resize(window_size);
+
+  ExtrinsicHandEyeSlidingWindow2D3D estimator(prob, window_size);
+  ExtrinsicHandEyeResult result;
+  for (std::size_t i = window_size; i < all_observations.size(); ++i)
+    result = estimator.update(all_observations[i]);
+
+  EXPECT_EQ(estimator.numMarginalizedObservations(), all_observations.size() - window_size);
+  EXPECT_TRUE(result.final_cost_per_obs < ProblemCreator<ExtrinsicHandEyeProblem2D3D>::max_cost_per_obs);
+  EXPECT_TRUE(result.target_mount_to_target.isApprox(true_target_mount_to_target, 1e-6));
+  EXPECT_TRUE(result.camera_mount_to_camera.isApprox(true_camera_mount_to_camera, 1e-6));
+}
+
 int main(int argc, char **argv)
 {
   testing::InitGoogleTest(&argc, argv);
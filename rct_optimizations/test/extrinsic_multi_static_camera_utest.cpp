@@ -1,6 +1,7 @@
 #include <gtest/gtest.h>
 #include <rct_optimizations/extrinsic_multi_static_camera.h>
 #include <rct_optimizations/ceres_math_utilities.h>
+#include <rct_optimizations/ransac.h>
 #include <rct_optimizations_tests/utilities.h>
 #include <rct_optimizations_tests/observation_creator.h>
 
@@ -159,9 +160,9 @@ TEST(ExtrinsicMultiStaticCamera, single_camera)
   EXPECT_EQ(opt_result.covariance.covariance_matrix.cols(), 12);
   EXPECT_EQ(opt_result.covariance.correlation_matrix.rows(), 12);
   EXPECT_EQ(opt_result.covariance.correlation_matrix.cols(), 12);
-  EXPECT_EQ(opt_result.covariance.standard_deviations.size(), 12);
-  EXPECT_EQ(opt_result.covariance.covariances.size(), 66);
-  EXPECT_EQ(opt_result.covariance.correlation_coeffs.size(), 66);
+  EXPECT_EQ(opt_result.covariance.getStandardDeviations().size(), 12);
+  EXPECT_EQ(opt_result.covariance.getCovariances().size(), 66);
+  EXPECT_EQ(opt_result.covariance.getCorrelationCoeffs().size(), 66);
 
   printResults(opt_result);
 }
@@ -249,13 +250,132 @@ TEST(ExtrinsicMultiStaticCamera, two_cameras)
   EXPECT_EQ(opt_result.covariance.covariance_matrix.cols(), 18);
   EXPECT_EQ(opt_result.covariance.correlation_matrix.rows(), 18);
   EXPECT_EQ(opt_result.covariance.correlation_matrix.cols(), 18);
-  EXPECT_EQ(opt_result.covariance.standard_deviations.size(), 18);
-  EXPECT_EQ(opt_result.covariance.covariances.size(), 153);
-  EXPECT_EQ(opt_result.covariance.correlation_coeffs.size(), 153);
+  EXPECT_EQ(opt_result.covariance.getStandardDeviations().size(), 18);
+  EXPECT_EQ(opt_result.covariance.getCovariances().size(), 153);
+  EXPECT_EQ(opt_result.covariance.getCorrelationCoeffs().size(), 153);
 
   printResults(opt_result);
 }
 
+TEST(ExtrinsicMultiStaticCamera, ransac)
+{
+  ExtrinsicMultiStaticCameraMovingTargetProblem problem_def;
+
+  // Create a target
+  test::Target target(5, 5, 0.015);
+
+  // Create the wrist to target transform
+  Eigen::Isometry3d wrist_to_target = Eigen::Isometry3d::Identity();
+  wrist_to_target.translation() = Eigen::Vector3d(0, 0, 0.25);
+
+  // Create the base to camera transforms
+  std::vector<Eigen::Isometry3d> base_to_camera;
+  base_to_camera.resize(2);
+  base_to_camera[0] = Eigen::Isometry3d(Eigen::AngleAxisd(M_PI, Eigen::Vector3d::UnitX()));
+  base_to_camera[0].translation() = Eigen::Vector3d(-0.1, 0, 2.0);
+  base_to_camera[1] = Eigen::Isometry3d(Eigen::AngleAxisd(M_PI, Eigen::Vector3d::UnitX()));
+  base_to_camera[1].translation() = Eigen::Vector3d(0.1, 0, 2.0);
+
+  // Set up the problem
+  problem_def.intr.resize(2);
+  problem_def.intr.at(0).fx() = 1411.0;
+  problem_def.intr.at(0).fy() = 1408.0;
+  problem_def.intr.at(0).cx() = 807.2;
+  problem_def.intr.at(0).cy() = 615.0;
+  problem_def.intr.at(1) = problem_def.intr.at(0);
+
+  problem_def.base_to_camera_guess.resize(problem_def.intr.size());
+  problem_def.base_to_camera_guess[0] = Eigen::Isometry3d(Eigen::AngleAxisd(M_PI + 0.01, Eigen::Vector3d::UnitX()));
+  problem_def.base_to_camera_guess[0].translation() = Eigen::Vector3d(-0.101, 0.001, 1.99);
+  problem_def.base_to_camera_guess[1] = Eigen::Isometry3d(Eigen::AngleAxisd(M_PI + 0.02, Eigen::Vector3d::UnitX()));
+  problem_def.base_to_camera_guess[1].translation() = Eigen::Vector3d(0.101, 0.001, 1.99);
+
+  problem_def.wrist_to_target_guess = Eigen::Isometry3d::Identity();
+  problem_def.wrist_to_target_guess.translation() = Eigen::Vector3d(0.001, 0.001, 0.26);
+  problem_def.covariance_mode = CovarianceMode::NONE;
+
+  // Add the observations
+  problem_def.wrist_poses.resize(problem_def.intr.size());
+  problem_def.image_observations.resize(problem_def.intr.size());
+
+  // Set up variables for observation generation
+  std::vector<Eigen::Vector3d> axes = {Eigen::Vector3d::UnitY(), Eigen::Vector3d::UnitX()};
+
+  // Generate observations for each camera
+  for (std::size_t i = 0; i < problem_def.intr.size(); ++i)
+  {
+    // Create the camera
+    test::Camera camera;
+    camera.intr = problem_def.intr.at(i);
+    camera.width = 1600;
+    camera.height = 1200;
+
+    // Generate various data by rotating about different axes
+    for(const auto& axis : axes)
+    {
+      auto tmp = addObservations(target, camera, base_to_camera.at(i), wrist_to_target, axis);
+
+      // Add the wrist poses to the problem
+      auto &poses = problem_def.wrist_poses.at(i);
+      poses.insert(poses.end(), tmp.wrist_poses.begin(), tmp.wrist_poses.end());
+
+      // Add the image_observations to the problem
+      auto &obs = problem_def.image_observations.at(i);
+      obs.insert(obs.end(), tmp.correspondences.begin(), tmp.correspondences.end());
+    }
+  }
+
+  // Corrupt an observation of the second camera that sees the entire target by detecting the target features in the
+  // reverse order (i.e. as if the target were rotated by 180 degrees)
+  std::vector<Correspondence2D3D::Set>& camera_observations = problem_def.image_observations[1];
+  std::size_t corrupted = camera_observations.size();
+  for (std::size_t i = 0; i < camera_observations.size(); ++i)
+  {
+    if (camera_observations[i].size() == 25)
+    {
+      corrupted = i;
+      break;
+    }
+  }
+  ASSERT_LT(corrupted + 1, camera_observations.size());
+
+  Correspondence2D3D::Set& reversed = camera_observations[corrupted];
+  for (std::size_t i = 0; i < reversed.size() / 2; ++i)
+    std::swap(reversed[i].in_target, reversed[reversed.size() - 1 - i].in_target);
+
+  RansacOptions options;
+  options.max_iterations = 100;
+
+  ExtrinsicMultiStaticCameraMovingTargetRansacResult result;
+  ASSERT_NO_THROW(result = optimizeRansac(problem_def, options));
+  ASSERT_EQ(result.rejected_observations.size(), 2);
+  EXPECT_TRUE(result.rejected_observations[0].empty());
+  EXPECT_EQ(result.rejected_observations[1], std::vector<std::size_t>{ corrupted });
+  EXPECT_EQ(result.inlier_observations[1].size() + 1, camera_observations.size());
+  EXPECT_TRUE(result.cameras_without_consensus.empty());
+
+  EXPECT_TRUE(result.converged);
+  EXPECT_LT(result.final_cost_per_obs, 1e-15);
+  EXPECT_TRUE(result.wrist_to_target.isApprox(wrist_to_target, 1e-8));
+  for (std::size_t c = 0; c < result.base_to_camera.size(); ++c)
+  {
+    EXPECT_TRUE(result.base_to_camera[c].isApprox(base_to_camera[c], 1e-8));
+  }
+
+  // A camera with too few observations to find a consensus keeps all of its observations and is reported
+  ExtrinsicMultiStaticCameraMovingTargetProblem few_observations(problem_def);
+  few_observations.wrist_poses[1] = { problem_def.wrist_poses[1][corrupted], problem_def.wrist_poses[1][corrupted + 1] };
+  few_observations.image_observations[1] = { camera_observations[corrupted], camera_observations[corrupted + 1] };
+  result = optimizeRansac(few_observations, options);
+  EXPECT_EQ(result.cameras_without_consensus, std::vector<std::size_t>{ 1 });
+  EXPECT_EQ(result.inlier_observations[1].size(), 2);
+  EXPECT_TRUE(result.rejected_observations[1].empty());
+
+  // The number of observations of each camera must match its number of wrist poses
+  few_observations.wrist_poses[1].pop_back();
+  EXPECT_THROW(optimizeRansac(few_observations, options), OptimizationException);
+}
+
 int main(int argc, char **argv)
 {
   testing::InitGoogleTest(&argc, argv);
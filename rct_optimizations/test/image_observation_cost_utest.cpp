@@ -0,0 +1,233 @@
+#include <rct_optimizations/image_observation_cost.h>
+#include <rct_optimizations/eigen_conversions.h>
+#include <rct_optimizations_tests/observation_creator.h>
+#include <rct_optimizations_tests/utilities.h>
+
+#include <ceres/autodiff_cost_function.h>
+#include <ceres/numeric_diff_cost_function.h>
+#include <gtest/gtest.h>
+
+using namespace rct_optimizations;
+
+class ImageObservationCostTest : public ::testing::Test
+{
+public:
+  ImageObservationCostTest()
+    : camera(test::makeKinectCamera())
+    , target(5, 7, 0.025)
+    , camera_to_a(test::perturbPose(Eigen::Isometry3d::Identity(), 0.1, 0.1))
+    , a(test::perturbPose(Eigen::Isometry3d::Identity(), 0.1, 0.1))
+    , a_to_b(test::perturbPose(Eigen::Isometry3d::Identity(), 0.1, 0.1))
+  {
+    // Place the center of the target 0.5m in front of the camera, facing the camera
+    Eigen::Isometry3d camera_to_target(Eigen::Isometry3d::Identity());
+    camera_to_target.translate(Eigen::Vector3d(0.0, 0.0, 0.5));
+    camera_to_target.rotate(Eigen::AngleAxisd(M_PI, Eigen::Vector3d::UnitX()));
+    camera_to_target.translate(-target.center);
+
+    // Solve for the pose B that completes the chain to the target
+    b = (camera_to_a * a * a_to_b).inverse() * camera_to_target;
+  }
+
+protected:
+  test::Camera camera;
+  test::Target target;
+  Eigen::Isometry3d camera_to_a;
+  Eigen::Isometry3d a;
+  Eigen::Isometry3d a_to_b;
+  Eigen::Isometry3d b;
+};
+
+TEST_F(ImageObservationCostTest, Residuals2D)
+{
+  const Eigen::Isometry3d camera_to_target = camera_to_a * a * a_to_b * b;
+  Correspondence2D3D::Set correspondences = test::getCorrespondences(Eigen::Isometry3d::Identity(),
+                                                                     camera_to_target,
+                                                                     camera,
+                                                                     target,
+                                                                     true);
+  ASSERT_EQ(correspondences.size(), target.points.size());
+
+  ImageObservationCost<2> cost(correspondences, camera.intr, camera_to_a, a_to_b);
+  ASSERT_EQ(cost.numResiduals(), static_cast<int>(2 * correspondences.size()));
+
+  // The residuals should be zero at the true poses
+  Pose6d pose_a = poseEigenToCal(a);
+  Pose6d pose_b = poseEigenToCal(b);
+  std::vector<double> residuals(cost.numResiduals());
+  ASSERT_TRUE(cost(pose_a.values.data(), pose_b.values.data(), residuals.data()));
+  for (double r : residuals)
+    EXPECT_NEAR(r, 0.0, 1.0e-8);
+
+  // The residuals of perturbed poses should match the projection of each point individually
+  const Eigen::Isometry3d a_perturbed = test::perturbPose(a, 0.01, 0.01);
+  const Eigen::Isometry3d b_perturbed = test::perturbPose(b, 0.01, 0.01);
+  pose_a = poseEigenToCal(a_perturbed);
+  pose_b = poseEigenToCal(b_perturbed);
+  ASSERT_TRUE(cost(pose_a.values.data(), pose_b.values.data(), residuals.data()));
+
+  for (std::size_t i = 0; i < correspondences.size(); ++i)
+  {
+    const Eigen::Vector3d camera_pt = camera_to_a * a_perturbed * a_to_b * b_perturbed * correspondences[i].in_target;
+    const Eigen::Vector2d expected = projectPoint(camera.intr, camera_pt) - correspondences[i].in_image;
+    EXPECT_NEAR(residuals[2 * i], expected.x(), 1.0e-8);
+    EXPECT_NEAR(residuals[2 * i + 1], expected.y(), 1.0e-8);
+  }
+
+  // The single pose parameter form should treat pose A as identity
+  ImageObservationCost<2> single_cost(correspondences, camera.intr, camera_to_a * a, a_to_b);
+  pose_b = poseEigenToCal(b);
+  ASSERT_TRUE(single_cost(pose_b.values.data(), residuals.data()));
+  for (double r : residuals)
+    EXPECT_NEAR(r, 0.0, 1.0e-8);
+
+  // All of the points should be in front of the camera
+  const Eigen::Matrix3Xd camera_points = single_cost.getTargetPointsInCamera(pose_b.values.data());
+  EXPECT_TRUE((camera_points.row(2).array() > 0.0).all());
+}
+
+TEST_F(ImageObservationCostTest, Residuals3D)
+{
+  const Eigen::Isometry3d camera_to_target = camera_to_a * a * a_to_b * b;
+  Correspondence3D3D::Set correspondences = test::getCorrespondences(Eigen::Isometry3d::Identity(),
+                                                                     camera_to_target,
+                                                                     target);
+
+  ImageObservationCost<3> cost(correspondences, camera_to_a, a_to_b);
+  ASSERT_EQ(cost.numResiduals(), static_cast<int>(3 * correspondences.size()));
+
+  const Eigen::Isometry3d a_perturbed = test::perturbPose(a, 0.01, 0.01);
+  const Eigen::Isometry3d b_perturbed = test::perturbPose(b, 0.01, 0.01);
+  const Pose6d pose_a = poseEigenToCal(a_perturbed);
+  const Pose6d pose_b = poseEigenToCal(b_perturbed);
+  std::vector<double> residuals(cost.numResiduals());
+  ASSERT_TRUE(cost(pose_a.values.data(), pose_b.values.data(), residuals.data()));
+
+  for (std::size_t i = 0; i < correspondences.size(); ++i)
+  {
+    const Eigen::Vector3d expected = camera_to_a * a_perturbed * a_to_b * b_perturbed * correspondences[i].in_target
+                                     - correspondences[i].in_image;
+    const Eigen::Map<const Eigen::Vector3d> actual(residuals.data() + 3 * i);
+    EXPECT_TRUE(actual.isApprox(expected, 1.0e-8));
+  }
+}
+
+TEST_F(ImageObservationCostTest, AutoDiffJacobians)
+{
+  const Eigen::Isometry3d camera_to_target = camera_to_a * a * a_to_b * b;
+  Correspondence2D3D::Set correspondences = test::getCorrespondences(Eigen::Isometry3d::Identity(),
+                                                                     camera_to_target,
+                                                                     camera,
+                                                                     target,
+                                                                     true);
+
+  auto* cost = new ImageObservationCost<2>(correspondences, camera.intr, camera_to_a, a_to_b);
+  const int n_residuals = cost->numResiduals();
+  ceres::AutoDiffCostFunction<ImageObservationCost<2>, ceres::DYNAMIC, 6, 6> autodiff(cost, n_residuals);
+
+  auto* numeric_cost = new ImageObservationCost<2>(correspondences, camera.intr, camera_to_a, a_to_b);
+  ceres::NumericDiffCostFunction<ImageObservationCost<2>, ceres::CENTRAL, ceres::DYNAMIC, 6, 6> numeric(
+    numeric_cost, ceres::TAKE_OWNERSHIP, n_residuals);
+
+  const Pose6d pose_a = poseEigenToCal(test::perturbPose(a, 0.01, 0.01));
+  const Pose6d pose_b = poseEigenToCal(test::perturbPose(b, 0.01, 0.01));
+  const double* parameters[2] = { pose_a.values.data(), pose_b.values.data() };
+
+  using JacobianMatrix = Eigen::Matrix<double, Eigen::Dynamic, 6, Eigen::RowMajor>;
+  Eigen::VectorXd ad_residuals(n_residuals), nd_residuals(n_residuals);
+  JacobianMatrix ad_jac_a(n_residuals, 6), ad_jac_b(n_residuals, 6), nd_jac_a(n_residuals, 6), nd_jac_b(n_residuals, 6);
+  double* ad_jacobians[2] = { ad_jac_a.data(), ad_jac_b.data() };
+  double* nd_jacobians[2] = { nd_jac_a.data(), nd_jac_b.data() };
+
+  ASSERT_TRUE(autodiff.Evaluate(parameters, ad_residuals.data(), ad_jacobians));
+  ASSERT_TRUE(numeric.Evaluate(parameters, nd_residuals.data(), nd_jacobians));
+
+  EXPECT_TRUE(ad_residuals.isApprox(nd_residuals));
+  EXPECT_LT((ad_jac_a - nd_jac_a).cwiseAbs().maxCoeff(), 1.0e-4 * ad_jac_a.cwiseAbs().maxCoeff());
+  EXPECT_LT((ad_jac_b - nd_jac_b).cwiseAbs().maxCoeff(), 1.0e-4 * ad_jac_b.cwiseAbs().maxCoeff());
+}
+
+template<Eigen::Index IMAGE_DIM>
+void compareAnalyticJacobians(const AnalyticImageObservationCost<IMAGE_DIM>& analytic,
+                              ceres::CostFunction& autodiff,
+                              const Pose6d& pose_a,
+                              const Pose6d& pose_b)
+{
+  const int n_residuals = analytic.num_residuals();
+  ASSERT_EQ(n_residuals, autodiff.num_residuals());
+
+  const double* parameters[2] = { pose_a.values.data(), pose_b.values.data() };
+
+  using JacobianMatrix = Eigen::Matrix<double, Eigen::Dynamic, 6, Eigen::RowMajor>;
+  Eigen::VectorXd an_residuals(n_residuals), ad_residuals(n_residuals);
+  JacobianMatrix an_jac_a(n_residuals, 6), an_jac_b(n_residuals, 6), ad_jac_a(n_residuals, 6), ad_jac_b(n_residuals, 6);
+  double* an_jacobians[2] = { an_jac_a.data(), an_jac_b.data() };
+  double* ad_jacobians[2] = { ad_jac_a.data(), ad_jac_b.data() };
+
+  ASSERT_TRUE(analytic.Evaluate(parameters, an_residuals.data(), an_jacobians));
+  ASSERT_TRUE(autodiff.Evaluate(parameters, ad_residuals.data(), ad_jacobians));
+
+  EXPECT_TRUE(an_residuals.isApprox(ad_residuals, 1.0e-12));
+  EXPECT_TRUE(an_jac_a.isApprox(ad_jac_a, 1.0e-10));
+  EXPECT_TRUE(an_jac_b.isApprox(ad_jac_b, 1.0e-10));
+
+  // Residuals only
+  Eigen::VectorXd residuals(n_residuals);
+  ASSERT_TRUE(analytic.Evaluate(parameters, residuals.data(), nullptr));
+  EXPECT_TRUE(residuals.isApprox(ad_residuals, 1.0e-12));
+
+  // Jacobian of only one of the parameter blocks
+  JacobianMatrix jac_b(n_residuals, 6);
+  double* partial_jacobians[2] = { nullptr, jac_b.data() };
+  ASSERT_TRUE(analytic.Evaluate(parameters, residuals.data(), partial_jacobians));
+  EXPECT_TRUE(jac_b.isApprox(ad_jac_b, 1.0e-10));
+}
+
+TEST_F(ImageObservationCostTest, AnalyticJacobians2D)
+{
+  const Eigen::Isometry3d camera_to_target = camera_to_a * a * a_to_b * b;
+  Correspondence2D3D::Set correspondences = test::getCorrespondences(Eigen::Isometry3d::Identity(),
+                                                                     camera_to_target,
+                                                                     camera,
+                                                                     target,
+                                                                     true);
+
+  AnalyticImageObservationCost<2> analytic(correspondences, camera.intr, camera_to_a, a_to_b);
+
+  auto* cost = new ImageObservationCost<2>(correspondences, camera.intr, camera_to_a, a_to_b);
+  ceres::AutoDiffCostFunction<ImageObservationCost<2>, ceres::DYNAMIC, 6, 6> autodiff(cost, cost->numResiduals());
+
+  compareAnalyticJacobians(analytic,
+                           autodiff,
+                           poseEigenToCal(test::perturbPose(a, 0.01, 0.01)),
+                           poseEigenToCal(test::perturbPose(b, 0.01, 0.01)));
+
+  // Check the small angle approximation of the rotation Jacobian with a zero rotation for pose A
+  Pose6d pose_a;
+  pose_a.values = {{ 0.0, 0.0, 0.0, 0.01, 0.0, 0.0 }};
+  compareAnalyticJacobians(analytic, autodiff, pose_a, poseEigenToCal(test::perturbPose(b, 0.01, 0.01)));
+}
+
+TEST_F(ImageObservationCostTest, AnalyticJacobians3D)
+{
+  const Eigen::Isometry3d camera_to_target = camera_to_a * a * a_to_b * b;
+  Correspondence3D3D::Set correspondences = test::getCorrespondences(Eigen::Isometry3d::Identity(),
+                                                                     camera_to_target,
+                                                                     target);
+
+  AnalyticImageObservationCost<3> analytic(correspondences, camera_to_a, a_to_b);
+
+  auto* cost = new ImageObservationCost<3>(correspondences, camera_to_a, a_to_b);
+  ceres::AutoDiffCostFunction<ImageObservationCost<3>, ceres::DYNAMIC, 6, 6> autodiff(cost, cost->numResiduals());
+
+  compareAnalyticJacobians(analytic,
+                           autodiff,
+                           poseEigenToCal(test::perturbPose(a, 0.01, 0.01)),
+                           poseEigenToCal(test::perturbPose(b, 0.01, 0.01)));
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
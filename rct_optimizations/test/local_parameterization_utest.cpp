@@ -5,6 +5,7 @@
 #include <ceres/dynamic_autodiff_cost_function.h>
 #include <ceres/solver.h>
 #include <gtest/gtest.h>
+#include <numeric>
 
 using namespace rct_optimizations;
 
@@ -90,6 +91,74 @@ TEST(LocalParameterizationTests, SubsetParameterization)
   EXPECT_LE(diff.row(0).abs().sum(), std::numeric_limits<double>::epsilon());
 }
 
+TEST(LocalParameterizationTests, AngleAxisPlus)
+{
+  // An orientation close to a rotation of pi, and an increment that rotates it past pi
+  const Eigen::AngleAxisd x_rotation(M_PI - 0.01, Eigen::Vector3d(1.0, 2.0, 3.0).normalized());
+  const Eigen::AngleAxisd delta_rotation(0.05, Eigen::Vector3d(3.0, 2.0, 1.0).normalized());
+  const Eigen::Vector3d x(x_rotation.angle() * x_rotation.axis());
+  const Eigen::Vector3d delta(delta_rotation.angle() * delta_rotation.axis());
+
+  // The increment is composed with the orientation, and the angle of the result stays within pi
+  Eigen::Vector3d x_plus_delta;
+  EXPECT_TRUE(AngleAxisPlus()(x.data(), delta.data(), x_plus_delta.data()));
+  EXPECT_LE(x_plus_delta.norm(), M_PI);
+
+  const Eigen::Matrix3d expected = (delta_rotation * x_rotation).toRotationMatrix();
+  const Eigen::Matrix3d actual = Eigen::AngleAxisd(x_plus_delta.norm(), x_plus_delta.normalized()).toRotationMatrix();
+  EXPECT_TRUE(actual.isApprox(expected, 1.0e-12));
+
+  // A zero increment does not change the orientation
+  const Eigen::Vector3d zero(Eigen::Vector3d::Zero());
+  EXPECT_TRUE(AngleAxisPlus()(x.data(), zero.data(), x_plus_delta.data()));
+  EXPECT_TRUE(x_plus_delta.isApprox(x, 1.0e-12));
+
+  // The translation of a pose is updated additively
+  Pose6d pose({ x(0), x(1), x(2), 1.0, 2.0, 3.0 });
+  const std::array<double, 6> pose_delta = { 0.0, 0.0, 0.0, 0.1, 0.2, 0.3 };
+  Pose6d pose_plus_delta;
+  EXPECT_TRUE(Pose6dPlus()(pose.values.data(), pose_delta.data(), pose_plus_delta.values.data()));
+  EXPECT_NEAR(pose_plus_delta.rx(), pose.rx(), 1.0e-12);
+  EXPECT_NEAR(pose_plus_delta.x(), 1.1, 1.0e-12);
+  EXPECT_NEAR(pose_plus_delta.y(), 2.2, 1.0e-12);
+  EXPECT_NEAR(pose_plus_delta.z(), 3.3, 1.0e-12);
+}
+
+TEST(LocalParameterizationTests, PoseParameterization)
+{
+  Pose6d pose;
+  Eigen::Vector3d angle_axis(Eigen::Vector3d::Zero());
+  Eigen::Vector3d masked_angle_axis(Eigen::Vector3d::Zero());
+
+  ceres::Problem problem;
+  problem.AddParameterBlock(pose.values.data(), 6);
+  problem.AddParameterBlock(angle_axis.data(), 3);
+  problem.AddParameterBlock(masked_angle_axis.data(), 3);
+
+  // The additive update does not set a parameterization
+  setPose6dParameterization(problem, pose.values.data(), PoseParameterization::ANGLE_AXIS);
+  EXPECT_EQ(problem.GetParameterization(pose.values.data()), nullptr);
+
+  setPose6dParameterization(problem, pose.values.data(), PoseParameterization::MANIFOLD);
+  EXPECT_NE(problem.GetParameterization(pose.values.data()), nullptr);
+  EXPECT_EQ(problem.ParameterBlockLocalSize(pose.values.data()), 6);
+
+  // Angle-axis blocks with masked elements are left to the subset parameterization
+  std::map<const double*, std::vector<int>> masks;
+  masks[masked_angle_axis.data()] = { 0 };
+  setAngleAxisParameterization(problem, { angle_axis.data(), masked_angle_axis.data() }, masks,
+                               PoseParameterization::MANIFOLD);
+  EXPECT_NE(problem.GetParameterization(angle_axis.data()), nullptr);
+  EXPECT_EQ(problem.GetParameterization(masked_angle_axis.data()), nullptr);
+
+  EXPECT_NO_THROW(addSubsetParameterization(problem, masks));
+  EXPECT_EQ(problem.ParameterBlockLocalSize(masked_angle_axis.data()), 2);
+
+  // Blocks that are not in the problem are ignored
+  Pose6d unused;
+  EXPECT_NO_THROW(setPose6dParameterization(problem, unused.values.data(), PoseParameterization::MANIFOLD));
+}
+
 int main(int argc, char **argv)
 {
   testing::InitGoogleTest(&argc, argv);
@@ -0,0 +1,142 @@
+#include <rct_optimizations/observation_selection.h>
+#include <rct_optimizations/extrinsic_hand_eye.h>
+
+// Test utilities
+#include <rct_optimizations_tests/utilities.h>
+#include <rct_optimizations_tests/observation_creator.h>
+#include <rct_optimizations_tests/pose_generator.h>
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <memory>
+
+using namespace rct_optimizations;
+
+TEST(ObservationSelectionTest, RedundantObservations)
+{
+  // Many redundant observations of the first parameter, and a single observation of each of the others
+  std::vector<Eigen::MatrixXd> jacobians;
+  for (std::size_t i = 0; i < 10; ++i)
+    jacobians.push_back(Eigen::RowVector3d(1.0, 0.0, 0.0));
+  jacobians.push_back(Eigen::RowVector3d(0.0, 1.0, 0.0));
+  jacobians.push_back(Eigen::RowVector3d(0.0, 0.0, 1.0));
+
+  // The first selections should cover every parameter once
+  ObservationSelectionOptions options;
+  options.max_observations = 3;
+  options.min_uncertainty_reduction = 0.0;
+  ObservationSelectionResult result = selectObservations(jacobians, options);
+  ASSERT_EQ(result.selected_observations.size(), 3);
+  ASSERT_EQ(result.efficiency.size(), 3);
+  EXPECT_NE(std::find(result.selected_observations.begin(), result.selected_observations.end(), 10),
+            result.selected_observations.end());
+  EXPECT_NE(std::find(result.selected_observations.begin(), result.selected_observations.end(), 11),
+            result.selected_observations.end());
+  EXPECT_TRUE(std::is_sorted(result.efficiency.begin(), result.efficiency.end()));
+
+  // The efficiency reaches 1 with all of the observations
+  options.max_observations = 0;
+  result = selectObservations(jacobians, options);
+  EXPECT_EQ(result.selected_observations.size(), jacobians.size());
+  EXPECT_NEAR(result.efficiency.back(), 1.0, 1.0e-9);
+
+  // The selection stops once the target efficiency is reached: a third of the information of the first parameter is
+  // enough for an efficiency of (1/3)^(1/3) ~= 0.69
+  options.min_efficiency = 0.65;
+  result = selectObservations(jacobians, options);
+  EXPECT_GE(result.efficiency.back(), options.min_efficiency);
+  EXPECT_LT(result.selected_observations.size(), 7);
+
+  // A prior on the first parameter makes its observations unnecessary
+  Eigen::MatrixXd prior = Eigen::MatrixXd::Zero(3, 3);
+  prior(0, 0) = 1.0e6;
+  options.max_observations = 2;
+  result = selectObservations(jacobians, options, prior);
+  ASSERT_EQ(result.selected_observations.size(), 2);
+  EXPECT_GE(*std::min_element(result.selected_observations.begin(), result.selected_observations.end()), 10);
+
+  // The Jacobians must all have the same number of columns
+  jacobians.push_back(Eigen::RowVector2d(1.0, 0.0));
+  EXPECT_THROW(selectObservations(jacobians, options), OptimizationException);
+}
+
+TEST(ObservationSelectionTest, UncertaintyReduction)
+{
+  // Many redundant observations of the first parameter, and a single observation of each of the others
+  std::vector<Eigen::MatrixXd> jacobians;
+  for (std::size_t i = 0; i < 10; ++i)
+    jacobians.push_back(Eigen::RowVector3d(1.0, 0.0, 0.0));
+  jacobians.push_back(Eigen::RowVector3d(0.0, 1.0, 0.0));
+  jacobians.push_back(Eigen::RowVector3d(0.0, 0.0, 1.0));
+
+  // Without a minimum reduction of the uncertainty, the default options select every observation
+  ObservationSelectionOptions options;
+  options.min_uncertainty_reduction = 0.0;
+  ObservationSelectionResult result = selectObservations(jacobians, options);
+  EXPECT_EQ(result.selected_observations.size(), jacobians.size());
+
+  /* The selection stops once the next observation reduces the uncertainty too little: the second, third and fourth
+   * observations of the first parameter reduce its standard deviation by factors of 2^(1/2), (3/2)^(1/2) and (4/3)^(1/2),
+   * i.e. the geometric mean of the standard deviations by 11%, 6.5% and 4.7% */
+  options.min_uncertainty_reduction = 0.05;
+  result = selectObservations(jacobians, options);
+  EXPECT_EQ(result.selected_observations.size(), 5);
+
+  // The maximum number of observations still applies
+  options.max_observations = 4;
+  result = selectObservations(jacobians, options);
+  EXPECT_EQ(result.selected_observations.size(), 4);
+}
+
+TEST(ObservationSelectionTest, HandEye)
+{
+  Eigen::Isometry3d true_target_mount_to_target(Eigen::Isometry3d::Identity());
+  true_target_mount_to_target.translate(Eigen::Vector3d(1.0, 0, 0.0));
+
+  Eigen::Isometry3d true_camera_mount_to_camera(Eigen::Isometry3d::Identity());
+  true_camera_mount_to_camera.translation() = Eigen::Vector3d(0.05, 0, 0.1);
+  true_camera_mount_to_camera.linear() << 0, 0, 1, -1, 0, 0, 0, -1, 0;
+
+  test::Camera camera = test::makeKinectCamera();
+  std::vector<std::shared_ptr<test::PoseGenerator>> pose_generators = {
+    std::make_shared<test::HemispherePoseGenerator>()
+  };
+
+  ExtrinsicHandEyeProblem2D3D problem;
+  problem.intr = camera.intr;
+  problem.target_mount_to_target_guess = true_target_mount_to_target;
+  problem.camera_mount_to_camera_guess = true_camera_mount_to_camera;
+  problem.observations = test::createObservations(camera,
+                                                  test::Target(5, 7, 0.025),
+                                                  pose_generators,
+                                                  true_target_mount_to_target,
+                                                  true_camera_mount_to_camera);
+
+  ObservationSelectionOptions options;
+  options.min_uncertainty_reduction = 0.05;
+  const ObservationSelectionResult selection = selectObservations(problem, options);
+
+  // Once all of the parameters are constrained, further observations are redundant
+  ASSERT_FALSE(selection.selected_observations.empty());
+  EXPECT_LT(selection.selected_observations.size(), problem.observations.size() / 2);
+  EXPECT_TRUE(std::is_sorted(selection.efficiency.begin(), selection.efficiency.end()));
+
+  // The selected observations should be sufficient to solve the calibration
+  ExtrinsicHandEyeProblem2D3D subset(problem);
+  subset.observations.clear();
+  for (const std::size_t i : selection.selected_observations)
+    subset.observations.push_back(problem.observations[i]);
+  subset.target_mount_to_target_guess = test::perturbPose(true_target_mount_to_target, 0.01, 0.05);
+  subset.camera_mount_to_camera_guess = test::perturbPose(true_camera_mount_to_camera, 0.01, 0.05);
+
+  const ExtrinsicHandEyeResult result = optimize(subset);
+  EXPECT_TRUE(result.converged);
+  EXPECT_TRUE(result.target_mount_to_target.isApprox(true_target_mount_to_target, 1e-6));
+  EXPECT_TRUE(result.camera_mount_to_camera.isApprox(true_camera_mount_to_camera, 1e-6));
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
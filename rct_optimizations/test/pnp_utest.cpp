@@ -4,6 +4,7 @@
 #include <rct_optimizations/pnp.h>
 #include <rct_optimizations_tests/observation_creator.h>
 #include <rct_optimizations_tests/utilities.h>
+#include <random>
 
 using namespace rct_optimizations;
 
@@ -142,6 +143,126 @@ TEST_F(PnP2DTest, BadIntrinsicParameters)
   std::cout << result.covariance.toString() << std::endl;
 }
 
+TEST_F(PnP2DTest, PlanarPoseClosedForm)
+{
+  Correspondence2D3D::Set correspondences = test::getCorrespondences(target_to_camera,
+                                                                     Eigen::Isometry3d::Identity(),
+                                                                     camera,
+                                                                     target,
+                                                                     true);
+
+  // The closed-form solution should be exact for noise-free observations
+  Eigen::Isometry3d camera_to_target = estimatePlanarPose(camera.intr, correspondences);
+  EXPECT_TRUE(camera_to_target.isApprox(target_to_camera.inverse(), 1.0e-6));
+
+  // The target points do not need to lie in the x-y plane of the target frame
+  const Eigen::Isometry3d plane_offset = test::perturbPose(Eigen::Isometry3d::Identity(), 0.1, 1.0);
+  Correspondence2D3D::Set offset_correspondences(correspondences);
+  for (Correspondence2D3D& corr : offset_correspondences)
+    corr.in_target = plane_offset * corr.in_target;
+
+  camera_to_target = estimatePlanarPose(camera.intr, offset_correspondences);
+  EXPECT_TRUE(camera_to_target.isApprox(target_to_camera.inverse() * plane_offset.inverse(), 1.0e-6));
+
+  // Use the closed-form solution as the initial guess of the optimization
+  PnPProblem problem;
+  problem.intr = camera.intr;
+  problem.correspondences = correspondences;
+  problem.camera_to_target_guess = estimatePlanarPose(camera.intr, correspondences);
+  PnPResult result = optimize(problem);
+  EXPECT_TRUE(result.converged);
+  EXPECT_TRUE(result.camera_to_target.isApprox(target_to_camera.inverse()));
+
+  // Too few correspondences
+  EXPECT_THROW(estimatePlanarPose(camera.intr, Correspondence2D3D::Set(correspondences.begin(), correspondences.begin() + 3)),
+               std::runtime_error);
+
+  // Non-planar target points
+  Correspondence2D3D::Set non_planar(correspondences);
+  for (std::size_t i = 0; i < non_planar.size(); i += 2)
+    non_planar[i].in_target.z() += 0.05;
+  EXPECT_THROW(estimatePlanarPose(camera.intr, non_planar), std::runtime_error);
+}
+
+TEST_F(PnP2DTest, ClosedFormGuess)
+{
+  PnPProblem problem;
+  problem.intr = camera.intr;
+  problem.correspondences = test::getCorrespondences(target_to_camera,
+                                                     Eigen::Isometry3d::Identity(),
+                                                     camera,
+                                                     target,
+                                                     true);
+
+  // The identity guess (with the target in the plane of the camera) should be ignored
+  problem.use_closed_form_guess = true;
+  PnPResult result = optimize(problem);
+  EXPECT_TRUE(result.converged);
+  EXPECT_TRUE(result.camera_to_target.isApprox(target_to_camera.inverse()));
+  EXPECT_LT(result.final_cost_per_obs, 1.0e-15);
+
+  // Return the closed-form estimate without refinement
+  problem.max_refinement_iterations = 0;
+  result = optimize(problem);
+  EXPECT_TRUE(result.converged);
+  EXPECT_TRUE(result.camera_to_target.isApprox(estimatePlanarPose(camera.intr, problem.correspondences)));
+  EXPECT_DOUBLE_EQ(result.initial_cost_per_obs, result.final_cost_per_obs);
+  EXPECT_LT(result.final_cost_per_obs, 1.0e-10);
+}
+
+TEST_F(PnP2DTest, Batch)
+{
+  PnPProblem problem;
+  problem.intr = camera.intr;
+  problem.correspondences = test::getCorrespondences(target_to_camera,
+                                                     Eigen::Isometry3d::Identity(),
+                                                     camera,
+                                                     target,
+                                                     true);
+
+  // Create problems with different guesses and noisy observations
+  std::mt19937 mt_rand(RCT_RANDOM_SEED);
+  std::normal_distribution<double> dist(0.0, 0.5);
+  std::vector<PnPProblem> problems;
+  for (std::size_t i = 0; i < N_RANDOM_SAMPLES; ++i)
+  {
+    PnPProblem noisy_problem(problem);
+    for (Correspondence2D3D& corr : noisy_problem.correspondences)
+      corr.in_image += Eigen::Vector2d(dist(mt_rand), dist(mt_rand));
+
+    noisy_problem.camera_to_target_guess = target_to_camera.inverse()
+                                           * Eigen::Translation3d(0.01 * dist(mt_rand), 0.01 * dist(mt_rand), 0.01 * dist(mt_rand))
+                                           * Eigen::AngleAxisd(0.05 * dist(mt_rand), Eigen::Vector3d::UnitZ());
+    problems.push_back(noisy_problem);
+  }
+
+  // A problem that cannot be solved should not prevent the others from being solved
+  PnPProblem bad_problem(problem);
+  bad_problem.correspondences.resize(3);
+  bad_problem.use_closed_form_guess = true;
+  problems.push_back(bad_problem);
+
+  const std::vector<PnPResult> results = optimizeBatch(problems);
+  ASSERT_EQ(results.size(), problems.size());
+  EXPECT_FALSE(results.back().converged);
+
+  // The results should match the results of the Ceres optimization
+  for (std::size_t i = 0; i < N_RANDOM_SAMPLES; ++i)
+  {
+    const PnPResult expected = optimize(problems[i]);
+    EXPECT_TRUE(results[i].converged);
+    EXPECT_TRUE(results[i].camera_to_target.isApprox(expected.camera_to_target, 1.0e-6));
+    EXPECT_NEAR(results[i].initial_cost_per_obs, expected.initial_cost_per_obs, 1.0e-6 * expected.initial_cost_per_obs);
+    EXPECT_NEAR(results[i].final_cost_per_obs, expected.final_cost_per_obs, 1.0e-3 * expected.final_cost_per_obs);
+    EXPECT_TRUE(results[i].covariance.covariance_matrix.isApprox(expected.covariance.covariance_matrix, 1.0e-3));
+  }
+
+  // The results should not depend on the number of threads
+  const std::vector<PnPResult> serial_results = optimizeBatch(problems, 1);
+  for (std::size_t i = 0; i < N_RANDOM_SAMPLES; ++i)
+    EXPECT_TRUE(serial_results[i].camera_to_target.isApprox(results[i].camera_to_target));
+}
+
 class PnP3DTest : public ::testing::Test
 {
   public:
@@ -191,6 +312,10 @@ TEST_F(PnP3DTest, PerturbedInitialCondition)
   ba::accumulator_set<double, ba::features<ba::stats<ba::tag::mean, ba::tag::variance>>> pos_acc;
   ba::accumulator_set<double, ba::features<ba::stats<ba::tag::mean, ba::tag::variance>>> ori_acc;
 
+  // Refine the perturbed guess rather than using the closed-form solution
+  problem.use_closed_form_guess = false;
+  problem.max_refinement_iterations = 50;
+
   for (std::size_t i = 0; i < N_RANDOM_SAMPLES; ++i)
   {
     problem.camera_to_target_guess = test::perturbPose(target_to_camera.inverse(), 0.05, 0.05);
@@ -214,6 +339,45 @@ TEST_F(PnP3DTest, PerturbedInitialCondition)
   EXPECT_LT(ba::mean(residual_acc) + 3 * std::sqrt(ba::variance(residual_acc)), 1.0e-10);
 }
 
+TEST_F(PnP3DTest, ClosedForm)
+{
+  PnPProblem3D problem;
+  problem.correspondences = test::getCorrespondences(target_to_camera, Eigen::Isometry3d::Identity(), target);
+
+  // The closed-form solution should not depend on the guess
+  problem.camera_to_target_guess = test::perturbPose(target_to_camera.inverse(), 0.5, 1.0);
+  PnPResult result = optimize(problem);
+  EXPECT_TRUE(result.converged);
+  EXPECT_TRUE(result.camera_to_target.isApprox(target_to_camera.inverse()));
+  EXPECT_LT(result.final_cost_per_obs, 1.0e-15);
+  checkCorrelation(result.covariance.correlation_matrix);
+
+  // The covariance should match the covariance computed by Ceres
+  problem.max_refinement_iterations = 10;
+  PnPResult refined_result = optimize(problem);
+  EXPECT_TRUE(refined_result.camera_to_target.isApprox(result.camera_to_target));
+  EXPECT_TRUE(refined_result.covariance.covariance_matrix.isApprox(result.covariance.covariance_matrix, 1.0e-6));
+  problem.max_refinement_iterations = 0;
+
+  // Corrupt one correspondence and exclude it with a weight of zero
+  problem.weights.assign(problem.correspondences.size(), 2.0);
+  problem.correspondences.front().in_image += Eigen::Vector3d(0.1, -0.1, 0.1);
+  problem.weights.front() = 0.0;
+  result = optimize(problem);
+  EXPECT_TRUE(result.camera_to_target.isApprox(target_to_camera.inverse()));
+  EXPECT_LT(result.final_cost_per_obs, 1.0e-15);
+
+  // Mismatched weights
+  problem.weights.pop_back();
+  EXPECT_THROW(optimize(problem), std::runtime_error);
+
+  // Points on a line do not determine the pose
+  Correspondence3D3D::Set line;
+  for (std::size_t i = 0; i < TARGET_COLS; ++i)
+    line.push_back(problem.correspondences[i]);
+  EXPECT_THROW(estimatePose3D(line), std::runtime_error);
+}
+
 int main(int argc, char **argv)
 {
   testing::InitGoogleTest(&argc, argv);
@@ -0,0 +1,136 @@
+/**
+ * Benchmark comparing the additive angle-axis update of the pose parameters with the update on SO(3) of @ref Pose6dPlus
+ * (see @ref PoseParameterization). The test problem is the 3D hand-eye calibration of @ref ExtrinsicHandEyeProblem3D3D,
+ * solved from guesses whose orientations are increasingly far from the truth. For each orientation error, the benchmark
+ * reports the mean number of solver iterations and solve time, and the fraction of the trials that reach the true solution
+ */
+#include <rct_optimizations/eigen_conversions.h>
+#include <rct_optimizations/image_observation_cost.h>
+#include <rct_optimizations/local_parameterization.h>
+
+#include <ceres/ceres.h>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace rct_optimizations;
+
+struct Statistics
+{
+  double iterations = 0.0;
+  double milliseconds = 0.0;
+  std::size_t successes = 0;
+};
+
+/** @brief Uniformly distributed random rotation of a given angle */
+Eigen::AngleAxisd randomRotation(std::mt19937& mt_rand, const double angle)
+{
+  std::normal_distribution<double> dist;
+  Eigen::Vector3d axis(dist(mt_rand), dist(mt_rand), dist(mt_rand));
+  return Eigen::AngleAxisd(angle, axis.normalized());
+}
+
+/** @brief Uniformly distributed random pose, with a translation within 1 m of the origin */
+Eigen::Isometry3d randomPose(std::mt19937& mt_rand)
+{
+  std::uniform_real_distribution<double> angle_dist(0.0, M_PI);
+  std::uniform_real_distribution<double> translation_dist(-1.0, 1.0);
+
+  Eigen::Isometry3d pose(randomRotation(mt_rand, angle_dist(mt_rand)));
+  pose.translation() = Eigen::Vector3d(translation_dist(mt_rand), translation_dist(mt_rand), translation_dist(mt_rand));
+  return pose;
+}
+
+/**
+ * @brief Solves a random hand-eye calibration from guesses whose orientations are rotated by the input angle from the truth
+ * and accumulates the solver statistics
+ */
+void solve(std::mt19937& mt_rand,
+           const double angle_error,
+           const std::size_t n_observations,
+           const PoseParameterization parameterization,
+           Statistics& stats)
+{
+  const Eigen::Isometry3d camera_to_camera_mount = randomPose(mt_rand);
+  const Eigen::Isometry3d target_mount_to_target = randomPose(mt_rand);
+
+  // A grid of target features
+  std::vector<Eigen::Vector3d> target_points;
+  for (int i = 0; i < 5; ++i)
+    for (int j = 0; j < 5; ++j)
+      target_points.emplace_back(0.05 * i, 0.05 * j, 0.0);
+
+  Pose6d internal_camera_to_camera_mount =
+      poseEigenToCal(camera_to_camera_mount * randomRotation(mt_rand, angle_error));
+  Pose6d internal_target_mount_to_target =
+      poseEigenToCal(target_mount_to_target * randomRotation(mt_rand, angle_error));
+
+  ceres::Problem problem;
+  for (std::size_t i = 0; i < n_observations; ++i)
+  {
+    const Eigen::Isometry3d camera_mount_to_target_mount = randomPose(mt_rand);
+    const Eigen::Isometry3d camera_to_target = camera_to_camera_mount * camera_mount_to_target_mount
+                                               * target_mount_to_target;
+
+    Correspondence3D3D::Set correspondences;
+    for (const Eigen::Vector3d& point : target_points)
+      correspondences.emplace_back(camera_to_target * point, point);
+
+    auto* cost_block = new AnalyticImageObservationCost<3>(correspondences,
+                                                           Eigen::Isometry3d::Identity(),
+                                                           camera_mount_to_target_mount);
+    problem.AddResidualBlock(cost_block, nullptr, internal_camera_to_camera_mount.values.data(),
+                             internal_target_mount_to_target.values.data());
+  }
+
+  setPose6dParameterization(problem, internal_camera_to_camera_mount.values.data(), parameterization);
+  setPose6dParameterization(problem, internal_target_mount_to_target.values.data(), parameterization);
+
+  ceres::Solver::Options options = DefaultSolverOptions();
+  ceres::Solver::Summary summary;
+
+  const auto start = std::chrono::steady_clock::now();
+  ceres::Solve(options, &problem, &summary);
+  const auto end = std::chrono::steady_clock::now();
+
+  stats.iterations += static_cast<double>(summary.iterations.size() - 1);
+  stats.milliseconds += std::chrono::duration<double, std::milli>(end - start).count();
+
+  if (poseCalToEigen(internal_camera_to_camera_mount).isApprox(camera_to_camera_mount, 1.0e-6) &&
+      poseCalToEigen(internal_target_mount_to_target).isApprox(target_mount_to_target, 1.0e-6))
+    ++stats.successes;
+}
+
+int main(int argc, char **argv)
+{
+  const std::size_t n_trials = argc > 1 ? std::stoul(argv[1]) : 100;
+  const std::size_t n_observations = argc > 2 ? std::stoul(argv[2]) : 10;
+
+  std::cout << "Hand-eye calibration: " << n_observations << " observations, " << n_trials << " trials" << std::endl;
+  std::cout << "Orientation error | Angle-axis: iterations, ms, success | Manifold: iterations, ms, success" << std::endl;
+
+  for (const double degrees : { 10.0, 45.0, 90.0, 135.0, 170.0 })
+  {
+    // The same random problems are solved with both parameterizations
+    Statistics angle_axis, manifold;
+    std::mt19937 angle_axis_rand(0);
+    std::mt19937 manifold_rand(0);
+    for (std::size_t i = 0; i < n_trials; ++i)
+    {
+      solve(angle_axis_rand, degrees * M_PI / 180.0, n_observations, PoseParameterization::ANGLE_AXIS, angle_axis);
+      solve(manifold_rand, degrees * M_PI / 180.0, n_observations, PoseParameterization::MANIFOLD, manifold);
+    }
+
+    const double n = static_cast<double>(n_trials);
+    std::cout << "  " << degrees << " deg"
+              << " | " << angle_axis.iterations / n << ", " << angle_axis.milliseconds / n << ", "
+              << static_cast<double>(angle_axis.successes) / n
+              << " | " << manifold.iterations / n << ", " << manifold.milliseconds / n << ", "
+              << static_cast<double>(manifold.successes) / n << std::endl;
+  }
+
+  return 0;
+}
@@ -0,0 +1,75 @@
+#include <rct_optimizations/pose_planner.h>
+
+// Test utilities
+#include <rct_optimizations_tests/utilities.h>
+#include <rct_optimizations_tests/observation_creator.h>
+#include <rct_optimizations_tests/pose_generator.h>
+
+#include <gtest/gtest.h>
+#include <memory>
+
+using namespace rct_optimizations;
+
+TEST(PosePlannerTest, HandEye)
+{
+  Eigen::Isometry3d true_target_mount_to_target(Eigen::Isometry3d::Identity());
+  true_target_mount_to_target.translate(Eigen::Vector3d(1.0, 0, 0.0));
+
+  Eigen::Isometry3d true_camera_mount_to_camera(Eigen::Isometry3d::Identity());
+  true_camera_mount_to_camera.translation() = Eigen::Vector3d(0.05, 0, 0.1);
+  true_camera_mount_to_camera.linear() << 0, 0, 1, -1, 0, 0, 0, -1, 0;
+
+  const test::Camera camera = test::makeKinectCamera();
+  const test::Target target(5, 7, 0.025);
+
+  ExtrinsicHandEyeProblem2D3D problem;
+  problem.intr = camera.intr;
+  problem.target_mount_to_target_guess = true_target_mount_to_target;
+  problem.camera_mount_to_camera_guess = true_camera_mount_to_camera;
+
+  // Candidate poses of the camera around a static target
+  std::vector<PoseCandidate> candidates;
+  for (const Eigen::Isometry3d& target_to_camera : test::HemispherePoseGenerator().generate(true_target_mount_to_target))
+  {
+    PoseCandidate candidate;
+    candidate.to_camera_mount = true_target_mount_to_target * target_to_camera * true_camera_mount_to_camera.inverse();
+    candidates.push_back(candidate);
+  }
+
+  // Candidates from which the camera faces away from the target should never be selected
+  const std::size_t n_visible = candidates.size();
+  for (std::size_t i = 0; i < 5; ++i)
+  {
+    PoseCandidate candidate = candidates[i];
+    candidate.to_camera_mount = candidate.to_camera_mount * true_camera_mount_to_camera
+                                * Eigen::AngleAxisd(M_PI, Eigen::Vector3d::UnitX())
+                                * true_camera_mount_to_camera.inverse();
+    candidates.push_back(candidate);
+  }
+
+  PosePlannerOptions options;
+  options.min_uncertainty_reduction = 0.05;
+  options.image_width = static_cast<unsigned>(camera.width);
+  options.image_height = static_cast<unsigned>(camera.height);
+  const ObservationSelectionResult plan = planPoses(problem, target.points, candidates, options);
+
+  ASSERT_FALSE(plan.selected_observations.empty());
+  EXPECT_LT(plan.selected_observations.size(), n_visible / 2);
+  for (const std::size_t i : plan.selected_observations)
+    EXPECT_LT(i, n_visible);
+
+  // Observations that have already been collected at all of the candidate poses leave little to be gained from them
+  problem.observations = test::createObservations(camera,
+                                                  target,
+                                                  { std::make_shared<test::HemispherePoseGenerator>() },
+                                                  true_target_mount_to_target,
+                                                  true_camera_mount_to_camera);
+  const ObservationSelectionResult replan = planPoses(problem, target.points, candidates, options);
+  EXPECT_LT(replan.selected_observations.size(), plan.selected_observations.size());
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,124 @@
+#include <rct_optimizations/solver_options.h>
+
+#include <ceres/ceres.h>
+#include <gtest/gtest.h>
+
+using namespace rct_optimizations;
+
+/**
+ * @brief Cost with a configurable number of residuals that depends on a "local" parameter block of size 6 and a "shared"
+ * parameter block of size 4
+ */
+struct CoupledCost
+{
+  template<typename T>
+  bool operator()(const T* const local, const T* const shared, T* residual) const
+  {
+    for (int i = 0; i < num_residuals; ++i)
+      residual[i] = local[i % 6] - shared[i % 4] + T(i);
+    return true;
+  }
+
+  int num_residuals;
+};
+
+void addCoupledResidual(ceres::Problem& problem, double* local, double* shared, const int num_residuals)
+{
+  auto* cost = new ceres::AutoDiffCostFunction<CoupledCost, ceres::DYNAMIC, 6, 4>(new CoupledCost{ num_residuals },
+                                                                                   num_residuals);
+  problem.AddResidualBlock(cost, nullptr, local, shared);
+}
+
+TEST(SolverOptionsTest, ManualProfile)
+{
+  std::vector<double> local(6, 0.0), shared(4, 0.0);
+  ceres::Problem problem;
+  addCoupledResidual(problem, local.data(), shared.data(), 10);
+
+  ceres::Solver::Options options = DefaultSolverOptions(42);
+  options.linear_solver_type = ceres::CGNR;
+  options.num_threads = 3;
+
+  const ceres::Solver::Options out = configureSolverOptions(problem, options, SolverProfile::MANUAL);
+  EXPECT_EQ(out.max_num_iterations, 42);
+  EXPECT_EQ(out.linear_solver_type, ceres::CGNR);
+  EXPECT_EQ(out.num_threads, 3);
+}
+
+TEST(SolverOptionsTest, SmallProblem)
+{
+  // A small problem without an elimination structure should be solved densely on a single thread
+  std::vector<double> local(6, 0.0), shared(4, 0.0);
+  ceres::Problem problem;
+  addCoupledResidual(problem, local.data(), shared.data(), 100);
+  addCoupledResidual(problem, local.data(), shared.data(), 100);
+
+  ceres::Solver::Options options = DefaultSolverOptions();
+  options.num_threads = 8;
+
+  const ceres::Solver::Options out = configureSolverOptions(problem, options, SolverProfile::AUTOMATIC, 8);
+  EXPECT_EQ(out.max_num_iterations, 150);
+  EXPECT_EQ(out.linear_solver_type, ceres::DENSE_QR);
+  EXPECT_EQ(out.num_threads, 1);
+  EXPECT_EQ(out.linear_solver_ordering, nullptr);
+}
+
+TEST(SolverOptionsTest, SchurElimination)
+{
+  // Many local blocks that each depend on a shared block (i.e. a bundle adjustment problem) should be solved by
+  // eliminating the local blocks
+  const std::size_t n = 20;
+  std::vector<std::vector<double>> local(n, std::vector<double>(6, 0.0));
+  std::vector<double> shared(4, 0.0);
+
+  ceres::Problem problem;
+  for (std::size_t i = 0; i < n; ++i)
+  {
+    // Split the residuals of each local block across several residual blocks
+    addCoupledResidual(problem, local[i].data(), shared.data(), 10);
+    addCoupledResidual(problem, local[i].data(), shared.data(), 10);
+  }
+
+  ceres::Solver::Options out = configureSolverOptions(problem, DefaultSolverOptions());
+  EXPECT_EQ(out.linear_solver_type, ceres::DENSE_SCHUR);
+  ASSERT_NE(out.linear_solver_ordering, nullptr);
+  EXPECT_EQ(out.linear_solver_ordering->NumGroups(), 2);
+  EXPECT_EQ(out.linear_solver_ordering->GroupSize(0), static_cast<int>(n));
+  EXPECT_EQ(out.linear_solver_ordering->GroupId(shared.data()), 1);
+  for (std::size_t i = 0; i < n; ++i)
+    EXPECT_EQ(out.linear_solver_ordering->GroupId(local[i].data()), 0);
+
+  // Blocks held constant are not part of the linear system: the remaining local blocks are independent and can be solved
+  // directly
+  problem.SetParameterBlockConstant(shared.data());
+  out = configureSolverOptions(problem, DefaultSolverOptions());
+  EXPECT_EQ(out.linear_solver_type, ceres::DENSE_QR);
+  EXPECT_EQ(out.linear_solver_ordering, nullptr);
+}
+
+TEST(SolverOptionsTest, Threads)
+{
+  const std::size_t n = 8;
+  std::vector<std::vector<double>> local(n, std::vector<double>(6, 0.0));
+  std::vector<double> shared(4, 0.0);
+
+  ceres::Problem problem;
+  for (std::size_t i = 0; i < n; ++i)
+    addCoupledResidual(problem, local[i].data(), shared.data(), 2000);
+
+  // The number of threads is limited by the maximum number of threads...
+  EXPECT_EQ(configureSolverOptions(problem, DefaultSolverOptions(), SolverProfile::AUTOMATIC, 4).num_threads, 4);
+
+  // ...and by the number of residual blocks
+  EXPECT_EQ(configureSolverOptions(problem, DefaultSolverOptions(), SolverProfile::AUTOMATIC, 16).num_threads,
+            static_cast<int>(n));
+
+  // A value of 0 selects the number of hardware threads
+  EXPECT_GE(configureSolverOptions(problem, DefaultSolverOptions(), SolverProfile::AUTOMATIC, 0).num_threads, 1);
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
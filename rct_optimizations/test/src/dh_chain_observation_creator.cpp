@@ -1,5 +1,6 @@
 #include <rct_optimizations_tests/dh_chain_observation_creator.h>
 #include <rct_optimizations_tests/observation_creator.h>
+#include <rct_optimizations/parallel.h>
 
 namespace rct_optimizations
 {
@@ -13,14 +14,16 @@ KinObservation3D3D::Set createKinematicObservations(const DHChain &to_camera_cha
                                                     const Target &target,
                                                     const std::size_t n)
 {
-  KinObservation3D3D::Set observations;
-  observations.reserve(n);
+  // Draw the poses from the random streams of the chains, so that subsequent calls create different observations
+  const std::vector<Eigen::VectorXd> camera_chain_poses = to_camera_chain.createUniformlyRandomPoses(n);
+  const std::vector<Eigen::VectorXd> target_chain_poses = to_target_chain.createUniformlyRandomPoses(n);
 
-  for (std::size_t i = 0; i < n; ++i)
-  {
-    KinObservation3D3D obs;
-    obs.camera_chain_joints = to_camera_chain.createUniformlyRandomPose();
-    obs.target_chain_joints = to_target_chain.createUniformlyRandomPose();
+  // Each observation only depends on its poses, so the set can be created in parallel
+  KinObservation3D3D::Set observations(n);
+  parallelFor(n, [&](const std::size_t i) {
+    KinObservation3D3D& obs = observations[i];
+    obs.camera_chain_joints = camera_chain_poses[i];
+    obs.target_chain_joints = target_chain_poses[i];
 
     Eigen::Isometry3d to_camera_mount = to_camera_chain.getFK<double>(obs.camera_chain_joints);
     Eigen::Isometry3d to_target_mount = to_target_chain.getFK<double>(obs.target_chain_joints);
@@ -28,8 +31,7 @@ KinObservation3D3D::Set createKinematicObservations(const DHChain &to_camera_cha
     obs.correspondence_set = getCorrespondences(to_camera_mount * true_mount_to_camera,
                                                 camera_base_to_target_base * to_target_mount * true_mount_to_target,
                                                 target);
-    observations.push_back(obs);
-  }
+  });
 
   return observations;
 }
@@ -86,6 +88,7 @@ KinObservation2D3D::Set createKinematicObservations(const DHChain &to_camera_cha
     KinObservation2D3D obs;
     obs.camera_chain_joints = to_camera_chain.createUniformlyRandomPose();
     obs.target_chain_joints = to_target_chain.createUniformlyRandomPose();
+    ++attempts;
 
     Eigen::Isometry3d to_camera_mount = to_camera_chain.getFK(obs.camera_chain_joints);
     Eigen::Isometry3d to_target_mount = to_target_chain.getFK(obs.target_chain_joints);
@@ -120,8 +123,6 @@ KinObservation2D3D::Set createKinematicObservations(const DHChain &to_camera_cha
         correspondences += obs.correspondence_set.size();
       }
     }
-
-    ++attempts;
   }
 
   if (attempts > max_attempts || correspondences < n * target.points.size())
@@ -177,14 +178,15 @@ KinematicMeasurement::Set createKinematicMeasurements(
   const Eigen::Isometry3d &camera_base_to_target_base,
   const std::size_t n)
 {
-  KinematicMeasurement::Set measurements;
-  measurements.reserve(n);
+  // Draw the poses from the random streams of the chains, so that subsequent calls create different measurements
+  const std::vector<Eigen::VectorXd> camera_chain_poses = to_camera_chain.createUniformlyRandomPoses(n);
+  const std::vector<Eigen::VectorXd> target_chain_poses = to_target_chain.createUniformlyRandomPoses(n);
 
-  for (std::size_t i = 0; i < n; ++i)
-  {
-    KinematicMeasurement m;
-    m.camera_chain_joints = to_camera_chain.createUniformlyRandomPose();
-    m.target_chain_joints = to_target_chain.createUniformlyRandomPose();
+  KinematicMeasurement::Set measurements(n);
+  parallelFor(n, [&](const std::size_t i) {
+    KinematicMeasurement& m = measurements[i];
+    m.camera_chain_joints = camera_chain_poses[i];
+    m.target_chain_joints = target_chain_poses[i];
 
     const Eigen::Isometry3d camera_base_to_camera = to_camera_chain.getFK(m.camera_chain_joints)
                                                     * true_mount_to_camera;
@@ -192,9 +194,7 @@ KinematicMeasurement::Set createKinematicMeasurements(
                                                     * to_target_chain.getFK(m.target_chain_joints)
                                                     * true_mount_to_target;
     m.camera_to_target = camera_base_to_camera.inverse() * camera_base_to_target;
-
-    measurements.push_back(m);
-  }
+  });
 
   return measurements;
 }
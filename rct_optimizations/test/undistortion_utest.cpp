@@ -0,0 +1,109 @@
+#include <rct_optimizations/camera_model.h>
+#include <rct_optimizations/undistortion.h>
+#include <rct_optimizations_tests/observation_creator.h>
+#include <rct_optimizations_tests/utilities.h>
+
+#include <gtest/gtest.h>
+
+using namespace rct_optimizations;
+
+class UndistortionTest : public ::testing::Test
+{
+public:
+  UndistortionTest()
+    : camera(test::makeKinectCamera())
+    , distortion({{-0.25, 0.08, 0.001, -0.0015, -0.01}})
+  {
+  }
+
+  /** @brief Creates a grid of undistorted normalized points whose distorted projections cover the image */
+  Eigen::Matrix2Xd createNormalizedPoints() const
+  {
+    const Eigen::Index n = 25;
+    Eigen::Matrix2Xd points(2, n * n);
+    for (Eigen::Index i = 0; i < n; ++i)
+    {
+      for (Eigen::Index j = 0; j < n; ++j)
+      {
+        points.col(i * n + j) << (static_cast<double>(i) / (n - 1) - 0.5) * camera.width / camera.intr.fx(),
+                                 (static_cast<double>(j) / (n - 1) - 0.5) * camera.height / camera.intr.fy();
+      }
+    }
+    return points;
+  }
+
+  /** @brief Distorts and projects normalized points into the image */
+  Eigen::Matrix2Xd project(const Eigen::Matrix2Xd& normalized_points) const
+  {
+    Eigen::Matrix2Xd image_points(2, normalized_points.cols());
+    for (Eigen::Index i = 0; i < normalized_points.cols(); ++i)
+    {
+      const Eigen::Vector3d p = normalized_points.col(i).homogeneous();
+      RadialTangentialModel::project(camera.intr.values.data(), distortion.data(), p.data(), image_points.col(i).data());
+    }
+    return image_points;
+  }
+
+  test::Camera camera;
+  std::array<double, 5> distortion;
+};
+
+TEST_F(UndistortionTest, UndistortPoints)
+{
+  const Eigen::Matrix2Xd expected = createNormalizedPoints();
+  const Eigen::Matrix2Xd image_points = project(expected);
+
+  // The lookup table alone should be accurate to a small fraction of a pixel
+  {
+    Undistorter undistorter(camera.intr, distortion, camera.width, camera.height, 8.0, 0);
+    const Eigen::Matrix2Xd undistorted = undistorter.undistortPoints(image_points);
+    EXPECT_LT((undistorted - expected).cwiseAbs().maxCoeff() * camera.intr.fx(), 0.05);
+  }
+
+  // With refinement, the result should be as accurate as a full iterative inversion
+  Undistorter undistorter(camera.intr, distortion, camera.width, camera.height);
+  const Eigen::Matrix2Xd undistorted = undistorter.undistortPoints(image_points);
+  EXPECT_LT((undistorted - expected).cwiseAbs().maxCoeff(), 1.0e-10);
+  EXPECT_LT((undistorter.distortPoints(undistorted) - undistorter.distortPoints(expected)).cwiseAbs().maxCoeff(), 1.0e-10);
+
+  // Single point
+  EXPECT_TRUE(undistorter.undistortPoint(image_points.col(7)).isApprox(expected.col(7), 1.0e-10));
+
+  // Invalid configurations
+  EXPECT_THROW(Undistorter(camera.intr, distortion, 0, camera.height), OptimizationException);
+  EXPECT_THROW(Undistorter(camera.intr, distortion, camera.width, camera.height, 0.0), OptimizationException);
+}
+
+TEST_F(UndistortionTest, UndistortCorrespondences)
+{
+  test::Target target(5, 7, 0.025);
+  Eigen::Isometry3d camera_to_target(Eigen::Isometry3d::Identity());
+  camera_to_target.translate(Eigen::Vector3d(0.05, -0.03, 0.4));
+  camera_to_target.rotate(Eigen::AngleAxisd(M_PI - 0.2, Eigen::Vector3d::UnitX()));
+
+  // The pin-hole correspondences are the expected result of the undistortion
+  const Correspondence2D3D::Set expected = test::getCorrespondences(Eigen::Isometry3d::Identity(),
+                                                                    camera_to_target,
+                                                                    camera,
+                                                                    target,
+                                                                    true);
+  Correspondence2D3D::Set distorted(expected);
+  for (Correspondence2D3D& corr : distorted)
+  {
+    const Eigen::Vector3d in_camera = camera_to_target * corr.in_target;
+    RadialTangentialModel::project(camera.intr.values.data(), distortion.data(), in_camera.data(), corr.in_image.data());
+  }
+
+  Undistorter undistorter(camera.intr, distortion, camera.width, camera.height);
+  const std::vector<Correspondence2D3D::Set> undistorted = undistorter.undistort(std::vector<Correspondence2D3D::Set>(2, distorted));
+  ASSERT_EQ(undistorted.size(), 2);
+  for (const Correspondence2D3D::Set& set : undistorted)
+  {
+    ASSERT_EQ(set.size(), expected.size());
+    for (std::size_t i = 0; i < set.size(); ++i)
+    {
+      EXPECT_TRUE(set[i].in_target.isApprox(expected[i].in_target));
+      EXPECT_LT((set[i].in_image - expected[i].in_image).norm(), 1.0e-7);
+    }
+  }
+}